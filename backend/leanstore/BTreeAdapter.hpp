@@ -140,10 +140,10 @@ struct BTreeVSAdapter : BTreeInterface<Key, Payload> {
       // u8 key_bytes[sizeof(Key)];
       // std::array<u8, sizeof(Key)> key_bytes;
       // size_t value_length = 0;
-      vector<KEY> output_keys;
+      vector<Key> output_keys;
       // const u8* value_ptr = nullptr;
       auto ret = btree.scanAscAll([&](const u8* key, u16 key_length, const u8* payload, u16 payload_length) {
-         output_keys.push_back(utils::u8_to<KEY>(key, key_length));
+         output_keys.push_back(utils::u8_to<Key>(key, key_length));
          return true;
       }) == OP_RESULT::OK;
       // std::cout << "Size of vector scanall: " << output_keys.size() << std::endl;
@@ -154,10 +154,10 @@ struct BTreeVSAdapter : BTreeInterface<Key, Payload> {
    bool scan_asc_all_seg() override
    {
       // u8 key_bytes[sizeof(Key)];
-      vector<KEY> output_keys;
+      vector<Key> output_keys;
 
       auto ret = btree.scanAscAllSeg([&](const u8* key, u16 key_length, const u8* payload, u16 payload_length) {
-         output_keys.push_back(utils::u8_to<KEY>(key, key_length));
+         output_keys.push_back(utils::u8_to<Key>(key, key_length));
          return true;
       }) == OP_RESULT::OK;
       // std::cout << "Size of vector: " << output_keys.size() << std::endl;
@@ -171,7 +171,7 @@ struct BTreeVSAdapter : BTreeInterface<Key, Payload> {
       // u8 key_bytes[sizeof(Key)];
       std::array<u8, sizeof(Key)> key_bytes;
       size_t value_length = 0;
-      vector<KEY> output_keys;
+      vector<Key> output_keys;
       if (rlength != 0) {
          output_keys.reserve(rlength);
       }
@@ -179,7 +179,7 @@ struct BTreeVSAdapter : BTreeInterface<Key, Payload> {
       auto ret = btree.scanAsc(
                      key_bytes.data(), fold(key_bytes.data(), k),
                      [&](const u8* key, u16 key_length, const u8* payload, u16 payload_length) {
-                        output_keys.push_back(utils::u8_to<KEY>(key, key_length));
+                        output_keys.push_back(utils::u8_to<Key>(key, key_length));
                         return true;
                      },
                      []() {}, rlength) == OP_RESULT::OK;
@@ -211,14 +211,14 @@ struct BTreeVSAdapter : BTreeInterface<Key, Payload> {
       std::array<u8, sizeof(Key)> key_bytes;
       size_t value_length = 0;
       const u8* value_ptr = nullptr;
-      std::vector<KEY> output_keys;
+      std::vector<Key> output_keys;
       if (rlength != 0) {
          output_keys.reserve(rlength);
       }
       return btree.scanAscSeg(
                  k, key_bytes.data(), fold(key_bytes.data(), k),
                  [&](const u8* key, u16 key_length, const u8* payload, u16 payload_length) {
-                    output_keys.push_back(utils::u8_to<KEY>(key, key_length));
+                    output_keys.push_back(utils::u8_to<Key>(key, key_length));
                     return true;
                  },
                  []() {}, rlength) == OP_RESULT::OK;
@@ -86,4 +86,31 @@ DEFINE_uint64(tmp, 0, "");
 DEFINE_string(attached_segments_file, "./attached_segment.bin", "");
 DEFINE_string(secondary_mapping_file, "./secondary_mapping.bin", "");
 DEFINE_string(segments_file, "./segments.bin", "");
-DEFINE_uint32(max_error, 32, "max_error of the segments");
\ No newline at end of file
+DEFINE_uint32(max_error, 32, "max_error of the segments");
+DEFINE_uint64(mapping_delta_merge_threshold, 64, "leaf splits/merges buffered before they are folded into the secondary mapping");
+DEFINE_uint32(train_threads, 1, "threads harvesting leaf separators and building the root model in fast_train, 1 keeps the sequential path");
+DEFINE_uint32(multi_get_group, 16, "keys BTreeLL::multi_get keeps in flight between its stages, at most 64");
+DEFINE_uint32(scan_prefetch_leaves, 4, "leafs the model guided scan prefetches ahead of its cursor, 0 disables it");
+DEFINE_uint32(scan_readahead_leaves, 16, "leafs the model guided scan reads ahead from SSD (libaio), 0 disables it");
+DEFINE_uint32(ut_io_depth, 64, "page reads a user thread worker keeps in flight (libaio)");
+DEFINE_string(root_model, "spline", "root model of the trees registered without their own choice: spline, linear, rmi, pla");
+DEFINE_uint64(rmi_leaf_models, 0, "leaf models of the rmi root model, 0 sizes them to the mapping");
+DEFINE_uint64(pla_recursive_error, 4, "error of the pla levels over the segments, 0 binary searches the segments instead");
+DEFINE_string(mapping_search, "simd", "last mile search in the leaf mapping of those trees: simd, exponential, binary");
+DEFINE_uint32(leaf_train_threads, 1, "threads retraining the leaf models queued by writes");
+DEFINE_uint64(leaf_train_rate, 0, "leaf models a trainer thread retrains per second at most, 0 is unlimited");
+DEFINE_bool(learned_image_verify, true, "check the section checksums of the learned index image on recovery, the header is always checked");
+DEFINE_double(warmup_fraction, 0.1, "hottest fraction of the leafs read in the background after a recovery, 0 disables the warmup");
+DEFINE_uint64(warmup_read_rate, 0, "leaf reads per second the warmup issues at most, 0 is unlimited");
+DEFINE_string(replacement_policy, "sampled", "frames the page providers cool: random, clock (second chance) or sampled (lowest sampled access count)");
+DEFINE_uint64(replacement_samples, 8, "candidates the sampled replacement policy compares per pick");
+DEFINE_string(io_engine, "libaio", "engine of the write back, read-ahead and WAL I/O: libaio or io_uring");
+DEFINE_bool(io_uring_sqpoll, false, "io_uring rings get a kernel thread polling their submissions, submits skip the system call");
+DEFINE_bool(io_uring_fixed_pool, false, "register the buffer pool with the io_uring read rings, needs it within RLIMIT_MEMLOCK for every ring");
+DEFINE_uint64(numa_slices, 1, "buffer pool slices, each bound to a NUMA node with its own partitions, free lists and page providers, 0 is one per node");
+DEFINE_uint64(alloc_magazine_size, 16, "free frames and PIDs a worker takes in one batch for allocatePage, at most 64, 0 takes them one by one");
+DEFINE_uint64(wal_pipeline_depth, 2, "group commit rounds in flight, the next round is gathered while the previous ones are written, 1 waits for each");
+DEFINE_string(wal_files, "", "comma separated files the group commit rounds are striped over, empty writes them to the end of the SSD");
+DEFINE_uint64(wal_file_gib, 16, "size of each of the wal_files, the chunks grow downwards from its end");
+DEFINE_uint64(wal_redo_batch_mib, 1024, "WAL read per redo pass on recovery, the pages of a batch are read, replayed and written back once");
+DEFINE_uint64(wal_redo_io_depth, 64, "pages every recovery worker reads and writes at once while it replays its share of a batch");
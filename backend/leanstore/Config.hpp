@@ -81,4 +81,31 @@ DECLARE_string(attached_segments_file);
 DECLARE_string(secondary_mapping_file);
 DECLARE_string(segments_file);
 // -------------------------------------------------------------------------------------
-DECLARE_uint32(max_error);
\ No newline at end of file
+DECLARE_uint32(max_error);
+DECLARE_uint64(mapping_delta_merge_threshold);
+DECLARE_uint32(train_threads);
+DECLARE_uint32(multi_get_group);
+DECLARE_uint32(scan_prefetch_leaves);
+DECLARE_uint32(scan_readahead_leaves);
+DECLARE_uint32(ut_io_depth);
+DECLARE_string(root_model);
+DECLARE_string(mapping_search);
+DECLARE_uint64(rmi_leaf_models);
+DECLARE_uint64(pla_recursive_error);
+DECLARE_uint32(leaf_train_threads);
+DECLARE_uint64(leaf_train_rate);
+DECLARE_bool(learned_image_verify);
+DECLARE_double(warmup_fraction);
+DECLARE_uint64(warmup_read_rate);
+DECLARE_string(replacement_policy);
+DECLARE_uint64(replacement_samples);
+DECLARE_string(io_engine);
+DECLARE_bool(io_uring_sqpoll);
+DECLARE_bool(io_uring_fixed_pool);
+DECLARE_uint64(numa_slices);
+DECLARE_uint64(alloc_magazine_size);
+DECLARE_uint64(wal_pipeline_depth);
+DECLARE_string(wal_files);
+DECLARE_uint64(wal_file_gib);
+DECLARE_uint64(wal_redo_batch_mib);
+DECLARE_uint64(wal_redo_io_depth);
@@ -48,6 +48,10 @@ LeanStore::LeanStore()
    // -------------------------------------------------------------------------------------
    // Check if configurations make sense
    ensure(!FLAGS_vw || FLAGS_wal);
+   // XMerge moves records between leafs without logging them
+   ensure(!FLAGS_xmerge || !FLAGS_wal);
+   // Out-of-place write-back moves pages to new PIDs, the redo applies the records to the PIDs they were logged for
+   ensure(!FLAGS_out_of_place || !FLAGS_wal);
    // -------------------------------------------------------------------------------------
    // Set the default logger to file logger
    // Init SSD pool
@@ -82,14 +86,7 @@ LeanStore::LeanStore()
    // -------------------------------------------------------------------------------------
    DTRegistry::global_dt_registry.registerDatastructureType(0, storage::btree::BTreeLL::getMeta());
    // -------------------------------------------------------------------------------------
-   if (FLAGS_recover) {
-      auto start_time = std::chrono::high_resolution_clock::now();
-      deserializeState();
-      auto end_time = std::chrono::high_resolution_clock::now();
-      auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count();
-      std::cout << "Loading of meta data took " << duration / 1000000 << "ms" << std::endl;
-   }
-   // -------------------------------------------------------------------------------------
+   // The redo runs on the workers of the CRManager
    u64 end_of_block_device;
    if (FLAGS_wal_offset_gib == 0) {
       ioctl(ssd_fd, BLKGETSIZE64, &end_of_block_device);
@@ -98,6 +95,22 @@ LeanStore::LeanStore()
    }
    cr_manager = make_unique<cr::CRManager>(ssd_fd, end_of_block_device);
    cr::CRManager::global = cr_manager.get();
+   // -------------------------------------------------------------------------------------
+   if (FLAGS_recover) {
+      auto start_time = std::chrono::high_resolution_clock::now();
+      deserializeState();
+      auto end_time = std::chrono::high_resolution_clock::now();
+      auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count();
+      std::cout << "Recovery (meta data" << (FLAGS_wal ? ", redo" : "") << ") took " << duration / 1000000 << "ms" << std::endl;
+   }
+   if (FLAGS_wal) {
+      if (FLAGS_recover) {
+         // End of recovery checkpoint: the redone pages are on the SSD, the state that goes with them next to
+         // the recover file, the next redo starts from an empty WAL
+         serializeState(FLAGS_recover_file);
+      }
+      cr_manager->resetWAL();
+   }
 }
 // -------------------------------------------------------------------------------------
 LeanStore::~LeanStore()
@@ -107,8 +120,12 @@ LeanStore::~LeanStore()
       MYPAUSE();
    }
    if (FLAGS_persist) {
-      serializeState();
+      serializeState(FLAGS_persist_file);
       buffer_manager->writeAllBufferFrames();
+      if (FLAGS_wal) {
+         posix_check(fdatasync(ssd_fd) == 0);
+         cr_manager->resetWAL();
+      }
    }
    //  close(ssd_fd);
 }
@@ -223,16 +240,39 @@ void LeanStore::startProfilingThread()
 }
 // -------------------------------------------------------------------------------------
 storage::btree::BTreeLL& LeanStore::registerBTreeLL(string name)
+{
+   auto router_config = storage::btree::RouterConfig::parse(FLAGS_root_model, FLAGS_mapping_search);
+   router_config.rmi_leaf_models = FLAGS_rmi_leaf_models;
+   router_config.pla_recursive_error = FLAGS_pla_recursive_error;
+   return registerBTreeLL(name, router_config);
+}
+// -------------------------------------------------------------------------------------
+storage::btree::BTreeLL& LeanStore::registerBTreeLL(string name, const storage::btree::RouterConfig& router_config)
 {
    assert(btrees_ll.find(name) == btrees_ll.end());
    auto& btree = btrees_ll[name];
+   btree.router_config = router_config;
    DTID dtid = DTRegistry::global_dt_registry.registerDatastructureInstance(0, reinterpret_cast<void*>(&btree), name);
    auto& bf = buffer_manager->allocatePage();
    Guard guard(bf.header.latch, GUARD_STATE::EXCLUSIVE);
    bf.header.keep_in_memory = true;
    bf.page.dt_id = dtid;
    guard.unlock();
-   btree.create(dtid, &bf);
+   if (FLAGS_wal) {
+      // The page guards log through the worker of the calling thread
+      cr_manager->scheduleJobSync(0, [&]() {
+         btree.create(dtid, &bf);
+         // The state written below names the tree, the WAL must hold its first pages before
+         auto& worker = cr::Worker::my();
+         while (worker.wal_durable_gsn.load(std::memory_order_acquire) < worker.wal_max_gsn.load()) {
+            MYPAUSE();
+         }
+      });
+      // A crash before the first checkpoint leaves only the WAL, its redo needs the trees it names
+      serializeState(FLAGS_recover_file);
+   } else {
+      btree.create(dtid, &bf);
+   }
 // Should start auto train
 #ifdef AUTO_TRAIN
    btree.auto_train();
@@ -250,11 +290,11 @@ LeanStore::GlobalStats LeanStore::getGlobalStats()
    return global_stats;
 }
 // -------------------------------------------------------------------------------------
-void LeanStore::serializeState()
+void LeanStore::serializeState(const std::string& path)
 {
    // Serialize data structure instances
    std::ofstream json_file;
-   json_file.open(FLAGS_persist_file, ios::trunc);
+   json_file.open(path, ios::trunc);
    rs::Document d;
    rs::Document::AllocatorType& allocator = d.GetAllocator();
    d.SetObject();
@@ -337,6 +377,7 @@ void LeanStore::deserializeState()
    // -------------------------------------------------------------------------------------
    const rs::Value& dts = d["registered_datastructures"];
    assert(dts.IsArray());
+   std::vector<std::tuple<DTID, std::unordered_map<std::string, std::string>>> serialized_dts;
    for (auto& dt : dts.GetArray()) {
       assert(dt.IsObject());
       const DTID dt_id = dt["id"].GetInt();
@@ -359,7 +400,35 @@ void LeanStore::deserializeState()
       } else {
          UNREACHABLE();
       }
-      DTRegistry::global_dt_registry.deserialize(dt_id, serialized_dt_map);
+      serialized_dts.emplace_back(dt_id, std::move(serialized_dt_map));
+   }
+   // -------------------------------------------------------------------------------------
+   // The meta nodes and everything below them are read after the redo
+   if (FLAGS_wal) {
+      const auto begin = std::chrono::high_resolution_clock::now();
+      const auto stats = cr_manager->redo();
+      if (stats.records > 0) {
+         buffer_manager->reservePIDsUpTo(stats.max_pid);
+      }
+      const auto took = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - begin).count();
+      std::cout << "redo: " << stats.records << " records of " << stats.chunks << " chunks (" << stats.bytes / 1024 / 1024 << " MiB) replayed on "
+                << stats.pages << " pages in " << took << " ms" << std::endl;
+   }
+   auto deserialize_dts = [&]() {
+      for (auto& [dt_id, serialized_dt_map] : serialized_dts) {
+         DTRegistry::global_dt_registry.deserialize(dt_id, serialized_dt_map);
+      }
+      if (FLAGS_wal) {
+         for (auto& [name, btree] : btrees_ll) {
+            btree.finishRedo();
+         }
+      }
+   };
+   if (FLAGS_wal) {
+      // The page guards sync the GSN of the calling thread's worker
+      cr_manager->scheduleJobSync(0, deserialize_dts);
+   } else {
+      deserialize_dts();
    }
 }
 // -------------------------------------------------------------------------------------
@@ -45,6 +45,7 @@ class LeanStore
    GlobalStats getGlobalStats();
    // -------------------------------------------------------------------------------------
    storage::btree::BTreeLL& registerBTreeLL(string name);
+   storage::btree::BTreeLL& registerBTreeLL(string name, const storage::btree::RouterConfig& router_config);
    storage::btree::BTreeLL& retrieveBTreeLL(string name) { return btrees_ll[name]; }
    // -------------------------------------------------------------------------------------
    storage::BufferManager& getBufferManager() { return *buffer_manager; }
@@ -61,7 +62,7 @@ class LeanStore
    static std::list<std::tuple<string, s64*>> persisted_s64_flags;
    void serializeFlags(rapidjson::Document& d);
    void deserializeFlags();
-   void serializeState();
+   void serializeState(const std::string& path);
    void deserializeState();
 
   public:
@@ -24,9 +24,14 @@
 #define RMI_EXPONENTIAL_SEARCH
 #define LR_EXPONENTIAL_SEARCH
 #define EXPONENTIAL_SEARCH
+#define SIMD_LEAF_SEARCH
+// Leafs refit their model on every insert and remove, the leaf trainers only recompute the error bound
+#define INCREMENTAL_LEAF_MODEL
+#define SIMD_MAPPING_SEARCH
 #define AUTO_TRAIN
 #define SMO_STATS
 #define COMPACT_MAPPING
+// #define MAPPING_BLOCKS
 // #define SEGMENT_STATS
 #define ATTACH_AT_ROOT
 #define ATTACH_AT_ROOT_NODE
@@ -38,4 +43,7 @@
 #define MISS_PROB 0.01
 
 using KEY = uint32_t;
-// using KEY = uint64_t;
\ No newline at end of file
+// using KEY = uint64_t;
+// Keys of the root models and the mapping: byte keys normalized by KeyNormalizer, wider than KEY so
+// that the bytes after a common prefix of long keys (strings, folded multi column keys) still tell them apart
+using MODEL_KEY = uint64_t;
\ No newline at end of file
@@ -2,8 +2,11 @@
 
 #include "leanstore/profiling/counters/CPUCounters.hpp"
 // -------------------------------------------------------------------------------------
+#include <fcntl.h>
+#include <unistd.h>
 // -------------------------------------------------------------------------------------
 #include <mutex>
+#include <sstream>
 // -------------------------------------------------------------------------------------
 namespace leanstore
 {
@@ -53,6 +56,21 @@ CRManager::CRManager(s32 ssd_fd, u64 end_of_block_device) : ssd_fd(ssd_fd), end_
    while (running_threads < workers_count) {
    }
    // -------------------------------------------------------------------------------------
+   if (FLAGS_wal_files.empty()) {
+      wal_stripes.push_back({ssd_fd, end_of_block_device});
+   } else {
+      std::stringstream files(FLAGS_wal_files);
+      std::string path;
+      while (std::getline(files, path, ',')) {
+         const s32 fd = open(path.c_str(), O_RDWR | O_DIRECT | O_CREAT, 0666);
+         posix_check(fd > -1);
+         const u64 file_bytes = FLAGS_wal_file_gib * 1024 * 1024 * 1024;
+         posix_check(fallocate(fd, 0, 0, file_bytes) == 0);
+         wal_stripes.push_back({fd, file_bytes});
+      }
+      ensure(wal_stripes.size() > 0);
+   }
+   // -------------------------------------------------------------------------------------
    if (FLAGS_wal) {
       std::thread group_commiter([&]() { groupCommiter(); });
       cpu_set_t cpuset;
@@ -75,6 +93,11 @@ CRManager::~CRManager()
    for (u64 t_i = 0; t_i < workers_count; t_i++) {
       delete workers[t_i];
    }
+   for (auto& stripe : wal_stripes) {
+      if (stripe.fd != ssd_fd) {
+         close(stripe.fd);
+      }
+   }
 }
 // -------------------------------------------------------------------------------------
 void CRManager::scheduleJobSync(u64 t_i, std::function<void()> job)
@@ -44,12 +44,32 @@ class CRManager
    // -------------------------------------------------------------------------------------
    const s32 ssd_fd;
    const u64 end_of_block_device;
+   // Files the group commit rounds go to round robin, each one filled downwards from its end
+   struct WALStripe {
+      s32 fd;
+      u64 end;
+   };
+   std::vector<WALStripe> wal_stripes;
    // -------------------------------------------------------------------------------------
    CRManager(s32 ssd_fd, u64 end_of_block_device);
    ~CRManager();
    // -------------------------------------------------------------------------------------
    void groupCommiter();
    // -------------------------------------------------------------------------------------
+   // Recovery.cpp
+   struct RedoStats {
+      u64 chunks = 0;
+      u64 bytes = 0;
+      u64 records = 0;
+      u64 pages = 0;
+      PID max_pid = 0;
+   };
+   // Replays the DT records of the complete prefix of the group commit rounds on the pages on the SSD,
+   // before the data structures resolve their meta nodes. Nothing is undone
+   RedoStats redo();
+   // Zeroes the meta of every stripe, once the pages the WAL covers are on the SSD
+   void resetWAL();
+   // -------------------------------------------------------------------------------------
    void scheduleJobAsync(u64 t_i, std::function<void()> job);
    void scheduleJobSync(u64 t_i, std::function<void()> job);
    void joinAll();
@@ -1,11 +1,11 @@
 #include "CRMG.hpp"
+#include "leanstore/io/IOEngine.hpp"
 #include "leanstore/profiling/counters/CPUCounters.hpp"
 #include "leanstore/profiling/counters/CRCounters.hpp"
 #include "leanstore/profiling/counters/WorkerCounters.hpp"
 #include "leanstore/utils/Misc.hpp"
 // -------------------------------------------------------------------------------------
 // -------------------------------------------------------------------------------------
-#include <libaio.h>
 #include <unistd.h>
 
 #include <chrono>
@@ -18,10 +18,29 @@ namespace leanstore
 namespace cr
 {
 // -------------------------------------------------------------------------------------
-struct alignas(512) SSDMeta {
-   u64 last_written_chunk;
+namespace
+{
+// What one group commit round took from the workers and writes to its stripe
+struct CommitRound {
+   struct Cut {
+      u64 ready_to_commit_cut;  // Exclusive, counted from the first transaction the worker ever queued
+      LID gsn_to_flush;
+      u64 wt_cursor_to_flush;
+      LID first_lsn_in_chunk;
+   };
+   SSDMeta meta;
+   u64 round_i;
+   u64 stripe_i;
+   LID max_safe_gsn;
+   u64 pending_ops;
+   bool meta_written;
+   Cut cuts[WALChunk::STATIC_MAX_WORKERS];
+   WALChunk chunk;
 };
+}  // namespace
 // -------------------------------------------------------------------------------------
+// Gathers round R+1 while the writes of round R are in flight, rounds commit in order. A round
+// goes to stripe round_i % stripes, that keeps the writes of consecutive rounds on different files.
 void CRManager::groupCommiter()
 {
    using Time = decltype(std::chrono::high_resolution_clock::now());
@@ -32,215 +51,244 @@ void CRManager::groupCommiter()
    pthread_setname_np(pthread_self(), thread_name.c_str());
    CPUCounters::registerThread(thread_name, false);
    // -------------------------------------------------------------------------------------
-   WALChunk chunk;
-   SSDMeta meta;
-   [[maybe_unused]] u64 round_i = 0;  // For debugging
-   const u64 meta_offset = end_of_block_device - sizeof(SSDMeta);
-   u64* index = reinterpret_cast<u64*>(chunk.data);
-   u64 ssd_offset = end_of_block_device - sizeof(SSDMeta);
+   ensure(workers_count <= WALChunk::STATIC_MAX_WORKERS);
+   const u64 pipeline_depth = std::max<u64>(FLAGS_wal_pipeline_depth, 1);
+   auto rounds = std::make_unique<CommitRound[]>(pipeline_depth);
+   u64 round_i = 0;
+   u64 rounds_in_flight = 0;
+   u64 last_chunk_round = WALChunk::NO_ROUND;
    // -------------------------------------------------------------------------------------
-   // Async IO
-   const u64 batch_max_size = (workers_count * 2) + 2;
-   s32 io_slot = 0;
-   std::unique_ptr<struct iocb[]> iocbs = make_unique<struct iocb[]>(batch_max_size);
-   std::unique_ptr<struct iocb*[]> iocbs_ptr = make_unique<struct iocb*[]>(batch_max_size);
-   std::unique_ptr<struct io_event[]> events = make_unique<struct io_event[]>(batch_max_size);
-   io_context_t aio_context;
-   {
-      memset(&aio_context, 0, sizeof(aio_context));
-      const int ret = io_setup(batch_max_size, &aio_context);
-      if (ret != 0) {
-         throw ex::GenericException("io_setup failed, ret code = " + std::to_string(ret));
-      }
-   }
-   auto add_pwrite = [&](u8* src, u64 size, u64 offset) {
-      io_prep_pwrite(&iocbs[io_slot], ssd_fd, src, size, offset);
-      iocbs[io_slot].data = src;
-      iocbs_ptr[io_slot] = &iocbs[io_slot];
-      io_slot++;
+   // Async IO: two writes per worker, the chunk, the meta and the syncs, for every round in flight
+   const u64 batch_max_size = (workers_count * 2) + 5;
+   const u64 engine_depth = batch_max_size * pipeline_depth;
+   std::unique_ptr<io::IOEngine::Completion[]> completions = make_unique<io::IOEngine::Completion[]>(engine_depth);
+   struct StripeWriter {
+      std::unique_ptr<io::IOEngine> engine;
+      u64 ssd_offset;
+      u64 meta_offset;
    };
+   std::vector<StripeWriter> stripes;
+   for (const auto& stripe : wal_stripes) {
+      stripes.push_back({io::IOEngine::create(stripe.fd, engine_depth), stripe.end - sizeof(SSDMeta), stripe.end - sizeof(SSDMeta)});
+   }
    // -------------------------------------------------------------------------------------
-   LID max_safe_gsn;
-   // -------------------------------------------------------------------------------------
-   while (keep_running) {
-      io_slot = 0;
-      round_i++;
-      CRCounters::myCounters().gct_rounds++;
+   auto add_pwrite = [&](CommitRound& round, u8* src, u64 size, u64 offset) {
+      stripes[round.stripe_i].engine->prepWrite(src, size, offset, &round);
+      round.pending_ops++;
+   };
+   auto add_fdatasync = [&](CommitRound& round) {
+      stripes[round.stripe_i].engine->prepSync(&round);
+      round.pending_ops++;
+   };
+   // Phase 1, takes what the workers queued since the previous round and queues its writes
+   auto gather = [&](CommitRound& round) {
       COUNTERS_BLOCK() { phase_1_begin = std::chrono::high_resolution_clock::now(); }
-      // -------------------------------------------------------------------------------------
-      max_safe_gsn = std::numeric_limits<LID>::max();
+      StripeWriter& stripe = stripes[round.stripe_i];
+      WALChunk& chunk = round.chunk;
+      u64& ssd_offset = stripe.ssd_offset;
+      round.max_safe_gsn = std::numeric_limits<LID>::max();
+      round.pending_ops = 0;
+      round.meta_written = false;
+      chunk.workers_count = workers_count;
       chunk.total_size = sizeof(WALChunk);
-      // -------------------------------------------------------------------------------------
-      // Phase 1
+      chunk.round = round.round_i;
+      chunk.prev_round = last_chunk_round;
+      // The cuts of all workers at one instant: a page's records then reach the SSD in GSN order across
+      // rounds, the redo relies on it
+      for (u32 w_i = 0; w_i < workers_count; w_i++) {
+         workers[w_i]->worker_group_commiter_mutex.lock();
+      }
       for (u32 w_i = 0; w_i < workers_count; w_i++) {
          Worker& worker = *workers[w_i];
+         auto& cut = round.cuts[w_i];
+         cut.ready_to_commit_cut = worker.group_commit_data.ready_to_commit_erased + worker.ready_to_commit_queue.size();
+         cut.gsn_to_flush = worker.wal_max_gsn;
+         cut.wt_cursor_to_flush = worker.wal_wt_cursor;
+      }
+      for (u32 w_i = 0; w_i < workers_count; w_i++) {
+         workers[w_i]->worker_group_commiter_mutex.unlock();
+      }
+      for (u32 w_i = 0; w_i < workers_count; w_i++) {
+         Worker& worker = *workers[w_i];
+         auto& cut = round.cuts[w_i];
+         const u64 gathered_cursor = worker.group_commit_data.gathered_cursor;
          {
-            std::unique_lock<std::mutex> g(worker.worker_group_commiter_mutex);
-            worker.group_commit_data.ready_to_commit_cut = worker.ready_to_commit_queue.size();
-            worker.group_commit_data.gsn_to_flush = worker.wal_max_gsn;
-            worker.group_commit_data.wt_cursor_to_flush = worker.wal_wt_cursor;
-         }
-         {
-            auto& wal_entry = *reinterpret_cast<WALEntry*>(worker.wal_buffer + worker.wal_ww_cursor);
-            worker.group_commit_data.first_lsn_in_chunk = wal_entry.lsn;
+            auto& wal_entry = *reinterpret_cast<WALEntry*>(worker.wal_buffer + gathered_cursor);
+            cut.first_lsn_in_chunk = wal_entry.lsn;
          }
-         {
-            if (worker.group_commit_data.wt_cursor_to_flush > worker.wal_ww_cursor) {
-               const u64 lower_offset = utils::downAlign(worker.wal_ww_cursor);
-               const u64 upper_offset = utils::upAlign(worker.group_commit_data.wt_cursor_to_flush);
-               const u64 size = worker.group_commit_data.wt_cursor_to_flush - worker.wal_ww_cursor;
-               const u64 size_aligned = upper_offset - lower_offset;
+         if (cut.wt_cursor_to_flush > gathered_cursor) {
+            const u64 lower_offset = utils::downAlign(gathered_cursor);
+            const u64 upper_offset = utils::upAlign(cut.wt_cursor_to_flush);
+            const u64 size = cut.wt_cursor_to_flush - gathered_cursor;
+            const u64 size_aligned = upper_offset - lower_offset;
+            // -------------------------------------------------------------------------------------
+            ssd_offset -= size_aligned;
+            if (!FLAGS_wal_io_hack) {
+               add_pwrite(round, worker.wal_buffer + lower_offset, size_aligned, ssd_offset);
+            }
+            // -------------------------------------------------------------------------------------
+            COUNTERS_BLOCK() { CRCounters::myCounters().gct_write_bytes += size_aligned; }
+            chunk.slot[w_i].offset = ssd_offset + (gathered_cursor - lower_offset);
+            chunk.slot[w_i].length = size;
+            chunk.total_size += size_aligned;
+            ensure(chunk.slot[w_i].offset >= ssd_offset);
+         } else if (cut.wt_cursor_to_flush < gathered_cursor) {
+            {
+               // XXXXXX---------------
+               const u64 upper_offset = utils::upAlign(cut.wt_cursor_to_flush);
+               const u64 size = cut.wt_cursor_to_flush;
+               const u64 size_aligned = upper_offset;
                // -------------------------------------------------------------------------------------
                ssd_offset -= size_aligned;
                if (!FLAGS_wal_io_hack) {
-                  add_pwrite(worker.wal_buffer + lower_offset, size_aligned, ssd_offset);
+                  add_pwrite(round, worker.wal_buffer, size_aligned, ssd_offset);
                }
-               // -------------------------------------------------------------------------------------
                COUNTERS_BLOCK() { CRCounters::myCounters().gct_write_bytes += size_aligned; }
-               chunk.slot[w_i].offset = ssd_offset + (worker.wal_ww_cursor - lower_offset);
                chunk.slot[w_i].length = size;
-               assert(chunk.slot[w_i].offset < end_of_block_device);
                chunk.total_size += size_aligned;
-               ensure(chunk.slot[w_i].offset >= ssd_offset);
-            } else if (worker.group_commit_data.wt_cursor_to_flush < worker.wal_ww_cursor) {
-               {
-                  // XXXXXX---------------
-                  const u64 lower_offset = 0;
-                  const u64 upper_offset = utils::upAlign(worker.group_commit_data.wt_cursor_to_flush);
-                  const u64 size = worker.group_commit_data.wt_cursor_to_flush;
-                  const u64 size_aligned = upper_offset - lower_offset;
-                  // -------------------------------------------------------------------------------------
-                  ssd_offset -= size_aligned;
-                  if (!FLAGS_wal_io_hack) {
-                     add_pwrite(worker.wal_buffer, size_aligned, ssd_offset);
-                  }
-                  COUNTERS_BLOCK() { CRCounters::myCounters().gct_write_bytes += size_aligned; }
-                  chunk.slot[w_i].length = size;
-               }
-               {
-                  // ------------XXXXXXXXX
-                  const u64 lower_offset = utils::downAlign(worker.wal_ww_cursor);
-                  const u64 upper_offset = Worker::WORKER_WAL_SIZE;
-                  const u64 size = Worker::WORKER_WAL_SIZE - worker.wal_ww_cursor;
-                  const u64 size_aligned = upper_offset - lower_offset;
-                  // -------------------------------------------------------------------------------------
-                  ssd_offset -= size_aligned;
-                  if (!FLAGS_wal_io_hack) {
-                     add_pwrite(worker.wal_buffer + lower_offset, size_aligned, ssd_offset);
-                  }
-                  COUNTERS_BLOCK() { CRCounters::myCounters().gct_write_bytes += size_aligned; }
-                  chunk.slot[w_i].offset = ssd_offset + (worker.wal_ww_cursor - lower_offset);
-                  chunk.slot[w_i].length += size;
+            }
+            {
+               // ------------XXXXXXXXX
+               const u64 lower_offset = utils::downAlign(gathered_cursor);
+               const u64 upper_offset = Worker::WORKER_WAL_SIZE;
+               const u64 size = Worker::WORKER_WAL_SIZE - gathered_cursor;
+               const u64 size_aligned = upper_offset - lower_offset;
+               // -------------------------------------------------------------------------------------
+               ssd_offset -= size_aligned;
+               if (!FLAGS_wal_io_hack) {
+                  add_pwrite(round, worker.wal_buffer + lower_offset, size_aligned, ssd_offset);
                }
-               ensure(chunk.slot[w_i].offset >= ssd_offset);
-            } else {
-               chunk.slot[w_i].offset = 0;
-               chunk.slot[w_i].length = 0;
+               COUNTERS_BLOCK() { CRCounters::myCounters().gct_write_bytes += size_aligned; }
+               chunk.slot[w_i].offset = ssd_offset + (gathered_cursor - lower_offset);
+               chunk.slot[w_i].length += size;
+               chunk.total_size += size_aligned;
             }
+            ensure(chunk.slot[w_i].offset >= ssd_offset);
+         } else {
+            chunk.slot[w_i].offset = 0;
+            chunk.slot[w_i].length = 0;
          }
-         // -------------------------------------------------------------------------------------
-         index[w_i] = ssd_offset;
+         worker.group_commit_data.gathered_cursor = cut.wt_cursor_to_flush;
       }
-      // -------------------------------------------------------------------------------------
-      if (workers[0]->wal_max_gsn > workers[0]->group_commit_data.max_safe_gsn_to_commit) {
-         max_safe_gsn = std::min<LID>(workers[0]->group_commit_data.gsn_to_flush, max_safe_gsn);
-      }
-      for (u32 w_i = 1; w_i < workers_count; w_i++) {
-         Worker& worker = *workers[w_i];
-         worker.group_commit_data.max_safe_gsn_to_commit = std::min<LID>(worker.group_commit_data.max_safe_gsn_to_commit, max_safe_gsn);
-         if (worker.wal_max_gsn > worker.group_commit_data.gsn_to_flush) {
-            max_safe_gsn = std::min<LID>(max_safe_gsn, worker.group_commit_data.gsn_to_flush);
+      // A worker that logged past its cut may hold records below the GSN of the transactions queued
+      // by the others, those may only commit below its cut
+      for (u32 w_i = 0; w_i < workers_count; w_i++) {
+         if (workers[w_i]->wal_max_gsn > round.cuts[w_i].gsn_to_flush) {
+            round.max_safe_gsn = std::min<LID>(round.max_safe_gsn, round.cuts[w_i].gsn_to_flush);
          }
       }
       // -------------------------------------------------------------------------------------
-      COUNTERS_BLOCK()
-      {
-         phase_1_end = std::chrono::high_resolution_clock::now();
-         write_begin = phase_1_end;
-      }
-      // -------------------------------------------------------------------------------------
-      // Flush
       if (chunk.total_size > sizeof(WALChunk)) {
          ensure(ssd_offset % 512 == 0);
          ssd_offset -= sizeof(WALChunk);
+         round.meta.last_written_chunk = ssd_offset;
+         round.meta.last_written_round = round.round_i;
+         last_chunk_round = round.round_i;
          if (!FLAGS_wal_io_hack) {
-            add_pwrite(reinterpret_cast<u8*>(&chunk), sizeof(WALChunk), ssd_offset);
-            {
-               s32 ret_code = io_submit(aio_context, io_slot, iocbs_ptr.get());
-               ensure(ret_code == s32(io_slot));
-            }
-            {
-               if (io_slot > 0) {
-                  const s32 done_requests = io_getevents(aio_context, io_slot, io_slot, events.get(), NULL);
-                  if (done_requests != io_slot) {
-                     cerr << done_requests << endl;
-                     raise(SIGTRAP);
-                     ensure(false);
-                  }
-                  io_slot = 0;
-               }
-            }
+            add_pwrite(round, reinterpret_cast<u8*>(&chunk), sizeof(WALChunk), ssd_offset);
             if (FLAGS_wal_fsync) {
-               fdatasync(ssd_fd);
+               // One batch: a sync once the WAL writes are done, the meta write after it, a sync linked to that
+               add_fdatasync(round);
+               add_pwrite(round, reinterpret_cast<u8*>(&round.meta), sizeof(SSDMeta), stripe.meta_offset);
+               add_fdatasync(round);
+               round.meta_written = true;
             }
+            stripe.engine->submit();
          }
-         // -------------------------------------------------------------------------------------
-         meta.last_written_chunk = ssd_offset;
-         if (!FLAGS_wal_io_hack) {
-            const u64 ret = pwrite(ssd_fd, &meta, sizeof(SSDMeta), meta_offset);
-            ensure(ret == sizeof(SSDMeta));
+      }
+      round.meta_written |= round.pending_ops == 0;
+      COUNTERS_BLOCK()
+      {
+         phase_1_end = std::chrono::high_resolution_clock::now();
+         CRCounters::myCounters().gct_phase_1_ms += (std::chrono::duration_cast<std::chrono::microseconds>(phase_1_end - phase_1_begin).count());
+      }
+   };
+   // -------------------------------------------------------------------------------------
+   // Waits for the oldest round, the completions of younger rounds on the same stripe are counted off as well
+   auto await = [&](CommitRound& round) {
+      COUNTERS_BLOCK() { write_begin = std::chrono::high_resolution_clock::now(); }
+      StripeWriter& stripe = stripes[round.stripe_i];
+      while (round.pending_ops || !round.meta_written) {
+         if (round.pending_ops == 0) {
+            // The meta must not overtake the chunk it points to
+            add_pwrite(round, reinterpret_cast<u8*>(&round.meta), sizeof(SSDMeta), stripe.meta_offset);
+            stripe.engine->submit();
+            round.meta_written = true;
          }
-         if (!FLAGS_wal_io_hack && FLAGS_wal_fsync) {
-            fdatasync(ssd_fd);
+         const u64 reaped = stripe.engine->reap(completions.get(), 1, engine_depth);
+         for (u64 c_i = 0; c_i < reaped; c_i++) {
+            ensure(completions[c_i].result >= 0);
+            static_cast<CommitRound*>(completions[c_i].user_data)->pending_ops--;
          }
       }
-      // -------------------------------------------------------------------------------------
       COUNTERS_BLOCK()
       {
          write_end = std::chrono::high_resolution_clock::now();
-         phase_2_begin = write_end;
+         CRCounters::myCounters().gct_write_ms += (std::chrono::duration_cast<std::chrono::microseconds>(write_end - write_begin).count());
       }
-      // -------------------------------------------------------------------------------------
-      // Phase 2, commit
+   };
+   // -------------------------------------------------------------------------------------
+   // Phase 2, acknowledges the transactions of a durable round
+   auto commit = [&](CommitRound& round) {
+      COUNTERS_BLOCK() { phase_2_begin = std::chrono::high_resolution_clock::now(); }
+      [[maybe_unused]] u64 now_ns = 0;
+      COUNTERS_BLOCK() { now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
       u64 committed_tx = 0;
-      for (s32 w_i = 0; w_i < s32(workers_count); w_i++) {
+      [[maybe_unused]] u64 commit_latency_us = 0;
+      for (u32 w_i = 0; w_i < workers_count; w_i++) {
          Worker& worker = *workers[w_i];
-         {
-            u64 tx_i = 0;
-            std::unique_lock<std::mutex> g(worker.worker_group_commiter_mutex);
-            if (chunk.slot[w_i].offset) {
-               worker.wal_finder.insertJumpPoint(worker.group_commit_data.first_lsn_in_chunk, chunk.slot[w_i]);
-            }
-            // -------------------------------------------------------------------------------------
-            worker.wal_ww_cursor.store(worker.group_commit_data.wt_cursor_to_flush, std::memory_order_release);
-            while (tx_i < worker.group_commit_data.ready_to_commit_cut) {
-               if (worker.ready_to_commit_queue[tx_i].max_gsn < worker.group_commit_data.max_safe_gsn_to_commit) {
-                  worker.ready_to_commit_queue[tx_i].state = Transaction::STATE::COMMITED;
-                  committed_tx++;
-                  tx_i++;
-               } else {
-                  break;
-               }
-            }
-            if (0 && tx_i > 0) {  // TODO: verify the latency optimization
-               const u64 high_water_mark = worker.ready_to_commit_queue[tx_i - 1].tts + 1;
-               worker.high_water_mark.store(high_water_mark, std::memory_order_release);
-               // cout << "HighWaterMark[" << w_i << "] = " << worker.high_water_mark << endl;
-            }
+         const auto& cut = round.cuts[w_i];
+         u64 tx_i = 0;
+         std::unique_lock<std::mutex> g(worker.worker_group_commiter_mutex);
+         if (round.chunk.slot[w_i].offset) {
+            worker.wal_finder.insertJumpPoint(cut.first_lsn_in_chunk, {round.chunk.slot[w_i], round.stripe_i});
+         }
+         // -------------------------------------------------------------------------------------
+         worker.wal_ww_cursor.store(cut.wt_cursor_to_flush, std::memory_order_release);
+         worker.wal_durable_gsn.store(cut.gsn_to_flush, std::memory_order_release);
+         const u64 cut_in_queue = cut.ready_to_commit_cut - worker.group_commit_data.ready_to_commit_erased;
+         while (tx_i < cut_in_queue && worker.ready_to_commit_queue[tx_i].max_gsn < round.max_safe_gsn) {
+            COUNTERS_BLOCK() { commit_latency_us += (now_ns - worker.ready_to_commit_queue[tx_i].ready_ns) / 1000; }
+            tx_i++;
+         }
+         if (tx_i > 0) {
+            committed_tx += tx_i;
             worker.ready_to_commit_queue.erase(worker.ready_to_commit_queue.begin(), worker.ready_to_commit_queue.begin() + tx_i);
-            worker.group_commit_data.max_safe_gsn_to_commit = std::numeric_limits<u64>::max();
+            worker.group_commit_data.ready_to_commit_erased += tx_i;
+            worker.wal_committed_cursor.store(worker.group_commit_data.ready_to_commit_erased, std::memory_order_release);
          }
       }
       CRCounters::myCounters().gct_committed_tx += committed_tx;
       COUNTERS_BLOCK()
       {
+         CRCounters::myCounters().gct_commit_latency_us += commit_latency_us;
          phase_2_end = std::chrono::high_resolution_clock::now();
-         CRCounters::myCounters().gct_phase_1_ms += (std::chrono::duration_cast<std::chrono::microseconds>(phase_1_end - phase_1_begin).count());
          CRCounters::myCounters().gct_phase_2_ms += (std::chrono::duration_cast<std::chrono::microseconds>(phase_2_end - phase_2_begin).count());
-         CRCounters::myCounters().gct_write_ms += (std::chrono::duration_cast<std::chrono::microseconds>(write_end - write_begin).count());
+      }
+   };
+   // -------------------------------------------------------------------------------------
+   while (keep_running) {
+      CommitRound& round = rounds[round_i % pipeline_depth];
+      round.round_i = round_i;
+      round.stripe_i = round_i % stripes.size();
+      CRCounters::myCounters().gct_rounds++;
+      gather(round);
+      round_i++;
+      rounds_in_flight++;
+      if (rounds_in_flight == pipeline_depth) {
+         CommitRound& oldest = rounds[(round_i - rounds_in_flight) % pipeline_depth];
+         await(oldest);
+         commit(oldest);
+         rounds_in_flight--;
       }
    }
-
+   while (rounds_in_flight) {
+      CommitRound& oldest = rounds[(round_i - rounds_in_flight) % pipeline_depth];
+      await(oldest);
+      commit(oldest);
+      rounds_in_flight--;
+   }
+   // -------------------------------------------------------------------------------------
    running_threads--;
 }
 // -------------------------------------------------------------------------------------
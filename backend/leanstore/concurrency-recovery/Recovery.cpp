@@ -0,0 +1,238 @@
+#include "CRMG.hpp"
+#include "leanstore/io/IOEngine.hpp"
+#include "leanstore/storage/buffer-manager/DTRegistry.hpp"
+// -------------------------------------------------------------------------------------
+// -------------------------------------------------------------------------------------
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <iostream>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace cr
+{
+// -------------------------------------------------------------------------------------
+namespace
+{
+struct ChunkRef {
+   u64 round;
+   u64 prev_round;
+   u64 stripe_i;
+   u64 offset;
+   u64 total_size;
+};
+// A DT record in the batch buffer
+struct RedoRecord {
+   PID pid;
+   LID gsn;
+   const WALDTEntry* entry;
+};
+// Larger reads are split, neither engine takes I/Os of GiBs
+constexpr u64 MAX_READ_SIZE = 8 * 1024 * 1024;
+}  // namespace
+// -------------------------------------------------------------------------------------
+// ARIES without analysis and undo: the rounds are replayed in order, the records of a page in GSN order.
+// Every stripe is walked upwards from the chunk its meta points to, the rounds of all stripes must then
+// form one chain, the first round missing ends the WAL. A batch of rounds is parsed into one share of
+// records per worker (pid % workers), every worker reads its pages in groups, replays and writes them back.
+CRManager::RedoStats CRManager::redo()
+{
+   RedoStats stats;
+   std::vector<ChunkRef> chunks;
+   {
+      auto header = static_cast<WALChunk*>(std::aligned_alloc(512, sizeof(WALChunk)));
+      auto meta = static_cast<SSDMeta*>(std::aligned_alloc(512, sizeof(SSDMeta)));
+      for (u64 s_i = 0; s_i < wal_stripes.size(); s_i++) {
+         const WALStripe& stripe = wal_stripes[s_i];
+         const u64 meta_offset = stripe.end - sizeof(SSDMeta);
+         posix_check(pread(stripe.fd, meta, sizeof(SSDMeta), meta_offset) == sizeof(SSDMeta));
+         if (meta->last_written_chunk == 0) {
+            continue;
+         }
+         u64 offset = meta->last_written_chunk;
+         while (offset < meta_offset) {
+            posix_check(pread(stripe.fd, header, sizeof(WALChunk), offset) == sizeof(WALChunk));
+            ensure(header->total_size >= sizeof(WALChunk) && offset + header->total_size <= meta_offset);
+            chunks.push_back({header->round, header->prev_round, s_i, offset, header->total_size});
+            offset += header->total_size;
+         }
+      }
+      free(header);
+      free(meta);
+   }
+   std::sort(chunks.begin(), chunks.end(), [](const ChunkRef& a, const ChunkRef& b) { return a.round < b.round; });
+   u64 chain_length = 0;
+   for (u64 prev_round = WALChunk::NO_ROUND; chain_length < chunks.size() && chunks[chain_length].prev_round == prev_round; chain_length++) {
+      prev_round = chunks[chain_length].round;
+   }
+   if (chain_length < chunks.size()) {
+      std::cout << "redo: " << chunks.size() - chain_length << " chunks behind a round that did not reach the SSD are ignored" << std::endl;
+      chunks.resize(chain_length);
+   }
+   if (chunks.empty()) {
+      return stats;
+   }
+   // -------------------------------------------------------------------------------------
+   std::vector<std::unique_ptr<io::IOEngine>> readers;
+   for (const auto& stripe : wal_stripes) {
+      readers.push_back(io::IOEngine::create(stripe.fd, 16));
+   }
+   std::vector<io::IOEngine::Completion> completions(16);
+   const u64 batch_bytes = FLAGS_wal_redo_batch_mib * 1024 * 1024;
+   u8* batch = nullptr;
+   u64 batch_capacity = 0;
+   std::vector<std::vector<RedoRecord>> shares(workers_count);
+   std::atomic<u64> pages = 0;
+   // -------------------------------------------------------------------------------------
+   auto redo_share = [&](std::vector<RedoRecord>& records) {
+      std::sort(records.begin(), records.end(), [](const RedoRecord& a, const RedoRecord& b) { return a.pid < b.pid || (a.pid == b.pid && a.gsn < b.gsn); });
+      const u64 io_depth = std::max<u64>(FLAGS_wal_redo_io_depth, 1);
+      auto group = static_cast<u8*>(std::aligned_alloc(512, storage::PAGE_SIZE * io_depth));
+      auto engine = io::IOEngine::create(ssd_fd, io_depth);
+      std::vector<io::IOEngine::Completion> page_completions(io_depth);
+      std::vector<u64> group_begin(io_depth + 1);
+      u64 r_i = 0;
+      while (r_i < records.size()) {
+         u64 pages_n = 0;
+         while (r_i < records.size() && pages_n < io_depth) {
+            const PID pid = records[r_i].pid;
+            group_begin[pages_n] = r_i;
+            while (r_i < records.size() && records[r_i].pid == pid) {
+               r_i++;
+            }
+            engine->prepRead(group + pages_n * storage::PAGE_SIZE, storage::PAGE_SIZE, pid * storage::PAGE_SIZE, reinterpret_cast<void*>(pages_n));
+            pages_n++;
+         }
+         group_begin[pages_n] = r_i;
+         ensure(engine->submitAndWait(page_completions.data(), pages_n) == pages_n);
+         for (u64 c_i = 0; c_i < pages_n; c_i++) {
+            ensure(page_completions[c_i].result >= 0);
+            if (page_completions[c_i].result < s64(storage::PAGE_SIZE)) {
+               // Past the end of the file, the page begins with its WALInitPage
+               std::memset(group + reinterpret_cast<u64>(page_completions[c_i].user_data) * storage::PAGE_SIZE, 0, storage::PAGE_SIZE);
+            }
+         }
+         for (u64 p_i = 0; p_i < pages_n; p_i++) {
+            auto& page = *reinterpret_cast<storage::BufferFrame::Page*>(group + p_i * storage::PAGE_SIZE);
+            const PID pid = records[group_begin[p_i]].pid;
+            for (u64 g_i = group_begin[p_i]; g_i < group_begin[p_i + 1]; g_i++) {
+               const WALDTEntry& entry = *records[g_i].entry;
+               storage::DTRegistry::global_dt_registry.redo(entry.dt_id, page, pid, entry.gsn, entry.payload, entry.size - sizeof(WALDTEntry));
+            }
+            page.magic_debugging_number = pid;
+            engine->prepWrite(group + p_i * storage::PAGE_SIZE, storage::PAGE_SIZE, pid * storage::PAGE_SIZE, nullptr);
+         }
+         ensure(engine->submitAndWait(page_completions.data(), pages_n) == pages_n);
+         for (u64 c_i = 0; c_i < pages_n; c_i++) {
+            ensure(page_completions[c_i].result == s64(storage::PAGE_SIZE));
+         }
+         pages += pages_n;
+      }
+      free(group);
+      records.clear();
+   };
+   // -------------------------------------------------------------------------------------
+   for (u64 c_b = 0; c_b < chunks.size();) {
+      u64 c_e = c_b, bytes = 0;
+      while (c_e < chunks.size() && (c_e == c_b || bytes + chunks[c_e].total_size <= batch_bytes)) {
+         bytes += chunks[c_e++].total_size;
+      }
+      if (bytes > batch_capacity) {
+         free(batch);
+         batch = static_cast<u8*>(std::aligned_alloc(512, bytes));
+         batch_capacity = bytes;
+      }
+      // The stripes are read at once, every chunk in pieces of at most MAX_READ_SIZE
+      {
+         struct Read {
+            u8* destination;
+            u64 size;
+            u64 offset;
+         };
+         std::vector<std::deque<Read>> reads(wal_stripes.size());
+         for (u64 c_i = c_b, batch_offset = 0; c_i < c_e; batch_offset += chunks[c_i++].total_size) {
+            for (u64 done = 0; done < chunks[c_i].total_size; done += MAX_READ_SIZE) {
+               const u64 size = std::min<u64>(MAX_READ_SIZE, chunks[c_i].total_size - done);
+               reads[chunks[c_i].stripe_i].push_back({batch + batch_offset + done, size, chunks[c_i].offset + done});
+            }
+         }
+         bool pending = true;
+         while (pending) {
+            pending = false;
+            for (u64 s_i = 0; s_i < wal_stripes.size(); s_i++) {
+               auto& engine = *readers[s_i];
+               while (!reads[s_i].empty() && engine.inFlight() + engine.queued() < completions.size()) {
+                  const Read& read = reads[s_i].front();
+                  engine.prepRead(read.destination, read.size, read.offset, reinterpret_cast<void*>(read.size));
+                  reads[s_i].pop_front();
+               }
+               engine.submit();
+               if (engine.inFlight()) {
+                  const u64 reaped = engine.reap(completions.data(), 1, completions.size());
+                  for (u64 c_i = 0; c_i < reaped; c_i++) {
+                     ensure(completions[c_i].result == s64(reinterpret_cast<u64>(completions[c_i].user_data)));
+                  }
+               }
+               pending |= engine.inFlight() || !reads[s_i].empty();
+            }
+         }
+      }
+      // -------------------------------------------------------------------------------------
+      for (u64 c_i = c_b, batch_offset = 0; c_i < c_e; batch_offset += chunks[c_i++].total_size) {
+         const u8* chunk_begin = batch + batch_offset;
+         const auto& header = *reinterpret_cast<const WALChunk*>(chunk_begin);
+         ensure(header.round == chunks[c_i].round);
+         for (u32 w_i = 0; w_i < header.workers_count; w_i++) {
+            const WALChunk::Slot& slot = header.slot[w_i];
+            if (slot.length == 0) {
+               continue;
+            }
+            const u8* log = chunk_begin + (slot.offset - chunks[c_i].offset);
+            for (u64 cursor = 0; cursor < slot.length;) {
+               const auto& entry = *reinterpret_cast<const WALEntry*>(log + cursor);
+               ensure(entry.size > 0 && cursor + entry.size <= slot.length);
+               if (entry.type == WALEntry::TYPE::DT_SPECIFIC) {
+                  const auto& dt_entry = static_cast<const WALDTEntry&>(entry);
+                  // Data structures created after the last checkpoint are unknown, so are their pages
+                  if (storage::DTRegistry::global_dt_registry.dt_instances_ht.count(dt_entry.dt_id)) {
+                     shares[dt_entry.pid % workers_count].push_back({dt_entry.pid, dt_entry.gsn, &dt_entry});
+                     stats.max_pid = std::max<PID>(stats.max_pid, dt_entry.pid);
+                     stats.records++;
+                  }
+               }
+               cursor += entry.size;
+            }
+         }
+      }
+      // -------------------------------------------------------------------------------------
+      for (u64 t_i = 0; t_i < workers_count; t_i++) {
+         scheduleJobAsync(t_i, [&, t_i]() { redo_share(shares[t_i]); });
+      }
+      joinAll();
+      stats.chunks += c_e - c_b;
+      stats.bytes += bytes;
+      c_b = c_e;
+   }
+   free(batch);
+   posix_check(fdatasync(ssd_fd) == 0);
+   stats.pages = pages;
+   return stats;
+}
+// -------------------------------------------------------------------------------------
+void CRManager::resetWAL()
+{
+   auto meta = static_cast<SSDMeta*>(std::aligned_alloc(512, sizeof(SSDMeta)));
+   std::memset(meta, 0, sizeof(SSDMeta));
+   for (const auto& stripe : wal_stripes) {
+      posix_check(pwrite(stripe.fd, meta, sizeof(SSDMeta), stripe.end - sizeof(SSDMeta)) == sizeof(SSDMeta));
+      posix_check(fdatasync(stripe.fd) == 0);
+   }
+   free(meta);
+}
+// -------------------------------------------------------------------------------------
+}  // namespace cr
+}  // namespace leanstore
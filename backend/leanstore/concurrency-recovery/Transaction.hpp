@@ -15,6 +15,8 @@ struct Transaction {
    STATE state = STATE::IDLE;
    u64 tts = 0;
    LID min_gsn, max_gsn;
+   u64 commit_seq = 0;  // position in the commit order of its worker
+   u64 ready_ns = 0;    // when commitTX queued it, for the commit latency
 };
 // -------------------------------------------------------------------------------------
 }  // namespace cr
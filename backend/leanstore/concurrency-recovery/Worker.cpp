@@ -1,5 +1,6 @@
 #include "Worker.hpp"
 
+#include "CRMG.hpp"
 #include "leanstore/Config.hpp"
 #include "leanstore/profiling/counters/CRCounters.hpp"
 #include "leanstore/profiling/counters/WorkerCounters.hpp"
@@ -8,6 +9,7 @@
 // -------------------------------------------------------------------------------------
 #include <stdio.h>
 
+#include <chrono>
 #include <cstdlib>
 #include <fstream>
 #include <mutex>
@@ -197,7 +199,12 @@ void Worker::commitTX()
          high_water_mark.store(active_tx.tts + 1, std::memory_order_release);
       }
       {
+         COUNTERS_BLOCK()
+         {
+            active_tx.ready_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+         }
          std::unique_lock<std::mutex> g(worker_group_commiter_mutex);
+         active_tx.commit_seq = commit_seq_counter++;
          ready_to_commit_queue.push_back(active_tx);
       }
    }
@@ -255,12 +262,12 @@ void Worker::iterateOverCurrentTXEntries(std::function<void(const WALEntry& entr
    }
 }
 // -------------------------------------------------------------------------------------
-WALChunk::Slot Worker::WALFinder::getJumpPoint(LID lsn)
+Worker::WALFinder::JumpPoint Worker::WALFinder::getJumpPoint(LID lsn)
 {
    std::unique_lock guard(m);
    // -------------------------------------------------------------------------------------
    if (ht.size() == 0) {
-      return {0, 0};
+      return {{0, 0}, 0};
    } else {
       auto iter = ht.lower_bound(lsn);
       if (iter != ht.end() && iter->first == lsn) {
@@ -272,10 +279,10 @@ WALChunk::Slot Worker::WALFinder::getJumpPoint(LID lsn)
    }
 }
 // -------------------------------------------------------------------------------------
-void Worker::WALFinder::insertJumpPoint(LID LSN, WALChunk::Slot slot)
+void Worker::WALFinder::insertJumpPoint(LID LSN, JumpPoint jump_point)
 {
    std::unique_lock guard(m);
-   ht[LSN] = slot;
+   ht[LSN] = jump_point;
 }
 // -------------------------------------------------------------------------------------
 Worker::WALFinder::~WALFinder() {}
@@ -314,15 +321,17 @@ void Worker::getWALEntry(LID lsn, u32 in_memory_offset, std::function<void(WALEn
 outofmemory : {
    COUNTERS_BLOCK() { WorkerCounters::myCounters().wal_buffer_miss++; }
    // 2- Read from SSD, accelerate using getLowerBound
-   const auto slot = wal_finder.getJumpPoint(lsn);
+   const auto jump_point = wal_finder.getJumpPoint(lsn);
+   const auto& slot = jump_point.slot;
    if (slot.offset == 0) {
       goto outofmemory;
    }
+   const s32 wal_fd = CRManager::global->wal_stripes[jump_point.stripe].fd;
    const u64 lower_bound = slot.offset;
    const u64 lower_bound_aligned = utils::downAlign(lower_bound);
    const u64 read_size_aligned = utils::upAlign(slot.length + lower_bound - lower_bound_aligned);
    auto log_chunk = static_cast<u8*>(std::aligned_alloc(512, read_size_aligned));
-   const u64 ret = pread(ssd_fd, log_chunk, read_size_aligned, lower_bound_aligned);
+   const u64 ret = pread(wal_fd, log_chunk, read_size_aligned, lower_bound_aligned);
    posix_check(ret >= read_size_aligned);
    WorkerCounters::myCounters().wal_read_bytes += read_size_aligned;
    // -------------------------------------------------------------------------------------
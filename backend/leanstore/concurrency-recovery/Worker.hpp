@@ -5,6 +5,7 @@
 // -------------------------------------------------------------------------------------
 #include <atomic>
 #include <functional>
+#include <limits>
 #include <map>
 #include <mutex>
 #include <queue>
@@ -37,7 +38,15 @@ struct alignas(512) WALChunk {
    u8 workers_count;
    u32 total_size;
    Slot slot[STATIC_MAX_WORKERS];
+   u64 round;       // group commit round, orders the chunks of all WAL stripes
+   u64 prev_round;  // round of the previous chunk on any stripe, NO_ROUND for the first one
    u8 data[];
+   static constexpr u64 NO_ROUND = std::numeric_limits<u64>::max();
+};
+// Last sector of every WAL stripe, the newest chunk is found through it
+struct alignas(512) SSDMeta {
+   u64 last_written_chunk;  // 0: nothing written since the last reset
+   u64 last_written_round;
 };
 // -------------------------------------------------------------------------------------
 struct Worker {
@@ -75,11 +84,8 @@ struct Worker {
    // -------------------------------------------------------------------------------------
    // Accessible only by the group commit thread
    struct GroupCommitData {
-      u64 ready_to_commit_cut = 0;  // Exclusive ) == size
-      u64 max_safe_gsn_to_commit = std::numeric_limits<u64>::max();
-      LID gsn_to_flush;
-      u64 wt_cursor_to_flush;
-      LID first_lsn_in_chunk;
+      u64 gathered_cursor = 0;         // end of what the last round took, the next one starts there
+      u64 ready_to_commit_erased = 0;  // transactions committed and erased from ready_to_commit_queue so far
       bool skip = false;
    };
    GroupCommitData group_commit_data;
@@ -87,11 +93,21 @@ struct Worker {
    // Shared between Group Committer and Worker
    std::mutex worker_group_commiter_mutex;
    std::vector<Transaction> ready_to_commit_queue;
+   u64 commit_seq_counter = 0;
+   // Transactions of this worker the group committer acknowledged, in commit order, published once per round
+   atomic<u64> wal_committed_cursor = 0;  // GCT->W
+   // The records of this worker up to this GSN are on the SSD, published once per round like the cursor
+   atomic<LID> wal_durable_gsn = 0;  // GCT->W
+   inline bool isCommitted(const Transaction& tx) const { return tx.commit_seq < wal_committed_cursor.load(std::memory_order_acquire); }
    struct WALFinder {
+      struct JumpPoint {
+         WALChunk::Slot slot;
+         u64 stripe;  // CRManager::wal_stripes
+      };
       std::mutex m;
-      std::map<LID, WALChunk::Slot> ht;  // LSN->SSD Offset
-      void insertJumpPoint(LID lsn, WALChunk::Slot slot);
-      WALChunk::Slot getJumpPoint(LID lsn);
+      std::map<LID, JumpPoint> ht;  // LSN->SSD Offset
+      void insertJumpPoint(LID lsn, JumpPoint jump_point);
+      JumpPoint getJumpPoint(LID lsn);
       ~WALFinder();
    };
    WALFinder wal_finder;
@@ -108,7 +124,7 @@ struct Worker {
    atomic<u64> wal_ww_cursor = 0;                // GCT->W
    alignas(512) u8 wal_buffer[WORKER_WAL_SIZE];  // W->GCT
    LID wal_lsn_counter = 0;
-   LID clock_gsn;
+   LID clock_gsn = 0;
    // -------------------------------------------------------------------------------------
    u32 walFreeSpace();
    u32 walContiguousFreeSpace();
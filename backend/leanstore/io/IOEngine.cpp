@@ -0,0 +1,141 @@
+#include "IOEngine.hpp"
+
+#include "Exceptions.hpp"
+#include "leanstore/Config.hpp"
+// -------------------------------------------------------------------------------------
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace io
+{
+// -------------------------------------------------------------------------------------
+std::unique_ptr<IOEngine> IOEngine::create(const std::string& name, int fd, u64 depth, u8* fixed_region, u64 fixed_bytes)
+{
+   if (name == "libaio") {
+      return std::make_unique<LibaioEngine>(fd, depth);
+   } else if (name == "io_uring") {
+      return std::make_unique<IoUringEngine>(fd, depth, FLAGS_io_uring_sqpoll, fixed_region, fixed_bytes);
+   }
+   throw ex::GenericException("unknown io engine " + name);
+}
+// -------------------------------------------------------------------------------------
+std::unique_ptr<IOEngine> IOEngine::create(int fd, u64 depth, u8* fixed_region, u64 fixed_bytes)
+{
+   return create(FLAGS_io_engine, fd, depth, fixed_region, fixed_bytes);
+}
+// -------------------------------------------------------------------------------------
+LibaioEngine::LibaioEngine(int fd, u64 depth) : IOEngine(fd, depth)
+{
+   iocbs = std::make_unique<struct iocb[]>(depth);
+   iocbs_ptr = std::make_unique<struct iocb*[]>(depth);
+   events = std::make_unique<struct io_event[]>(depth);
+   is_sync = std::make_unique<bool[]>(depth);
+   early_completions.reserve(depth);
+   // -------------------------------------------------------------------------------------
+   memset(&aio_context, 0, sizeof(aio_context));
+   const int ret = io_setup(depth, &aio_context);
+   if (ret != 0) {
+      throw ex::GenericException("io_setup failed, ret code = " + std::to_string(ret));
+   }
+}
+// -------------------------------------------------------------------------------------
+LibaioEngine::~LibaioEngine()
+{
+   io_destroy(aio_context);
+}
+// -------------------------------------------------------------------------------------
+void LibaioEngine::prepRead(u8* destination, u64 bytes, u64 offset, void* user_data)
+{
+   assert(queued_ops + in_flight_ops < depth);
+   const u64 slot = queued_ops++;
+   io_prep_pread(&iocbs[slot], fd, destination, bytes, offset);
+   iocbs[slot].data = user_data;
+   iocbs_ptr[slot] = &iocbs[slot];
+   is_sync[slot] = false;
+}
+// -------------------------------------------------------------------------------------
+void LibaioEngine::prepWrite(const u8* source, u64 bytes, u64 offset, void* user_data)
+{
+   assert(queued_ops + in_flight_ops < depth);
+   const u64 slot = queued_ops++;
+   io_prep_pwrite(&iocbs[slot], fd, const_cast<u8*>(source), bytes, offset);
+   iocbs[slot].data = user_data;
+   iocbs_ptr[slot] = &iocbs[slot];
+   is_sync[slot] = false;
+}
+// -------------------------------------------------------------------------------------
+void LibaioEngine::prepSync(void* user_data)
+{
+   assert(queued_ops + in_flight_ops < depth);
+   const u64 slot = queued_ops++;
+   iocbs[slot].data = user_data;
+   is_sync[slot] = true;
+}
+// -------------------------------------------------------------------------------------
+void LibaioEngine::issue(u64 begin, u64 end)
+{
+   while (begin < end) {
+      const int ret_code = io_submit(aio_context, end - begin, iocbs_ptr.get() + begin);
+      ensure(ret_code > 0);
+      kernel_in_flight += ret_code;
+      begin += ret_code;
+   }
+}
+// -------------------------------------------------------------------------------------
+u64 LibaioEngine::submit()
+{
+   u64 begin = 0;
+   for (u64 slot = 0; slot < queued_ops; slot++) {
+      if (is_sync[slot]) {
+         issue(begin, slot);
+         while (kernel_in_flight > 0) {
+            Completion completion;
+            reapEvents(&completion, 1, 1);
+            early_completions.push_back(completion);
+         }
+         const int ret = fdatasync(fd);
+         early_completions.push_back({iocbs[slot].data, ret == 0 ? 0 : -s64(errno)});
+         begin = slot + 1;
+      }
+   }
+   issue(begin, queued_ops);
+   const u64 submitted = queued_ops;
+   in_flight_ops += submitted;
+   queued_ops = 0;
+   return submitted;
+}
+// -------------------------------------------------------------------------------------
+u64 LibaioEngine::reapEvents(Completion* completions, u64 min, u64 max)
+{
+   min = std::min(min, kernel_in_flight);
+   max = std::min(max, kernel_in_flight);
+   if (max == 0) {
+      return 0;
+   }
+   struct timespec no_wait = {0, 0};
+   const int done_requests = io_getevents(aio_context, min, max, events.get(), min ? NULL : &no_wait);
+   ensure(done_requests >= 0);
+   for (int e_i = 0; e_i < done_requests; e_i++) {
+      completions[e_i] = {events[e_i].data, static_cast<s64>(events[e_i].res)};
+   }
+   kernel_in_flight -= done_requests;
+   return done_requests;
+}
+// -------------------------------------------------------------------------------------
+u64 LibaioEngine::reap(Completion* completions, u64 min, u64 max)
+{
+   const u64 early = std::min<u64>(max, early_completions.size());
+   std::copy(early_completions.begin(), early_completions.begin() + early, completions);
+   early_completions.erase(early_completions.begin(), early_completions.begin() + early);
+   const u64 reaped = early + reapEvents(completions + early, min > early ? min - early : 0, max - early);
+   in_flight_ops -= reaped;
+   return reaped;
+}
+// -------------------------------------------------------------------------------------
+}  // namespace io
+}  // namespace leanstore
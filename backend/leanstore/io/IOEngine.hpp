@@ -0,0 +1,145 @@
+#pragma once
+#include "Units.hpp"
+// -------------------------------------------------------------------------------------
+#include <libaio.h>
+#include <sys/uio.h>
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+// -------------------------------------------------------------------------------------
+struct io_uring_sqe;
+struct io_uring_cqe;
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace io
+{
+// -------------------------------------------------------------------------------------
+// Batched reads, writes and syncs on one file. Nothing is issued before submit, at most depth
+// operations are queued and in flight together. An engine is used by one thread at a time.
+class IOEngine
+{
+  public:
+   struct Completion {
+      void* user_data;
+      s64 result;  // bytes transferred, 0 for a sync, -errno if it failed
+   };
+   // -------------------------------------------------------------------------------------
+   IOEngine(int fd, u64 depth) : fd(fd), depth(depth) {}
+   virtual ~IOEngine() = default;
+   IOEngine(const IOEngine&) = delete;
+   IOEngine& operator=(const IOEngine&) = delete;
+   // -------------------------------------------------------------------------------------
+   virtual void prepRead(u8* destination, u64 bytes, u64 offset, void* user_data) = 0;
+   virtual void prepWrite(const u8* source, u64 bytes, u64 offset, void* user_data) = 0;
+   // fdatasync that starts once everything queued before it completed, what is queued after it
+   // starts once the sync completed
+   virtual void prepSync(void* user_data) = 0;
+   // Issues the queued operations, returns how many
+   virtual u64 submit() = 0;
+   // Reaps at least min and at most max completions, blocks until min are there
+   virtual u64 reap(Completion* completions, u64 min, u64 max) = 0;
+   // submit and reap of n, in one system call where the engine can
+   virtual u64 submitAndWait(Completion* completions, u64 n)
+   {
+      submit();
+      return reap(completions, n, n);
+   }
+   // -------------------------------------------------------------------------------------
+   inline u64 queued() const { return queued_ops; }
+   inline u64 inFlight() const { return in_flight_ops; }
+   virtual const char* name() const = 0;
+   // -------------------------------------------------------------------------------------
+   // name is libaio or io_uring, throws ex::GenericException for anything else. The engine may
+   // register [fixed_region, fixed_region + fixed_bytes) with the kernel to skip pinning the pages
+   // of every I/O into it.
+   static std::unique_ptr<IOEngine> create(const std::string& name, int fd, u64 depth, u8* fixed_region = nullptr, u64 fixed_bytes = 0);
+   // The engine of --io_engine
+   static std::unique_ptr<IOEngine> create(int fd, u64 depth, u8* fixed_region = nullptr, u64 fixed_bytes = 0);
+
+  protected:
+   const int fd;
+   const u64 depth;
+   u64 queued_ops = 0;
+   u64 in_flight_ops = 0;
+};
+// -------------------------------------------------------------------------------------
+// libaio has no asynchronous fdatasync on most file systems, submit waits for the operations
+// before a sync and runs it itself
+class LibaioEngine : public IOEngine
+{
+  public:
+   LibaioEngine(int fd, u64 depth);
+   ~LibaioEngine();
+   void prepRead(u8* destination, u64 bytes, u64 offset, void* user_data) override;
+   void prepWrite(const u8* source, u64 bytes, u64 offset, void* user_data) override;
+   void prepSync(void* user_data) override;
+   u64 submit() override;
+   u64 reap(Completion* completions, u64 min, u64 max) override;
+   const char* name() const override { return "libaio"; }
+
+  private:
+   io_context_t aio_context;
+   std::unique_ptr<struct iocb[]> iocbs;
+   std::unique_ptr<struct iocb*[]> iocbs_ptr;
+   std::unique_ptr<struct io_event[]> events;
+   std::unique_ptr<bool[]> is_sync;            // the queued slot is a sync, its iocb only holds the user data
+   std::vector<Completion> early_completions;  // reaped by submit while it waited for a sync
+   u64 kernel_in_flight = 0;
+   // -------------------------------------------------------------------------------------
+   void issue(u64 begin, u64 end);
+   u64 reapEvents(Completion* completions, u64 min, u64 max);
+};
+// -------------------------------------------------------------------------------------
+// Raw io_uring without liburing: fixed file, optionally registered buffers (READ_FIXED and
+// WRITE_FIXED for every I/O inside the registered region) and a kernel SQ polling thread.
+// Syncs are drained and linked to the operation queued right before them, a failed write cancels
+// the sync behind it.
+class IoUringEngine : public IOEngine
+{
+  public:
+   IoUringEngine(int fd, u64 depth, bool sqpoll, u8* fixed_region, u64 fixed_bytes);
+   ~IoUringEngine();
+   void prepRead(u8* destination, u64 bytes, u64 offset, void* user_data) override;
+   void prepWrite(const u8* source, u64 bytes, u64 offset, void* user_data) override;
+   void prepSync(void* user_data) override;
+   u64 submit() override;
+   u64 reap(Completion* completions, u64 min, u64 max) override;
+   u64 submitAndWait(Completion* completions, u64 n) override;
+   const char* name() const override { return "io_uring"; }
+   // -------------------------------------------------------------------------------------
+   bool hasFixedFile() const { return fixed_file; }
+   bool hasFixedBuffers() const { return !fixed_buffers.empty(); }
+
+  private:
+   int ring_fd = -1;
+   bool sqpoll;
+   bool fixed_file = false;
+   u8* fixed_base = nullptr;
+   std::vector<struct iovec> fixed_buffers;  // the registered region in 1 GiB pieces
+   // Rings
+   u8* sq_ring = nullptr;
+   u8* cq_ring = nullptr;
+   u64 sq_ring_bytes = 0, cq_ring_bytes = 0;
+   struct io_uring_sqe* sqes = nullptr;
+   u64 sqes_bytes = 0;
+   u32 *sq_head, *sq_tail, *sq_mask, *sq_flags, *sq_array;
+   u32 *cq_head, *cq_tail, *cq_mask;
+   struct io_uring_cqe* cqes;
+   u32 sq_entries = 0;
+   u32 sq_local_tail = 0;
+   u32 sq_submitted_tail = 0;
+   struct io_uring_sqe* last_sqe = nullptr;                 // queued, not submitted yet
+   u32 ops_after_sync = std::numeric_limits<u32>::max();  // in this batch, max without a sync
+   // -------------------------------------------------------------------------------------
+   void release();
+   struct io_uring_sqe& nextSQE();
+   void prepRW(u8 opcode, u8 fixed_opcode, u8* buffer, u64 bytes, u64 offset, void* user_data);
+   s32 enter(u32 to_submit, u32 min_complete, u32 flags);
+   u64 flush();
+};
+// -------------------------------------------------------------------------------------
+}  // namespace io
+}  // namespace leanstore
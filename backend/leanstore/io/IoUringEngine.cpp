@@ -0,0 +1,272 @@
+#include "IOEngine.hpp"
+
+#include "Exceptions.hpp"
+// -------------------------------------------------------------------------------------
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace io
+{
+// -------------------------------------------------------------------------------------
+namespace
+{
+constexpr u64 FIXED_BUFFER_BITS = 30;  // the kernel registers at most 1 GiB per buffer
+inline u32 loadAcquire(const u32* p)
+{
+   return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+inline void storeRelease(u32* p, u32 v)
+{
+   __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+}  // namespace
+// -------------------------------------------------------------------------------------
+IoUringEngine::IoUringEngine(int fd, u64 depth, bool sqpoll, u8* fixed_region, u64 fixed_bytes) : IOEngine(fd, depth), sqpoll(sqpoll)
+{
+   struct io_uring_params params;
+   memset(&params, 0, sizeof(params));
+   if (sqpoll) {
+      params.flags |= IORING_SETUP_SQPOLL;
+      params.sq_thread_idle = 1000;  // ms
+   }
+   ring_fd = syscall(__NR_io_uring_setup, depth, &params);
+   if (ring_fd < 0) {
+      throw ex::GenericException(std::string("io_uring_setup failed: ") + strerror(errno));
+   }
+   sq_entries = params.sq_entries;
+   // -------------------------------------------------------------------------------------
+   sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(u32);
+   cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+   const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+   if (single_mmap) {
+      sq_ring_bytes = cq_ring_bytes = std::max(sq_ring_bytes, cq_ring_bytes);
+   }
+   sq_ring = reinterpret_cast<u8*>(mmap(nullptr, sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING));
+   cq_ring = single_mmap ? sq_ring
+                         : reinterpret_cast<u8*>(
+                               mmap(nullptr, cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING));
+   sqes_bytes = params.sq_entries * sizeof(struct io_uring_sqe);
+   sqes = reinterpret_cast<struct io_uring_sqe*>(
+       mmap(nullptr, sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+   if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+      const std::string error = strerror(errno);
+      release();
+      throw ex::GenericException("io_uring rings can not be mapped: " + error);
+   }
+   sq_head = reinterpret_cast<u32*>(sq_ring + params.sq_off.head);
+   sq_tail = reinterpret_cast<u32*>(sq_ring + params.sq_off.tail);
+   sq_mask = reinterpret_cast<u32*>(sq_ring + params.sq_off.ring_mask);
+   sq_flags = reinterpret_cast<u32*>(sq_ring + params.sq_off.flags);
+   sq_array = reinterpret_cast<u32*>(sq_ring + params.sq_off.array);
+   cq_head = reinterpret_cast<u32*>(cq_ring + params.cq_off.head);
+   cq_tail = reinterpret_cast<u32*>(cq_ring + params.cq_off.tail);
+   cq_mask = reinterpret_cast<u32*>(cq_ring + params.cq_off.ring_mask);
+   cqes = reinterpret_cast<struct io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+   sq_local_tail = sq_submitted_tail = *sq_tail;
+   // -------------------------------------------------------------------------------------
+   // Both registrations are optimizations, without them the I/O goes through the plain fd and buffers
+   fixed_file = syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_FILES, &fd, 1) == 0;
+   if (fixed_region != nullptr && fixed_bytes > 0) {
+      for (u64 offset = 0; offset < fixed_bytes; offset += (u64(1) << FIXED_BUFFER_BITS)) {
+         fixed_buffers.push_back({fixed_region + offset, std::min<u64>(fixed_bytes - offset, u64(1) << FIXED_BUFFER_BITS)});
+      }
+      if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, fixed_buffers.data(), fixed_buffers.size()) != 0) {
+         // Typically RLIMIT_MEMLOCK
+         fixed_buffers.clear();
+      } else {
+         fixed_base = fixed_region;
+      }
+   }
+}
+// -------------------------------------------------------------------------------------
+IoUringEngine::~IoUringEngine()
+{
+   release();
+}
+// -------------------------------------------------------------------------------------
+void IoUringEngine::release()
+{
+   if (sqes != nullptr && sqes != MAP_FAILED) {
+      munmap(sqes, sqes_bytes);
+   }
+   if (cq_ring != nullptr && cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+      munmap(cq_ring, cq_ring_bytes);
+   }
+   if (sq_ring != nullptr && sq_ring != MAP_FAILED) {
+      munmap(sq_ring, sq_ring_bytes);
+   }
+   sqes = nullptr;
+   sq_ring = cq_ring = nullptr;
+   if (ring_fd >= 0) {
+      close(ring_fd);  // also unregisters the file and the buffers
+      ring_fd = -1;
+   }
+}
+// -------------------------------------------------------------------------------------
+s32 IoUringEngine::enter(u32 to_submit, u32 min_complete, u32 flags)
+{
+   while (true) {
+      const s32 ret = syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0);
+      if (ret >= 0) {
+         return ret;
+      }
+      if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+         throw ex::GenericException(std::string("io_uring_enter failed: ") + strerror(errno));
+      }
+   }
+}
+// -------------------------------------------------------------------------------------
+struct io_uring_sqe& IoUringEngine::nextSQE()
+{
+   assert(queued_ops + in_flight_ops < depth);
+   // The polling thread may not have consumed the previous batch yet
+   while (sq_local_tail - loadAcquire(sq_head) >= sq_entries) {
+      enter(0, 0, sqpoll ? IORING_ENTER_SQ_WAIT : 0);
+   }
+   const u32 idx = sq_local_tail & *sq_mask;
+   struct io_uring_sqe& sqe = sqes[idx];
+   memset(&sqe, 0, sizeof(sqe));
+   sq_array[idx] = idx;
+   sq_local_tail++;
+   queued_ops++;
+   if (fixed_file) {
+      sqe.fd = 0;
+      sqe.flags = IOSQE_FIXED_FILE;
+   } else {
+      sqe.fd = fd;
+   }
+   return sqe;
+}
+// -------------------------------------------------------------------------------------
+void IoUringEngine::prepRW(u8 opcode, u8 fixed_opcode, u8* buffer, u64 bytes, u64 offset, void* user_data)
+{
+   struct io_uring_sqe& sqe = nextSQE();
+   sqe.opcode = opcode;
+   sqe.off = offset;
+   sqe.addr = reinterpret_cast<u64>(buffer);
+   sqe.len = bytes;
+   sqe.user_data = reinterpret_cast<u64>(user_data);
+   if (!fixed_buffers.empty() && buffer >= fixed_base) {
+      const u64 first = u64(buffer - fixed_base) >> FIXED_BUFFER_BITS;
+      const u64 last = u64(buffer + bytes - 1 - fixed_base) >> FIXED_BUFFER_BITS;
+      // A page across two registered buffers goes the unregistered way
+      if (first == last && first < fixed_buffers.size() &&
+          buffer + bytes <= reinterpret_cast<u8*>(fixed_buffers[first].iov_base) + fixed_buffers[first].iov_len) {
+         sqe.opcode = fixed_opcode;
+         sqe.buf_index = first;
+      }
+   }
+   last_sqe = &sqe;
+   ops_after_sync = ops_after_sync == std::numeric_limits<u32>::max() ? ops_after_sync : ops_after_sync + 1;
+}
+// -------------------------------------------------------------------------------------
+void IoUringEngine::prepRead(u8* destination, u64 bytes, u64 offset, void* user_data)
+{
+   prepRW(IORING_OP_READ, IORING_OP_READ_FIXED, destination, bytes, offset, user_data);
+}
+// -------------------------------------------------------------------------------------
+void IoUringEngine::prepWrite(const u8* source, u64 bytes, u64 offset, void* user_data)
+{
+   prepRW(IORING_OP_WRITE, IORING_OP_WRITE_FIXED, const_cast<u8*>(source), bytes, offset, user_data);
+}
+// -------------------------------------------------------------------------------------
+void IoUringEngine::prepSync(void* user_data)
+{
+   // An op that follows a drained sync already waits for everything before it, linking the next
+   // sync to it costs nothing and cancels the sync if it failed (the WAL meta write)
+   if (ops_after_sync == 1) {
+      last_sqe->flags |= IOSQE_IO_LINK;
+   }
+   struct io_uring_sqe& sqe = nextSQE();
+   sqe.opcode = IORING_OP_FSYNC;
+   sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+   sqe.flags |= IOSQE_IO_DRAIN;
+   sqe.user_data = reinterpret_cast<u64>(user_data);
+   last_sqe = &sqe;
+   ops_after_sync = 0;
+}
+// -------------------------------------------------------------------------------------
+// Publishes the queued sqes, returns how many the kernel still has to be told about
+u64 IoUringEngine::flush()
+{
+   storeRelease(sq_tail, sq_local_tail);
+   const u64 to_submit = sq_local_tail - sq_submitted_tail;
+   sq_submitted_tail = sq_local_tail;
+   in_flight_ops += queued_ops;
+   queued_ops = 0;
+   last_sqe = nullptr;
+   ops_after_sync = std::numeric_limits<u32>::max();
+   return to_submit;
+}
+// -------------------------------------------------------------------------------------
+u64 IoUringEngine::submit()
+{
+   const u64 to_submit = flush();
+   if (to_submit == 0) {
+      return 0;
+   }
+   if (sqpoll) {
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      if (loadAcquire(sq_flags) & IORING_SQ_NEED_WAKEUP) {
+         enter(0, 0, IORING_ENTER_SQ_WAKEUP);
+      }
+   } else {
+      u64 submitted = 0;
+      while (submitted < to_submit) {
+         submitted += enter(to_submit - submitted, 0, 0);
+      }
+   }
+   return to_submit;
+}
+// -------------------------------------------------------------------------------------
+u64 IoUringEngine::reap(Completion* completions, u64 min, u64 max)
+{
+   u64 reaped = 0;
+   while (true) {
+      u32 head = *cq_head;
+      const u32 tail = loadAcquire(cq_tail);
+      while (head != tail && reaped < max) {
+         const struct io_uring_cqe& cqe = cqes[head & *cq_mask];
+         completions[reaped++] = {reinterpret_cast<void*>(cqe.user_data), cqe.res};
+         head++;
+      }
+      storeRelease(cq_head, head);
+      if (reaped >= min) {
+         break;
+      }
+      enter(0, min - reaped, IORING_ENTER_GETEVENTS);
+   }
+   in_flight_ops -= reaped;
+   return reaped;
+}
+// -------------------------------------------------------------------------------------
+u64 IoUringEngine::submitAndWait(Completion* completions, u64 n)
+{
+   const u64 to_submit = flush();
+   u32 flags = IORING_ENTER_GETEVENTS;
+   if (sqpoll) {
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      if (loadAcquire(sq_flags) & IORING_SQ_NEED_WAKEUP) {
+         flags |= IORING_ENTER_SQ_WAKEUP;
+      }
+      enter(0, n, flags);
+   } else {
+      // Submits everything and waits for n in one system call
+      u64 submitted = enter(to_submit, n, flags);
+      while (submitted < to_submit) {
+         submitted += enter(to_submit - submitted, 0, 0);
+      }
+   }
+   return reap(completions, n, n);
+}
+// -------------------------------------------------------------------------------------
+}  // namespace io
+}  // namespace leanstore
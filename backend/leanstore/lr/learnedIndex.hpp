@@ -182,6 +182,74 @@ class learnedindex
    inline size_t get_error() const { return error; }
 };
 
+// Least squares fit of the slot position over the slot head (the first 4 key bytes after the prefix),
+// kept in the leaf page as running sums so that an insert or a remove refits in O(1). The sums are
+// integers, hence the fit equals a full train over the heads; only the error bound goes stale and is
+// recomputed by the leaf every few updates.
+struct LeafFit {
+   u64 n = 0;
+   u64 sum_x = 0;
+   u64 sum_xy = 0;
+   // x * x needs 128 bits, kept in halves as the page does not align the node to 16 bytes
+   u64 sum_xx_low = 0;
+   u64 sum_xx_high = 0;
+   double m = 0, c = 0;
+   u16 error = 0;
+   u16 updates = 0;  // since the error was computed
+
+   // x takes position pos, the slots from pos on move up by one, shifted_sum_x is the sum of their x
+   inline void insertAt(u32 x, u64 pos, u64 shifted_sum_x)
+   {
+      sum_xy += shifted_sum_x + static_cast<u64>(x) * pos;
+      sum_x += x;
+      setSumXX(getSumXX() + static_cast<unsigned __int128>(x) * x);
+      n++;
+      updates++;
+      refit();
+   }
+   // x leaves position pos, the slots after it move down by one, shifted_sum_x is the sum of their x
+   inline void removeAt(u32 x, u64 pos, u64 shifted_sum_x)
+   {
+      sum_xy -= shifted_sum_x + static_cast<u64>(x) * pos;
+      sum_x -= x;
+      setSumXX(getSumXX() - static_cast<unsigned __int128>(x) * x);
+      n--;
+      updates++;
+      refit();
+   }
+   inline void refit()
+   {
+      if (n <= 1) {
+         m = 0;
+         c = 0;
+         return;
+      }
+      const unsigned __int128 delta = static_cast<unsigned __int128>(n) * getSumXX() - static_cast<unsigned __int128>(sum_x) * sum_x;
+      const u64 sum_y = n * (n - 1) / 2;
+      if (delta == 0) {
+         // All heads equal
+         m = 0;
+         c = static_cast<double>(sum_y) / n;
+         return;
+      }
+      const __int128 numerator = static_cast<__int128>(n) * sum_xy - static_cast<__int128>(sum_x) * sum_y;
+      const long double slope = static_cast<long double>(numerator) / static_cast<long double>(delta);
+      m = slope;
+      c = (sum_y - slope * sum_x) / static_cast<long double>(n);
+   }
+   inline size_t predict(u32 x) const
+   {
+      const double position = m * x + c;
+      return (position <= 0) ? 0 : static_cast<size_t>(position + 0.5);
+   }
+   inline unsigned __int128 getSumXX() const { return (static_cast<unsigned __int128>(sum_xx_high) << 64) | sum_xx_low; }
+   inline void setSumXX(unsigned __int128 sum_xx)
+   {
+      sum_xx_low = static_cast<u64>(sum_xx);
+      sum_xx_high = static_cast<u64>(sum_xx >> 64);
+   }
+};
+
 template <typename KEY, typename PID>
 void store_models_to_file(const std::string& filename, const ska::flat_hash_map<PID, learnedindex<KEY>>& models)
 {
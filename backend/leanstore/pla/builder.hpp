@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace pla
+{
+// position ~ slope * (x - key) + intercept for the keys from `key` up to the next segment
+template <class KType>
+struct Segment {
+   KType key;
+   double slope;
+   double intercept;
+
+   inline double Estimate(const KType x) const
+   {
+      return (x < key) ? intercept - slope * static_cast<double>(key - x) : slope * static_cast<double>(x - key) + intercept;
+   }
+};
+
+// Builds the fewest segments that keep every key within `max_error` positions in a single
+// pass over sorted data. Each segment keeps the convex hulls of the upper (position + error)
+// and lower (position - error) points it covers, plus the rectangle of the steepest and the
+// flattest line that still fit them, and is closed once the next key falls outside of it.
+// Implementation is based on:
+// J. O'Rourke. An on-line algorithm for fitting straight lines between data ranges. [CACM'81]
+// as used by the PGM-index [VLDB'20].
+template <class KeyType>
+class Builder
+{
+  public:
+   Builder(size_t max_error = 32, size_t start_position = 0) : max_error_(max_error), position_(start_position) {}
+
+   // Adds a key. Assumes that keys are stored in a dense array.
+   void AddKey(KeyType key)
+   {
+      if (num_keys_ > 0 && key == prev_key_) {
+         // Duplicates share the position of their first occurrence
+         position_++;
+         return;
+      }
+      assert(num_keys_ == 0 || key > prev_key_);
+      if (!AddPoint(key, position_)) {
+         segments_.push_back(CurrentSegment());
+         points_in_hull_ = 0;
+         AddPoint(key, position_);
+      }
+      num_keys_++;
+      prev_key_ = key;
+      position_++;
+   }
+
+   std::vector<Segment<KeyType>> Finalize()
+   {
+      if (points_in_hull_ > 0) {
+         segments_.push_back(CurrentSegment());
+         points_in_hull_ = 0;
+      }
+      return std::move(segments_);
+   }
+
+  private:
+   // Relative to the first key of the segment, long double keeps 64 bit keys exact
+   struct Point {
+      long double x, y;
+      Point operator-(const Point& other) const { return {x - other.x, y - other.y}; }
+   };
+   // dy/dx for vectors whose dx have the same sign, compared without dividing
+   static inline bool Flatter(const Point& a, const Point& b) { return a.y * b.x < b.y * a.x; }
+   static inline long double Cross(const Point& o, const Point& a, const Point& b)
+   {
+      return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+   }
+
+   bool AddPoint(const KeyType key, const size_t position)
+   {
+      if (points_in_hull_ == 0) {
+         first_key_ = key;
+      }
+      const long double x = static_cast<long double>(key - first_key_);
+      const Point upper{x, static_cast<long double>(position) + max_error_};
+      const Point lower{x, static_cast<long double>(position) - max_error_};
+      if (points_in_hull_ == 0) {
+         rectangle_[0] = upper;
+         rectangle_[1] = lower;
+         upper_.assign(1, upper);
+         lower_.assign(1, lower);
+         upper_start_ = lower_start_ = 0;
+         points_in_hull_++;
+         return true;
+      }
+      if (points_in_hull_ == 1) {
+         rectangle_[2] = lower;
+         rectangle_[3] = upper;
+         upper_.push_back(upper);
+         lower_.push_back(lower);
+         points_in_hull_++;
+         return true;
+      }
+      // rectangle_[0] -> rectangle_[2] is the flattest line that fits, [1] -> [3] the steepest
+      const Point min_slope = rectangle_[2] - rectangle_[0];
+      const Point max_slope = rectangle_[3] - rectangle_[1];
+      if (Flatter(upper - rectangle_[2], min_slope) || Flatter(max_slope, lower - rectangle_[3])) {
+         return false;
+      }
+      if (Flatter(upper - rectangle_[1], max_slope)) {
+         // The steepest line now pivots on the lower hull point that is flattest towards upper
+         size_t min_i = lower_start_;
+         for (size_t i = lower_start_ + 1; i < lower_.size(); i++) {
+            if (Flatter(upper - lower_[min_i], upper - lower_[i])) {
+               break;
+            }
+            min_i = i;
+         }
+         rectangle_[1] = lower_[min_i];
+         rectangle_[3] = upper;
+         lower_start_ = min_i;
+         size_t end = upper_.size();
+         while (end >= upper_start_ + 2 && Cross(upper_[end - 2], upper_[end - 1], upper) <= 0) {
+            end--;
+         }
+         upper_.resize(end);
+         upper_.push_back(upper);
+      }
+      if (Flatter(min_slope, lower - rectangle_[0])) {
+         // The flattest line now pivots on the upper hull point that is steepest towards lower
+         size_t max_i = upper_start_;
+         for (size_t i = upper_start_ + 1; i < upper_.size(); i++) {
+            if (Flatter(lower - upper_[i], lower - upper_[max_i])) {
+               break;
+            }
+            max_i = i;
+         }
+         rectangle_[0] = upper_[max_i];
+         rectangle_[2] = lower;
+         upper_start_ = max_i;
+         size_t end = lower_.size();
+         while (end >= lower_start_ + 2 && Cross(lower_[end - 2], lower_[end - 1], lower) >= 0) {
+            end--;
+         }
+         lower_.resize(end);
+         lower_.push_back(lower);
+      }
+      points_in_hull_++;
+      return true;
+   }
+
+   // The line through the intersection of the two diagonals, with the mean of their slopes
+   Segment<KeyType> CurrentSegment() const
+   {
+      if (points_in_hull_ == 1) {
+         return {first_key_, 0, static_cast<double>((rectangle_[0].y + rectangle_[1].y) / 2)};
+      }
+      const Point r = rectangle_[2] - rectangle_[0];
+      const Point s = rectangle_[3] - rectangle_[1];
+      const long double min_slope = r.y / r.x;
+      const long double max_slope = s.y / s.x;
+      const long double slope = (min_slope + max_slope) / 2;
+      const long double denominator = r.x * s.y - r.y * s.x;
+      long double intercept;
+      if (denominator == 0) {
+         // Parallel, any line between the two fits
+         intercept = ((rectangle_[0].y - min_slope * rectangle_[0].x) + (rectangle_[1].y - max_slope * rectangle_[1].x)) / 2;
+      } else {
+         const Point q = rectangle_[1] - rectangle_[0];
+         const long double t = (q.x * s.y - q.y * s.x) / denominator;
+         const long double ix = rectangle_[0].x + t * r.x;
+         const long double iy = rectangle_[0].y + t * r.y;
+         intercept = iy - slope * ix;
+      }
+      return {first_key_, static_cast<double>(slope), static_cast<double>(intercept)};
+   }
+
+   const size_t max_error_;
+   size_t position_;
+   size_t num_keys_ = 0;
+   KeyType prev_key_ = 0;
+   KeyType first_key_ = 0;
+
+   size_t points_in_hull_ = 0;
+   Point rectangle_[4];
+   std::vector<Point> upper_, lower_;
+   size_t upper_start_ = 0, lower_start_ = 0;
+
+   std::vector<Segment<KeyType>> segments_;
+};
+
+}  // namespace pla
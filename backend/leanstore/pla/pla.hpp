@@ -0,0 +1,109 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "builder.hpp"
+
+namespace pla
+{
+
+// Optimal piecewise linear approximation of the mapping. The segment of a key is found by
+// binary search or, with a recursive error, by the same kind of model over the first keys of
+// the segments, level by level until one segment is left.
+template <class KeyType>
+class RecursivePLA
+{
+  public:
+   RecursivePLA() = default;
+
+   // Pre: keys sorted. recursive_error = 0 binary searches the segments.
+   void Build(const std::vector<KeyType>& keys, size_t max_error, size_t recursive_error = 4)
+   {
+      max_error_ = max_error;
+      recursive_error_ = recursive_error;
+      num_keys_ = keys.size();
+      levels_.clear();
+      levels_.push_back(BuildLevel(keys, max_error));
+      if (recursive_error == 0) {
+         return;
+      }
+      while (levels_.back().size() > 1) {
+         std::vector<KeyType> first_keys(levels_.back().size());
+         for (size_t i = 0; i < first_keys.size(); i++) {
+            first_keys[i] = levels_.back()[i].key;
+         }
+         levels_.push_back(BuildLevel(first_keys, recursive_error));
+      }
+   }
+
+   // Index of the last segment whose first key is <= key, 0 for keys before the first one
+   inline size_t GetSegment(const KeyType key) const
+   {
+      const auto& bottom = levels_.front();
+      if (levels_.size() == 1) {
+         return UpperBound(bottom, key, 0, bottom.size());
+      }
+      size_t idx = 0;
+      for (size_t level = levels_.size() - 1; level > 0; level--) {
+         const auto& lower = levels_[level - 1];
+         const double estimate = levels_[level][idx].Estimate(key);
+         const size_t pos = (estimate <= 0) ? 0 : std::min<size_t>(estimate, lower.size());
+         size_t begin = (pos > recursive_error_ + 1) ? pos - recursive_error_ - 1 : 0;
+         size_t end = std::min(lower.size(), pos + recursive_error_ + 2);
+         // The window is exact for the keys the level was built on, widen it for the others
+         if (begin > 0 && lower[begin].key > key) {
+            end = begin;
+            begin = 0;
+         } else if (end < lower.size() && lower[end].key <= key) {
+            begin = end;
+            end = lower.size();
+         }
+         idx = UpperBound(lower, key, begin, end);
+      }
+      return idx;
+   }
+   inline double GetEstimatedPosition(const KeyType key) const
+   {
+      if (num_keys_ == 0) {
+         return 0;
+      }
+      const double pos = levels_.front()[GetSegment(key)].Estimate(key);
+      return std::min(std::max(pos, 0.0), static_cast<double>(num_keys_));
+   }
+
+   inline size_t GetNumSegments() const { return levels_.empty() ? 0 : levels_.front().size(); }
+   inline size_t GetNumLevels() const { return levels_.size(); }
+   // Returns the size in bytes.
+   inline size_t GetSize() const
+   {
+      size_t size = sizeof(*this);
+      for (const auto& level : levels_) {
+         size += level.size() * sizeof(Segment<KeyType>);
+      }
+      return size;
+   }
+
+   size_t max_error_ = 0;
+
+  private:
+   size_t recursive_error_ = 0;
+   size_t num_keys_ = 0;
+   // Bottom up, levels_[0] over the keys
+   std::vector<std::vector<Segment<KeyType>>> levels_;
+
+   static std::vector<Segment<KeyType>> BuildLevel(const std::vector<KeyType>& keys, size_t max_error)
+   {
+      Builder<KeyType> builder(max_error);
+      for (const KeyType key : keys) {
+         builder.AddKey(key);
+      }
+      return builder.Finalize();
+   }
+   static inline size_t UpperBound(const std::vector<Segment<KeyType>>& level, const KeyType key, size_t begin, size_t end)
+   {
+      const auto it = std::upper_bound(level.begin() + begin, level.begin() + end, key,
+                                       [](const KeyType key, const Segment<KeyType>& segment) { return key < segment.key; });
+      return (it == level.begin()) ? 0 : (it - level.begin()) - 1;
+   }
+};
+
+}  // namespace pla
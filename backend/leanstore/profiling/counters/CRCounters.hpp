@@ -22,6 +22,7 @@ struct CRCounters {
    // -------------------------------------------------------------------------------------
    atomic<u64> gct_rounds = 0;
    atomic<u64> gct_committed_tx = 0;
+   atomic<u64> gct_commit_latency_us = 0;  // Summed over the committed transactions, from commitTX to the acknowledgement
    // -------------------------------------------------------------------------------------
    CRCounters() {}
    // -------------------------------------------------------------------------------------
@@ -21,6 +21,8 @@ struct WorkerCounters {
    atomic<u64> cold_hit_counter = 0;
    atomic<u64> read_operations_counter = 0;
    atomic<u64> allocate_operations_counter = 0;
+   static constexpr u64 allocate_latency_buckets = 24;
+   atomic<u64> allocate_latency_ns_log2[allocate_latency_buckets] = {0};  // bucket b: [2^b, 2^(b+1)) ns
    atomic<u64> restarts_counter = 0;
    atomic<u64> tx = 0;
    atomic<u64> tx_abort = 0;
@@ -43,6 +45,11 @@ struct WorkerCounters {
    // -------------------------------------------------------------------------------------
    atomic<u64> page_read[max_dt_id] = {0};
    // -------------------------------------------------------------------------------------
+   // Leaf model training queue
+   atomic<u64> leaf_train_enqueued[max_dt_id] = {0};
+   atomic<u64> leaf_train_dequeued[max_dt_id] = {0};
+   atomic<u64> leaf_models_trained[max_dt_id] = {0};
+   // -------------------------------------------------------------------------------------
    constexpr static u64 VW_MAX_STEPS = 10;
    atomic<u64> vw_version_step[max_dt_id][VW_MAX_STEPS] = {0};
    // -------------------------------------------------------------------------------------
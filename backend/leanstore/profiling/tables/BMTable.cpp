@@ -55,9 +55,24 @@ void BMTable::open()
    });
    // -------------------------------------------------------------------------------------
    columns.emplace("allocate_ops", [&](Column& col) { col << (sum(WorkerCounters::worker_counters, &WorkerCounters::allocate_operations_counter)); });
+   columns.emplace("allocate_p50_ns", [&](Column& col) { col << allocateLatencyPercentile(0.5); });
+   columns.emplace("allocate_p99_ns", [&](Column& col) { col << allocateLatencyPercentile(0.99); });
    columns.emplace("r_mib", [&](Column& col) {
       col << (sum(WorkerCounters::worker_counters, &WorkerCounters::read_operations_counter) * EFFECTIVE_PAGE_SIZE / 1024.0 / 1024.0);
    });
+   // -------------------------------------------------------------------------------------
+   // Per NUMA slice
+   if (bm.slices_count > 1) {
+      for (u64 s_i = 0; s_i < bm.slices_count; s_i++) {
+         const std::string prefix = "s" + std::to_string(s_i) + "_";
+         columns.emplace(prefix + "node", [&, s_i](Column& col) { col << bm.slices[s_i].node; });
+         columns.emplace(prefix + "free_pct", [&, s_i](Column& col) { col << (slice_free[s_i] * 100.0 / sliceSize(s_i)); });
+         columns.emplace(prefix + "cool_pct", [&, s_i](Column& col) { col << (slice_cool[s_i] * 100.0 / sliceSize(s_i)); });
+         columns.emplace(prefix + "evicted_mib",
+                         [&, s_i](Column& col) { col << (bm.slices[s_i].evicted_pages.load() * EFFECTIVE_PAGE_SIZE / 1024.0 / 1024.0); });
+         columns.emplace(prefix + "remote_allocs", [&, s_i](Column& col) { col << bm.slices[s_i].remote_allocations.load(); });
+      }
+   }
 }
 // -------------------------------------------------------------------------------------
 void BMTable::next()
@@ -70,9 +85,18 @@ void BMTable::next()
    // -------------------------------------------------------------------------------------
    local_total_free = 0;
    local_total_cool = 0;
-   for (u64 p_i = 0; p_i < bm.partitions_count; p_i++) {
-      local_total_free += bm.partitions[p_i].dram_free_list.counter.load();
-      local_total_cool += bm.partitions[p_i].cooling_bfs_counter.load();
+   slice_free.assign(bm.slices_count, 0);
+   slice_cool.assign(bm.slices_count, 0);
+   for (u64 s_i = 0; s_i < bm.slices_count; s_i++) {
+      for (u64 p_i = bm.slices[s_i].p_begin; p_i < bm.slices[s_i].p_end; p_i++) {
+         slice_free[s_i] += bm.partitions[p_i].dram_free_list.counter.load();
+         slice_cool[s_i] += bm.partitions[p_i].cooling_bfs_counter.load();
+      }
+      local_total_free += slice_free[s_i];
+      local_total_cool += slice_cool[s_i];
+   }
+   for (u64 b_i = 0; b_i < WorkerCounters::allocate_latency_buckets; b_i++) {
+      local_allocate_latency[b_i] = sum(WorkerCounters::worker_counters, &WorkerCounters::allocate_latency_ns_log2, b_i);
    }
    total = local_phase_1_ms + local_phase_2_ms + local_phase_3_ms;
    for (auto& c : columns) {
@@ -80,5 +104,21 @@ void BMTable::next()
    }
 }
 // -------------------------------------------------------------------------------------
+u64 BMTable::allocateLatencyPercentile(double percentile)
+{
+   u64 allocations = 0;
+   for (u64 b_i = 0; b_i < WorkerCounters::allocate_latency_buckets; b_i++) {
+      allocations += local_allocate_latency[b_i];
+   }
+   u64 seen = 0;
+   for (u64 b_i = 0; b_i < WorkerCounters::allocate_latency_buckets; b_i++) {
+      seen += local_allocate_latency[b_i];
+      if (allocations && seen >= percentile * allocations) {
+         return 2ull << b_i;
+      }
+   }
+   return 0;
+}
+// -------------------------------------------------------------------------------------
 }  // namespace profiling
 }  // namespace leanstore
@@ -1,5 +1,6 @@
 #pragma once
 #include "ProfilingTable.hpp"
+#include "leanstore/profiling/counters/WorkerCounters.hpp"
 #include "leanstore/storage/buffer-manager/BufferManager.hpp"
 // -------------------------------------------------------------------------------------
 // -------------------------------------------------------------------------------------
@@ -15,6 +16,11 @@ class BMTable : public ProfilingTable
    BufferManager& bm;
    s64 local_phase_1_ms = 0, local_phase_2_ms = 0, local_phase_3_ms = 0, local_poll_ms = 0, total;
    u64 local_total_free, local_total_cool;
+   std::vector<u64> slice_free, slice_cool;
+   u64 local_allocate_latency[WorkerCounters::allocate_latency_buckets];
+   // Upper bound of the bucket the percentile falls in
+   u64 allocateLatencyPercentile(double percentile);
+   u64 sliceSize(u64 s_i) { return bm.slices[s_i].bf_end - bm.slices[s_i].bf_begin; }
 
   public:
    BMTable(BufferManager& bm);
@@ -26,7 +26,8 @@ void CRTable::open()
    columns.emplace("gct_phase_1_pct", [&](Column& col) { col << 100.0 * p1 / total; });
    columns.emplace("gct_phase_2_pct", [&](Column& col) { col << 100.0 * p2 / total; });
    columns.emplace("gct_write_pct", [&](Column& col) { col << 100.0 * write / total; });
-   columns.emplace("gct_committed_tx", [&](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::gct_committed_tx); });
+   columns.emplace("gct_committed_tx", [&](Column& col) { col << committed_tx; });
+   columns.emplace("gct_commit_latency_us", [&](Column& col) { col << commit_latency_us; });
    columns.emplace("gct_rounds", [&](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::gct_rounds); });
    columns.emplace("tx", [](Column& col) { col << sum(WorkerCounters::worker_counters, &WorkerCounters::tx); });
    columns.emplace("tx_abort", [](Column& col) { col << sum(WorkerCounters::worker_counters, &WorkerCounters::tx_abort); });
@@ -56,6 +57,8 @@ void CRTable::next()
    p2 = sum(CRCounters::cr_counters, &CRCounters::gct_phase_2_ms);
    write = sum(CRCounters::cr_counters, &CRCounters::gct_write_ms);
    total = p1 + p2 + write;
+   committed_tx = sum(CRCounters::cr_counters, &CRCounters::gct_committed_tx);
+   commit_latency_us = committed_tx ? sum(CRCounters::cr_counters, &CRCounters::gct_commit_latency_us) * 1.0 / committed_tx : 0;
    clear();
    for (auto& c : columns) {
       c.second.generator(c.second);
@@ -10,8 +10,8 @@ namespace profiling
 class CRTable : public ProfilingTable
 {
   private:
-   u64 wal_hits, wal_miss;
-   double p1, p2, total, write, wal_total, wal_hit_pct, wal_miss_pct;
+   u64 wal_hits, wal_miss, committed_tx;
+   double p1, p2, total, write, wal_total, wal_hit_pct, wal_miss_pct, commit_latency_us;
 
   public:
    virtual std::string getName();
@@ -41,6 +41,14 @@ void DTTable::open()
                    [&](Column& col) { col << sum(WorkerCounters::worker_counters, &WorkerCounters::xmerge_partial_counter, dt_id); });
    columns.emplace("xmerge_full_counter",
                    [&](Column& col) { col << sum(WorkerCounters::worker_counters, &WorkerCounters::xmerge_full_counter, dt_id); });
+   columns.emplace("leaf_models_trained",
+                   [&](Column& col) { col << sum(WorkerCounters::worker_counters, &WorkerCounters::leaf_models_trained, dt_id); });
+   columns.emplace("leaf_train_queue_depth", [&](Column& col) {
+      auto& depth = leaf_train_queue_depth[dt_id];
+      depth += static_cast<s64>(sum(WorkerCounters::worker_counters, &WorkerCounters::leaf_train_enqueued, dt_id));
+      depth -= static_cast<s64>(sum(WorkerCounters::worker_counters, &WorkerCounters::leaf_train_dequeued, dt_id));
+      col << depth;
+   });
    for (u64 i = 1; i < WorkerCounters::VW_MAX_STEPS; i++) {
       columns.emplace("vw_version_step_" + std::to_string(i),
                       [&, i](Column& col) { col << sum(WorkerCounters::worker_counters, &WorkerCounters::vw_version_step, dt_id, i); });
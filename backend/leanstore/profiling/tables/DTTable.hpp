@@ -14,6 +14,8 @@ class DTTable : public ProfilingTable
   private:
    string dt_name;
    u64 dt_id;
+   // Queued minus drained leafs of every interval so far
+   std::unordered_map<u64, s64> leaf_train_queue_depth;
    BufferManager& bm;
 
   public:
@@ -0,0 +1,132 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace rmi
+{
+
+struct SearchBound {
+   size_t begin;
+   size_t end;  // Exclusive.
+};
+// Two stage recursive model index: a linear root picks one of N linear leaf models, each leaf
+// predicts the position of the key and knows how far off it is for the keys it was trained on.
+// Lines are fitted relative to a base key, so that 64 bit keys keep their precision.
+template <class KeyType>
+class TwoStageRMI
+{
+  public:
+   // Leaf models per key when train() is asked to choose
+   static constexpr size_t AUTO_KEYS_PER_LEAF = 64;
+
+   TwoStageRMI() = default;
+
+   // Pre: keys sorted
+   void train(const std::vector<KeyType>& keys, size_t leaf_models = 0)
+   {
+      num_keys_ = keys.size();
+      base_ = (num_keys_ > 0) ? keys.front() : 0;
+      max_error_ = 0;
+      if (leaf_models == 0) {
+         leaf_models = num_keys_ / AUTO_KEYS_PER_LEAF;
+      }
+      leaf_models = std::max<size_t>(1, std::min(leaf_models, std::max<size_t>(1, num_keys_)));
+      leaves_.assign(leaf_models, Leaf());
+      // Root: key -> leaf, scaled so that the leaves get about the same number of keys
+      const double scale = static_cast<double>(leaf_models) / std::max<size_t>(1, num_keys_);
+      Line root = fit(keys, 0, num_keys_);
+      root_ = {std::max(0.0, root.slope * scale), root.intercept * scale};
+      // Leaves: the root is monotone, so every leaf owns a contiguous range of the keys
+      size_t begin = 0;
+      for (size_t leaf = 0; leaf < leaf_models; leaf++) {
+         size_t end = begin;
+         while (end < num_keys_ && leafOf(keys[end]) == leaf) {
+            end++;
+         }
+         Leaf& model = leaves_[leaf];
+         model.begin = begin;
+         model.end = end;
+         const Line line = fit(keys, begin, end);
+         model.slope = line.slope;
+         model.intercept = line.intercept;
+         for (size_t i = begin; i < end; i++) {
+            const double error = std::abs(estimate(model, keys[i]) - static_cast<double>(i));
+            model.error = std::max<size_t>(model.error, std::ceil(error));
+         }
+         max_error_ = std::max(max_error_, model.error);
+         begin = end;
+      }
+   }
+   // -------------------------------------------------------------------------------------
+   inline size_t leafOf(const KeyType key) const
+   {
+      const double leaf = (key < base_) ? 0 : root_.slope * static_cast<double>(key - base_) + root_.intercept;
+      return (leaf <= 0) ? 0 : std::min<size_t>(leaf, leaves_.size() - 1);
+   }
+   inline double GetEstimatedPosition(const KeyType key) const { return estimate(leaves_[leafOf(key)], key); }
+   // Off by at most this for the keys the leaf of key was trained on
+   inline size_t GetError(const KeyType key) const { return leaves_[leafOf(key)].error; }
+   inline SearchBound GetSearchBound(const KeyType key) const
+   {
+      const Leaf& leaf = leaves_[leafOf(key)];
+      const size_t estimate = this->estimate(leaf, key);
+      const size_t begin = (estimate < leaf.error) ? 0 : (estimate - leaf.error);
+      const size_t end = std::min(estimate + leaf.error + 2, num_keys_);
+      return SearchBound{begin, end};
+   }
+   inline size_t max_error() const { return max_error_; }
+   inline size_t leaf_models() const { return leaves_.size(); }
+   inline size_t GetSize() const { return sizeof(*this) + leaves_.size() * sizeof(Leaf); }
+
+  private:
+   struct Line {
+      double slope = 0, intercept = 0;
+   };
+   struct Leaf {
+      double slope = 0, intercept = 0;
+      // Keys [begin, end) were routed here, estimates are clamped to them
+      size_t begin = 0, end = 0;
+      size_t error = 0;
+   };
+   KeyType base_ = 0;
+   size_t num_keys_ = 0;
+   size_t max_error_ = 0;
+   Line root_;
+   std::vector<Leaf> leaves_;
+
+   inline double estimate(const Leaf& leaf, const KeyType key) const
+   {
+      const double pos = (key < base_) ? 0 : leaf.slope * static_cast<double>(key - base_) + leaf.intercept;
+      return std::min(std::max(pos, static_cast<double>(leaf.begin)), static_cast<double>(leaf.end));
+   }
+   // Least squares line of position over key - base_ for keys [begin, end)
+   Line fit(const std::vector<KeyType>& keys, const size_t begin, const size_t end) const
+   {
+      Line line;
+      const size_t n = end - begin;
+      if (n == 0) {
+         line.intercept = begin;
+         return line;
+      }
+      long double sum_x = 0, sum_y = 0, sum_xy = 0, sum_xx = 0;
+      for (size_t i = begin; i < end; i++) {
+         const long double x = keys[i] - base_;
+         sum_x += x;
+         sum_y += i;
+         sum_xy += x * i;
+         sum_xx += x * x;
+      }
+      const long double delta = n * sum_xx - sum_x * sum_x;
+      if (delta != 0) {
+         line.slope = (n * sum_xy - sum_x * sum_y) / delta;
+      }
+      line.intercept = (sum_y - line.slope * sum_x) / n;
+      return line;
+   }
+};
+
+}  // namespace rmi
@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include "builder.hpp"
+
+namespace spline
+{
+// Builds the spline over `keys[begin, end]` with positions relative to the whole
+// array. Neighbouring ranges have to share their boundary key, the builder always
+// places a knot on the first and the last key of a range.
+template <class KeyType>
+std::vector<Coord<KeyType>> BuildRange(const std::vector<KeyType>& keys, size_t begin, size_t end, size_t max_error)
+{
+   Builder<KeyType> builder(max_error, begin);
+   for (auto i = begin; i <= end; i++) {
+      builder.AddKey(keys[i]);
+   }
+   return builder.Finalize();
+}
+
+// Concatenates the splines of neighbouring ranges built by `BuildRange`. The shared
+// boundary knot appears in both parts and is kept once. Every segment is still one
+// the greedy corridor accepted, so the `max_error` guarantee carries over.
+template <class KeyType>
+std::vector<Coord<KeyType>> StitchRanges(std::vector<std::vector<Coord<KeyType>>>& parts)
+{
+   std::vector<Coord<KeyType>> result;
+   size_t total = 0;
+   for (auto& part : parts) {
+      total += part.size();
+   }
+   result.reserve(total);
+   for (auto& part : parts) {
+      auto first = part.begin();
+      if (!result.empty() && first != part.end() && first->x == result.back().x) {
+         first++;
+      }
+      result.insert(result.end(), first, part.end());
+   }
+   return result;
+}
+}  // namespace spline
@@ -0,0 +1,69 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "builder.hpp"
+
+namespace spline
+{
+// Re-fits only the spline segments touched by `dirty_keys` after the underlying
+// dense key array changed from the one `points` was built on to `keys`.
+//
+// Every dirty key was either inserted into or removed from the key array. A
+// segment that contains no dirty key keeps its shape, its knots only move by the
+// number of keys inserted/removed in front of them. Segments that contain a dirty
+// key are rebuilt with the greedy corridor between the closest untouched knots,
+// which keeps the `max_error` guarantee of the whole spline.
+template <class KeyType>
+std::vector<Coord<KeyType>> RefitSegments(const std::vector<Coord<KeyType>>& points,
+                                          const std::vector<KeyType>& keys,
+                                          const std::vector<KeyType>& dirty_keys,
+                                          size_t max_error)
+{
+   std::vector<Coord<KeyType>> result;
+   if (keys.empty()) {
+      return result;
+   }
+   const long knots = points.size();
+   auto position_of = [&](const KeyType key) -> size_t { return std::lower_bound(keys.begin(), keys.end(), key) - keys.begin(); };
+   // Knot windows (lo, hi) whose interior has to be rebuilt. lo == -1 and hi == knots
+   // stand for the first/last key of the new array.
+   std::vector<std::pair<long, long>> windows;
+   for (auto key : dirty_keys) {
+      auto lb = std::lower_bound(points.begin(), points.end(), key, [](const Coord<KeyType>& coord, const KeyType k) { return coord.x < k; });
+      long s = lb - points.begin();
+      // The knot itself may have disappeared, so it cannot be used as an anchor
+      long hi = (s < knots && points[s].x == key) ? s + 1 : s;
+      windows.push_back({s - 1, std::min(hi, knots)});
+   }
+   std::sort(windows.begin(), windows.end());
+   std::vector<std::pair<long, long>> merged;
+   for (auto& window : windows) {
+      if (!merged.empty() && window.first <= merged.back().second) {
+         merged.back().second = std::max(merged.back().second, window.second);
+      } else {
+         merged.push_back(window);
+      }
+   }
+   // -------------------------------------------------------------------------------------
+   long k = 0;
+   for (auto& [lo, hi] : merged) {
+      for (; k <= lo; k++) {
+         result.push_back({points[k].x, static_cast<double>(position_of(points[k].x))});
+      }
+      const size_t begin = (lo < 0) ? 0 : position_of(points[lo].x);
+      const size_t end = (hi >= knots) ? keys.size() - 1 : position_of(points[hi].x);
+      Builder<KeyType> builder(max_error, begin);
+      for (auto i = begin; i <= end; i++) {
+         builder.AddKey(keys[i]);
+      }
+      auto rebuilt = builder.Finalize();
+      // The lower anchor was already emitted, the upper one is the last rebuilt point
+      result.insert(result.end(), rebuilt.begin() + ((lo < 0) ? 0 : 1), rebuilt.end());
+      k = hi + 1;
+   }
+   for (; k < knots; k++) {
+      result.push_back({points[k].x, static_cast<double>(position_of(points[k].x))});
+   }
+   return result;
+}
+}  // namespace spline
@@ -2,6 +2,7 @@
 #include "core/BTreeGenericIterator.hpp"
 #include "leanstore/concurrency-recovery/CRMG.hpp"
 #include "leanstore/fold.hpp"
+#include "leanstore/utils/Parallelize.hpp"
 // #include "leanstore/BTreeAdapter.hpp"
 // #include "leanstore/utils/convert.hpp"
 #ifdef INSTURMENT_CODE
@@ -13,6 +14,7 @@
 #include "gflags/gflags.h"
 // -------------------------------------------------------------------------------------
 #include <signal.h>
+#include <chrono>
 // -------------------------------------------------------------------------------------
 using namespace std;
 using namespace leanstore::storage;
@@ -284,27 +286,26 @@ OP_RESULT BTreeLL::lookup_simulate_long_tail(u8* key, u16 key_length, function<v
 OP_RESULT BTreeLL::fast_tail_lookup(u8* key_bytes, u16 key_length, function<void(const u8*, u16)> payload_callback)
 {
    auto key = utils::u8_to<KEY>(key_bytes, key_length);
-   if (std::shared_lock<std::shared_mutex> lock(model_lock);
-       trained && lock.owns_lock() && mapping_key[0] <= key && key <= mapping_key[mapping_key.size() - 1]) {
+   const MODEL_KEY model_key = modelKey(key_bytes, key_length);
+   EpochGuard epoch_guard;
+   if (auto model = currentModel(); model != nullptr && model->covers(model_key)) {
       // std::cout << "Using segment" << std::endl;
-      auto spline_idx = spline_predictor.GetSplineSegment(key);
-      auto leaf_idx = spline_predictor.GetEstimatedPosition(key, spline_idx, mapping_key);
-      BufferFrame* leaf_bf = mapping_bfs[leaf_idx];
+      auto leaf_idx = model->search(model_key);
+      BufferFrame* leaf_bf = model->bf(leaf_idx);
       // Simulate disk access with probability
       auto prob = rand() / static_cast<float>(RAND_MAX);
       if (prob < MISS_PROB) {
          // std::cout << "Reading page from the disk" << std::endl;
-         auto pid = mapping_pid[leaf_idx];
+         auto pid = model->pid(leaf_idx);
          BufferFrame testbf;
          BMC::global_bf->getPage(pid, &testbf);
       }
       // end of simulation code
 
 #ifdef PID_CHECK
-      if (auto pid = mapping_pid[leaf_idx]; leaf_bf == nullptr || leaf_bf->header.pid != pid) {
+      if (auto pid = model->pid(leaf_idx); leaf_bf == nullptr || leaf_bf->header.pid != pid) {
          auto info = BMC::global_bf->getPageinBufferPool(pid);
          leaf_bf = info.bf;
-         mapping_bfs[leaf_idx] = leaf_bf;
       }
 #endif
       // BufferFrame* leaf_bf = fastTrainFindLeafUsingSegmentAttachedAtRoot(key);
@@ -313,14 +314,19 @@ OP_RESULT BTreeLL::fast_tail_lookup(u8* key_bytes, u16 key_length, function<void
          s16 pos = 0;
 #ifdef MODEL_IN_LEAF_NODE
 #ifdef MODEL_LR
-         auto swip = leaf.swip();
-         auto bf = swip.bfPtr();
          auto key_length = sizeof(KEY);
          u8 key_bytes[key_length];
          fold(key_bytes, key);
+#ifdef INCREMENTAL_LEAF_MODEL
+         pos = leaf->fitSearch<true>(key_bytes, key_length);
+#else
+         auto swip = leaf.swip();
+         auto bf = swip.bfPtr();
          if (auto& model = bf->header.model; model.m == 0) {
             auto predict = bf->header.model.predict(key);
-#ifdef EXPONENTIAL_SEARCH
+#if defined(SIMD_LEAF_SEARCH)
+            pos = leaf->modelSearch<true>(key_bytes, key_length, predict, model.get_error());
+#elif defined(EXPONENTIAL_SEARCH)
             pos = leaf->exponentialSearch(key_bytes, key_length, predict);
 #else
             auto search_bound = bf->header.model.get_searchbound(predict, leaf->count);
@@ -352,6 +358,7 @@ OP_RESULT BTreeLL::fast_tail_lookup(u8* key_bytes, u16 key_length, function<void
          } else {
             pos = leaf->lowerBound<true>(key_bytes, key_length);
          }
+#endif
 #else
          auto spline_idx = leaf_bf->header.splines.GetSplineSegment(key);
          auto predict = leaf_bf->header.splines.GetEstimatedPosition(key, spline_idx);
@@ -557,10 +564,10 @@ OP_RESULT BTreeLL::fast_trained_lookup(KEY key, function<void(const u8*, u16)> p
          HybridPageGuard<BTreeNode> leaf;
 #ifdef ATTACH_AT_ROOT
          // fastTrainFindLeafUsingSegmentAttachedAtRoot(leaf, key, key_bytes);
-         fastTrainFindLeafUsingSegment(leaf, key, key_bytes);
+         fastTrainFindLeafUsingSegment(leaf, modelKey(key), key_bytes);
 
 #else
-         fastTrainFindLeafUsingSegment(leaf, key, key_bytes);
+         fastTrainFindLeafUsingSegment(leaf, modelKey(key), key_bytes);
 #endif
          // -------------------------------------------------------------------------------------
          DEBUG_BLOCK()
@@ -632,98 +639,32 @@ OP_RESULT BTreeLL::fast_trained_lookup(KEY key, function<void(const u8*, u16)> p
    }
 }
 
-OP_RESULT BTreeLL::fast_trained_lookup_new(const KEY key)
+template <typename Key>
+OP_RESULT BTreeLL::fast_trained_lookup_new(const Key key)
 {
-   if (std::shared_lock<std::shared_mutex> lock(model_lock);
-       lock.owns_lock() && trained && mapping_key[0] <= key && key <= mapping_key[mapping_key.size() - 1]) {
-      auto spline_idx = spline_predictor.GetSplineSegment(key);
-      auto leaf_idx = spline_predictor.GetEstimatedPosition(key, spline_idx, mapping_key);
-      BufferFrame* leaf_bf = mapping_bfs[leaf_idx];
+   const MODEL_KEY model_key = modelKey(key);
+   EpochGuard epoch_guard;
+   if (auto model = currentModel(); model != nullptr && model->covers(model_key)) {
+      auto leaf_idx = model->search(model_key);
+      PID leaf_pid = 0;
+      BufferFrame* leaf_bf = nullptr;
+      const bool from_delta =
+          !mapping_deltas.empty() && mapping_deltas.resolve(model_key, model->keys(), leaf_idx, leaf_pid, leaf_bf, model->folded_seq);
+      if (!from_delta) {
+         leaf_pid = model->pid(leaf_idx);
+         leaf_bf = model->bf(leaf_idx);
+      }
+      leaf_access_sketch.record(leaf_pid);
 #ifdef PID_CHECK
-      if (auto pid = mapping_pid[leaf_idx]; leaf_bf == nullptr || leaf_bf->header.pid != pid) {
-         auto info = BMC::global_bf->getPageinBufferPool(pid);
+      if (leaf_bf == nullptr || leaf_bf->header.pid != leaf_pid) {
+         auto info = BMC::global_bf->getPageinBufferPool(leaf_pid);
          leaf_bf = info.bf;
-         mapping_bfs[leaf_idx] = leaf_bf;
       }
 #endif
       // BufferFrame* leaf_bf = fastTrainFindLeafUsingSegmentAttachedAtRoot(key);
       if (leaf_bf != nullptr) {
          HybridPageGuard<BTreeNode> leaf(leaf_bf);
-         s16 pos = 0;
-#ifdef MODEL_IN_LEAF_NODE
-#ifdef MODEL_LR
-
-         auto swip = leaf.swip();
-         auto bf = swip.bfPtr();
-         auto key_length = sizeof(KEY);
-         u8 key_bytes[key_length];
-         fold(key_bytes, key);
-         // if (auto& model = bf->header.model; model.version == bf->page.GSN) {
-         if (auto& model = bf->header.model; model.m == 0) {
-            auto predict = model.predict(key);
-
-#ifdef EXPONENTIAL_SEARCH
-            pos = leaf->exponentialSearch(key_bytes, key_length, predict);
-#else
-            auto search_bound = bf->header.model.get_searchbound(predict, leaf->count);
-            pos = leaf->binarySearch(key_bytes, key_length, search_bound.begin, search_bound.end);
-#endif
-            // ensure(predict == pos);
-            // if (predict != pos) {
-            //    std::cout << "leaf node prediction error" << std::endl;
-            // }
-            //          auto leaf_model = leaf_node_models.find(leaf_bf->header.pid);
-            //          if (leaf_model != leaf_node_models.end()) {
-            //             // INFO("Found model in leaf node");
-            //             auto predict = leaf_model->second.search(key);
-            // // INFO("Predicted position %d", predict);
-            // #ifdef EXPONENTIAL_SEARCH
-            //             pos = leaf->exponentialSearch(key_bytes, key_length, predict);
-            // #else
-            //             auto search_bound = leaf_model->second.get_searchbound(predict, leaf->count);
-            //             auto key_length = sizeof(KEY);
-            //             u8 key_bytes[key_length];
-            //             fold(key_bytes, key);
-            //             // INFO("Search bound %d %d", search_bound.begin, search_bound.end);
-            //             pos = leaf->binarySearch(key_bytes, key_length, search_bound.begin, search_bound.end);
-            // #endif
-            //             // INFO("Found position %d", pos);
-            //          } else {
-            //             std::cout << "All leaf node should have models attached to it" << std::endl;
-            //             auto key_length = sizeof(KEY);
-            //             u8 key_bytes[key_length];
-            //             fold(key_bytes, key);
-            //             pos = leaf->lowerBound<true>(key_bytes, key_length);
-            //          }
-         } else {
-            pos = leaf->lowerBound<true>(key_bytes, key_length);
-         }
-#else
-         auto spline_idx = leaf_bf->header.splines.GetSplineSegment(key);
-         auto predict = leaf_bf->header.splines.GetEstimatedPosition(key, spline_idx);
-         auto search_bound = leaf_bf->header.splines.GetSearchBound(predict);
-         pos = leaf->binarySearch(key_bytes, key_length, search_bound.begin, search_bound.end);
-         // auto leaf_model = leaf_node_segments.find(leaf_bf->header.pid);
-         // if (leaf_model != leaf_node_segments.end()) {
-         //    // INFO("Found model in leaf node");
-         //    auto spline_idx = leaf_model->second.GetSplineSegment(key);
-         //    // INFO("Spline index %d", spline_idx);
-         //    auto predict = leaf_model->second.GetEstimatedPosition(key, spline_idx);
-         //    // INFO("Predicted position %d", predict);
-         //    auto search_bound = leaf_model->second.GetSearchBound(predict);
-         //    // INFO("Search bound %d %d", search_bound.begin, search_bound.end);
-         //    pos = leaf->binarySearch(key_bytes, key_length, search_bound.begin, search_bound.end);
-         //    // INFO("Found position %d", pos);
-         // } else {
-         //    pos = leaf->lowerBound<true>(key_bytes, key_length);
-         // }
-#endif
-#else
-         auto key_length = sizeof(KEY);
-         u8 key_bytes[key_length];
-         fold(key_bytes, key);
-         pos = leaf->lowerBound<true>(key_bytes, key_length);
-#endif
+         const s16 pos = searchLeaf(leaf, key);
          if (pos != -1) {
             // payload_callback(leaf->getPayload(pos), leaf->getPayloadLength(pos));
             // INFO("4 leaf_bf: %p key: %lu", leaf_bf, key);
@@ -735,7 +676,7 @@ OP_RESULT BTreeLL::fast_trained_lookup_new(const KEY key)
             // if (lf_key >= key && uf_key < key) {
             //    return OP_RESULT::NOT_FOUND;
             // }
-            auto key_length = sizeof(KEY);
+            auto key_length = sizeof(Key);
             u8 key_bytes[key_length];
             fold(key_bytes, key);
             s16 sanity_check_result = leaf->compareKeyWithBoundaries(key_bytes, key_length);
@@ -757,26 +698,36 @@ OP_RESULT BTreeLL::fast_trained_lookup_new(const KEY key)
          }
       }
    }
-   auto key_length = sizeof(KEY);
+   auto key_length = sizeof(Key);
    u8 key_bytes[key_length];
    fold(key_bytes, key);
    // return lookup(key_bytes, key_length, payload_callback);
    return OP_RESULT::NOT_FOUND;
 }
 
-OP_RESULT BTreeLL::fast_trained_lookup_new(const KEY key, function<void(const u8*, u16)> payload_callback)
+template <typename Key>
+OP_RESULT BTreeLL::fast_trained_lookup_new(const Key key, function<void(const u8*, u16)> payload_callback)
 {
-   if (std::shared_lock<std::shared_mutex> lock(model_lock);
-       lock.owns_lock() && trained && mapping_key[0] <= key && key <= mapping_key[mapping_key.size() - 1]) {
+   const MODEL_KEY model_key = modelKey(key);
+   EpochGuard epoch_guard;
+   if (auto model = currentModel(); model != nullptr && model->covers(model_key)) {
       // std::cout << "Using segment" << std::endl;
-      auto spline_idx = spline_predictor.GetSplineSegment(key);
-      auto leaf_idx = spline_predictor.GetEstimatedPosition(key, spline_idx, mapping_key);
-      BufferFrame* leaf_bf = mapping_bfs[leaf_idx];
+      auto leaf_idx = model->search(model_key);
+      PID leaf_pid = 0;
+      BufferFrame* leaf_bf = nullptr;
+      const bool from_delta =
+          !mapping_deltas.empty() && mapping_deltas.resolve(model_key, model->keys(), leaf_idx, leaf_pid, leaf_bf, model->folded_seq);
+      if (!from_delta) {
+         leaf_pid = model->pid(leaf_idx);
+         leaf_bf = model->bf(leaf_idx);
+      }
+      leaf_access_sketch.record(leaf_pid);
 #ifdef PID_CHECK
-      if (auto pid = mapping_pid[leaf_idx]; leaf_bf == nullptr || leaf_bf->header.pid != pid) {
+      if (auto pid = leaf_pid; leaf_bf == nullptr || leaf_bf->header.pid != pid) {
          auto info = BMC::global_bf->pageInBufferFrame(pid);
+         // The fences there are KEY wide, wider keys read the page and let the boundary check below catch a misprediction
          if (info.bf == nullptr) {
-            if (info.lower_fence <= key && key < info.upper_fence) {
+            if (sizeof(Key) != sizeof(KEY) || (info.lower_fence <= key && key < info.upper_fence)) {
                info = BMC::global_bf->getPageinBufferPool(pid);
             } else {
                // misprediction detected
@@ -784,7 +735,7 @@ OP_RESULT BTreeLL::fast_trained_lookup_new(const KEY key, function<void(const u8
                incorrect_leaf++;
                train_signal.notify_one();
 #endif
-               auto key_length = sizeof(KEY);
+               auto key_length = sizeof(Key);
                u8 key_bytes[key_length];
                fold(key_bytes, key);
                return lookup(key_bytes, key_length, payload_callback);
@@ -792,80 +743,12 @@ OP_RESULT BTreeLL::fast_trained_lookup_new(const KEY key, function<void(const u8
          }
          // auto info = BMC::global_bf->getPageinBufferPool(pid);
          leaf_bf = info.bf;
-         mapping_bfs[leaf_idx] = leaf_bf;
       }
 #endif
       // BufferFrame* leaf_bf = fastTrainFindLeafUsingSegmentAttachedAtRoot(key);
       if (leaf_bf != nullptr) {
          HybridPageGuard<BTreeNode> leaf(leaf_bf);
-         s16 pos = 0;
-#ifdef MODEL_IN_LEAF_NODE
-#ifdef MODEL_LR
-         auto swip = leaf.swip();
-         auto bf = swip.bfPtr();
-         auto key_length = sizeof(KEY);
-         u8 key_bytes[key_length];
-         fold(key_bytes, key);
-         if (auto& model = bf->header.model; model.m == 0) {
-            auto predict = bf->header.model.predict(key);
-#ifdef EXPONENTIAL_SEARCH
-            pos = leaf->exponentialSearch(key_bytes, key_length, predict);
-#else
-            auto search_bound = bf->header.model.get_searchbound(predict, leaf->count);
-            pos = leaf->binarySearch(key_bytes, key_length, search_bound.begin, search_bound.end);
-#endif
-            //          auto leaf_model = leaf_node_models.find(leaf_bf->header.pid);
-            //          if (leaf_model != leaf_node_models.end()) {
-            //             // INFO("Found model in leaf node");
-            //             auto predict = leaf_model->second.predict(key);
-            // // INFO("Predicted position %d", predict);
-            // #ifdef EXPONENTIAL_SEARCH
-            //             pos = leaf->exponentialSearch(key_bytes, key_length, predict);
-            // #else
-            //             auto search_bound = leaf_model->second.get_searchbound(predict, leaf->count);
-            //             auto key_length = sizeof(KEY);
-            //             u8 key_bytes[key_length];
-            //             fold(key_bytes, key);
-            //             // INFO("Search bound %d %d", search_bound.begin, search_bound.end);
-            //             pos = leaf->binarySearch(key_bytes, key_length, search_bound.begin, search_bound.end);
-            // #endif
-            //             // INFO("Found position %d", pos);
-            //          } else {
-            //             std::cout << "All leaf node should have models attached to it" << std::endl;
-            //             auto key_length = sizeof(KEY);
-            //             u8 key_bytes[key_length];
-            //             fold(key_bytes, key);
-            //             pos = leaf->lowerBound<true>(key_bytes, key_length);
-            //          }
-         } else {
-            pos = leaf->lowerBound<true>(key_bytes, key_length);
-         }
-#else
-         auto spline_idx = leaf_bf->header.splines.GetSplineSegment(key);
-         auto predict = leaf_bf->header.splines.GetEstimatedPosition(key, spline_idx);
-         auto search_bound = leaf_bf->header.splines.GetSearchBound(predict);
-         pos = leaf->binarySearch(key_bytes, key_length, search_bound.begin, search_bound.end);
-         // auto leaf_model = leaf_node_segments.find(leaf_bf->header.pid);
-         // if (leaf_model != leaf_node_segments.end()) {
-         //    // INFO("Found model in leaf node");
-         //    auto spline_idx = leaf_model->second.GetSplineSegment(key);
-         //    // INFO("Spline index %d", spline_idx);
-         //    auto predict = leaf_model->second.GetEstimatedPosition(key, spline_idx);
-         //    // INFO("Predicted position %d", predict);
-         //    auto search_bound = leaf_model->second.GetSearchBound(predict);
-         //    // INFO("Search bound %d %d", search_bound.begin, search_bound.end);
-         //    pos = leaf->binarySearch(key_bytes, key_length, search_bound.begin, search_bound.end);
-         //    // INFO("Found position %d", pos);
-         // } else {
-         //    pos = leaf->lowerBound<true>(key_bytes, key_length);
-         // }
-#endif
-#else
-         auto key_length = sizeof(KEY);
-         u8 key_bytes[key_length];
-         fold(key_bytes, key);
-         pos = leaf->lowerBound<true>(key_bytes, key_length);
-#endif
+         const s16 pos = searchLeaf(leaf, key);
          if (pos != -1) {
             payload_callback(leaf->getPayload(pos), leaf->getPayloadLength(pos));
             // INFO("4 leaf_bf: %p key: %lu", leaf_bf, key);
@@ -877,7 +760,7 @@ OP_RESULT BTreeLL::fast_trained_lookup_new(const KEY key, function<void(const u8
             // if (lf_key >= key && uf_key < key) {
             //    return OP_RESULT::NOT_FOUND;
             // }
-            auto key_length = sizeof(KEY);
+            auto key_length = sizeof(Key);
             u8 key_bytes[key_length];
             fold(key_bytes, key);
             s16 sanity_check_result = leaf->compareKeyWithBoundaries(key_bytes, key_length);
@@ -899,12 +782,161 @@ OP_RESULT BTreeLL::fast_trained_lookup_new(const KEY key, function<void(const u8
          }
       }
    }
-   auto key_length = sizeof(KEY);
+   auto key_length = sizeof(Key);
    u8 key_bytes[key_length];
    fold(key_bytes, key);
    return lookup(key_bytes, key_length, payload_callback);
    return OP_RESULT::NOT_FOUND;
 }
+// -------------------------------------------------------------------------------------
+template <typename Key>
+s16 BTreeLL::searchLeaf(HybridPageGuard<BTreeNode>& leaf, const Key key)
+{
+   auto key_length = sizeof(Key);
+   u8 key_bytes[key_length];
+   fold(key_bytes, key);
+#ifdef MODEL_IN_LEAF_NODE
+#ifdef MODEL_LR
+#ifdef INCREMENTAL_LEAF_MODEL
+   return leaf->fitSearch<true>(key_bytes, key_length);
+#else
+   // The frame models are trained over KEY, wider keys search the whole leaf
+   if (auto& model = leaf.bf->header.model; sizeof(Key) == sizeof(KEY) && model.m == 0) {
+      auto predict = model.predict(key);
+#if defined(SIMD_LEAF_SEARCH)
+      return leaf->modelSearch<true>(key_bytes, key_length, predict, model.get_error());
+#elif defined(EXPONENTIAL_SEARCH)
+      return leaf->exponentialSearch(key_bytes, key_length, predict);
+#else
+      auto search_bound = model.get_searchbound(predict, leaf->count);
+      return leaf->binarySearch(key_bytes, key_length, search_bound.begin, search_bound.end);
+#endif
+   }
+#endif
+#else
+   if (sizeof(Key) == sizeof(KEY)) {
+      auto& splines = leaf.bf->header.splines;
+      auto predict = splines.GetEstimatedPosition(key, splines.GetSplineSegment(key));
+      auto search_bound = splines.GetSearchBound(predict);
+      return leaf->binarySearch(key_bytes, key_length, search_bound.begin, search_bound.end);
+   }
+#endif
+#endif
+   return leaf->lowerBound<true>(key_bytes, key_length);
+}
+// -------------------------------------------------------------------------------------
+// Group prefetching: every stage issues the prefetch for the next one of all keys in the group
+// before any of them is used, so one miss per stage is paid for the whole group.
+// Keys that leave the learned path (not covered, stale frame, wrong leaf) take fast_trained_lookup_new.
+template <typename Key>
+u64 BTreeLL::multi_get(const Key* keys, const u64 n, function<void(u64 key_i, const u8* payload, u16 payload_length)> payload_callback)
+{
+   struct InFlight {
+      MODEL_KEY model_key;
+      double estimate;
+      size_t leaf_idx;
+      PID pid;
+      BufferFrame* bf;
+      bool learned;
+   };
+   constexpr u64 max_group = 64;
+   const u64 group = std::max<u64>(1, std::min<u64>(FLAGS_multi_get_group, max_group));
+   InFlight in_flight[max_group];
+   u64 found = 0;
+   for (u64 begin = 0; begin < n; begin += group) {
+      const u64 count = std::min(group, n - begin);
+      EpochGuard epoch_guard;
+      auto model = currentModel();
+      // 1. model estimate, prefetch the mapping window
+      for (u64 i = 0; i < count; i++) {
+         auto& f = in_flight[i];
+         f.model_key = modelKey(keys[begin + i]);
+         f.learned = model != nullptr && model->covers(f.model_key);
+         if (f.learned) {
+            f.estimate = model->estimate(f.model_key);
+            model->prefetchKeys(f.estimate);
+         }
+      }
+      // 2. last mile search, prefetch the pid/frame of the leaf
+      for (u64 i = 0; i < count; i++) {
+         auto& f = in_flight[i];
+         if (f.learned) {
+            f.leaf_idx = model->searchFrom(f.model_key, f.estimate);
+            model->prefetchLeaf(f.leaf_idx);
+         }
+      }
+      // 3. resolve the frame, prefetch its header for the pid check and the leaf model
+      for (u64 i = 0; i < count; i++) {
+         auto& f = in_flight[i];
+         if (f.learned) {
+            f.pid = 0;
+            f.bf = nullptr;
+            if (mapping_deltas.empty() || !mapping_deltas.resolve(f.model_key, model->keys(), f.leaf_idx, f.pid, f.bf, model->folded_seq)) {
+               f.pid = model->pid(f.leaf_idx);
+               f.bf = model->bf(f.leaf_idx);
+            }
+            leaf_access_sketch.record(f.pid);
+            if (f.bf == nullptr) {
+               f.learned = false;
+               continue;
+            }
+            __builtin_prefetch(&f.bf->header.pid);
+#ifndef INCREMENTAL_LEAF_MODEL
+            __builtin_prefetch(&f.bf->header.model);
+#endif
+         }
+      }
+      // 4. pid check, prefetch the node header and the predicted slot
+      for (u64 i = 0; i < count; i++) {
+         auto& f = in_flight[i];
+         if (f.learned) {
+#ifdef PID_CHECK
+            if (f.bf->header.pid != f.pid) {
+               f.learned = false;
+               continue;
+            }
+#endif
+            auto node = reinterpret_cast<BTreeNode*>(f.bf->page.dt);
+            __builtin_prefetch(node);
+#if defined(MODEL_IN_LEAF_NODE) && defined(MODEL_LR) && !defined(INCREMENTAL_LEAF_MODEL)
+            if (auto& leaf_model = f.bf->header.model; sizeof(Key) == sizeof(KEY) && leaf_model.m == 0) {
+               __builtin_prefetch(&node->slot[std::min<size_t>(leaf_model.predict(keys[begin + i]), BTreeNode::pure_slots_capacity - 1)]);
+            }
+#endif
+         }
+      }
+      // 5. search the leafs
+      for (u64 i = 0; i < count; i++) {
+         const u64 key_i = begin + i;
+         const Key key = keys[key_i];
+         auto callback = [&](const u8* payload, u16 payload_length) { payload_callback(key_i, payload, payload_length); };
+         if (in_flight[i].learned) {
+            HybridPageGuard<BTreeNode> leaf(in_flight[i].bf);
+            const s16 pos = searchLeaf(leaf, key);
+            if (pos != -1) {
+               callback(leaf->getPayload(pos), leaf->getPayloadLength(pos));
+               found++;
+               continue;
+            }
+            auto key_length = sizeof(Key);
+            u8 key_bytes[key_length];
+            fold(key_bytes, key);
+            if (leaf->compareKeyWithBoundaries(key_bytes, key_length) == 0) {
+               continue;
+            }
+#ifdef SMO_STATS
+            incorrect_leaf++;
+            train_signal.notify_one();
+#endif
+         }
+         if (fast_trained_lookup_new(key, callback) == OP_RESULT::OK) {
+            found++;
+         }
+      }
+   }
+   return found;
+}
+// -------------------------------------------------------------------------------------
 OP_RESULT BTreeLL::trained_lookup(KEY key, function<void(const u8*, u16)> payload_callback)
 {
 #ifdef INSTRUMENT_CODE
@@ -960,7 +992,7 @@ OP_RESULT BTreeLL::trained_lookup(KEY key, function<void(const u8*, u16)> payloa
          // BufferFrame newbf;
          // BufferFrame* bfptr = &newbf;
          // findLeafUsingSegment(leaf, key, key_length, bfptr);
-         findLeafUsingSegment(leaf, key, key_bytes);
+         findLeafUsingSegment(leaf, modelKey(key), key_bytes);
          // -------------------------------------------------------------------------------------
          DEBUG_BLOCK()
          {
@@ -1022,6 +1054,7 @@ OP_RESULT BTreeLL::trained_lookup(KEY key, function<void(const u8*, u16)> payloa
 OP_RESULT BTreeLL::scanAscAllSeg(std::function<bool(const u8* key, u16 key_length, const u8* payload, u16 payload_length)> callback)
 {
    // MyNote:: Slice -> std::string_view
+   EpochGuard epoch_guard;
    jumpmuTry()
    {  // TODO:: looke more into described interator
       BTreeSharedIterator iterator(*static_cast<BTreeGeneric*>(this));
@@ -1154,6 +1187,7 @@ OP_RESULT BTreeLL::scanAscSeg(KEY key,
                               u64 rlength)
 {
    Slice key1(start_key, key_length);
+   EpochGuard epoch_guard;
    jumpmuTry()
    {
       // TODO:: looke more into described interator
@@ -1228,8 +1262,8 @@ OP_RESULT BTreeLL::fast_insert(u8* o_key, u16 o_key_length, u8* o_value, u16 o_v
          wal_entry.submit();
       } else {
          iterator.leaf.incrementGSN();
-         // train_leaf_signal.notify_one();
       }
+      markLeafDirty(iterator.leaf.bf);
       jumpmu_return OP_RESULT::OK;
    }
    jumpmuCatch()
@@ -1258,6 +1292,7 @@ OP_RESULT BTreeLL::insert(u8* o_key, u16 o_key_length, u8* o_value, u16 o_value_
       } else {
          iterator.leaf.incrementGSN();
       }
+      markLeafDirty(iterator.leaf.bf);
       jumpmu_return OP_RESULT::OK;
    }
    jumpmuCatch()
@@ -1266,6 +1301,33 @@ OP_RESULT BTreeLL::insert(u8* o_key, u16 o_key_length, u8* o_value, u16 o_value_
    }
 }
 // -------------------------------------------------------------------------------------
+// Pre: iterator stands on the key
+static void updateInPlace(BTreeExclusiveIterator& iterator,
+                          Slice key,
+                          function<void(u8* payload, u16 payload_size)>& callback,
+                          WALUpdateGenerator& wal_update_generator)
+{
+   auto current_value = iterator.mutableValue();
+   if (FLAGS_wal) {
+      // if it is a secondary index, then we can not use updateSameSize
+      assert(wal_update_generator.entry_size > 0);
+      // -------------------------------------------------------------------------------------
+      auto wal_entry = iterator.leaf.reserveWALEntry<BTreeLL::WALUpdate>(key.length() + wal_update_generator.entry_size);
+      wal_entry->type = WAL_LOG_TYPE::WALUpdate;
+      wal_entry->key_length = key.length();
+      std::memcpy(wal_entry->payload, key.data(), key.length());
+      wal_update_generator.before(current_value.data(), wal_entry->payload + key.length());
+      // The actual update by the client
+      callback(current_value.data(), current_value.length());
+      wal_update_generator.after(current_value.data(), wal_entry->payload + key.length());
+      wal_entry.submit();
+   } else {
+      callback(current_value.data(), current_value.length());
+      iterator.leaf.incrementGSN();
+   }
+   iterator.contentionSplit();
+}
+// -------------------------------------------------------------------------------------
 OP_RESULT BTreeLL::updateSameSize(u8* o_key,
                                   u16 o_key_length,
                                   function<void(u8* payload, u16 payload_size)> callback,
@@ -1280,25 +1342,52 @@ OP_RESULT BTreeLL::updateSameSize(u8* o_key,
       if (ret != OP_RESULT::OK) {
          jumpmu_return ret;
       }
-      auto current_value = iterator.mutableValue();
-      if (FLAGS_wal) {
-         // if it is a secondary index, then we can not use updateSameSize
-         assert(wal_update_generator.entry_size > 0);
-         // -------------------------------------------------------------------------------------
-         auto wal_entry = iterator.leaf.reserveWALEntry<WALUpdate>(key.length() + wal_update_generator.entry_size);
-         wal_entry->type = WAL_LOG_TYPE::WALUpdate;
-         wal_entry->key_length = key.length();
-         std::memcpy(wal_entry->payload, key.data(), key.length());
-         wal_update_generator.before(current_value.data(), wal_entry->payload + key.length());
-         // The actual update by the client
-         callback(current_value.data(), current_value.length());
-         wal_update_generator.after(current_value.data(), wal_entry->payload + key.length());
-         wal_entry.submit();
-      } else {
-         callback(current_value.data(), current_value.length());
-         iterator.leaf.incrementGSN();
+      updateInPlace(iterator, key, callback, wal_update_generator);
+      jumpmu_return OP_RESULT::OK;
+   }
+   jumpmuCatch()
+   {
+      ensure(false);
+   }
+}
+// -------------------------------------------------------------------------------------
+OP_RESULT BTreeLL::updateSameSizeSeg(u8* o_key,
+                                     u16 o_key_length,
+                                     function<void(u8* payload, u16 payload_size)> callback,
+                                     WALUpdateGenerator wal_update_generator)
+{
+   cr::Worker::my().walEnsureEnoughSpace(PAGE_SIZE * 1);
+   Slice key(o_key, o_key_length);
+   EpochGuard epoch_guard;
+   jumpmuTry()
+   {
+      BTreeExclusiveIterator iterator(*static_cast<BTreeGeneric*>(this));
+      auto ret = iterator.seekExactWithModel(key);
+      if (ret != OP_RESULT::OK) {
+         jumpmu_return ret;
       }
-      iterator.contentionSplit();
+      updateInPlace(iterator, key, callback, wal_update_generator);
+      jumpmu_return OP_RESULT::OK;
+   }
+   jumpmuCatch()
+   {
+      ensure(false);
+   }
+}
+// -------------------------------------------------------------------------------------
+OP_RESULT BTreeLL::lookupSeg(u8* o_key, u16 o_key_length, function<void(const u8*, u16)> payload_callback)
+{
+   Slice key(o_key, o_key_length);
+   EpochGuard epoch_guard;
+   jumpmuTry()
+   {
+      BTreeSharedIterator iterator(*static_cast<BTreeGeneric*>(this));
+      auto ret = iterator.seekExactWithModel(key);
+      if (ret != OP_RESULT::OK) {
+         jumpmu_return ret;
+      }
+      auto value = iterator.value();
+      payload_callback(value.data(), value.length());
       jumpmu_return OP_RESULT::OK;
    }
    jumpmuCatch()
@@ -1320,9 +1409,10 @@ OP_RESULT BTreeLL::remove(u8* o_key, u16 o_key_length)
       }
       Slice value = iterator.value();
       if (FLAGS_wal) {
-         auto wal_entry = iterator.leaf.reserveWALEntry<WALRemove>(o_key_length);
+         auto wal_entry = iterator.leaf.reserveWALEntry<WALRemove>(o_key_length + value.length());
          wal_entry->type = WAL_LOG_TYPE::WALRemove;
          wal_entry->key_length = o_key_length;
+         wal_entry->value_length = value.length();
          std::memcpy(wal_entry->payload, key.data(), key.length());
          std::memcpy(wal_entry->payload + o_key_length, value.data(), value.length());
          wal_entry.submit();
@@ -1331,6 +1421,7 @@ OP_RESULT BTreeLL::remove(u8* o_key, u16 o_key_length)
       }
       ret = iterator.removeCurrent();
       ensure(ret == OP_RESULT::OK);
+      markLeafDirty(iterator.leaf.bf);
       iterator.mergeIfNeeded();
       jumpmu_return OP_RESULT::OK;
    }
@@ -1393,7 +1484,7 @@ void BTreeLL::scanAll()
    std::cout << "total kv:" << total_kv << std::endl;
 }
 
-void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vector<BufferFrame*>& bfs)
+void BTreeLL::slot_keys(std::vector<MODEL_KEY>& keys, std::vector<PID>& pids, std::vector<BufferFrame*>& bfs)
 {
    u32 volatile mask = 1;
    auto target_guard = HybridPageGuard<BTreeNode>();
@@ -1402,7 +1493,7 @@ void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vec
    keys.clear();
    bfs.clear();
    while (true) {
-      std::vector<KEY> node_key;
+      std::vector<MODEL_KEY> node_key;
       std::vector<PID> node_pid;
       std::vector<BufferFrame*> node_bf;
       jumpmuTry()
@@ -1419,9 +1510,9 @@ void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vec
          for (auto i = 0; i < target_guard->count; i++) {
             target_guard.recheck();
             auto key_len = target_guard->getFullKeyLen(i);
-            u8 key_bytes[sizeof(KEY)];
+            u8 key_bytes[key_len];
             target_guard->copyFullKey(i, key_bytes);
-            auto int_key = utils::u8_to<KEY>(key_bytes, sizeof(KEY));
+            auto int_key = modelKey(key_bytes, key_len);
             auto c_swip = target_guard->getChild(i);
             BufferFrame* bfptr = nullptr;
             PID child_pid = 0;
@@ -1450,20 +1541,20 @@ void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vec
                   leaf_last_key_bytes[i] = 0;
                }
                leaf->copyFullKey(leaf->count - 1, leaf_last_key_bytes);
-               // auto leaf_last_key = utils::u8_to<KEY>(leaf_last_key_bytes, leaf_last_key_len);
-               auto leaf_last_key = utils::u8_to<KEY>(leaf_last_key_bytes, sizeof(KEY));
+               // auto leaf_last_key = modelKey(leaf_last_key_bytes, leaf_last_key_len);
+               auto leaf_last_key = modelKey(leaf_last_key_bytes, sizeof(KEY));
                ensure(leaf_last_key <= int_key);
                if (leaf_last_key != int_key) {
                   cout << "[last_keys 0] i: " << i << " inner_count: " << target_guard->count << " slot key: " << int_key
                        << " slot key len: " << key_len << " child pid: " << child_pid << " leaf_count: " << leaf->count
                        << " is_leaf: " << leaf->is_leaf << " last key: " << leaf_last_key << " last key len:" << leaf_last_key_len << endl;
                };
-               auto uf_key = utils::u8_to<KEY>(leaf->getUpperFenceKey(), leaf->upper_fence.length);
-               // auto uf_key = utils::u8_to<KEY>(leaf->getUpperFenceKey(), sizeof(KEY));
+               auto uf_key = modelKey(leaf->getUpperFenceKey(), leaf->upper_fence.length);
+               // auto uf_key = modelKey(leaf->getUpperFenceKey(), sizeof(KEY));
                // ensure(uf_key >= int_key);
                auto c_swip = target_guard->getChild(i + 1);
                leaf = HybridPageGuard(target_guard, c_swip);
-               auto lf_key = utils::u8_to<KEY>(leaf->getLowerFenceKey(), leaf->lower_fence.length);
+               auto lf_key = modelKey(leaf->getLowerFenceKey(), leaf->lower_fence.length);
                ensure(lf_key >= int_key);
                ensure(uf_key <= int_key);
                if (!(int_key <= lf_key && int_key >= uf_key))
@@ -1480,7 +1571,7 @@ void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vec
          target_guard.recheck();
          auto upper_fence_key = target_guard->getUpperFenceKey();
          auto upper_fence_key_len = target_guard->upper_fence.length;
-         auto upper_fence_key_int = (upper_fence_key != nullptr) ? utils::u8_to<KEY>(upper_fence_key, upper_fence_key_len) : 0;
+         auto upper_fence_key_int = (upper_fence_key != nullptr) ? modelKey(upper_fence_key, upper_fence_key_len) : 0;
          auto c_swip = target_guard->upper;
          BufferFrame* bfptr = nullptr;
          PID child_pid = 0;
@@ -1506,7 +1597,7 @@ void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vec
                auto leaf_last_key_len = leaf->getFullKeyLen(leaf->count - 1);
                u8 leaf_last_key_bytes[leaf_last_key_len];
                leaf->copyFullKey(leaf->count - 1, leaf_last_key_bytes);
-               auto leaf_last_key = utils::u8_to<KEY>(leaf_last_key_bytes, leaf_last_key_len);
+               auto leaf_last_key = modelKey(leaf_last_key_bytes, leaf_last_key_len);
                // keys.push_back(leaf_last_key);
                // ensure(leaf_last_key == upper_fence_key_int);
                if (leaf_last_key != upper_fence_key_int) {
@@ -1514,16 +1605,16 @@ void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vec
                        << " upper_fence_key_len: " << upper_fence_key_len << " last key: " << leaf_last_key << " last key len: " << leaf_last_key_len
                        << endl;
                };
-               auto uf_key = utils::u8_to<KEY>(leaf->getUpperFenceKey(), leaf->upper_fence.length);
+               auto uf_key = modelKey(leaf->getUpperFenceKey(), leaf->upper_fence.length);
                auto c_swip = target_guard->getChild(target_guard->count);
-               auto lf_key = utils::u8_to<KEY>(leaf->getLowerFenceKey(), leaf->lower_fence.length);
+               auto lf_key = modelKey(leaf->getLowerFenceKey(), leaf->lower_fence.length);
                if (upper_fence_key_int <= lf_key || upper_fence_key_int > uf_key)
                   cout << "[slot_keys 1] sanity_check_result: 0 leaf_count: " << leaf->count << " key: " << upper_fence_key_int
                        << " is_leaf: " << leaf->is_leaf << " lower_fence: " << lf_key << " upper_fence: " << uf_key << endl;
                ensure(uf_key == upper_fence_key_int);
             }
          }
-         // auto lower_fence_key_int = (lower_fence_key != nullptr) ? utils::u8_to<KEY>(lower_fence_key, lower_fence_key_len) : 0;
+         // auto lower_fence_key_int = (lower_fence_key != nullptr) ? modelKey(lower_fence_key, lower_fence_key_len) : 0;
          for (auto i = 0; i < node_key.size(); i++) {
             keys.push_back(node_key[i]);
             pids.push_back(node_pid[i]);
@@ -1548,7 +1639,7 @@ void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vec
    std::memcpy(key, target_guard->getUpperFenceKey(), target_guard->upper_fence.length);
    key[key_length - 1] = 0;
    while (target_guard->getUpperFenceKey() != nullptr) {
-      std::vector<KEY> node_key;
+      std::vector<MODEL_KEY> node_key;
       std::vector<PID> node_pid;
       std::vector<BufferFrame*> node_bf;
       jumpmuTry()
@@ -1557,8 +1648,8 @@ void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vec
          // auto lower_fence_key_len = target_guard->lower_fence.length;
          // auto upper_fence_key = target_guard->getUpperFenceKey();
          // auto upper_fence_key_len = target_guard->upper_fence.length;
-         // auto upper_fence_key_int = (upper_fence_key != nullptr) ? utils::u8_to<KEY>(upper_fence_key, upper_fence_key_len) : 0;
-         // auto lower_fence_key_int = (lower_fence_key != nullptr) ? utils::u8_to<KEY>(lower_fence_key, lower_fence_key_len) : 0;
+         // auto upper_fence_key_int = (upper_fence_key != nullptr) ? modelKey(upper_fence_key, upper_fence_key_len) : 0;
+         // auto lower_fence_key_int = (lower_fence_key != nullptr) ? modelKey(lower_fence_key, lower_fence_key_len) : 0;
 
          findLeafParentCanJump(target_guard, key, key_length);
          // TODO: arrary or vector of key of length target_guard->count
@@ -1573,9 +1664,9 @@ void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vec
          for (auto i = 0; i < target_guard->count; i++) {
             target_guard.recheck();
             auto key_len = target_guard->getFullKeyLen(i);
-            u8 key_bytes[sizeof(KEY)];
+            u8 key_bytes[key_len];
             target_guard->copyFullKey(i, key_bytes);
-            auto key_int = utils::u8_to<KEY>(key_bytes, sizeof(KEY));
+            auto key_int = modelKey(key_bytes, key_len);
             auto c_swip = target_guard->getChild(i);
             BufferFrame* bfptr = nullptr;
             PID child_pid = 0;
@@ -1600,8 +1691,8 @@ void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vec
          key_length = upper_fence_key_len + 1;
          std::memcpy(key, target_guard->getUpperFenceKey(), target_guard->upper_fence.length);
          key[key_length - 1] = 0;
-         auto upper_fence_key_int = (upper_fence_key != nullptr) ? utils::u8_to<KEY>(upper_fence_key, upper_fence_key_len) : 0;
-         // auto lower_fence_key_int = (lower_fence_key != nullptr) ? utils::u8_to<KEY>(lower_fence_key, lower_fence_key_len) : 0;
+         auto upper_fence_key_int = (upper_fence_key != nullptr) ? modelKey(upper_fence_key, upper_fence_key_len) : 0;
+         // auto lower_fence_key_int = (lower_fence_key != nullptr) ? modelKey(lower_fence_key, lower_fence_key_len) : 0;
          auto c_swip = target_guard->upper;
          BufferFrame* bfptr = nullptr;
          PID child_pid = 0;
@@ -1638,19 +1729,236 @@ void BTreeLL::slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vec
    }
    // INFO("slot_keys completed");
 }
+// -------------------------------------------------------------------------------------
+// Splits the key space for the training threads. A trained tree already knows its leaf
+// distribution, otherwise the separators of the root are used.
+std::vector<MODEL_KEY> BTreeLL::train_partition_bounds(const u64 threads)
+{
+   std::vector<MODEL_KEY> bounds;
+   {
+      std::shared_lock<std::shared_mutex> lock(model_lock);
+      const auto keys = trainerKeys();
+      if (trained && keys.size() > threads * 4) {
+         const u64 partitions = threads * 4;
+         for (u64 p_i = 1; p_i < partitions; p_i++) {
+            bounds.push_back(keys[p_i * keys.size() / partitions]);
+         }
+         bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+         return bounds;
+      }
+   }
+   u32 volatile mask = 1;
+   while (true) {
+      jumpmuTry()
+      {
+         bounds.clear();
+         HybridPageGuard<BTreeNode> p_guard(meta_node_bf);
+         HybridPageGuard<BTreeNode> root_guard(p_guard, p_guard->upper);
+         for (u16 i = 0; i < root_guard->count; i++) {
+            root_guard.recheck();
+            u8 key_bytes[root_guard->getFullKeyLen(i)];
+            root_guard->copyFullKey(i, key_bytes);
+            bounds.push_back(modelKey(key_bytes, root_guard->getFullKeyLen(i)));
+         }
+         root_guard.recheck();
+         jumpmu_break;
+      }
+      jumpmuCatch()
+      {
+         BACKOFF_STRATEGIES();
+      }
+   }
+   bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+   return bounds;
+}
+// -------------------------------------------------------------------------------------
+// Same walk as slot_keys, restricted to the leaf parents whose upper fence lies in (from, to].
+// A null bound is open.
+void BTreeLL::slot_keys_range(const MODEL_KEY* from, const MODEL_KEY* to, LeafHarvest& harvest)
+{
+   u32 volatile mask = 1;
+   auto target_guard = HybridPageGuard<BTreeNode>();
+   std::vector<u8> seek_key, next_key;
+   if (from != nullptr) {
+      seek_key.resize(KeyNormalizer<MODEL_KEY>::MAX_PREFIX + sizeof(MODEL_KEY) + 1, 0);
+      seek_key.resize(key_normalizer.denormalize(*from, seek_key.data()) + 1);
+   }
+   std::vector<MODEL_KEY> node_key;
+   std::vector<PID> node_pid;
+   std::vector<BufferFrame*> node_bf;
+   while (true) {
+      jumpmuTry()
+      {
+         if (seek_key.empty()) {
+            findFirstLeafParentCanJump(target_guard);
+         } else {
+            findLeafParentCanJump(target_guard, seek_key.data(), seek_key.size());
+         }
+         node_key.clear();
+         node_pid.clear();
+         node_bf.clear();
+         auto collect_child = [&](Swip<BTreeNode>& c_swip) {
+            BufferFrame* bfptr = nullptr;
+            PID child_pid = 0;
+            if (c_swip.isHOT()) {
+               bfptr = c_swip.bfPtr();
+               child_pid = bfptr->header.pid;
+            } else if (c_swip.isCOOL()) {
+               bfptr = c_swip.bfPtrAsHot();
+               child_pid = bfptr->header.pid;
+            } else {
+               child_pid = c_swip.asPageID();
+            }
+            node_pid.push_back(child_pid);
+            node_bf.push_back(bfptr);
+         };
+         for (u16 i = 0; i < target_guard->count; i++) {
+            target_guard.recheck();
+            u8 key_bytes[target_guard->getFullKeyLen(i)];
+            target_guard->copyFullKey(i, key_bytes);
+            node_key.push_back(modelKey(key_bytes, target_guard->getFullKeyLen(i)));
+            collect_child(target_guard->getChild(i));
+         }
+         collect_child(target_guard->upper);
+         const u16 upper_fence_len = target_guard->upper_fence.length;
+         const bool rightmost = (target_guard->getUpperFenceKey() == nullptr || upper_fence_len == 0);
+         const MODEL_KEY upper_fence_key = rightmost ? 0 : modelKey(target_guard->getUpperFenceKey(), upper_fence_len);
+         const MODEL_KEY lower_fence_key = modelKey(target_guard->getLowerFenceKey(), target_guard->lower_fence.length);
+         const bool leftmost = (target_guard->getLowerFenceKey() == nullptr || target_guard->lower_fence.length == 0);
+         if (!rightmost) {
+            next_key.resize(upper_fence_len + 1);
+            std::memcpy(next_key.data(), target_guard->getUpperFenceKey(), upper_fence_len);
+            next_key[upper_fence_len] = 0;
+         }
+         target_guard.recheck();
+         // -------------------------------------------------------------------------------------
+         if (!rightmost && to != nullptr && upper_fence_key > *to) {
+            jumpmu_break;
+         }
+         if (harvest.pids.empty()) {
+            harvest.lower_fence = lower_fence_key;
+            harvest.first = leftmost;
+         }
+         harvest.keys.insert(harvest.keys.end(), node_key.begin(), node_key.end());
+         harvest.pids.insert(harvest.pids.end(), node_pid.begin(), node_pid.end());
+         harvest.bfs.insert(harvest.bfs.end(), node_bf.begin(), node_bf.end());
+         if (rightmost) {
+            harvest.last = true;
+            jumpmu_break;
+         }
+         harvest.keys.push_back(upper_fence_key);
+         harvest.upper_fence = upper_fence_key;
+         seek_key.swap(next_key);
+         jumpmu_continue;
+      }
+      jumpmuCatch()
+      {
+         BACKOFF_STRATEGIES();
+      }
+   }
+}
+// -------------------------------------------------------------------------------------
+// Harvests the partitions concurrently and concatenates them. Leaf parents are never shared
+// between partitions, so the result equals the sequential walk unless an SMO moved a fence
+// in between, which is detected at the seams. Returns false in that case.
+bool BTreeLL::slot_keys_parallel(std::vector<MODEL_KEY>& keys, std::vector<PID>& pids, std::vector<BufferFrame*>& bfs, const u64 threads)
+{
+   if (getHeight() < 3) {
+      return false;
+   }
+   auto bounds = train_partition_bounds(threads);
+   if (bounds.empty()) {
+      return false;
+   }
+   std::vector<LeafHarvest> parts(bounds.size() + 1);
+   utils::Parallelize::parallelRange(0, parts.size() - 1, threads, [&](u64 p_i) {
+      slot_keys_range((p_i == 0) ? nullptr : &bounds[p_i - 1], (p_i == bounds.size()) ? nullptr : &bounds[p_i], parts[p_i]);
+   });
+   // -------------------------------------------------------------------------------------
+   u64 total = 0;
+   for (auto& part : parts) {
+      total += part.pids.size();
+   }
+   pids.clear();
+   keys.clear();
+   bfs.clear();
+   pids.reserve(total);
+   keys.reserve(total);
+   bfs.reserve(total);
+   LeafHarvest* prev = nullptr;
+   for (auto& part : parts) {
+      if (part.pids.empty()) {
+         continue;
+      }
+      if ((prev == nullptr) ? !part.first : (prev->last || prev->upper_fence != part.lower_fence)) {
+         return false;
+      }
+      keys.insert(keys.end(), part.keys.begin(), part.keys.end());
+      pids.insert(pids.end(), part.pids.begin(), part.pids.end());
+      bfs.insert(bfs.end(), part.bfs.begin(), part.bfs.end());
+      prev = &part;
+   }
+   return prev != nullptr && prev->last && pids.size() == keys.size() + 1;
+}
 void BTreeLL::forced_train(const int max_error)
 {
    fast_train(max_error);
-#ifdef MODEL_IN_LEAF_NODE
+#if defined(MODEL_IN_LEAF_NODE) && !defined(INCREMENTAL_LEAF_MODEL)
    train_leaf_nodes_bf(1);
 #endif
 }
+// -------------------------------------------------------------------------------------
+// The prefix is that of the smallest and the largest key. It is kept for the life of the tree,
+// keys inserted outside of it later are clamped and only cost accuracy.
+void BTreeLL::learn_key_prefix()
+{
+   auto boundary_key = [&](const bool last) {
+      std::vector<u8> key;
+      HybridPageGuard<BTreeNode> leaf;
+      if (last) {
+         findLastLeafAndLatch<LATCH_FALLBACK_MODE::SHARED>(leaf);
+      } else {
+         findFirstLeafAndLatch<LATCH_FALLBACK_MODE::SHARED>(leaf);
+      }
+      if (leaf->count > 0) {
+         const u16 slot = last ? leaf->count - 1 : 0;
+         key.resize(leaf->getFullKeyLen(slot));
+         leaf->copyFullKey(slot, key.data());
+      }
+      return key;
+   };
+   const auto min_key = boundary_key(false);
+   const auto max_key = boundary_key(true);
+   key_normalizer.learn(min_key.data(), min_key.size(), max_key.data(), max_key.size());
+   INFO("Key prefix length: %u", key_normalizer.prefixLength());
+}
 void BTreeLL::fast_train(const int max_error)
 {
-   std::vector<KEY> keys;
+   std::vector<MODEL_KEY> keys;
    std::vector<PID> pids;
    std::vector<BufferFrame*> bfs;
-   slot_keys(keys, pids, bfs);
+   if (!key_normalizer.learned()) {
+      learn_key_prefix();
+   }
+#ifdef COMPACT_MAPPING
+   // SMOs published while harvesting may be missing from the harvest, keep them around
+   const auto delta_seq = mapping_deltas.sequence();
+#endif
+   const u64 threads = std::max<u64>(FLAGS_train_threads, 1);
+   auto elapsed_us = [](std::chrono::high_resolution_clock::time_point& begin) {
+      auto end = std::chrono::high_resolution_clock::now();
+      auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+      begin = end;
+      return us;
+   };
+   TrainTimings timings;
+   timings.threads = threads;
+   auto phase_begin = std::chrono::high_resolution_clock::now();
+   timings.parallel_harvest = (threads > 1) && slot_keys_parallel(keys, pids, bfs, threads);
+   if (!timings.parallel_harvest) {
+      slot_keys(keys, pids, bfs);
+   }
+   timings.harvest_us = elapsed_us(phase_begin);
    std::unique_lock<std::shared_mutex> lock(model_lock);
    INFO("Training started");
    DEBUG_BLOCK()
@@ -1664,6 +1972,7 @@ void BTreeLL::fast_train(const int max_error)
    mapping_key.clear();
    mapping_pid.clear();
    mapping_bfs.clear();
+   mapping_image.reset();
 #else
    secondary_mapping_pid.clear();
    secondary_mapping_bf.clear();
@@ -1683,7 +1992,7 @@ void BTreeLL::fast_train(const int max_error)
    auto leaf_count = 0ul;
    /* Segments if we want to add the first key. Should not be there.*/
    /**
-   auto key = std::numeric_limits<KEY>::min();
+   auto key = std::numeric_limits<MODEL_KEY>::min();
 
    sbd.AddKey(key);
 #ifdef COMPACT_MAPPING
@@ -1712,7 +2021,7 @@ void BTreeLL::fast_train(const int max_error)
 #endif
    }
    // Attach last key and leaf node
-   // auto key = std::numeric_limits<KEY>::max();
+   // auto key = std::numeric_limits<MODEL_KEY>::max();
    auto bfpid = pids[pids.size() - 1];
    auto bf = bfs[bfs.size() - 1];
 #ifdef COMPACT_MAPPING
@@ -1723,14 +2032,26 @@ void BTreeLL::fast_train(const int max_error)
    secondary_mapping_pid.push_back(make_pair(key, bfpid));
    secondary_mapping_bf.push_back(make_pair(key, bf));
 #endif
+   timings.mapping_us = elapsed_us(phase_begin);
 #ifdef MODEL_SEG
-   auto sbd = spline::Builder<KEY>(max_error);
-   for (auto i = 0; i < keys.size(); i++) {
-      auto key = keys[i];
-      sbd.AddKey(key);
+   std::vector<spline::Coord<MODEL_KEY>> segments;
+   // Ranges overlap in their boundary key, see spline::StitchRanges
+   const u64 ranges = (keys.size() >= threads * 1024) ? threads : 1;
+   if (ranges > 1) {
+      std::vector<std::vector<spline::Coord<MODEL_KEY>>> parts(ranges);
+      utils::Parallelize::parallelRange(0, ranges - 1, threads, [&](u64 r_i) {
+         parts[r_i] = spline::BuildRange(keys, r_i * (keys.size() - 1) / ranges, (r_i + 1) * (keys.size() - 1) / ranges, max_error);
+      });
+      segments = spline::StitchRanges(parts);
+   } else {
+      auto sbd = spline::Builder<MODEL_KEY>(max_error);
+      for (auto i = 0; i < keys.size(); i++) {
+         auto key = keys[i];
+         sbd.AddKey(key);
+      }
+      segments = sbd.Finalize();
    }
-   auto segments = sbd.Finalize();
-   spline_predictor = spline::RadixSpline<KEY>(max_error, pids.size(), segments);
+   spline_predictor = spline::RadixSpline<MODEL_KEY>(max_error, pids.size(), segments);
 #endif
    // INFO("spline predictor create. segments: %lu", segments.size() - 1);
    DEBUG_BLOCK()
@@ -1773,10 +2094,75 @@ void BTreeLL::fast_train(const int max_error)
    incorrect_leaf = 0;
 #endif
    trained = true;
-
-   INFO("Training End");
+   timings.spline_us = elapsed_us(phase_begin);
+#ifdef COMPACT_MAPPING
+   lock.unlock();
+   publishModel(nullptr, delta_seq);
+   timings.publish_us = elapsed_us(phase_begin);
+   // only after the new model is visible, lookups fall back to the deltas until then
+   mapping_deltas.eraseBefore(delta_seq);
+#endif
+   last_train_timings = timings;
+   INFO("Training End threads: %lu parallel_harvest: %d harvest_us: %lu mapping_us: %lu spline_us: %lu publish_us: %lu", timings.threads,
+        timings.parallel_harvest, timings.harvest_us, timings.mapping_us, timings.spline_us, timings.publish_us);
    return;
 }
+// -------------------------------------------------------------------------------------
+// Folds the leaf splits/merges recorded since the last train into the mapping and re-fits
+// only the spline segments that cover them. Readers are blocked only for the swap.
+void BTreeLL::merge_mapping_deltas()
+{
+#ifdef COMPACT_MAPPING
+   auto applied = mapping_deltas.snapshot();
+   if (applied.empty()) {
+      return;
+   }
+   std::vector<MODEL_KEY> new_keys, dirty_keys;
+   std::vector<PID> new_pids;
+   std::vector<BufferFrame*> new_bfs;
+   std::vector<spline::Coord<MODEL_KEY>> new_points;
+   {
+      // only the training thread modifies the mapping, readers can go on meanwhile
+      std::shared_lock<std::shared_mutex> lock(model_lock);
+      if (!trained) {
+         return;
+      }
+      MappingDeltaBuffer::apply(applied, trainerKeys(), trainerPids(), mapping_bfs, new_keys, new_pids, new_bfs, dirty_keys);
+      if (new_keys.empty()) {
+         return;
+      }
+#ifdef MODEL_SEG
+      new_points = spline::RefitSegments(spline_predictor.spline_points_, new_keys, dirty_keys, max_error_);
+#endif
+   }
+   DEBUG_BLOCK()
+   {
+      std::cout << "Merging deltas: " << applied.size() << " dirty separators: " << dirty_keys.size() << " leafs: " << new_pids.size()
+                << " segments: " << new_points.size() << std::endl;
+   }
+   {
+      std::unique_lock<std::shared_mutex> lock(model_lock);
+      mapping_key.swap(new_keys);
+      mapping_pid.swap(new_pids);
+      mapping_bfs.swap(new_bfs);
+      mapping_image.reset();
+#ifdef MODEL_SEG
+      spline_predictor = spline::RadixSpline<MODEL_KEY>(max_error_, mapping_pid.size(), std::move(new_points));
+#endif
+   }
+   // Every delta put after the copy was taken has a higher sequence number than the ones in it
+   u64 folded_seq = 0;
+   for (auto& delta : applied) {
+      folded_seq = std::max(folded_seq, delta.seq + 1);
+   }
+   publishModel(nullptr, folded_seq);
+   mapping_deltas.erase(applied);
+#ifdef SMO_STATS
+   num_splits = 0;
+   incorrect_leaf = 0;
+#endif
+#endif
+}
 
 void BTreeLL::auto_train(const int max_error)
 {
@@ -1789,50 +2175,50 @@ void BTreeLL::auto_train(const int max_error)
    training_thread = std::thread([this]() {
       // auto last_train_time = std::chrono::steady_clock::now();
       const auto WAIT_TIME = 2;
+      const auto INCORRECT_TOLERANCE = 1;
       while (bg_training_thread) {
+         bool full_train = true;
          {
             std::unique_lock<std::mutex> lk(this->train_signal_lock);
-            this->train_signal.wait(lk, [this] {
+            this->train_signal.wait(lk, [this, &full_train] {
                const auto START_HEIGHT = 3;
-               const auto INCORRECT_TOLERANCE = 1;
                auto first_train = (!trained && this->getHeight() > START_HEIGHT);
                auto incorrect_tolerance = (trained && (static_cast<float>(incorrect_leaf) / num_splits) > INCORRECT_TOLERANCE);
-               INFO("Checking at height: %lu incorrect_leaf: %lu num_splits: %lu first_train: %u incorrect_tolearance: %u", this->getHeight(),
-                    incorrect_leaf, num_splits, first_train, incorrect_tolerance);
+#ifdef COMPACT_MAPPING
+               auto pending_deltas = (trained && mapping_deltas.size() >= FLAGS_mapping_delta_merge_threshold);
+#else
+               auto pending_deltas = false;
+#endif
+               INFO("Checking at height: %lu incorrect_leaf: %lu num_splits: %lu first_train: %u incorrect_tolearance: %u pending_deltas: %u",
+                    this->getHeight(), incorrect_leaf, num_splits, first_train, incorrect_tolerance, pending_deltas);
                // auto write_heavy = (static_cast<float>(num_splits) / this->mapping_pid.size() > 0.10);
                // INFO("Checking if it needs to be retrained");
                // return first_train || read_heavy || write_heavy;
-               return bg_training_thread ? (first_train || incorrect_tolerance) : true;
+               full_train = first_train || incorrect_tolerance;
+               return bg_training_thread ? (full_train || pending_deltas) : true;
             });
          }
-         INFO("Training at height: %lu incorrect_leaf: %lu num_splits: %lu", this->getHeight(), incorrect_leaf, num_splits);
+         INFO("Training at height: %lu incorrect_leaf: %lu num_splits: %lu full_train: %u", this->getHeight(), incorrect_leaf, num_splits,
+              full_train);
          // auto current_time = std::chrono::steady_clock::now();
          // if ((current_time - last_train_time) < std::chrono::seconds(WAIT_TIME)) {
          //    trained = false;
          //    continue;
          // }
-         if (bg_training_thread)
+         if (bg_training_thread && full_train)
             this->fast_train(max_error_);
+         else if (bg_training_thread)
+            this->merge_mapping_deltas();
          // last_train_time = std::chrono::steady_clock::now();
          // WAIT_TIME = (last_train_time - current_time);
          // std::this_thread::sleep_for(std::chrono::seconds(5));
       }
    });
-   leaf_training_thread = std::thread([this]() {
-      const auto WAIT_TIME = 1;
-      while (bg_training_thread) {
-         {
-            // std::unique_lock<std::mutex> lk(this->train_leaf_signal_lock);
-            // this->train_leaf_signal.wait(lk, [this] { return true; });
-         }
-         if (bg_training_thread) {
-            this->train_leaf_nodes_bf(1);
-         }
-         std::this_thread::sleep_for(std::chrono::seconds(WAIT_TIME));
-      }
-   });
    training_thread.detach();
-   leaf_training_thread.detach();
+   for (u64 t_i = 0; t_i < FLAGS_leaf_train_threads; t_i++) {
+      leaf_trainers.emplace_back([this, t_i]() { this->train_queued_leaf_nodes(t_i); });
+      leaf_trainers.back().detach();
+   }
 }
 
 void BTreeLL::train_leaf_nodes_bf(size_t maxerror)
@@ -1853,6 +2239,34 @@ void BTreeLL::train_leaf_nodes_bf(size_t maxerror)
    INFO("Trained leaf nodes: %lu", trained_leaf_nodes);
 }
 
+// Trainer t_i of the pool, drains its rings of leaf_train_queue in slices of 10ms
+void BTreeLL::train_queued_leaf_nodes(const u64 t_i)
+{
+   const u64 trainers = FLAGS_leaf_train_threads;
+   const u64 per_slice = (FLAGS_leaf_train_rate == 0) ? std::numeric_limits<u64>::max() : std::max<u64>(1, FLAGS_leaf_train_rate / 100);
+   while (bg_training_thread) {
+      const auto slice_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+      u64 trained = 0;
+      const u64 drained = leaf_train_queue.drain(t_i, trainers, per_slice, [&](const LeafTrainQueue::Entry& entry) {
+         // Writes from now on queue the leaf again
+         entry.bf->header.model_queued = false;
+         jumpmuTry()
+         {
+            HybridPageGuard<BTreeNode> node(entry.bf);
+            if (entry.bf->header.pid == entry.pid && entry.bf->page.dt_id == dt_id && train_leaf_node(node, 1)) {
+               trained++;
+            }
+         }
+         jumpmuCatch() {}
+      });
+      WorkerCounters::myCounters().leaf_train_dequeued[dt_id] += drained;
+      WorkerCounters::myCounters().leaf_models_trained[dt_id] += trained;
+      if (drained == 0 || FLAGS_leaf_train_rate != 0) {
+         std::this_thread::sleep_until(slice_end);
+      }
+   }
+}
+
 void BTreeLL::train_leaf_nodes(size_t maxerror)
 {
    auto leaf_count = 0ul;
@@ -1882,6 +2296,18 @@ bool BTreeLL::train_leaf_node(HybridPageGuard<BTreeNode>& leaf, size_t maxerror)
    if (!(leaf->is_leaf)) {
       return false;
    }
+#ifdef INCREMENTAL_LEAF_MODEL
+   // The fit in the page follows every insert and remove, only its error bound is recomputed.
+   // Scanned optimistically, toExclusive() jumps if a writer came in between
+   static_cast<void>(maxerror);
+   if (leaf.guard.state == GUARD_STATE::SHARED) {
+      return false;
+   }
+   const u16 error = leaf->fitError();
+   leaf.toExclusive();
+   leaf->fit.error = error;
+   leaf->fit.updates = 0;
+#else
    // Get all the keys in the leaf node
    auto size = leaf->count;
    std::vector<KEY> keys;
@@ -1900,7 +2326,10 @@ bool BTreeLL::train_leaf_node(HybridPageGuard<BTreeNode>& leaf, size_t maxerror)
 #ifdef MODEL_LR
    auto linear = learnedindex<KEY>();
    linear.train(keys, bf->page.GSN);
-   leaf_node_models[pid] = linear;
+   {
+      std::unique_lock<std::mutex> guard(leaf_node_models_lock);
+      leaf_node_models[pid] = linear;
+   }
    bf->header.model = linear;
 #else
    auto sbd = spline::Builder<KEY>(maxerror);
@@ -1909,8 +2338,12 @@ bool BTreeLL::train_leaf_node(HybridPageGuard<BTreeNode>& leaf, size_t maxerror)
    }
    auto spline = sbd.Finalize();
    auto leaf_predictor = spline::RadixSpline<KEY>(maxerror, size, spline);
-   leaf_node_segments[pid] = leaf_predictor;
-   bf->header.splines = leaf_node_segments[pid];
+   {
+      std::unique_lock<std::mutex> guard(leaf_node_models_lock);
+      leaf_node_segments[pid] = leaf_predictor;
+   }
+   bf->header.splines = leaf_predictor;
+#endif
 #endif
    return true;
 }
@@ -1922,6 +2355,7 @@ void BTreeLL::train(const int max_error)
 #ifdef COMPACT_MAPPING
    mapping_key.clear();
    mapping_pid.clear();
+   mapping_image.reset();
 #else
    secondary_mapping_pid.clear();
 #endif
@@ -1953,8 +2387,8 @@ void BTreeLL::train(const int max_error)
    */
    auto leaf_count = 0;
    auto total_kv = 0;
-   auto sbd = spline::Builder<KEY>(max_error);
-   auto secondary_mapping = std::vector<std::pair<KEY, Swip<BTreeNode> > >();
+   auto sbd = spline::Builder<MODEL_KEY>(max_error);
+   auto secondary_mapping = std::vector<std::pair<MODEL_KEY, Swip<BTreeNode> > >();
    // auto secondary_mapping_pid = std::vector<std::pair<KEY, PID>>();
    {
       BTreeSharedIterator iterator(*static_cast<BTreeGeneric*>(this));
@@ -1970,26 +2404,26 @@ void BTreeLL::train(const int max_error)
       do {
          auto key = iterator.key();
          auto value = iterator.value();
-         auto key_itr_int = utils::string_view_to<KEY>(key);
+         auto key_itr_int = modelKey(key.data(), key.length());
          ;
          u8 keys[255];
          iterator.leaf->copyFullKey(0, keys);
          auto key_len = iterator.leaf->getFullKeyLen(0);
-         auto key_int = utils::u8_to<KEY>(keys, key_len);
+         auto key_int = modelKey(keys, key_len);
          ensure(key_itr_int == key_int);
          auto swip = iterator.leaf.swip();
          auto upper_fence_key_len = iterator.leaf->lower_fence.length;
          auto lower_fence_key_len = iterator.leaf->upper_fence.length;
          auto lower_fence_key = iterator.leaf->getLowerFenceKey();
          auto upper_fence_key = iterator.leaf->getUpperFenceKey();
-         auto upper_fence_key_int = (upper_fence_key != nullptr) ? utils::u8_to<KEY>(upper_fence_key, upper_fence_key_len) : 0;
-         auto lower_fence_key_int = (lower_fence_key != nullptr) ? utils::u8_to<KEY>(lower_fence_key, lower_fence_key_len) : 0;
+         auto upper_fence_key_int = (upper_fence_key != nullptr) ? modelKey(upper_fence_key, upper_fence_key_len) : 0;
+         auto lower_fence_key_int = (lower_fence_key != nullptr) ? modelKey(lower_fence_key, lower_fence_key_len) : 0;
          auto bf = swip.bfPtr();
          auto bfpid = bf->header.pid;
          auto leaf_fanout = iterator.leaf->count;
          iterator.leaf->copyFullKey(leaf_fanout - 1, keys);
          auto last_key_len = iterator.leaf->getFullKeyLen(leaf_fanout - 1);
-         auto last_key_int = utils::u8_to<KEY>(keys, last_key_len);
+         auto last_key_int = modelKey(keys, last_key_len);
 
          total_kv += leaf_fanout;
          DEBUG_BLOCK()
@@ -2026,7 +2460,7 @@ void BTreeLL::train(const int max_error)
    ensure(secondary_mapping_pid.size() == secondary_mapping.size());
    ensure(secondary_mapping_pid.size() == leaf_count);
 #endif
-   spline_predictor = spline::RadixSpline<KEY>(max_error, leaf_count, segments);
+   spline_predictor = spline::RadixSpline<MODEL_KEY>(max_error, leaf_count, segments);
    DEBUG_BLOCK()
    {
       std::cout << "segments count: " << segments.size() << std::endl;
@@ -2062,7 +2496,7 @@ void BTreeLL::train(const int max_error)
             u8 buffer[255];
             new_target_guard->copyFullKey(i, buffer);
             auto key_len = new_target_guard->getFullKeyLen(i);
-            auto key = utils::u8_to<KEY>(buffer, key_len);
+            auto key = modelKey(buffer, key_len);
             std::cout << key << " ";
          }
          std::cout << std::endl;
@@ -2198,7 +2632,7 @@ OP_RESULT BTreeLL::examine_spline_idx(HybridPageGuard<BTreeNode>& target_guard,
          u8 buffer[255];
          target_guard->copyFullKey(i, buffer);
          auto key_len = target_guard->getFullKeyLen(i);
-         auto key = utils::u8_to<KEY>(buffer, key_len);
+         auto key = modelKey(buffer, key_len);
          Swip<BTreeNode>& c_swip = target_guard->getChild(i);
          // p_guard = std::move(target_guard);
          auto c_guard = HybridPageGuard(target_guard, c_swip);
@@ -2222,6 +2656,9 @@ void BTreeLL::stats()
 #ifdef SMO_STATS
    printf("[Stats] SMO incorrect_leaf: %lu num_splits: %lu\n", incorrect_leaf, num_splits);
 #endif
+   printf("[Stats] Train threads: %lu parallel_harvest: %d harvest_us: %lu mapping_us: %lu spline_us: %lu publish_us: %lu\n",
+          last_train_timings.threads, last_train_timings.parallel_harvest, last_train_timings.harvest_us, last_train_timings.mapping_us,
+          last_train_timings.spline_us, last_train_timings.publish_us);
 
 #ifdef INMEM
    auto entries = countEntries();
@@ -2279,13 +2716,12 @@ OP_RESULT BTreeLL::attach_segment(const size_t& segment_ptr)
          auto target_guard = HybridPageGuard<BTreeNode>(p_guard, p_guard->upper);
          // -------------------------------------------------------------------------------------
          u16 volatile level = 0;
-         constexpr auto key_length = sizeof(KEY);
-         u8 lower_key[key_length];
-         u8 upper_key[key_length];
+         u8 lower_key[KeyNormalizer<MODEL_KEY>::MAX_PREFIX + sizeof(MODEL_KEY)];
+         u8 upper_key[KeyNormalizer<MODEL_KEY>::MAX_PREFIX + sizeof(MODEL_KEY)];
          // *reinterpret_cast<u64*>(upper_key) = __builtin_bswap64(spline_predictor.spline_points_[segment_ptr].x);
          // *reinterpret_cast<u64*>(lower_key) = __builtin_bswap64(spline_predictor.spline_points_[segment_ptr - 1].x);
-         auto upper_key_len = fold(upper_key, spline_predictor.spline_points_[segment_ptr].x);
-         auto lower_key_len = fold(lower_key, spline_predictor.spline_points_[segment_ptr - 1].x);
+         auto upper_key_len = key_normalizer.denormalize(spline_predictor.spline_points_[segment_ptr].x, upper_key);
+         auto lower_key_len = key_normalizer.denormalize(spline_predictor.spline_points_[segment_ptr - 1].x, lower_key);
          // -------------------------------------------------------------------------------------
          while (!target_guard->is_leaf) {
             if ((height - level) < min_attach_level_) {
@@ -2307,8 +2743,8 @@ OP_RESULT BTreeLL::attach_segment(const size_t& segment_ptr)
             // Mynote: looks for the child pointer
             // auto lower_key = reinterpret_cast<u8*>(&(spline_predictor.spline_points_[segment_ptr-1].x));
             // auto upper_key = reinterpret_cast<u8*>(&(spline_predictor.spline_points_[segment_ptr].x));
-            auto lower_pos = target_guard->lowerBound<false>(lower_key, key_length);
-            auto upper_pos = target_guard->lowerBound<false>(upper_key, key_length);
+            auto lower_pos = target_guard->lowerBound<false>(lower_key, lower_key_len);
+            auto upper_pos = target_guard->lowerBound<false>(upper_key, upper_key_len);
             if (lower_pos != upper_pos) {
                auto pid = target_guard.bf->header.pid;
                auto seg_ptr = attached_segments.find(pid);
@@ -2367,7 +2803,7 @@ OP_RESULT BTreeLL::attach_spline(HybridPageGuard<BTreeNode>& target_guard, size_
          u8 buffer[255];
          target_guard->copyFullKey(i, buffer);
          auto key_len = target_guard->getFullKeyLen(i);
-         auto key = utils::u8_to<KEY>(buffer, key_len);
+         auto key = modelKey(buffer, key_len);
          Swip<BTreeNode>& c_swip = target_guard->getChild(i);
          // p_guard = std::move(target_guard);
          jumpmuTry()
@@ -2440,6 +2876,61 @@ void BTreeLL::undo(void*, const u8*, const u64)
 // -------------------------------------------------------------------------------------
 void BTreeLL::todo(void*, const u8*, const u64) {}
 // -------------------------------------------------------------------------------------
+void BTreeLL::redo(void* btree_object, BufferFrame::Page& page, PID pid, LID gsn, const u8* wal_entry_ptr, const u16 entry_size)
+{
+   auto& btree = *static_cast<BTreeGeneric*>(reinterpret_cast<BTreeLL*>(btree_object));
+   const auto type = reinterpret_cast<const WALEntry*>(wal_entry_ptr)->type;
+   if (type == WAL_LOG_TYPE::WALInitPage || type == WAL_LOG_TYPE::WALLogicalSplit || type == WAL_LOG_TYPE::WALLogicalMerge) {
+      BTreeGeneric::redoStructure(btree, page, pid, gsn, wal_entry_ptr, entry_size);
+      return;
+   }
+   if (gsn <= page.GSN) {
+      return;
+   }
+   auto& node = *reinterpret_cast<BTreeNode*>(page.dt);
+   switch (type) {
+      case WAL_LOG_TYPE::WALInsert: {
+         const auto& wal_entry = *reinterpret_cast<const WALInsert*>(wal_entry_ptr);
+         ensure(node.prepareInsert(wal_entry.key_length, wal_entry.value_length));
+         node.insert(wal_entry.payload, wal_entry.key_length, wal_entry.payload + wal_entry.key_length, wal_entry.value_length);
+         break;
+      }
+      case WAL_LOG_TYPE::WALUpdate: {
+         // DELTA_COPY records behind the key: offset, size, before image, after image
+         const auto& wal_entry = *reinterpret_cast<const WALUpdate*>(wal_entry_ptr);
+         const s16 slot_id = node.lowerBound<true>(wal_entry.payload, wal_entry.key_length);
+         ensure(slot_id != -1);
+         u8* value = node.getPayload(slot_id);
+         const u8* delta = wal_entry.payload + wal_entry.key_length;
+         while (delta < wal_entry_ptr + entry_size) {
+            const u16 offset = *reinterpret_cast<const u16*>(delta);
+            const u16 size = *reinterpret_cast<const u16*>(delta + sizeof(u16));
+            std::memcpy(value + offset, delta + 2 * sizeof(u16) + size, size);
+            delta += 2 * sizeof(u16) + 2 * size;
+         }
+         break;
+      }
+      case WAL_LOG_TYPE::WALRemove: {
+         const auto& wal_entry = *reinterpret_cast<const WALRemove*>(wal_entry_ptr);
+         ensure(node.remove(wal_entry.payload, wal_entry.key_length));
+         break;
+      }
+      default:
+         UNREACHABLE();
+   }
+   page.GSN = gsn;
+}
+// -------------------------------------------------------------------------------------
+void BTreeLL::finishRedo()
+{
+   recomputeHeight();
+   if (redone_smos > 0 && trained) {
+      std::cout << "redo: " << redone_smos << " leaf splits and merges since the learned index image, retraining" << std::endl;
+      fast_train(max_error_);
+   }
+   redone_smos = 0;
+}
+// -------------------------------------------------------------------------------------
 std::unordered_map<std::string, std::string> BTreeLL::serialize(void* btree_object)
 {
    return BTreeGeneric::serialize(*static_cast<BTreeGeneric*>(reinterpret_cast<BTreeLL*>(btree_object)));
@@ -2458,6 +2949,7 @@ struct DTRegistry::DTMeta BTreeLL::getMeta()
                                     .checkpoint = checkpoint,
                                     .undo = undo,
                                     .todo = todo,
+                                    .redo = redo,
                                     .serialize = serialize,
                                     .deserialize = deserialize};
    return btree_meta;
@@ -2467,6 +2959,15 @@ struct ParentSwipHandler BTreeLL::findParent(void* btree_object, BufferFrame& to
 {
    return BTreeGeneric::findParent(*static_cast<BTreeGeneric*>(reinterpret_cast<BTreeLL*>(btree_object)), to_find);
 }
+// -------------------------------------------------------------------------------------
+template OP_RESULT BTreeLL::fast_trained_lookup_new<u32>(const u32, function<void(const u8*, u16)>);
+template OP_RESULT BTreeLL::fast_trained_lookup_new<u64>(const u64, function<void(const u8*, u16)>);
+template OP_RESULT BTreeLL::fast_trained_lookup_new<u32>(const u32);
+template OP_RESULT BTreeLL::fast_trained_lookup_new<u64>(const u64);
+template u64 BTreeLL::multi_get<u32>(const u32*, const u64, function<void(u64, const u8*, u16)>);
+template u64 BTreeLL::multi_get<u64>(const u64*, const u64, function<void(u64, const u8*, u16)>);
+template s16 BTreeLL::searchLeaf<u32>(HybridPageGuard<BTreeNode>&, const u32);
+template s16 BTreeLL::searchLeaf<u64>(HybridPageGuard<BTreeNode>&, const u64);
 }  // namespace btree
 }  // namespace storage
 }  // namespace leanstore
\ No newline at end of file
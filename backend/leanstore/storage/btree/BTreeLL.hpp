@@ -7,7 +7,9 @@
 #include "leanstore/lr/learnedIndex.hpp"
 #include "leanstore/profiling/counters/WorkerCounters.hpp"
 #include "leanstore/rs/builder.hpp"
+#include "leanstore/rs/partitioned.hpp"
 #include "leanstore/rs/radix_spline.h"
+#include "leanstore/rs/refit.hpp"
 #include "leanstore/storage/buffer-manager/BufferManager.hpp"
 #include "leanstore/sync-primitives/PageGuard.hpp"
 #include "leanstore/utils/RandomGenerator.hpp"
@@ -51,6 +53,25 @@ class BTreeLL : public BTreeInterface, public BTreeGeneric
       u16 value_length;
       u8 payload[];
    };
+   // Leaf separators of a run of leaf parents, harvested by one training thread
+   struct LeafHarvest {
+      std::vector<MODEL_KEY> keys;
+      std::vector<PID> pids;
+      std::vector<BufferFrame*> bfs;
+      MODEL_KEY lower_fence = 0;  // of the first leaf parent
+      MODEL_KEY upper_fence = 0;  // of the last leaf parent
+      bool first = false;         // starts with the leftmost leaf parent
+      bool last = false;          // ends with the rightmost leaf parent
+   };
+   struct TrainTimings {
+      u64 threads = 1;
+      bool parallel_harvest = false;
+      u64 harvest_us = 0;
+      u64 mapping_us = 0;
+      u64 spline_us = 0;
+      u64 publish_us = 0;
+   };
+   TrainTimings last_train_timings;
    // -------------------------------------------------------------------------------------
    virtual OP_RESULT lookup(u8* key, u16 key_length, function<void(const u8*, u16)> payload_callback) override;
    virtual OP_RESULT lookup_simulate_long_tail(u8* key, u16 key_length, function<void(const u8*, u16)> payload_callback) override;
@@ -58,14 +79,28 @@ class BTreeLL : public BTreeInterface, public BTreeGeneric
    virtual OP_RESULT trained_lookup(u8* key, u16 key_length, function<void(const u8*, u16)> payload_callback);
    virtual OP_RESULT trained_lookup(KEY key, function<void(const u8*, u16)> payload_callback);
    virtual OP_RESULT fast_trained_lookup(KEY key, function<void(const u8*, u16)> payload_callback);
-   OP_RESULT fast_trained_lookup_new(const KEY key, function<void(const u8*, u16)> payload_callback) override;
-   OP_RESULT fast_trained_lookup_new(const KEY key);
+   OP_RESULT fast_trained_lookup_new(const KEY key, function<void(const u8*, u16)> payload_callback) override
+   {
+      return fast_trained_lookup_new<KEY>(key, payload_callback);
+   }
+   // The integer lookups take the key width of the tree, u32 or u64 (instantiated in BTreeLL.cpp): the keys
+   // are stored as their folded bytes and routed through the normalizer, whatever the compile time KEY is
+   template <typename Key>
+   OP_RESULT fast_trained_lookup_new(const Key key, function<void(const u8*, u16)> payload_callback);
+   template <typename Key>
+   OP_RESULT fast_trained_lookup_new(const Key key);
+   // Learned lookups of keys[0, n) in groups of FLAGS_multi_get_group, stage by stage, so that
+   // the misses of one key overlap with the work on the others. Returns the number of keys found.
+   template <typename Key>
+   u64 multi_get(const Key* keys, const u64 n, function<void(u64 key_i, const u8* payload, u16 payload_length)> payload_callback);
    virtual OP_RESULT fast_insert(u8* o_key, u16 o_key_length, u8* o_value, u16 o_value_length);
    virtual OP_RESULT insert(u8* key, u16 key_length, u8* value, u16 value_length) override;
    virtual OP_RESULT updateSameSize(u8* key, u16 key_length, function<void(u8* value, u16 value_size)>, WALUpdateGenerator = {{}, {}, 0}) override;
    virtual OP_RESULT scanAscAll(function<bool(const u8* key, u16 key_length, const u8* value, u16 value_length)>) override;
    virtual OP_RESULT scanAscAllSeg(function<bool(const u8* key, u16 key_length, const u8* value, u16 value_length)>) override;
    virtual OP_RESULT remove(u8* key, u16 key_length) override;
+   virtual OP_RESULT lookupSeg(u8* key, u16 key_length, function<void(const u8*, u16)> payload_callback) override;
+   virtual OP_RESULT updateSameSizeSeg(u8* key, u16 key_length, function<void(u8* value, u16 value_size)>, WALUpdateGenerator = {{}, {}, 0}) override;
    virtual OP_RESULT scanAsc(u8* start_key,
                              u16 key_length,
                              function<bool(const u8* key, u16 key_length, const u8* value, u16 value_length)>,
@@ -89,19 +124,31 @@ class BTreeLL : public BTreeInterface, public BTreeGeneric
    virtual u64 countPages() override;
    virtual u64 countEntries() override;
    virtual u64 getHeight() override;
-   void slot_keys(std::vector<KEY>& keys, std::vector<PID>& pids, std::vector<BufferFrame*>& bfs);
+   void slot_keys(std::vector<MODEL_KEY>& keys, std::vector<PID>& pids, std::vector<BufferFrame*>& bfs);
+   bool slot_keys_parallel(std::vector<MODEL_KEY>& keys, std::vector<PID>& pids, std::vector<BufferFrame*>& bfs, const u64 threads);
+   void slot_keys_range(const MODEL_KEY* from, const MODEL_KEY* to, LeafHarvest& harvest);
+   std::vector<MODEL_KEY> train_partition_bounds(const u64 threads);
    virtual void auto_train(const int maxerror = 0) override;
    virtual void train(const int maxerror) override;
    void train_leaf_nodes(size_t maxerror);
    void train_leaf_nodes_bf(size_t maxerror);
+   void train_queued_leaf_nodes(const u64 t_i);
    bool train_leaf_node(HybridPageGuard<BTreeNode>& guard, size_t maxerror);
    void forced_train(const int maxerror) override;
    void fast_train(const int maxerror) override;
+   void learn_key_prefix();
+   void merge_mapping_deltas();
    void scanAll();
+   // Slot of key in a leaf, using the leaf model if there is one. -1 if the key is not in the leaf
+   template <typename Key>
+   s16 searchLeaf(HybridPageGuard<BTreeNode>& leaf, const Key key);
    // -------------------------------------------------------------------------------------
    static ParentSwipHandler findParent(void* btree_object, BufferFrame& to_find);
    static void undo(void* btree_object, const u8* wal_entry_ptr, const u64 tts);
    static void todo(void* btree_object, const u8* wal_entry_ptr, const u64 tts);
+   static void redo(void* btree_object, BufferFrame::Page& page, PID pid, LID gsn, const u8* wal_entry_ptr, const u16 entry_size);
+   // After the WAL redo: the height from the pages, the mapping retrained if the WAL split or merged leafs
+   void finishRedo();
    static std::unordered_map<std::string, std::string> serialize(void* btree_object);
    static void deserialize(void* btree_object, std::unordered_map<std::string, std::string> serialized);
    static DTRegistry::DTMeta getMeta();
@@ -40,6 +40,12 @@ void BTreeGeneric::create(DTID dtid, BufferFrame* meta_bf)
    HybridPageGuard<BTreeNode> meta_guard(meta_bf);
    ExclusivePageGuard meta_page(std::move(meta_guard));
    meta_page->upper = root_write_guard.bf();  // HACK: use upper of meta node as a swip to the storage root
+   if (FLAGS_wal) {
+      // Neither page is on the SSD yet, the redo of a crash before their first write back starts from these
+      cr::Worker::my().walEnsureEnoughSpace(2 * (sizeof(cr::WALDTEntry) + sizeof(WALInitPage)));
+      logInitPage(root_write_guard, true);
+      logInitPage(meta_page, false, root_write_guard.bf()->header.pid);
+   }
    attached_segments_file = FLAGS_attached_segments_file;
    secondary_mapping_file = FLAGS_secondary_mapping_file;
    segments_file = FLAGS_segments_file;
@@ -48,7 +54,8 @@ void BTreeGeneric::create(DTID dtid, BufferFrame* meta_bf)
 void BTreeGeneric::trySplit(BufferFrame& to_split, s16 favored_split_pos)
 {
    // MyNote: What is cr Worker
-   cr::Worker::my().walEnsureEnoughSpace(PAGE_SIZE * 1);
+   // The image of the left node and the records of the other pages
+   cr::Worker::my().walEnsureEnoughSpace(PAGE_SIZE * 2);
    auto parent_handler = findParent(*this, to_split);
    // MyNote: What is Read Page Guard
    HybridPageGuard<BTreeNode> p_guard = parent_handler.getParentReadPageGuard<BTreeNode>();
@@ -91,38 +98,22 @@ void BTreeGeneric::trySplit(BufferFrame& to_split, s16 favored_split_pos)
          // -------------------------------------------------------------------------------------
          c_x_guard->split(new_root, new_left_node, sep_info.slot, sep_key, sep_info.length);
       };
+      exec();
       if (FLAGS_wal) {
-         auto new_root_init_wal = new_root.reserveWALEntry<WALInitPage>(0);
-         new_root_init_wal->type = WAL_LOG_TYPE::WALInitPage;
-         new_root_init_wal->dt_id = dt_id;
-         new_root_init_wal.submit();
-         auto new_left_init_wal = new_left_node.reserveWALEntry<WALInitPage>(0);
-         new_left_init_wal->type = WAL_LOG_TYPE::WALInitPage;
-         new_left_init_wal->dt_id = dt_id;
-         new_left_init_wal.submit();
-         // -------------------------------------------------------------------------------------
+         logInitPage(new_root, false);
+         logInitPage(new_left_node, new_left_node->is_leaf);
          WALLogicalSplit logical_split_entry;
          logical_split_entry.type = WAL_LOG_TYPE::WALLogicalSplit;
          logical_split_entry.right_pid = c_x_guard.bf()->header.pid;
          logical_split_entry.parent_pid = new_root.bf()->header.pid;
          logical_split_entry.left_pid = new_left_node.bf()->header.pid;
-         // -------------------------------------------------------------------------------------
-         auto current_right_wal = c_x_guard.reserveWALEntry<WALLogicalSplit>(0);
-         *current_right_wal = logical_split_entry;
-         assert(current_right_wal->type == logical_split_entry.type);
-         current_right_wal.submit();
-         // -------------------------------------------------------------------------------------
-         exec();
-         // -------------------------------------------------------------------------------------
-         auto root_wal = new_root.reserveWALEntry<WALLogicalSplit>(0);
-         *root_wal = logical_split_entry;
-         root_wal.submit();
-         // -------------------------------------------------------------------------------------
-         auto left_wal = new_left_node.reserveWALEntry<WALLogicalSplit>(0);
-         *left_wal = logical_split_entry;
-         left_wal.submit();
-      } else {
-         exec();
+         logical_split_entry.right_pos = sep_info.slot;
+         logical_split_entry.sep_length = sep_info.length;
+         logical_split_entry.root_split = true;
+         logSplit(c_x_guard, logical_split_entry, sep_key, false);
+         logSplit(new_root, logical_split_entry, sep_key, false);
+         logSplit(new_left_node, logical_split_entry, sep_key, true);
+         logSplit(p_x_guard, logical_split_entry, nullptr, false);
       }
       // -------------------------------------------------------------------------------------
       height++;
@@ -147,37 +138,24 @@ void BTreeGeneric::trySplit(BufferFrame& to_split, s16 favored_split_pos)
             c_x_guard->split(p_x_guard, new_left_node, sep_info.slot, sep_key, sep_info.length);
          };
          // -------------------------------------------------------------------------------------
+         exec();
          if (FLAGS_wal) {
-            auto new_left_init_wal = new_left_node.reserveWALEntry<WALInitPage>(0);
-            new_left_init_wal->type = WAL_LOG_TYPE::WALInitPage;
-            new_left_init_wal->dt_id = dt_id;
-            new_left_init_wal.submit();
-            // -------------------------------------------------------------------------------------
+            logInitPage(new_left_node, new_left_node->is_leaf);
             WALLogicalSplit logical_split_entry;
             logical_split_entry.type = WAL_LOG_TYPE::WALLogicalSplit;
             logical_split_entry.right_pid = c_x_guard.bf()->header.pid;
             logical_split_entry.parent_pid = p_x_guard.bf()->header.pid;
             logical_split_entry.left_pid = new_left_node.bf()->header.pid;
-            // -------------------------------------------------------------------------------------
-            auto current_right_wal = c_x_guard.reserveWALEntry<WALLogicalSplit>(0);
-            *current_right_wal = logical_split_entry;
-            current_right_wal.submit();
-            // -------------------------------------------------------------------------------------
-            exec();
-            // -------------------------------------------------------------------------------------
-            auto parent_wal = p_x_guard.reserveWALEntry<WALLogicalSplit>(0);
-            *parent_wal = logical_split_entry;
-            parent_wal.submit();
-            // -------------------------------------------------------------------------------------
-            auto left_init_wal = new_left_node.reserveWALEntry<WALInitPage>(0);
-            left_init_wal->type = WAL_LOG_TYPE::WALInitPage;
-            left_init_wal->dt_id = dt_id;
-            left_init_wal.submit();
-            auto left_wal = new_left_node.reserveWALEntry<WALLogicalSplit>(0);
-            *left_wal = logical_split_entry;
-            left_wal.submit();
-         } else {
-            exec();
+            logical_split_entry.right_pos = sep_info.slot;
+            logical_split_entry.sep_length = sep_info.length;
+            logSplit(c_x_guard, logical_split_entry, sep_key, false);
+            logSplit(p_x_guard, logical_split_entry, sep_key, false);
+            logSplit(new_left_node, logical_split_entry, sep_key, true);
+         }
+         if (new_left_node->is_leaf) {
+            publishLeafSplit(sep_key, sep_info.length, new_left_node.bf());
+            markLeafDirty(new_left_node.bf());
+            markLeafDirty(c_x_guard.bf());
          }
       } else {
          p_guard.unlock();
@@ -187,9 +165,294 @@ void BTreeGeneric::trySplit(BufferFrame& to_split, s16 favored_split_pos)
    }
 }
 
+// -------------------------------------------------------------------------------------
+void BTreeGeneric::logInitPage(ExclusivePageGuard<BTreeNode>& guard, bool is_leaf, PID root_pid)
+{
+   auto wal_entry = guard.reserveWALEntry<WALInitPage>(0);
+   wal_entry->type = WAL_LOG_TYPE::WALInitPage;
+   wal_entry->dt_id = dt_id;
+   wal_entry->is_leaf = is_leaf;
+   wal_entry->root_pid = root_pid;
+   wal_entry.submit();
+}
+// -------------------------------------------------------------------------------------
+void BTreeGeneric::logSplit(ExclusivePageGuard<BTreeNode>& guard, const WALLogicalSplit& split, const u8* sep_key, bool with_image)
+{
+   const u16 sep_length = sep_key ? split.sep_length : 0;
+   const u16 image_size = with_image ? nodeImageSize(guard.ref()) : 0;
+   auto wal_entry = guard.reserveWALEntry<WALLogicalSplit>(sep_length + image_size);
+   *wal_entry = split;
+   wal_entry->sep_length = sep_length;
+   std::memcpy(wal_entry->payload, sep_key, sep_length);
+   if (with_image) {
+      logNodeImage(guard.ref(), wal_entry->payload + sep_length);
+   }
+   wal_entry.submit();
+}
+// -------------------------------------------------------------------------------------
+void BTreeGeneric::logMerge(ExclusivePageGuard<BTreeNode>& parent,
+                            ExclusivePageGuard<BTreeNode>& left,
+                            ExclusivePageGuard<BTreeNode>& right,
+                            s32 left_pos)
+{
+   WALLogicalMerge logical_merge_entry;
+   logical_merge_entry.type = WAL_LOG_TYPE::WALLogicalMerge;
+   logical_merge_entry.parent_pid = parent.bf()->header.pid;
+   logical_merge_entry.left_pid = left.bf()->header.pid;
+   logical_merge_entry.right_pid = right.bf()->header.pid;
+   logical_merge_entry.left_pos = left_pos;
+   auto parent_wal = parent.reserveWALEntry<WALLogicalMerge>(0);
+   *parent_wal = logical_merge_entry;
+   parent_wal.submit();
+   auto right_wal = right.reserveWALEntry<WALLogicalMerge>(nodeImageSize(right.ref()));
+   *right_wal = logical_merge_entry;
+   logNodeImage(right.ref(), right_wal->payload);
+   right_wal.submit();
+}
+
+// -------------------------------------------------------------------------------------
+#ifdef COMPACT_MAPPING
+void BTreeGeneric::publishModel(std::shared_ptr<const LearnedIndexImage> image, const u64 folded_seq)
+{
+   std::unique_lock<std::mutex> publishing(publish_lock);
+   auto snapshot = new ModelSnapshot();
+   {
+      std::shared_lock<std::shared_mutex> lock(model_lock);
+      ModelSnapshot* previous = model_snapshot.load(std::memory_order_acquire);
+      snapshot->version = previous ? previous->version + 1 : 1;
+      snapshot->mapping_version = snapshot->version;
+      snapshot->folded_seq = folded_seq;
+      if (mapping_image && router_config.model != ROUTER_MODEL::SPLINE) {
+         // Only fitting the other models needs the keys of an image in a vector, for as long as it takes
+         const auto keys = mapping_image->keys();
+         snapshot->router.build(router_config, std::vector<MODEL_KEY>(keys.begin(), keys.end()), spline_predictor);
+      } else {
+         snapshot->router.build(router_config, mapping_key, spline_predictor);
+      }
+      // Readers do not write to a published snapshot, the frames that went stale are looked up once here
+      const auto pids = trainerPids();
+      std::vector<BufferFrame*> bfs = mapping_bfs;
+      for (size_t idx = 0; idx < bfs.size(); idx++) {
+         if (bfs[idx] == nullptr || bfs[idx]->header.pid != pids[idx]) {
+            bfs[idx] = BMC::global_bf->pageInBufferFrame(pids[idx]).bf;
+         }
+      }
+#ifdef MAPPING_BLOCKS
+      snapshot->mapping.build(mapping_key, mapping_pid, bfs);
+#else
+      if (image) {
+         snapshot->mapping_key = image->keys();
+         snapshot->mapping_pid = image->pids();
+         snapshot->image = std::move(image);
+      } else {
+         snapshot->owned_key = mapping_key;
+         snapshot->owned_pid = mapping_pid;
+         snapshot->mapping_key = snapshot->owned_key;
+         snapshot->mapping_pid = snapshot->owned_pid;
+      }
+      snapshot->mapping_bfs = std::move(bfs);
+#endif
+   }
+   if (snapshot->size() == 0) {
+      delete snapshot;
+      snapshot = nullptr;
+   }
+   EpochManager::global().retire(model_snapshot.exchange(snapshot, std::memory_order_acq_rel));
+}
+// -------------------------------------------------------------------------------------
+void BTreeGeneric::useRouter(const RouterConfig& config)
+{
+   std::unique_lock<std::mutex> publishing(publish_lock);
+   {
+      std::unique_lock<std::shared_mutex> lock(model_lock);
+      router_config = config;
+   }
+   // Only swaps under publish_lock retire snapshots, so the current one stays valid without an EpochGuard
+   ModelSnapshot* current = model_snapshot.load(std::memory_order_acquire);
+   if (current == nullptr) {
+      return;  // the first publishModel builds it with config
+   }
+   const RouterConfig& built_with = current->router.config();
+   if (built_with.sameModel(config) && built_with.search == config.search) {
+      return;
+   }
+   // Same mapping as the current snapshot, the trainer's vectors may already be ahead of it
+   auto snapshot = copyModel(*current);
+   if (built_with.sameModel(config)) {
+      snapshot->router = current->router.withSearch(config.search);
+   } else {
+      const auto current_keys = current->keys();
+      std::vector<MODEL_KEY> keys(current_keys.size());
+      for (size_t i = 0; i < keys.size(); i++) {
+         keys[i] = current_keys[i];
+      }
+      std::shared_lock<std::shared_mutex> lock(model_lock);
+      snapshot->router.build(config, keys, spline_predictor);
+   }
+   EpochManager::global().retire(model_snapshot.exchange(snapshot, std::memory_order_acq_rel));
+}
+// -------------------------------------------------------------------------------------
+ModelSnapshot* BTreeGeneric::copyModel(const ModelSnapshot& current)
+{
+   auto snapshot = new ModelSnapshot();
+   snapshot->version = current.version + 1;
+   snapshot->mapping_version = current.mapping_version;
+   snapshot->folded_seq = current.folded_seq;
+   snapshot->router = current.router;
+#ifdef MAPPING_BLOCKS
+   snapshot->mapping = current.mapping;
+#else
+   if (current.image) {
+      snapshot->mapping_key = current.mapping_key;
+      snapshot->mapping_pid = current.mapping_pid;
+      snapshot->image = current.image;
+   } else {
+      snapshot->owned_key = current.owned_key;
+      snapshot->owned_pid = current.owned_pid;
+      snapshot->mapping_key = snapshot->owned_key;
+      snapshot->mapping_pid = snapshot->owned_pid;
+   }
+   snapshot->mapping_bfs = current.mapping_bfs;
+#endif
+   return snapshot;
+}
+// -------------------------------------------------------------------------------------
+void BTreeGeneric::startWarmup()
+{
+   warmup_stop = true;
+   if (warmup_thread.joinable()) {
+      warmup_thread.join();
+   }
+   warmup_stop = false;
+   warming_up = true;
+   warmup_thread = std::thread([this]() { warmup(); });
+}
+// -------------------------------------------------------------------------------------
+void BTreeGeneric::warmup()
+{
+   const auto begin = std::chrono::steady_clock::now();
+   u64 mapping_version = 0;
+   std::vector<size_t> hot_idx;
+   std::vector<PID> hot_pids;
+   {
+      EpochGuard epoch_guard;
+      ModelSnapshot* model = currentModel();
+      if (model == nullptr) {
+         warming_up = false;
+         return;
+      }
+      mapping_version = model->mapping_version;
+      std::vector<u32> counts(model->size());
+      for (size_t idx = 0; idx < counts.size(); idx++) {
+         counts[idx] = leaf_access_sketch.estimate(model->pid(idx));
+      }
+      // Leafs that were never sampled are not worth a read
+      const u64 budget = std::min<u64>(counts.size(), FLAGS_warmup_fraction * counts.size());
+      u32 threshold = 1;
+      if (budget > 0 && budget < counts.size()) {
+         std::vector<u32> ranked = counts;
+         std::nth_element(ranked.begin(), ranked.begin() + budget - 1, ranked.end(), std::greater<u32>());
+         threshold = std::max<u32>(threshold, ranked[budget - 1]);
+      }
+      // In mapping_key order, neighbouring leafs are likely neighbours on the SSD too
+      for (size_t idx = 0; idx < counts.size() && hot_idx.size() < budget; idx++) {
+         if (counts[idx] >= threshold) {
+            hot_idx.push_back(idx);
+            hot_pids.push_back(model->pid(idx));
+         }
+      }
+   }
+   // The frames go into copies of the snapshot, a published one is never written. A copy costs the whole
+   // mapping, so one is published whenever the pending frames reach those published already, and at the end.
+   std::vector<std::pair<size_t, BufferFrame*>> pending;
+   u64 filled = 0;
+   auto publish = [&]() {
+      std::unique_lock<std::mutex> publishing(publish_lock);
+      ModelSnapshot* current = model_snapshot.load(std::memory_order_acquire);
+      if (current == nullptr || current->mapping_version != mapping_version) {
+         // Retrained meanwhile, the new snapshot resolves its own frames
+         return false;
+      }
+      auto snapshot = copyModel(*current);
+      for (const auto& [idx, bf] : pending) {
+         snapshot->setBf(idx, bf);
+      }
+      filled += pending.size();
+      pending.clear();
+      EpochManager::global().retire(model_snapshot.exchange(snapshot, std::memory_order_acq_rel));
+      return true;
+   };
+   // What the read-ahead buffer of this thread holds, see BufferManager::readAhead
+   const u64 io_depth = std::max<u64>(2 * FLAGS_scan_readahead_leaves, 2);
+   u64 read = 0;
+   bool still_current = true;
+   for (u64 h_i = 0; h_i < hot_pids.size() && !warmup_stop; h_i += io_depth) {
+      const u64 n = std::min<u64>(io_depth, hot_pids.size() - h_i);
+      u64 missing = 0;
+      for (u64 i = h_i; i < h_i + n; i++) {
+         missing += !BMC::global_bf->isPageInBufferPool(hot_pids[i]);
+      }
+      const u64 submitted = BMC::global_bf->readAhead(&hot_pids[h_i], n);
+      while (BMC::global_bf->readAheadPending()) {
+         BMC::global_bf->pollReadAhead(true);
+      }
+      read += submitted;
+      for (u64 i = h_i; i < h_i + n; i++) {
+         BufferFrame* bf = BMC::global_bf->pageInBufferFrame(hot_pids[i]).bf;
+         if (bf != nullptr && bf->header.pid == hot_pids[i]) {
+            pending.emplace_back(hot_idx[i], bf);
+         }
+      }
+      if (pending.size() >= std::max<u64>(filled, io_depth) && !(still_current = publish())) {
+         break;
+      }
+      if (missing > 0 && submitted == 0) {
+         // No free frames left, the warmup does not evict what the workload already loaded
+         break;
+      }
+      if (FLAGS_warmup_read_rate > 0) {
+         std::this_thread::sleep_until(begin + std::chrono::microseconds(read * 1000000 / FLAGS_warmup_read_rate));
+      }
+   }
+   if (still_current && !warmup_stop && !pending.empty()) {
+      publish();
+   }
+   const auto took = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+   std::cout << "warmup: " << filled << " of " << hot_pids.size() << " hot leafs resolved, " << read << " read in " << took << " ms" << std::endl;
+   warming_up = false;
+}
+#endif
+// -------------------------------------------------------------------------------------
+// Leaf SMOs after training are recorded instead of invalidating the whole mapping
+void BTreeGeneric::publishLeafSplit(const u8* sep_key, const u16 sep_length, BufferFrame* new_left)
+{
+#ifdef COMPACT_MAPPING
+   if (!trained) {
+      return;
+   }
+   mapping_deltas.publish(modelKey(sep_key, sep_length), new_left->header.pid, new_left);
+   if (mapping_deltas.size() >= FLAGS_mapping_delta_merge_threshold) {
+      train_signal.notify_one();
+   }
+#endif
+}
+// -------------------------------------------------------------------------------------
+void BTreeGeneric::retractLeafSeparator(const u8* sep_key, const u16 sep_length)
+{
+#ifdef COMPACT_MAPPING
+   if (!trained) {
+      return;
+   }
+   mapping_deltas.retract(modelKey(sep_key, sep_length));
+   if (mapping_deltas.size() >= FLAGS_mapping_delta_merge_threshold) {
+      train_signal.notify_one();
+   }
+#endif
+}
 //-------------------------------------------------------------------------------------
 bool BTreeGeneric::tryMerge(BufferFrame& to_merge, bool swizzle_sibling)
 {
+   cr::Worker::my().walEnsureEnoughSpace(PAGE_SIZE * 2);
    auto parent_handler = findParent(*this, to_merge);
    HybridPageGuard<BTreeNode> p_guard = parent_handler.getParentReadPageGuard<BTreeNode>();
    HybridPageGuard<BTreeNode> c_guard = HybridPageGuard(p_guard, parent_handler.swip.cast<BTreeNode>());
@@ -222,12 +485,22 @@ bool BTreeGeneric::tryMerge(BufferFrame& to_merge, bool swizzle_sibling)
       auto c_x_guard = ExclusivePageGuard(std::move(c_guard));
       auto l_x_guard = ExclusivePageGuard(std::move(l_guard));
       // -------------------------------------------------------------------------------------
+      u16 sep_length = p_x_guard->getFullKeyLen(pos - 1);
+      u8 sep_key[sep_length];
+      p_x_guard->copyFullKey(pos - 1, sep_key);
       if (!l_x_guard->merge(pos - 1, p_x_guard, c_x_guard)) {
          p_guard = std::move(p_x_guard);
          c_guard = std::move(c_x_guard);
          l_guard = std::move(l_x_guard);
          return false;
       }
+      if (FLAGS_wal) {
+         logMerge(p_x_guard, l_x_guard, c_x_guard, pos - 1);
+      }
+      if (c_x_guard->is_leaf) {
+         retractLeafSeparator(sep_key, sep_length);
+         markLeafDirty(c_x_guard.bf());
+      }
       l_x_guard.reclaim();
       // -------------------------------------------------------------------------------------
       p_guard = std::move(p_x_guard);
@@ -249,12 +522,22 @@ bool BTreeGeneric::tryMerge(BufferFrame& to_merge, bool swizzle_sibling)
       auto r_x_guard = ExclusivePageGuard(std::move(r_guard));
       // -------------------------------------------------------------------------------------
       assert(p_x_guard->getChild(pos).bfPtr() == c_x_guard.bf());
+      u16 sep_length = p_x_guard->getFullKeyLen(pos);
+      u8 sep_key[sep_length];
+      p_x_guard->copyFullKey(pos, sep_key);
       if (!c_x_guard->merge(pos, p_x_guard, r_x_guard)) {
          p_guard = std::move(p_x_guard);
          c_guard = std::move(c_x_guard);
          r_guard = std::move(r_x_guard);
          return false;
       }
+      if (FLAGS_wal) {
+         logMerge(p_x_guard, c_x_guard, r_x_guard, pos);
+      }
+      if (r_x_guard->is_leaf) {
+         retractLeafSeparator(sep_key, sep_length);
+         markLeafDirty(r_x_guard.bf());
+      }
       c_x_guard.reclaim();
       // -------------------------------------------------------------------------------------
       p_guard = std::move(p_x_guard);
@@ -294,10 +577,15 @@ s16 BTreeGeneric::mergeLeftIntoRight(ExclusivePageGuard<BTreeNode>& parent,
 {
    // TODO: corner cases: new upper fence is larger than the older one.
    u32 space_upper_bound = from_left->mergeSpaceUpperBound(to_right);
+   u16 old_sep_length = parent->getFullKeyLen(left_pos);
+   u8 old_sep_key[old_sep_length];
+   parent->copyFullKey(left_pos, old_sep_key);
    if (space_upper_bound <= EFFECTIVE_PAGE_SIZE) {  // Do a full merge TODO: threshold
       bool succ = from_left->merge(left_pos, parent, to_right);
       static_cast<void>(succ);
       assert(succ);
+      retractLeafSeparator(old_sep_key, old_sep_length);
+      markLeafDirty(to_right.bf());
       from_left.reclaim();
       return 1;
    }
@@ -338,6 +626,9 @@ s16 BTreeGeneric::mergeLeftIntoRight(ExclusivePageGuard<BTreeNode>& parent,
       // -------------------------------------------------------------------------------------
       from_left->copyKeyValueRange(&tmp, 0, till_slot_id, copy_from_count);
       to_right->copyKeyValueRange(&tmp, copy_from_count, 0, to_right->count);
+#ifdef INCREMENTAL_LEAF_MODEL
+      tmp.rebuildFit();
+#endif
       memcpy(reinterpret_cast<u8*>(to_right.ptr()), &tmp, sizeof(BTreeNode));
       to_right->makeHint();
       // -------------------------------------------------------------------------------------
@@ -349,6 +640,9 @@ s16 BTreeGeneric::mergeLeftIntoRight(ExclusivePageGuard<BTreeNode>& parent,
       tmp.setFences(from_left->getLowerFenceKey(), from_left->lower_fence.length, new_left_uf_key, new_left_uf_length);
       // -------------------------------------------------------------------------------------
       from_left->copyKeyValueRange(&tmp, 0, 0, from_left->count - copy_from_count);
+#ifdef INCREMENTAL_LEAF_MODEL
+      tmp.rebuildFit();
+#endif
       memcpy(reinterpret_cast<u8*>(from_left.ptr()), &tmp, sizeof(BTreeNode));
       from_left->makeHint();
       // -------------------------------------------------------------------------------------
@@ -358,6 +652,10 @@ s16 BTreeGeneric::mergeLeftIntoRight(ExclusivePageGuard<BTreeNode>& parent,
       ensure(parent->prepareInsert(from_left->upper_fence.length, sizeof(SwipType)));
       auto swip = from_left.swip();
       parent->insert(from_left->getUpperFenceKey(), from_left->upper_fence.length, reinterpret_cast<u8*>(&swip), sizeof(SwipType));
+      retractLeafSeparator(old_sep_key, old_sep_length);
+      publishLeafSplit(new_left_uf_key, new_left_uf_length, from_left.bf());
+      markLeafDirty(from_left.bf());
+      markLeafDirty(to_right.bf());
    }
    return 2;
 }
@@ -453,7 +751,7 @@ BTreeGeneric::XMergeReturnCode BTreeGeneric::XMerge(HybridPageGuard<BTreeNode>&
    return ret_code;
 }
 
-size_t BTreeGeneric::exponentialSearch(const KEY& key, const size_t& pos, const size_t& start, const size_t& end)
+size_t BTreeGeneric::exponentialSearch(const MODEL_KEY& key, const size_t& pos, const size_t& start, const size_t& end)
 {
    auto begin_i = start, end_i = end - 1;
    size_t step = 1;
@@ -484,12 +782,12 @@ size_t BTreeGeneric::exponentialSearch(const KEY& key, const size_t& pos, const
    if (begin_i > end_i) {
       throw std::runtime_error("Invalid range");
    }
-   auto ret = std::lower_bound(mapping_key.begin() + begin_i, mapping_key.begin() + end_i, key, [](const KEY data, KEY val) { return data <= val; });
+   auto ret = std::lower_bound(mapping_key.begin() + begin_i, mapping_key.begin() + end_i, key, [](const MODEL_KEY data, MODEL_KEY val) { return data <= val; });
    return std::distance(mapping_key.begin(), ret);
 }
 //--------------------------------------------------------------------------------------------
 /**
-inline BufferFrame* BTreeGeneric::fastTrainedJumpToLeafUsingSegment(const KEY key_int, const size_t segment_id)
+inline BufferFrame* BTreeGeneric::fastTrainedJumpToLeafUsingSegment(const MODEL_KEY key_int, const size_t segment_id)
 {
 #ifdef LATENCY_BREAKDOWN
 #ifdef USE_TSC
@@ -515,7 +813,7 @@ inline BufferFrame* BTreeGeneric::fastTrainedJumpToLeafUsingSegment(const KEY ke
       auto searchbound = spline_predictor.GetSearchBound(pos);
 #ifdef COMPACT_MAPPING
       auto res = std::lower_bound(mapping_key.begin() + searchbound.begin, mapping_key.begin() + searchbound.end, key_int,
-                                  [](const KEY data, KEY val) { return data < val; });
+                                  [](const MODEL_KEY data, MODEL_KEY val) { return data < val; });
       auto leaf_idx = std::distance(mapping_key.begin(), res);
       // auto leaf_idx = binarySearch(mapping_key, pos, max_error_, key_int);
       // auto leaf_idx_simd = binarySearchSIMD(mapping_key, pos, max_error_, key_int);
@@ -530,7 +828,7 @@ inline BufferFrame* BTreeGeneric::fastTrainedJumpToLeafUsingSegment(const KEY ke
       // }
 #else
       auto res = std::lower_bound(secondary_mapping_pid.begin() + searchbound.begin, secondary_mapping_pid.begin() + searchbound.end, key_int,
-                                  [](const std::pair<KEY, PID>& data, KEY val) { return data.first <= val; });
+                                  [](const std::pair<MODEL_KEY, PID>& data, MODEL_KEY val) { return data.first <= val; });
       auto leaf_idx = std::distance(secondary_mapping_pid.begin(), res);
 #endif
 #ifdef LATENCY_BREAKDOWN
@@ -564,8 +862,14 @@ inline BufferFrame* BTreeGeneric::fastTrainedJumpToLeafUsingSegment(const KEY ke
 return nullptr;
 }
 **/
-bool BTreeGeneric::jumpToLeafUsingSegment(HybridPageGuard<BTreeNode>& target_guard, const KEY key_int, const size_t segment_id)
+bool BTreeGeneric::jumpToLeafUsingSegment(HybridPageGuard<BTreeNode>& target_guard, const MODEL_KEY key_int, const size_t segment_id)
 {
+#ifdef COMPACT_MAPPING
+   // Until the trainer copies a recovered image only the snapshot has the mapping
+   if (mapping_key.empty()) {
+      return false;
+   }
+#endif
    if (spline_predictor.is_within(key_int, segment_id)) {
       auto pos = spline_predictor.GetEstimatedPosition(key_int, segment_id);
       auto searchbound = spline_predictor.GetSearchBound(pos);
@@ -579,13 +883,15 @@ bool BTreeGeneric::jumpToLeafUsingSegment(HybridPageGuard<BTreeNode>& target_gua
 #endif
       secondary_search_timer->start();
 #endif
-#ifdef COMPACT_MAPPING
+#if defined(COMPACT_MAPPING) && defined(SIMD_MAPPING_SEARCH)
+      size_t leaf_idx = utils::simd::searchAround<MODEL_KEY, true>(mapping_key, pos, spline_predictor.max_error_, key_int);
+#elif defined(COMPACT_MAPPING)
       auto res = std::lower_bound(mapping_key.begin() + searchbound.begin, mapping_key.begin() + searchbound.end, key_int,
-                                  [](const KEY data, KEY val) { return data <= val; });
+                                  [](const MODEL_KEY data, MODEL_KEY val) { return data <= val; });
       auto leaf_idx = std::distance(mapping_key.begin(), res);
 #else
       auto res = std::lower_bound(secondary_mapping_pid.begin() + searchbound.begin, secondary_mapping_pid.begin() + searchbound.end, key_int,
-                                  [](const std::pair<KEY, PID>& data, KEY val) { return data.first <= val; });
+                                  [](const std::pair<MODEL_KEY, PID>& data, MODEL_KEY val) { return data.first <= val; });
       auto leaf_idx = std::distance(secondary_mapping_pid.begin(), res);
 #endif
 #ifdef LATENCY_BREAKDOWN
@@ -602,8 +908,8 @@ bool BTreeGeneric::jumpToLeafUsingSegment(HybridPageGuard<BTreeNode>& target_gua
       // Check if the page is correct
       {
          auto test_guard = HybridPageGuard<BTreeNode>(bf);
-         auto lf_key = utils::u8_to<KEY>(test_guard->getLowerFenceKey(), test_guard->lower_fence.length);
-         auto uf_key = utils::u8_to<KEY>(test_guard->getUpperFenceKey(), test_guard->upper_fence.length);
+         auto lf_key = modelKey(test_guard->getLowerFenceKey(), test_guard->lower_fence.length);
+         auto uf_key = modelKey(test_guard->getUpperFenceKey(), test_guard->upper_fence.length);
          if (lf_key <= key_int && uf_key >= key_int) {
             target_guard = HybridPageGuard<BTreeNode>(bf);
             return true;
@@ -619,6 +925,13 @@ bool BTreeGeneric::jumpToLeafUsingSegment(HybridPageGuard<BTreeNode>& target_gua
 // -------------------------------------------------------------------------------------
 BTreeGeneric::~BTreeGeneric()
 {
+#ifdef COMPACT_MAPPING
+   warmup_stop = true;
+   if (warmup_thread.joinable()) {
+      warmup_thread.join();
+   }
+   delete model_snapshot.exchange(nullptr);
+#endif
    bg_training_thread = false;
    model_lock.unlock();
    train_signal_lock.unlock();
@@ -666,6 +979,128 @@ void BTreeGeneric::checkpoint(void*, BufferFrame& bf, u8* dest)
       }
    }
 }
+u16 BTreeGeneric::nodeImageSize(BTreeNode& node)
+{
+   return (reinterpret_cast<u8*>(node.slot + node.count) - node.ptr()) + (EFFECTIVE_PAGE_SIZE - node.data_offset);
+}
+// -------------------------------------------------------------------------------------
+void BTreeGeneric::logNodeImage(BTreeNode& node, u8* dest)
+{
+   BTreeNode tmp(node.is_leaf);
+   std::memcpy(tmp.ptr(), node.ptr(), EFFECTIVE_PAGE_SIZE);
+   if (tmp.isInner()) {
+      for (u16 t_i = 0; t_i < tmp.count; t_i++) {
+         if (!tmp.getChild(t_i).isEVICTED()) {
+            tmp.getChild(t_i).evict(tmp.getChild(t_i).bfPtrAsHot()->header.pid);
+         }
+      }
+      if (!tmp.upper.isEVICTED()) {
+         tmp.upper.evict(tmp.upper.bfPtrAsHot()->header.pid);
+      }
+   }
+   const u16 head = reinterpret_cast<u8*>(tmp.slot + tmp.count) - tmp.ptr();
+   std::memcpy(dest, tmp.ptr(), head);
+   std::memcpy(dest + head, tmp.ptr() + tmp.data_offset, EFFECTIVE_PAGE_SIZE - tmp.data_offset);
+}
+// -------------------------------------------------------------------------------------
+void BTreeGeneric::loadNodeImage(BTreeNode& node, const u8* image, u16 image_size)
+{
+   const u16 tail = EFFECTIVE_PAGE_SIZE - reinterpret_cast<const BTreeNodeHeader*>(image)->data_offset;
+   const u16 head = image_size - tail;
+   std::memset(node.ptr(), 0, EFFECTIVE_PAGE_SIZE);
+   std::memcpy(node.ptr(), image, head);
+   std::memcpy(node.ptr() + EFFECTIVE_PAGE_SIZE - tail, image + head, tail);
+}
+// -------------------------------------------------------------------------------------
+void BTreeGeneric::redoStructure(BTreeGeneric& btree, BufferFrame::Page& page, PID pid, LID gsn, const u8* entry, u16 entry_size)
+{
+   auto& node = *reinterpret_cast<BTreeNode*>(page.dt);
+   const auto type = reinterpret_cast<const WALEntry*>(entry)->type;
+   if (type == WAL_LOG_TYPE::WALInitPage) {
+      // Whatever the SSD holds for a new page, its history starts here
+      const auto& init_page = *reinterpret_cast<const WALInitPage*>(entry);
+      page.dt_id = init_page.dt_id;
+      new (&node) BTreeNode(init_page.is_leaf);
+      if (init_page.root_pid != PID(-1)) {
+         node.upper.evict(init_page.root_pid);
+      }
+      page.GSN = gsn;
+      return;
+   }
+   if (type == WAL_LOG_TYPE::WALLogicalSplit) {
+      const auto& split = *reinterpret_cast<const WALLogicalSplit*>(entry);
+      if (pid == split.right_pid && node.is_leaf) {
+         btree.redone_smos++;
+      }
+      if (gsn <= page.GSN) {
+         return;
+      }
+      u8* sep_key = const_cast<u8*>(split.payload);
+      if (pid == split.right_pid) {
+         // What BTreeNode::split leaves in the right node, the slots after right_pos for leafs and inner nodes
+         BTreeNode tmp(node.is_leaf);
+         tmp.setFences(sep_key, split.sep_length, node.getUpperFenceKey(), node.upper_fence.length);
+         node.copyKeyValueRange(&tmp, 0, split.right_pos + 1, node.count - split.right_pos - 1);
+         tmp.upper = node.upper;
+#ifdef INCREMENTAL_LEAF_MODEL
+         if (tmp.is_leaf) {
+            tmp.rebuildFit();
+         }
+#endif
+         tmp.makeHint();
+         std::memcpy(node.ptr(), tmp.ptr(), sizeof(BTreeNode));
+      } else if (pid == split.left_pid) {
+         loadNodeImage(node, split.payload + split.sep_length, entry_size - sizeof(WALLogicalSplit) - split.sep_length);
+      } else if (pid == split.parent_pid) {
+         if (split.root_split) {
+            node.upper.evict(split.right_pid);
+         }
+         SwipType swip;
+         swip.evict(split.left_pid);
+         ensure(node.prepareInsert(split.sep_length, sizeof(SwipType)));
+         node.insert(sep_key, split.sep_length, reinterpret_cast<u8*>(&swip), sizeof(SwipType));
+      } else {
+         // The meta node of a root split
+         node.upper.evict(split.parent_pid);
+      }
+   } else if (type == WAL_LOG_TYPE::WALLogicalMerge) {
+      const auto& merge = *reinterpret_cast<const WALLogicalMerge*>(entry);
+      if (pid == merge.right_pid && node.is_leaf) {
+         btree.redone_smos++;
+      }
+      if (gsn <= page.GSN) {
+         return;
+      }
+      if (pid == merge.right_pid) {
+         loadNodeImage(node, merge.payload, entry_size - sizeof(WALLogicalMerge));
+      } else {
+         node.removeSlot(merge.left_pos);
+      }
+   } else {
+      UNREACHABLE();
+   }
+   page.GSN = gsn;
+}
+// -------------------------------------------------------------------------------------
+void BTreeGeneric::recomputeHeight()
+{
+   while (true) {
+      jumpmuTry()
+      {
+         HybridPageGuard<BTreeNode> p_guard(meta_node_bf);
+         HybridPageGuard<BTreeNode> c_guard(p_guard, p_guard->upper);
+         u64 levels = 1;
+         while (!c_guard->is_leaf) {
+            p_guard = std::move(c_guard);
+            c_guard = HybridPageGuard<BTreeNode>(p_guard, p_guard->upper);
+            levels++;
+         }
+         height = levels;
+         jumpmu_break;
+      }
+      jumpmuCatch() {}
+   }
+}
 // -------------------------------------------------------------------------------------
 // TODO: Refactor
 // Jump if any page on the path is already evicted or of the bf could not be found
@@ -901,44 +1336,94 @@ u32 BTreeGeneric::bytesFree()
 bool BTreeGeneric::learnedIndexStore()
 {
 #ifdef COMPACT_MAPPING
-   std::cout << "secondary mapping size: " << mapping_key.size();
-   std::cout << "secondary  " << mapping_pid.size();
-   BinaryFileStorage<KEY> store_engine_key(secondary_mapping_file + ".key");
-   store_engine_key.store(mapping_key);
-   BinaryFileStorage<PID> store_engine_pid(secondary_mapping_file + ".pid");
-   store_engine_pid.store(mapping_pid);
+   std::shared_lock<std::shared_mutex> lock(model_lock);
+   const auto keys = trainerKeys();
+   const auto pids = trainerPids();
 #else
-   std::cout << "secondary mapping size: " << secondary_mapping_pid.size();
-   BinaryFileStorage<std::pair<KEY, PID>> mapping(secondary_mapping_file);
-   mapping.store(secondary_mapping_pid);
+   std::vector<MODEL_KEY> keys;
+   std::vector<PID> pids;
+   for (auto& [key, pid] : secondary_mapping_pid) {
+      keys.push_back(key);
+      pids.push_back(pid);
+   }
 #endif
+   std::cout << "secondary mapping size: " << keys.size() << std::endl;
    std::cout << "splines vec: " << spline_predictor.spline_points_.size() << std::endl;
    std::cout << "attached segments: " << attached_segments.size() << std::endl;
-   BinaryFileStorage<spline::Coord<KEY>> splines(segments_file);
-   splines.store(spline_predictor.spline_points_);
-   store_map(attached_segments_file, attached_segments);
-#ifdef MODEL_IN_LEAF_NODE
    std::cout << "Leaf node models: " << leaf_node_models.size() << std::endl;
-   store_models_to_file<KEY>(secondary_mapping_file + ".leaf", leaf_node_models);
-#endif
+   const auto access_counts = leaf_access_sketch.counts();
+   LearnedIndexImage::write(learnedImageFile(), keys, pids, spline_predictor.max_error_, spline_predictor.spline_points_, leaf_node_models,
+                            attached_segments, access_counts);
    return true;
 }
 // -------------------------------------------------------------------------------------
 bool BTreeGeneric::learnedIndexLoad()
+{
+   if (!std::filesystem::exists(learnedImageFile())) {
+      return learnedIndexLoadFiles();
+   }
+   std::cout << "Mapping learned index image " << learnedImageFile() << std::endl;
+   auto image = std::make_shared<const LearnedIndexImage>(learnedImageFile(), FLAGS_learned_image_verify);
+   const auto keys = image->keys();
+   const auto pids = image->pids();
+#ifdef COMPACT_MAPPING
+#ifdef MAPPING_BLOCKS
+   // The blocked layout is a copy anyway
+   mapping_key.assign(keys.begin(), keys.end());
+   mapping_pid.assign(pids.begin(), pids.end());
+   mapping_image.reset();
+#else
+   // The trainer and the published snapshot both use the image in place, the first merge or train copies it
+   mapping_key.clear();
+   mapping_pid.clear();
+   mapping_image = image;
+#endif
+   mapping_bfs.assign(pids.size(), nullptr);
+#else
+   secondary_mapping_pid.clear();
+   secondary_mapping_bf.clear();
+   for (u64 i = 0; i < keys.size(); i++) {
+      secondary_mapping_pid.emplace_back(keys[i], pids[i]);
+      secondary_mapping_bf.emplace_back(keys[i], nullptr);
+   }
+#endif
+   spline_predictor = spline::RadixSpline<MODEL_KEY>(image->header().max_error, keys.size(), image->splinePoints());
+   image->loadAttachedSegments(attached_segments);
+   leaf_access_sketch.load(image->accessSketch());
+#ifdef MODEL_IN_LEAF_NODE
+   {
+      std::unique_lock<std::mutex> guard(leaf_node_models_lock);
+      image->loadLeafModels(leaf_node_models);
+   }
+#endif
+   std::cout << "secondary mapping size: " << keys.size() << std::endl;
+   std::cout << "splines vec: " << spline_predictor.spline_points_.size() << std::endl;
+   std::cout << "attached segments: " << attached_segments.size() << std::endl;
+   if (keys.size() > 0) {
+      trained = true;
+   }
+#ifdef COMPACT_MAPPING
+   publishModel(std::move(image));
+#endif
+   return true;
+}
+// -------------------------------------------------------------------------------------
+bool BTreeGeneric::learnedIndexLoadFiles()
 {
    std::cout << "Loading secondary mapping" << std::endl;
 #ifdef COMPACT_MAPPING
-   BinaryFileStorage<KEY> store_engine_key(secondary_mapping_file + ".key");
+   BinaryFileStorage<MODEL_KEY> store_engine_key(secondary_mapping_file + ".key");
    mapping_key = std::move(store_engine_key.load());
    BinaryFileStorage<PID> store_engine_pid(secondary_mapping_file + ".pid");
    mapping_pid = std::move(store_engine_pid.load());
+   mapping_image.reset();
    mapping_bfs.clear();
    mapping_bfs.resize(mapping_pid.size());
    for (auto i = 0; i < mapping_pid.size(); ++i) {
       mapping_bfs[i] = nullptr;
    }
 #else
-   BinaryFileStorage<std::pair<KEY, PID>> mapping(secondary_mapping_file);
+   BinaryFileStorage<std::pair<MODEL_KEY, PID>> mapping(secondary_mapping_file);
    secondary_mapping_pid = std::move(mapping.load());
    secondary_mapping_bf.clear();
    secondary_mapping_bf.reserve(secondary_mapping_pid.size());
@@ -947,14 +1432,14 @@ bool BTreeGeneric::learnedIndexLoad()
    }
 #endif
    std::cout << "Loading splines" << std::endl;
-   BinaryFileStorage<spline::Coord<KEY>> splines(segments_file);
+   BinaryFileStorage<spline::Coord<MODEL_KEY>> splines(segments_file);
    auto splines_vec = std::move(splines.load());
 #ifdef COMPACT_MAPPING
    auto leaf_count = mapping_key.size();
 #else
    auto leaf_count = secondary_mapping_pid.size();
 #endif
-   spline_predictor = spline::RadixSpline<KEY>(max_error_, leaf_count, splines_vec);
+   spline_predictor = spline::RadixSpline<MODEL_KEY>(max_error_, leaf_count, splines_vec);
    std::cout << "Loading attached segments" << std::endl;
    load_map(attached_segments_file, attached_segments);
 #ifdef COMPACT_MAPPING
@@ -970,6 +1455,9 @@ bool BTreeGeneric::learnedIndexLoad()
    if (mapping_key.size() > 0) {
       trained = true;
    }
+#ifdef COMPACT_MAPPING
+   publishModel();
+#endif
    return true;
 }
 // -------------------------------------------------------------------------------------
@@ -1032,6 +1520,11 @@ void BTreeGeneric::deserialize(BTreeGeneric& btree, std::unordered_map<std::stri
    assert(btree.meta_node_bf->page.dt_id == btree.dt_id);
    std::cout << "Desearializing " << std::endl;
    btree.learnedIndexLoad();
+#ifdef COMPACT_MAPPING
+   if (FLAGS_warmup_fraction > 0) {
+      btree.startWarmup();
+   }
+#endif
    // assert(reinterpret_cast<BTreeNode*>(btree.meta_node_bf->page.dt)->count > 0);
 }
 // -------------------------------------------------------------------------------------
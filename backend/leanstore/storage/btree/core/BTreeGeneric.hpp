@@ -4,6 +4,13 @@
 #include "BTreeInterface.hpp"
 #include "BTreeIteratorInterface.hpp"
 #include "BTreeNode.hpp"
+#include "BlockedMapping.hpp"
+#include "KeyNormalizer.hpp"
+#include "LeafAccessSketch.hpp"
+#include "LeafTrainQueue.hpp"
+#include "LearnedIndexImage.hpp"
+#include "LearnedRouter.hpp"
+#include "MappingDelta.hpp"
 #include "flat_hash_map.hpp"
 #include "leanstore/Config.hpp"
 #include "leanstore/compileConst.hpp"
@@ -12,8 +19,10 @@
 #include "leanstore/rs/builder.hpp"
 #include "leanstore/rs/radix_spline.h"
 #include "leanstore/storage/buffer-manager/BufferManager.hpp"
+#include "leanstore/sync-primitives/Epoch.hpp"
 #include "leanstore/sync-primitives/PageGuard.hpp"
 #include "leanstore/utils/RandomGenerator.hpp"
+#include "leanstore/utils/SIMDSearch.hpp"
 #include "leanstore/utils/convert.hpp"
 #ifdef INSTRUMENT_CACHE_MISS
 #include "cachemisscounter.hpp"
@@ -36,12 +45,111 @@ namespace btree
 // -------------------------------------------------------------------------------------
 struct WALInitPage : WALEntry {
    DTID dt_id;
+   bool is_leaf;
+   PID root_pid;  // The meta node of a new tree points to its root, -1 for all other pages
 };
+// Logged on every page of the split, the redo tells them apart by the pid. The right node keeps the slots
+// after right_pos, the parent gets the separator, the left node is logged as a compacted image behind
+// the separator, see BTreeGeneric::logNodeImage
 struct WALLogicalSplit : WALEntry {
    PID parent_pid = -1;
    PID left_pid = -1;
    PID right_pid = -1;
    s32 right_pos = -1;
+   u16 sep_length = 0;
+   bool root_split = false;  // parent is the new root, the meta node points to it
+   u8 payload[];
+};
+// The parent drops the slot of the left node, the right node is logged as an image of the union
+struct WALLogicalMerge : WALEntry {
+   PID parent_pid = -1;
+   PID left_pid = -1;
+   PID right_pid = -1;
+   s32 left_pos = -1;
+   u8 payload[];
+};
+// -------------------------------------------------------------------------------------
+// Last mile search of the learned lookups: first mapping key >= key around the estimate of the spline
+inline size_t searchMappingFrom(const spline::RadixSpline<MODEL_KEY>& spline, std::vector<MODEL_KEY>& keys, const MODEL_KEY key, const double estimate)
+{
+#ifdef SIMD_MAPPING_SEARCH
+   return utils::simd::searchAround(keys, estimate, spline.max_error_, key);
+#elif defined(RS_EXPONENTIAL_SEARCH)
+   return spline::RadixSpline<MODEL_KEY>::exponentialSearch(key, keys, estimate);
+#else
+   auto bound = spline.GetSearchBound(estimate);
+   return spline::RadixSpline<MODEL_KEY>::binarySearch(key, keys, bound.begin, bound.end);
+#endif
+}
+inline size_t searchMapping(const spline::RadixSpline<MODEL_KEY>& spline, std::vector<MODEL_KEY>& keys, const MODEL_KEY key, const size_t spline_idx)
+{
+   return searchMappingFrom(spline, keys, key, spline.GetEstimatedPosition(key, spline_idx));
+}
+// -------------------------------------------------------------------------------------
+// Immutable copy of the trained root model used by the lookup fast path. A new snapshot is
+// published with an atomic pointer swap, old ones are freed through the EpochManager.
+// The buffer frames are only a hint, readers look up the frame on a pid mismatch without writing it back.
+struct ModelSnapshot {
+   u64 version = 0;
+   // Version of the snapshot that built the mapping, copies that only swap the router or frames keep it
+   u64 mapping_version = 0;
+   // Mapping deltas below this sequence number are folded into the mapping, see MappingDeltaBuffer::resolve
+   u64 folded_seq = 0;
+   // Over modelKey()s, so the width is that of the normalizer and not the compile time KEY.
+   // Carries the RouterConfig it was built with, useRouter() compares against it
+   RootRouter<MODEL_KEY> router;
+#ifdef MAPPING_BLOCKS
+   BlockedMapping mapping;
+   // -------------------------------------------------------------------------------------
+   inline size_t size() const { return mapping.size(); }
+   inline bool covers(const MODEL_KEY key) const { return mapping.key(0) <= key && key <= mapping.key(mapping.size() - 1); }
+   inline size_t searchFrom(const MODEL_KEY key, const double estimate) const { return mapping.search(key, estimate, router.errorAt(key)); }
+   inline BlockedMapping::Keys keys() const { return mapping.keys(); }
+   inline PID pid(const size_t idx) const { return mapping.leaf(idx).pid; }
+   inline BufferFrame* bf(const size_t idx) const { return mapping.leaf(idx).bf; }
+   // Only before the snapshot is published
+   inline void setBf(const size_t idx, BufferFrame* bf) { mapping.leaf(idx).bf = bf; }
+   inline void prefetchKeys(const double estimate) const { mapping.prefetchKeys(estimate); }
+   inline void prefetchLeaf(const size_t idx) const { mapping.prefetchLeaf(idx); }
+#else
+   // Views of either the owned copies or the keys and pids of a mapped learned index image
+   utils::ArrayView<MODEL_KEY> mapping_key;
+   utils::ArrayView<PID> mapping_pid;
+   std::vector<BufferFrame*> mapping_bfs;
+   std::vector<MODEL_KEY> owned_key;
+   std::vector<PID> owned_pid;
+   std::shared_ptr<const LearnedIndexImage> image;
+   // -------------------------------------------------------------------------------------
+   ModelSnapshot() = default;
+   ModelSnapshot(const ModelSnapshot&) = delete;
+   ModelSnapshot& operator=(const ModelSnapshot&) = delete;
+   inline size_t size() const { return mapping_key.size(); }
+   inline bool covers(const MODEL_KEY key) const { return mapping_key.front() <= key && key <= mapping_key.back(); }
+   inline size_t searchFrom(const MODEL_KEY key, const double estimate) const { return router.search(mapping_key, key, estimate); }
+   inline utils::ArrayView<MODEL_KEY> keys() const { return mapping_key; }
+   inline PID pid(const size_t idx) const { return mapping_pid[idx]; }
+   inline BufferFrame* bf(const size_t idx) const { return mapping_bfs[idx]; }
+   // Only before the snapshot is published
+   inline void setBf(const size_t idx, BufferFrame* bf) { mapping_bfs[idx] = bf; }
+   // Lines the search around estimate starts with, the window borders decide whether it has to move
+   inline void prefetchKeys(const double estimate) const
+   {
+      const size_t pos = (estimate <= 0) ? 0 : std::min<size_t>(estimate, mapping_key.size() - 1);
+      const size_t max_error = router.maxError();
+      __builtin_prefetch(&mapping_key[(pos > max_error + 1) ? pos - max_error - 1 : 0]);
+      __builtin_prefetch(&mapping_key[pos]);
+      __builtin_prefetch(&mapping_key[std::min<size_t>(mapping_key.size() - 1, pos + max_error + 1)]);
+   }
+   inline void prefetchLeaf(const size_t idx) const
+   {
+      __builtin_prefetch(&mapping_pid[idx]);
+      __builtin_prefetch(&mapping_bfs[idx]);
+   }
+#endif
+   // -------------------------------------------------------------------------------------
+   // search() split in two, so that batched lookups can prefetch in between
+   inline double estimate(const MODEL_KEY key) const { return router.estimate(key); }
+   inline size_t search(const MODEL_KEY key) const { return searchFrom(key, estimate(key)); }
 };
 // -------------------------------------------------------------------------------------
 class BTreeGeneric
@@ -55,16 +163,22 @@ class BTreeGeneric
    BufferFrame* meta_node_bf;  // kept in memory
    atomic<u64> height = 1;
    DTID dt_id;
-   spline::RadixSpline<KEY> spline_predictor;
+   spline::RadixSpline<MODEL_KEY> spline_predictor;
    // rsindex::RadixSpline<KEY> rs_spline_predictor;
 
 #ifdef COMPACT_MAPPING
-   std::vector<KEY> mapping_key;
+   std::vector<MODEL_KEY> mapping_key;
    std::vector<PID> mapping_pid;
    std::vector<BufferFrame*> mapping_bfs;
+   // Set while the trainer's mapping is still the recovered image, the vectors above stay empty until it changes
+   std::shared_ptr<const LearnedIndexImage> mapping_image;
+   // Leaf splits/merges since the mapping was built, folded in by the training thread
+   MappingDeltaBuffer mapping_deltas;
+   // What lookups see, the vectors above are the trainer's copy guarded by model_lock
+   std::atomic<ModelSnapshot*> model_snapshot = nullptr;
 #else
-   std::vector<std::pair<KEY, PID>> secondary_mapping_pid;
-   std::vector<std::pair<KEY, BufferFrame*>> secondary_mapping_bf;
+   std::vector<std::pair<MODEL_KEY, PID>> secondary_mapping_pid;
+   std::vector<std::pair<MODEL_KEY, BufferFrame*>> secondary_mapping_bf;
    // std::vector<std::pair<KEY, Swip<BTreeNode>>> secondary_mapping_swip;
 #endif
    std::string secondary_mapping_file = "secondary_mapping.bin";
@@ -72,13 +186,27 @@ class BTreeGeneric
    std::string attached_segments_file = "attached_segments.bin";
    bool bg_training_thread = false;
    std::thread training_thread;
-   std::thread leaf_training_thread;
+   // Retrain the leaf models of the leafs in leaf_train_queue
+   std::vector<std::thread> leaf_trainers;
+   LeafTrainQueue leaf_train_queue;
+   std::mutex leaf_node_models_lock;
+   // Which leafs the learned lookups went to, the warmup after a recovery reads the hottest
+   LeafAccessSketch leaf_access_sketch;
+   std::atomic<bool> warming_up = false;
+   std::atomic<bool> warmup_stop = false;
+   std::thread warmup_thread;
    std::mutex train_signal_lock;
    std::mutex train_leaf_signal_lock;
    std::shared_mutex model_lock;
+   // Orders the snapshot swaps of the trainer and of useRouter()
+   std::mutex publish_lock;
    std::condition_variable train_signal;
    std::condition_variable train_leaf_signal;
    bool trained = false;
+   // Model and mapping search of the next snapshots, set when the tree is registered and by useRouter(), guarded by model_lock
+   RouterConfig router_config;
+   // Learned before the first model, the same for every model of the tree afterwards
+   KeyNormalizer<MODEL_KEY> key_normalizer;
    int max_error_ = 16;
    int min_attach_level_ = 2;
    ska::flat_hash_map<PID, std::vector<size_t>>& attached_segments = BMC::attached_segments;
@@ -113,14 +241,79 @@ class BTreeGeneric
    static ParentSwipHandler findParent(BTreeGeneric& btree_object, BufferFrame& to_find);
    static void iterateChildrenSwips(void* btree_object, BufferFrame& bf, std::function<bool(Swip<BufferFrame>&)> callback);
    static void checkpoint(void*, BufferFrame& bf, u8* dest);
+   // Header, slots and heap of the node with unswizzled children, what lies between is not logged
+   static u16 nodeImageSize(BTreeNode& node);
+   static void logNodeImage(BTreeNode& node, u8* dest);
+   static void loadNodeImage(BTreeNode& node, const u8* image, u16 image_size);
+   // Replays a WALInitPage, WALLogicalSplit or WALLogicalMerge record on the SSD copy of the page, leaf SMOs are
+   // counted in redone_smos whether the page already had them or not
+   static void redoStructure(BTreeGeneric& btree, BufferFrame::Page& page, PID pid, LID gsn, const u8* entry, u16 entry_size);
+   std::atomic<u64> redone_smos = 0;
+   // Counts the levels down to the leftmost leaf, root splits in the WAL are not in the persisted height
+   void recomputeHeight();
    static std::unordered_map<std::string, std::string> serialize(BTreeGeneric&);
    static void deserialize(BTreeGeneric&, std::unordered_map<std::string, std::string>);
    // -------------------------------------------------------------------------------------
    ~BTreeGeneric();
    // -------------------------------------------------------------------------------------
+   // Keys and separators as the models see them
+   inline MODEL_KEY modelKey(const u8* key, const u16 key_length) const { return key_normalizer.normalize(key, key_length); }
+   // Integer keys of the integer lookups (u32 or u64), normalized as their folded bytes
+   template <typename Key>
+   inline MODEL_KEY modelKey(const Key key) const
+   {
+      u8 key_bytes[sizeof(Key)];
+      for (u16 i = 0; i < sizeof(Key); i++) {
+         key_bytes[i] = static_cast<u8>(key >> (8 * (sizeof(Key) - 1 - i)));
+      }
+      return modelKey(key_bytes, sizeof(Key));
+   }
+#ifdef COMPACT_MAPPING
+   // Pre: only called by the thread that trains this tree
+   // With an image the snapshot uses its keys and pids in place instead of copying the trainer's vectors.
+   // folded_seq: the mapping holds every delta below it
+   void publishModel(std::shared_ptr<const LearnedIndexImage> image = nullptr, u64 folded_seq = 0);
+   // Switches the root model or the mapping search of the published snapshot. The mapping is shared with the
+   // current snapshot and the model is only refitted when config trains it differently, the leafs are left alone
+   void useRouter(const RouterConfig& config);
+   // The trainer's mapping, in the vectors or in mapping_image. Pre: model_lock held
+   inline utils::ArrayView<MODEL_KEY> trainerKeys() const { return mapping_image ? mapping_image->keys() : utils::ArrayView<MODEL_KEY>(mapping_key); }
+   inline utils::ArrayView<PID> trainerPids() const { return mapping_image ? mapping_image->pids() : utils::ArrayView<PID>(mapping_pid); }
+   // Pre: caller holds an EpochGuard for as long as it uses the snapshot
+   inline ModelSnapshot* currentModel() const { return model_snapshot.load(std::memory_order_acquire); }
+   // Snapshot over the same mapping, frames and router as current, for swaps that only change one of them.
+   // Pre: publish_lock held
+   ModelSnapshot* copyModel(const ModelSnapshot& current);
+   // Reads the FLAGS_warmup_fraction hottest leafs of the sketch in warmup_thread, in mapping_key
+   // order, and publishes snapshots whose mapping_bfs point to them
+   void startWarmup();
+   void warmup();
+#endif
+   void publishLeafSplit(const u8* sep_key, const u16 sep_length, BufferFrame* new_left);
+   void retractLeafSeparator(const u8* sep_key, const u16 sep_length);
+   // Queues the leaf for the trainers, once until it is trained again.
+   // Pre: bf exclusively latched
+   inline void markLeafDirty(BufferFrame* bf)
+   {
+#ifdef INCREMENTAL_LEAF_MODEL
+      // The fit is current, only a stale error bound is left to the trainers
+      if (!reinterpret_cast<BTreeNode*>(bf->page.dt)->fitErrorStale()) {
+         return;
+      }
+#endif
+      if (!bg_training_thread || bf->header.model_queued.load(std::memory_order_relaxed) || bf->header.model_queued.exchange(true)) {
+         return;
+      }
+      if (leaf_train_queue.push(bf->header.pid, bf)) {
+         WorkerCounters::myCounters().leaf_train_enqueued[dt_id]++;
+      } else {
+         bf->header.model_queued = false;
+      }
+   }
+   // -------------------------------------------------------------------------------------
    // Mapping key exponential search
-   size_t exponentialSearch(const KEY& key, const size_t& pos, const size_t& start, const size_t& end);
-   inline BufferFrame* fastTrainedJumpToLeafUsingSegment(const KEY key_int, const size_t segment_id)
+   size_t exponentialSearch(const MODEL_KEY& key, const size_t& pos, const size_t& start, const size_t& end);
+   inline BufferFrame* fastTrainedJumpToLeafUsingSegment(const MODEL_KEY key_int, const size_t segment_id)
    {
 #ifdef LATENCY_BREAKDOWN
 #ifdef USE_TSC
@@ -130,6 +323,12 @@ class BTreeGeneric
 #endif
       auto using_segment_timer = timer_registry.registerObject("using_segment", "inference_and_secondary_search");
       Scope scoped_timer(*using_segment_timer);
+#endif
+#ifdef COMPACT_MAPPING
+      // Until the trainer copies a recovered image only the snapshot has the mapping
+      if (mapping_key.empty()) {
+         return nullptr;
+      }
 #endif
       if (!spline_predictor.is_within(key_int, segment_id)) {
          // INFO("key_int: %lu, segment_id: %lu upper_x: %lu upper_pos: %lu lower_x: %lu lower_pos: %lu", key_int, segment_id,
@@ -153,7 +352,9 @@ class BTreeGeneric
       // #endif
       auto searchbound = spline_predictor.GetSearchBound(pos);
 #ifdef COMPACT_MAPPING
-#ifdef EXPONENTIAL_SEARCH
+#if defined(SIMD_MAPPING_SEARCH)
+      auto leaf_idx = utils::simd::searchAround(mapping_key, pos, spline_predictor.max_error_, key_int);
+#elif defined(EXPONENTIAL_SEARCH)
       auto leaf_idx = exponentialSearch(key_int, pos, searchbound.begin, searchbound.end);
 #else
       auto res = std::lower_bound(mapping_key.begin() + searchbound.begin, mapping_key.begin() + searchbound.end, key_int);
@@ -187,13 +388,13 @@ class BTreeGeneric
 #else
 #ifdef DONT_USE_PID
       auto res = std::lower_bound(secondary_mapping_bf.begin() + searchbound.begin, secondary_mapping_bf.begin() + searchbound.end, key_int,
-                                  [](const std::pair<KEY, BufferFrame*>& data, KEY val) { return data.first < val; });
+                                  [](const std::pair<MODEL_KEY, BufferFrame*>& data, MODEL_KEY val) { return data.first < val; });
       auto leaf_idx = std::distance(secondary_mapping_bf.begin(), res);
       auto& lbfs = res->second;
       auto lpid = secondary_mapping_pid[leaf_idx].second;
 #else
       auto res = std::lower_bound(secondary_mapping_pid.begin() + searchbound.begin, secondary_mapping_pid.begin() + searchbound.end, key_int,
-                                  [](const std::pair<KEY, PID>& data, KEY val) { return data.first < val; });
+                                  [](const std::pair<MODEL_KEY, PID>& data, MODEL_KEY val) { return data.first < val; });
       // auto leaf_idx = std::distance(secondary_mapping_pid.begin(), res);
       // auto pid = secondary_mapping_pid[leaf_idx].second;
       auto pid = res->second;
@@ -224,9 +425,15 @@ class BTreeGeneric
       // #endif
       return bf;
    };
-   bool jumpToLeafUsingSegment(HybridPageGuard<BTreeNode>& target_guard, const KEY key_int, const size_t segment_id);
-   inline BufferFrame* jumpToLeafUsingSegment(const KEY key_int, const size_t segment_id)
+   bool jumpToLeafUsingSegment(HybridPageGuard<BTreeNode>& target_guard, const MODEL_KEY key_int, const size_t segment_id);
+   inline BufferFrame* jumpToLeafUsingSegment(const MODEL_KEY key_int, const size_t segment_id)
    {
+#ifdef COMPACT_MAPPING
+      // Until the trainer copies a recovered image only the snapshot has the mapping
+      if (mapping_key.empty()) {
+         return nullptr;
+      }
+#endif
       if (!spline_predictor.is_within(key_int, segment_id)) {
          return nullptr;
       }
@@ -241,16 +448,18 @@ class BTreeGeneric
       auto secondary_search_timer = timer_registry.registerObject("secondary search", "secondary_search");
       secondary_search_timer->start();
 #endif
-#ifdef COMPACT_MAPPING
+#if defined(COMPACT_MAPPING) && defined(SIMD_MAPPING_SEARCH)
+      size_t leaf_idx = utils::simd::searchAround<MODEL_KEY, true>(mapping_key, pos, spline_predictor.max_error_, key_int);
+#elif defined(COMPACT_MAPPING)
       // Temporary fix for fast train
       auto res = std::lower_bound(mapping_key.begin() + searchbound.begin, mapping_key.begin() + searchbound.end, key_int,
-                                  [](const KEY data, KEY val) { return data <= val; });
+                                  [](const MODEL_KEY data, MODEL_KEY val) { return data <= val; });
       // auto res = std::lower_bound(mapping_key.begin() + searchbound.begin, mapping_key.begin() + searchbound.end, key_int,
       //  [](const KEY data, KEY val) { return data < val; });
       auto leaf_idx = std::distance(mapping_key.begin(), res);
 #else
       auto res = std::lower_bound(secondary_mapping_pid.begin() + searchbound.begin, secondary_mapping_pid.begin() + searchbound.end, key_int,
-                                  [](const std::pair<KEY, PID>& data, KEY val) { return data.first <= val; });
+                                  [](const std::pair<MODEL_KEY, PID>& data, MODEL_KEY val) { return data.first <= val; });
       auto leaf_idx = std::distance(secondary_mapping_pid.begin(), res);
 #endif
 #ifdef LATENCY_BREAKDOWN
@@ -421,7 +630,7 @@ class BTreeGeneric
       p_guard.unlock();
    }
 
-   inline BufferFrame* fastTrainFindLeafUsingSegmentAttachedAtRoot(KEY key)
+   inline BufferFrame* fastTrainFindLeafUsingSegmentAttachedAtRoot(MODEL_KEY key)
    {
       // if (!spline_predictor.WithinSpline(key)) {
       //    return nullptr;
@@ -432,7 +641,7 @@ class BTreeGeneric
    }
 
    template <LATCH_FALLBACK_MODE mode = LATCH_FALLBACK_MODE::SHARED>
-   inline void fastTrainFindLeafUsingSegment(HybridPageGuard<BTreeNode>& target_guard, KEY key, const u8* key_bytes)
+   inline void fastTrainFindLeafUsingSegment(HybridPageGuard<BTreeNode>& target_guard, MODEL_KEY key, const u8* key_bytes)
    {
 #ifdef INSTRUMENT_CODE
 #ifdef USE_TSC
@@ -534,7 +743,7 @@ class BTreeGeneric
             // auto it = std::lower_bound(segments->begin(), segments->end(), key,
             //                            [&](size_t a, KEY b) { return spline_predictor.spline_points_[a].x < key; });
             auto it = std::lower_bound(seg_ptr_vec.begin(), seg_ptr_vec.end(), key,
-                                       [&](size_t a, KEY b) { return spline_predictor.spline_points_[a].x < b; });
+                                       [&](size_t a, MODEL_KEY b) { return spline_predictor.spline_points_[a].x < b; });
 #ifdef LATENCY_BREAKDOWN
             // segment_search_timer->stop();
 #endif
@@ -615,7 +824,7 @@ class BTreeGeneric
          auto prob = rand() / static_cast<double>(RAND_MAX);
          if (prob < MISS_PROB) {
             // convert key to integer or number
-            auto key_int = utils::u8_to<KEY>(key, key_length);
+            auto key_int = modelKey(key, key_length);
             // search for the segment
             auto pred = spline_predictor.GetEstimatedPosition(key_int);
             // load the leaf and return
@@ -654,7 +863,7 @@ class BTreeGeneric
    }
 
    template <LATCH_FALLBACK_MODE mode = LATCH_FALLBACK_MODE::SHARED>
-   inline void findLeafUsingSegment(HybridPageGuard<BTreeNode>& target_guard, KEY key, const u8* key_bytes)
+   inline void findLeafUsingSegment(HybridPageGuard<BTreeNode>& target_guard, MODEL_KEY key, const u8* key_bytes)
    {
       const auto key_length = sizeof(KEY);
 #ifdef LATENCY_BREAKDOWN
@@ -724,7 +933,7 @@ class BTreeGeneric
                segment_search_timer->start();
 #endif
                auto it = std::lower_bound(seg_ptr_vec.begin(), seg_ptr_vec.end(), key,
-                                          [&](size_t a, KEY b) { return spline_predictor.spline_points_[a].x < key; });
+                                          [&](size_t a, MODEL_KEY b) { return spline_predictor.spline_points_[a].x < key; });
 #ifdef LATENCY_BREAKDOWN
                segment_search_timer->stop();
 #endif
@@ -893,7 +1102,7 @@ class BTreeGeneric
       target_guard = HybridPageGuard<BTreeNode>(p_guard, p_guard->upper);
       // -------------------------------------------------------------------------------------
       u16 volatile level = 0;
-      KEY key_int = utils::u8_to<KEY>(key, key_length);
+      const MODEL_KEY key_int = modelKey(key, key_length);
       // -------------------------------------------------------------------------------------
       while (!target_guard->is_leaf) {
 #ifdef LATENCY_BREAKDOWN
@@ -938,7 +1147,7 @@ class BTreeGeneric
                segment_search_timer->start();
 #endif
                auto it = std::lower_bound(seg_ptr_vec.begin(), seg_ptr_vec.end(), key_int,
-                                          [&](size_t a, KEY b) { return spline_predictor.spline_points_[a].x < key_int; });
+                                          [&](size_t a, MODEL_KEY b) { return spline_predictor.spline_points_[a].x < key_int; });
 #ifdef LATENCY_BREAKDOWN
                segment_search_timer->stop();
 #endif
@@ -1119,6 +1328,10 @@ class BTreeGeneric
    // -------------------------------------------------------------------------------------
    inline bool isMetaNode(HybridPageGuard<BTreeNode>& guard) { return meta_node_bf == guard.bf; }
    inline bool isMetaNode(ExclusivePageGuard<BTreeNode>& guard) { return meta_node_bf == guard.bf(); }
+   // WAL records of the SMOs, see WALLogicalSplit and WALLogicalMerge. sep_key is null for the meta node
+   void logInitPage(ExclusivePageGuard<BTreeNode>& guard, bool is_leaf, PID root_pid = -1);
+   void logSplit(ExclusivePageGuard<BTreeNode>& guard, const WALLogicalSplit& split, const u8* sep_key, bool with_image);
+   void logMerge(ExclusivePageGuard<BTreeNode>& parent, ExclusivePageGuard<BTreeNode>& left, ExclusivePageGuard<BTreeNode>& right, s32 left_pos);
    s64 iterateAllPages(std::function<s64(BTreeNode&)> inner, std::function<s64(BTreeNode&)> leaf);
    s64 iterateAllPagesRec(HybridPageGuard<BTreeNode>& node_guard, std::function<s64(BTreeNode&)> inner, std::function<s64(BTreeNode&)> leaf);
    s64 iterateAllPagesWithoutCheck(std::function<s64(BTreeNode&)> inner, std::function<s64(BTreeNode&)> leaf, LATCH_FALLBACK_MODE mode);
@@ -1132,7 +1345,11 @@ class BTreeGeneric
    u64 getHeight();
    double averageSpaceUsage();
    u32 bytesFree();
+   // The models and the mapping as one LearnedIndexImage next to secondary_mapping_file
+   inline std::string learnedImageFile() const { return secondary_mapping_file + ".img"; }
    bool learnedIndexLoad();
+   // Stores persisted before the image, one file per structure
+   bool learnedIndexLoadFiles();
    bool learnedIndexStore();
    void printInfos(uint64_t totalSize);
 };
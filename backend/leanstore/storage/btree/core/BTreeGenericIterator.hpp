@@ -31,10 +31,13 @@ class BTreePessimisticIterator : public BTreePessimisticIteratorInterface
    bool is_using_upper_fence;
    s32 cur = -1;
    s32 leaf_idx = 0;
+   ModelSnapshot* model = nullptr;
+   size_t read_ahead_until = 0;  // mapping index the SSD read-ahead has covered
    u8 buffer[1024];
    // -------------------------------------------------------------------------------------
   public:
    BTreePessimisticIterator(BTreeGeneric& btree) : btree(btree) {}
+   ~BTreePessimisticIterator() { drainReadAhead(); }
    bool nextLeaf()
    {
       if (leaf->upper_fence.length == 0) {
@@ -68,6 +71,158 @@ class BTreePessimisticIterator : public BTreePessimisticIteratorInterface
       }
    }
 
+   // -------------------------------------------------------------------------------------
+   // Model guided scans (seekwithseg/nextwithseg). The first leaf comes from the model, the following
+   // ones from its mapping, taken only if their lower fence is the upper fence of the current leaf.
+   // Pre: the caller holds an EpochGuard for as long as the iterator uses the model
+   template <typename Matches>
+   bool latchIfLeafMatches(BufferFrame* bf, const PID pid, Matches matches)
+   {
+      if (bf == nullptr || bf->header.pid != pid) {
+         // Not where the mapping saw it last, e.g. read ahead. Our own reads have to land first.
+         while (BMC::global_bf->readAheadPending() && !BMC::global_bf->isPageInBufferPool(pid)) {
+            BMC::global_bf->pollReadAhead(true);
+         }
+         bf = BMC::global_bf->pageInBufferFrame(pid).bf;
+         if (bf == nullptr) {
+            return false;
+         }
+      }
+      bool latched = false;
+      jumpmuTry()
+      {
+         HybridPageGuard<BTreeNode> target(bf);
+         if constexpr (mode == LATCH_FALLBACK_MODE::EXCLUSIVE) {
+            target.toExclusive();
+         } else {
+            target.toShared();
+         }
+         // The frame can have been evicted or reused before we latched it
+         if (bf->header.pid == pid && bf->header.state != BufferFrame::STATE::FREE && target->is_leaf && matches(target.ref())) {
+            leaf = std::move(target);
+            latched = true;
+         }
+      }
+      jumpmuCatch() {}
+      return latched;
+   }
+   bool seekLeafWithModel(Slice key)
+   {
+      const MODEL_KEY key_int = btree.modelKey(key.data(), key.length());
+      if (model == nullptr || !model->covers(key_int)) {
+         return false;
+      }
+      const size_t idx = model->search(key_int);
+      if (!latchIfLeafMatches(model->bf(idx), model->pid(idx), [&](BTreeNode& node) { return node.compareKeyWithBoundaries(key.data(), key.length()) == 0; })) {
+         return false;
+      }
+      leaf_idx = idx;
+      read_ahead_until = 0;
+      return true;
+   }
+   // Pre: buffer holds the upper fence of the previous leaf, fence_length includes the 0 suffix
+   bool nextLeafWithModel()
+   {
+      if (model == nullptr || leaf_idx < 0 || static_cast<size_t>(leaf_idx) >= model->size()) {
+         return false;
+      }
+      const size_t idx = leaf_idx + 1;
+      return latchIfLeafMatches(model->bf(idx), model->pid(idx), [&](BTreeNode& node) {
+         return node.lower_fence.length + 1 == fence_length && std::memcmp(node.getLowerFenceKey(), buffer, node.lower_fence.length) == 0;
+      });
+   }
+   // Mapping index of the current leaf by its upper fence, -1 if the model does not cover it
+   s32 mappingIndexOfLeaf()
+   {
+      if (model == nullptr || leaf->upper_fence.length == 0) {
+         return -1;
+      }
+      const MODEL_KEY upper = btree.modelKey(leaf->getUpperFenceKey(), leaf->upper_fence.length);
+      return model->covers(upper) ? model->search(upper) : -1;
+   }
+   // Frames FLAGS_scan_prefetch_leaves ahead of the cursor, and the mapping entries twice as far
+   void prefetchLeafsAhead()
+   {
+      if (model == nullptr || leaf_idx < 0) {
+         return;
+      }
+      readLeafsAhead();
+      const size_t ahead = FLAGS_scan_prefetch_leaves;
+      if (ahead == 0) {
+         return;
+      }
+      if (const size_t idx = leaf_idx + 2 * ahead; idx <= model->size()) {
+         model->prefetchLeaf(idx);
+      }
+      if (const size_t idx = leaf_idx + ahead; idx <= model->size()) {
+         if (BufferFrame* bf = model->bf(idx); bf != nullptr) {
+            __builtin_prefetch(&bf->header);
+            __builtin_prefetch(bf->page.dt);
+         }
+      }
+   }
+   // Issues SSD reads for the leafs among the next FLAGS_scan_readahead_leaves the mapping does not
+   // see in the pool. The window is refilled once half of it is consumed, so the reads are batched.
+   // The batch is installed before the scan returns to its caller: the IOFrame mutexes of the reads are
+   // ours until then, a scan callback touching one of these leafs would wait for itself and other
+   // readers of them for the callback.
+   void readLeafsAhead()
+   {
+      const size_t ahead = FLAGS_scan_readahead_leaves;
+      if (ahead == 0) {
+         return;
+      }
+      const size_t begin = std::max<size_t>(read_ahead_until, leaf_idx + 1);
+      const size_t end = std::min<size_t>(leaf_idx + 1 + ahead, model->size() + 1);
+      if (begin >= end || (end - begin < (ahead + 1) / 2 && end <= model->size())) {
+         return;
+      }
+      PID pids[ahead];
+      u64 pids_count = 0;
+      for (size_t idx = begin; idx < end; idx++) {
+         BufferFrame* bf = model->bf(idx);
+         const PID pid = model->pid(idx);
+         if (bf == nullptr || bf->header.pid != pid || bf->header.state == BufferFrame::STATE::FREE) {
+            pids[pids_count++] = pid;
+         }
+      }
+      read_ahead_until = end;
+      if (pids_count > 0) {
+         BMC::global_bf->readAhead(pids, pids_count);
+         drainReadAhead();
+      }
+   }
+   // Installs this thread's outstanding reads, before it blocks in resolveSwip on one of them or leaves
+   void drainReadAhead()
+   {
+      while (BMC::global_bf->readAheadPending()) {
+         BMC::global_bf->pollReadAhead(true);
+      }
+   }
+   // First slot >= key, starting at the position the leaf model predicts
+   s32 startSlotWithModel(Slice key)
+   {
+#ifdef INCREMENTAL_LEAF_MODEL
+      return leaf->fitSearch<false>(key.data(), key.length());
+#elif defined(MODEL_IN_LEAF_NODE) && defined(MODEL_LR)
+      if (auto& leaf_model = leaf.bf->header.model; leaf_model.m != 0 && leaf->count > 0) {
+         const KEY key_int = utils::u8_to<KEY>(key.data(), key.length());
+         const s16 predict = std::min<size_t>(leaf_model.predict(key_int), leaf->count - 1);
+#ifdef SIMD_LEAF_SEARCH
+         return leaf->modelSearch<false>(key.data(), key.length(), predict, leaf_model.get_error());
+#else
+         bool is_equal = false;
+         const s32 pos = leaf->exponentialSearch<false>(key.data(), key.length(), predict, &is_equal);
+         // The exponential search stops at the last slot, even if key is above it
+         if (is_equal || pos < leaf->count - 1) {
+            return pos;
+         }
+#endif
+      }
+#endif
+      return leaf->lowerBound<false>(key.data(), key.length());
+   }
+
   public:
    virtual OP_RESULT seekExact(Slice key) override
    {
@@ -81,6 +236,24 @@ class BTreePessimisticIterator : public BTreePessimisticIteratorInterface
          return OP_RESULT::NOT_FOUND;
       }
    }
+   // seekExact for point operations, the leaf comes from the model if it has it
+   // Pre: the caller holds an EpochGuard
+   OP_RESULT seekExactWithModel(Slice key)
+   {
+      model = btree.currentModel();
+      if (cur == -1 || leaf->compareKeyWithBoundaries(key.data(), key.length()) != 0) {
+         if (!seekLeafWithModel(key)) {
+            drainReadAhead();
+            btree.findLeafAndLatch<mode>(leaf, key.data(), key.length());
+         }
+      }
+      cur = leaf->lowerBound<true>(key.data(), key.length());
+      if (cur != -1) {
+         return OP_RESULT::OK;
+      } else {
+         return OP_RESULT::NOT_FOUND;
+      }
+   }
    // -------------------------------------------------------------------------------------
    virtual OP_RESULT seekFirstLeaf() override
    {
@@ -110,28 +283,17 @@ class BTreePessimisticIterator : public BTreePessimisticIteratorInterface
    }
    virtual OP_RESULT seekwithseg(Slice key) override
    {
+      model = btree.currentModel();
       if (cur == -1 || leaf->compareKeyWithBoundaries(key.data(), key.length()) != 0) {
-         auto key_int = utils::u8_to<KEY>(key.data(), key.length());
-         auto spline_idx = btree.spline_predictor.GetSplineSegment(key_int);
-         leaf_idx = btree.spline_predictor.GetEstimatedPosition(key_int, spline_idx, btree.mapping_key);
-         auto leaf_bf = btree.mapping_bfs[leaf_idx];
-         if (leaf_bf != nullptr) {
-            leaf = HybridPageGuard<BTreeNode>(leaf_bf);
-            s16 sanity_check_result = leaf->compareKeyWithBoundaries(key.data(), key.length());
-            if (sanity_check_result == 0) {
-               btree.findLeafAndLatch<mode>(leaf, key.data(), key.length());
-            } else {
-               if constexpr (mode == LATCH_FALLBACK_MODE::EXCLUSIVE) {
-                  leaf.toExclusive();
-               } else if (mode == LATCH_FALLBACK_MODE::SHARED) {
-                  leaf.toShared();
-               }
-            }
-         } else {
+         if (!seekLeafWithModel(key)) {
+            drainReadAhead();
             btree.findLeafAndLatch<mode>(leaf, key.data(), key.length());
+            leaf_idx = mappingIndexOfLeaf();
+            read_ahead_until = 0;
          }
+         prefetchLeafsAhead();
       }
-      cur = leaf->lowerBound<false>(key.data(), key.length());
+      cur = startSlotWithModel(key);
       if (cur < leaf->count) {
          return OP_RESULT::OK;
       } else {
@@ -221,6 +383,9 @@ class BTreePessimisticIterator : public BTreePessimisticIteratorInterface
    // -------------------------------------------------------------------------------------
    virtual OP_RESULT nextwithseg() override
    {
+      if (model == nullptr) {
+         model = btree.currentModel();
+      }
       while (true) {
          ensure(leaf.guard.state != GUARD_STATE::OPTIMISTIC);
          if ((cur + 1) < leaf->count) {
@@ -229,34 +394,35 @@ class BTreePessimisticIterator : public BTreePessimisticIteratorInterface
          } else if (leaf->upper_fence.length == 0) {
             return OP_RESULT::NOT_FOUND;
          } else {
-            // leaf_idx
-            auto keys = utils::u8_to<KEY>(leaf->getUpperFenceKey(), leaf->upper_fence.length);
-            // auto keys = btree.mapping_key[leaf_idx + 1];
-            // auto keys = btree.mapping_key[leaf_idx];
-            auto leaf_bf = btree.mapping_bfs[leaf_idx + 1];
-            if (leaf_bf != nullptr) {
-               auto nxtleaf = HybridPageGuard<BTreeNode>(leaf_bf);
-               auto key_int = utils::u8_to<KEY>(nxtleaf->getLowerFenceKey(), nxtleaf->lower_fence.length);
-               // auto key_int = utils::u8_to<KEY>(nxtleaf->getUpperFenceKey(), nxtleaf->upper_fence.length);
-               if (key_int == keys) {
-                  leaf = std::move(nxtleaf);
-                  cur = 0;
-                  leaf_idx++;
-                  // return OP_RESULT::OK;
-               } else {
-                  std::cout << "leaf_bf is lower: " << key_int << " upper: " << keys << std::endl;
-                  next();
-               }
-            } else {
-               std::cout << "leaf_bf is null" << std::endl;
-               next();
+            fence_length = leaf->upper_fence.length + 1;
+            is_using_upper_fence = true;
+            std::memcpy(buffer, leaf->getUpperFenceKey(), leaf->upper_fence.length);
+            buffer[fence_length - 1] = 0;
+            // -------------------------------------------------------------------------------------
+            leaf.unlock();
+            // -------------------------------------------------------------------------------------
+            if (nextLeafWithModel()) {
+               // All keys of the next leaf are above its lower fence
+               leaf_idx++;
+               prefetchLeafsAhead();
+               cur = -1;
+               continue;
             }
-            if constexpr (mode == LATCH_FALLBACK_MODE::EXCLUSIVE) {
-               leaf.toExclusive();
+            // Mapping is stale here, take the fence path and find our place in the mapping again
+            drainReadAhead();
+            btree.findLeafAndLatch<mode>(leaf, buffer, fence_length);
+            leaf_idx = mappingIndexOfLeaf();
+            read_ahead_until = 0;
+            prefetchLeafsAhead();
+            // -------------------------------------------------------------------------------------
+            if (leaf->count == 0) {
+               continue;
             }
-            if constexpr (mode == LATCH_FALLBACK_MODE::SHARED) {
-               leaf.toShared();
+            cur = leaf->lowerBound<false>(buffer, fence_length);
+            if (cur == leaf->count) {
+               continue;
             }
+            return OP_RESULT::OK;
          }
       }
       // // auto count = 0;
@@ -437,12 +603,12 @@ class BTreeExclusiveIterator : public BTreePessimisticIterator<LATCH_FALLBACK_MO
    }
    virtual OP_RESULT seekToInsertFast(Slice key)
    {
-      KEY key_int = utils::u8_to<KEY>(key.data(), key.length());
+      const MODEL_KEY key_int = btree.modelKey(key.data(), key.length());
       bool is_equal = false;
       if (cur == -1 || leaf->compareKeyWithBoundaries(key.data(), key.length()) != 0) {
-         if (btree.mapping_key[0] <= key_int && key_int <= btree.mapping_key[btree.mapping_key.size() - 1]) {
+         if (!btree.mapping_key.empty() && btree.mapping_key[0] <= key_int && key_int <= btree.mapping_key[btree.mapping_key.size() - 1]) {
             auto spline_idx = btree.spline_predictor.GetSplineSegment(key_int);
-            auto leaf_idx = btree.spline_predictor.GetEstimatedPosition(key_int, spline_idx, btree.mapping_key);
+            auto leaf_idx = searchMapping(btree.spline_predictor, btree.mapping_key, key_int, spline_idx);
             auto leaf_bf = btree.mapping_bfs[leaf_idx];
             if (leaf_bf != nullptr) {
                leaf = HybridPageGuard<BTreeNode>(leaf_bf);
@@ -456,8 +622,8 @@ class BTreeExclusiveIterator : public BTreePessimisticIterator<LATCH_FALLBACK_MO
                //    cur = leaf->lowerBound<false>(key.data(), key.length(), &is_equal);
                // }
 #ifdef INSERT_MODEL_IN_LEAF_NODE
-               auto lf_key = utils::u8_to<KEY>(leaf->getLowerFenceKey(), leaf->lower_fence.length);
-               auto uf_key = utils::u8_to<KEY>(leaf->getUpperFenceKey(), leaf->upper_fence.length);
+               auto lf_key = btree.modelKey(leaf->getLowerFenceKey(), leaf->lower_fence.length);
+               auto uf_key = btree.modelKey(leaf->getUpperFenceKey(), leaf->upper_fence.length);
                if (lf_key > key_int || uf_key < key_int) {
                   btree.incorrect_leaf++;
                   btree.findLeafAndLatch<LATCH_FALLBACK_MODE::EXCLUSIVE>(leaf, key.data(), key.length());
@@ -465,8 +631,10 @@ class BTreeExclusiveIterator : public BTreePessimisticIterator<LATCH_FALLBACK_MO
                }
 #ifdef MODEL_LR
                else if (auto& model = leaf_bf->header.model; model.m != 0) {
-                  auto predict = model.predict(key_int);
-#ifdef EXPONENTIAL_SEARCH
+                  auto predict = model.predict(utils::u8_to<KEY>(key.data(), key.length()));
+#if defined(SIMD_LEAF_SEARCH)
+                  cur = leaf->modelSearch<false>(key.data(), key.length(), predict, model.get_error(), &is_equal);
+#elif defined(EXPONENTIAL_SEARCH)
                   cur = leaf->exponentialSearch<false>(key.data(), key.length(), predict, &is_equal);
 #else
                   auto search_bound = bf->header.model.get_search_bound();
@@ -477,8 +645,8 @@ class BTreeExclusiveIterator : public BTreePessimisticIterator<LATCH_FALLBACK_MO
                }
 #endif
 #else
-               auto lf_key = utils::u8_to<KEY>(leaf->getLowerFenceKey(), leaf->lower_fence.length);
-               auto uf_key = utils::u8_to<KEY>(leaf->getUpperFenceKey(), leaf->upper_fence.length);
+               auto lf_key = btree.modelKey(leaf->getLowerFenceKey(), leaf->lower_fence.length);
+               auto uf_key = btree.modelKey(leaf->getUpperFenceKey(), leaf->upper_fence.length);
                if (lf_key > key_int || uf_key < key_int) {
                   btree.incorrect_leaf++;
                   btree.findLeafAndLatch<LATCH_FALLBACK_MODE::EXCLUSIVE>(leaf, key.data(), key.length());
@@ -19,7 +19,8 @@ enum class WAL_LOG_TYPE : u8 {
    WALAfterBeforeImage = 4,
    WALAfterImage = 5,
    WALLogicalSplit = 10,
-   WALInitPage = 11
+   WALInitPage = 11,
+   WALLogicalMerge = 12
 };
 struct WALEntry {
    WAL_LOG_TYPE type;
@@ -52,6 +53,9 @@ class BTreeInterface
    virtual OP_RESULT fast_insert(u8* key, u16 key_length, u8* value, u16 value_length) = 0;
    virtual OP_RESULT updateSameSize(u8* key, u16 key_length, function<void(u8* value, u16 value_size)>, WALUpdateGenerator = {{}, {}, 0}) = 0;
    virtual OP_RESULT remove(u8* key, u16 key_length) = 0;
+   // Point operations on byte keys that take the leaf from the trained model
+   virtual OP_RESULT lookupSeg(u8* key, u16 key_length, function<void(const u8*, u16)> payload_callback) = 0;
+   virtual OP_RESULT updateSameSizeSeg(u8* key, u16 key_length, function<void(u8* value, u16 value_size)>, WALUpdateGenerator = {{}, {}, 0}) = 0;
    virtual OP_RESULT scanAscAll(function<bool(const u8* key, u16 key_length, const u8* value, u16 value_length)>) = 0;
    virtual OP_RESULT scanAscAllSeg(function<bool(const u8* key, u16 key_length, const u8* value, u16 value_length)>) = 0;
    virtual OP_RESULT scanAsc(u8* start_key,
@@ -157,6 +157,9 @@ s16 BTreeNode::insertDoNotCopyPayload(const u8* key, u16 key_len, u16 payload_le
    // -------------------------------------------------------------------------------------
    count++;
    updateHint(slotId);
+#ifdef INCREMENTAL_LEAF_MODEL
+   fitInsert(slotId);
+#endif
    return slotId;
 }
 // -------------------------------------------------------------------------------------
@@ -176,6 +179,9 @@ s32 BTreeNode::insert(const u8* key, u16 key_len, const u8* payload, u16 payload
    storeKeyValue(slotId, key, key_len, payload, payload_length);
    count++;
    updateHint(slotId);
+#ifdef INCREMENTAL_LEAF_MODEL
+   fitInsert(slotId);
+#endif
    return slotId;
    // -------------------------------------------------------------------------------------
    DEBUG_BLOCK()
@@ -201,6 +207,9 @@ void BTreeNode::compactify()
    tmp.setFences(getLowerFenceKey(), lower_fence.length, getUpperFenceKey(), upper_fence.length);
    copyKeyValueRange(&tmp, 0, 0, count);
    tmp.upper = upper;
+#ifdef INCREMENTAL_LEAF_MODEL
+   tmp.fit = fit;
+#endif
    memcpy(reinterpret_cast<char*>(this), &tmp, sizeof(BTreeNode));
    makeHint();
    assert(freeSpace() == should);  // TODO: why should ??
@@ -239,6 +248,9 @@ bool BTreeNode::merge(u16 slotId, ExclusivePageGuard<BTreeNode>& parent, Exclusi
       }
       copyKeyValueRange(&tmp, 0, 0, count);
       right->copyKeyValueRange(&tmp, count, 0, right->count);
+#ifdef INCREMENTAL_LEAF_MODEL
+      tmp.rebuildFit();
+#endif
       parent->removeSlot(slotId);
       memcpy(reinterpret_cast<u8*>(right.ptr()), &tmp, sizeof(BTreeNode));
       right->makeHint();
@@ -453,6 +465,10 @@ void BTreeNode::split(ExclusivePageGuard<BTreeNode>& parent, ExclusivePageGuard<
    if (is_leaf) {
       copyKeyValueRange(nodeLeft.ptr(), 0, 0, sepSlot + 1);
       copyKeyValueRange(nodeRight, 0, nodeLeft->count, count - nodeLeft->count);
+#ifdef INCREMENTAL_LEAF_MODEL
+      nodeLeft->rebuildFit();
+      nodeRight->rebuildFit();
+#endif
    } else {
       copyKeyValueRange(nodeLeft.ptr(), 0, 0, sepSlot);
       copyKeyValueRange(nodeRight, 0, nodeLeft->count + 1, count - nodeLeft->count - 1);
@@ -467,6 +483,9 @@ void BTreeNode::split(ExclusivePageGuard<BTreeNode>& parent, ExclusivePageGuard<
 // -------------------------------------------------------------------------------------
 bool BTreeNode::removeSlot(u16 slotId)
 {
+#ifdef INCREMENTAL_LEAF_MODEL
+   fitRemove(slotId);
+#endif
    space_used -= getKeyLen(slotId) + getPayloadLength(slotId);
    memmove(slot + slotId, slot + slotId + 1, sizeof(Slot) * (count - slotId - 1));
    count--;
@@ -474,6 +493,68 @@ bool BTreeNode::removeSlot(u16 slotId)
    return true;
 }
 // -------------------------------------------------------------------------------------
+#ifdef INCREMENTAL_LEAF_MODEL
+// Pre: the slot is stored and counted
+void BTreeNode::fitInsert(u16 slotId)
+{
+   if (!is_leaf) {
+      return;
+   }
+   fit.insertAt(slot[slotId].head, slotId, sumHeads(slotId + 1, count));
+   // Past what fitErrorStale() queues for, in case no trainer runs
+   if (fit.updates > count / 2) {
+      refreshFitError();
+   }
+}
+// -------------------------------------------------------------------------------------
+// Pre: the slot is still in the node
+void BTreeNode::fitRemove(u16 slotId)
+{
+   if (!is_leaf) {
+      return;
+   }
+   fit.removeAt(slot[slotId].head, slotId, sumHeads(slotId + 1, count));
+   if (fit.updates > count / 2) {
+      refreshFitError();
+   }
+}
+// -------------------------------------------------------------------------------------
+// After the slots were copied in, e.g. on split and merge, where the prefix and hence the heads change
+void BTreeNode::rebuildFit()
+{
+   fit = LeafFit();
+   unsigned __int128 sum_xx = 0;
+   for (u16 i = 0; i < count; i++) {
+      const u64 x = slot[i].head;
+      fit.sum_x += x;
+      fit.sum_xy += x * i;
+      sum_xx += static_cast<unsigned __int128>(x) * x;
+   }
+   fit.n = count;
+   fit.setSumXX(sum_xx);
+   fit.refit();
+   refreshFitError();
+}
+// -------------------------------------------------------------------------------------
+// Also run under an optimistic latch by the leaf trainers, hence the count is clamped to the page
+u16 BTreeNode::fitError()
+{
+   const u16 slots = std::min<u64>(count, pure_slots_capacity);
+   size_t error = 0;
+   for (u16 i = 0; i < slots; i++) {
+      const size_t predicted = fit.predict(slot[i].head);
+      error = std::max(error, (predicted > i) ? predicted - i : i - predicted);
+   }
+   return std::min<size_t>(error, std::numeric_limits<u16>::max());
+}
+// -------------------------------------------------------------------------------------
+void BTreeNode::refreshFitError()
+{
+   fit.error = fitError();
+   fit.updates = 0;
+}
+#endif
+// -------------------------------------------------------------------------------------
 bool BTreeNode::remove(const u8* key, const u16 keyLength)
 {
    int slotId = lowerBound<true>(key, keyLength);
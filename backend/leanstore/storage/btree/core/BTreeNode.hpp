@@ -5,6 +5,7 @@
 #include "leanstore/storage/buffer-manager/BufferFrame.hpp"
 #include "leanstore/storage/buffer-manager/DTRegistry.hpp"
 #include "leanstore/sync-primitives/PageGuard.hpp"
+#include "leanstore/utils/SIMDSearch.hpp"
 // -------------------------------------------------------------------------------------
 // -------------------------------------------------------------------------------------
 
@@ -73,6 +74,9 @@ struct BTreeNodeHeader {
       u8 tag[hint_count * 4];
    };
    // u32 hint[hint_count];
+#ifdef INCREMENTAL_LEAF_MODEL
+   LeafFit fit;
+#endif
 
    BTreeNodeHeader(bool is_leaf) : is_leaf(is_leaf) {}
    ~BTreeNodeHeader() {}
@@ -444,6 +448,84 @@ struct BTreeNode : public BTreeNodeHeader {
       }
       return lower;
    }
+   // Lower bound of key around the slot a leaf model predicts. The heads of [pos - max_error,
+   // pos + max_error] are counted branch free (gathers, the slots are packed), full keys are only
+   // compared on a head tie. Exact in any case, lowerBound() is the fallback if the window misses.
+   template <bool equalityOnly = false>
+   s16 modelSearch(const u8* key, u16 keyLength, size_t predicted, size_t max_error, bool* isequal = nullptr)
+   {
+      if (isequal != nullptr) {
+         *isequal = false;
+      }
+      if (count == 0 || keyLength < prefix_length || (prefix_length > 0 && memcmp(key, getLowerFenceKey(), prefix_length) != 0)) {
+         return lowerBound<equalityOnly>(key, keyLength, isequal);
+      }
+      const u16 pos = std::min<size_t>(predicted, count - 1);
+      const u8* suffix = key + prefix_length;
+      u16 suffix_length = keyLength - prefix_length;
+      const HeadType keyHead = head(suffix, suffix_length);
+      const u16 begin = (pos > max_error) ? pos - max_error : 0;
+      const u16 end = std::min<size_t>(count, pos + max_error + 1);
+      // Every slot with keyHead has to be in the window, ties are resolved in it
+      if ((begin > 0 && slot[begin - 1].head >= keyHead) || (end < count && slot[end].head <= keyHead)) {
+         return lowerBound<equalityOnly>(key, keyLength, isequal);
+      }
+      u16 lower = begin + utils::simd::countLessStrided(reinterpret_cast<const u8*>(&slot[begin].head), sizeof(Slot), end - begin, keyHead);
+      // With fixed width keys this loop runs at most once
+      for (; lower < end && slot[lower].head == keyHead; lower++) {
+         s32 cmp;
+         if (slot[lower].key_len <= 4) {
+            cmp = static_cast<s32>(suffix_length) - slot[lower].key_len;
+         } else {
+            cmp = cmpKeys(suffix, getKey(lower), suffix_length, getKeyLen(lower));
+         }
+         if (cmp == 0) {
+            if (isequal != nullptr) {
+               *isequal = true;
+            }
+            return lower;
+         } else if (cmp < 0) {
+            break;
+         }
+      }
+      if constexpr (equalityOnly) {
+         return -1;
+      }
+      return lower;
+   }
+#ifdef INCREMENTAL_LEAF_MODEL
+   // Slot the in-page fit predicts for key
+   inline size_t predictSlot(const u8* key, u16 keyLength)
+   {
+      if (keyLength < prefix_length) {
+         return 0;
+      }
+      u16 suffix_length = keyLength - prefix_length;
+      return fit.predict(head(key + prefix_length, suffix_length));
+   }
+   template <bool equalityOnly = false>
+   inline s16 fitSearch(const u8* key, u16 keyLength, bool* isequal = nullptr)
+   {
+      return modelSearch<equalityOnly>(key, keyLength, predictSlot(key, keyLength), fit.error, isequal);
+   }
+   // Sum of the heads of [begin, end), the x the slots moved by an insert or remove contribute
+   inline u64 sumHeads(u16 begin, u16 end)
+   {
+      u64 sum = 0;
+      for (u16 i = begin; i < end; i++) {
+         sum += slot[i].head;
+      }
+      return sum;
+   }
+   // The bound lags the fit once count / 8 slots moved, the leaf trainers then recompute it
+   inline bool fitErrorStale() { return fit.updates > count / 8; }
+   // Largest distance between the predicted and the actual slot
+   u16 fitError();
+   void fitInsert(u16 slotId);
+   void fitRemove(u16 slotId);
+   void rebuildFit();
+   void refreshFitError();
+#endif
    // Returns the position where the key[pos] (if exists) >= key (not less than the given key)
    // Asc: (2) (2) (1) -> (2) (2) (1) (0) -> (2) (2) (1) (0) (0) -> ...  -> (2) (2) (2)
    template <bool equalityOnly = false>
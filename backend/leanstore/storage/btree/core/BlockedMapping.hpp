@@ -0,0 +1,115 @@
+#pragma once
+#include "Units.hpp"
+#include "leanstore/compileConst.hpp"
+#include "leanstore/utils/SIMDSearch.hpp"
+// -------------------------------------------------------------------------------------
+#include <algorithm>
+#include <limits>
+#include <vector>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+struct BufferFrame;
+namespace btree
+{
+// -------------------------------------------------------------------------------------
+// Secondary mapping laid out for lookups (MAPPING_BLOCKS). Every block starts with one cache
+// line of separators followed by the pid/BufferFrame slots of exactly those leafs, so the
+// search probes one key line per block and resolving the leaf costs one more line in the
+// same block, instead of a line in each of mapping_pid and mapping_bfs.
+class BlockedMapping
+{
+  public:
+   static constexpr size_t KEYS_PER_BLOCK = 64 / sizeof(MODEL_KEY);
+   struct Leaf {
+      PID pid;
+      BufferFrame* bf;
+   };
+   struct alignas(64) Block {
+      MODEL_KEY keys[KEYS_PER_BLOCK];
+      Leaf leafs[KEYS_PER_BLOCK];
+   };
+   // Random access to the separators, for MappingDeltaBuffer::resolve
+   struct Keys {
+      const BlockedMapping& mapping;
+      inline size_t size() const { return mapping.size(); }
+      inline MODEL_KEY operator[](const size_t i) const { return mapping.key(i); }
+   };
+   // -------------------------------------------------------------------------------------
+   // keys holds the separators, pids/bfs one more entry for the rightmost leaf
+   void build(const std::vector<MODEL_KEY>& keys, const std::vector<PID>& pids, const std::vector<BufferFrame*>& bfs)
+   {
+      count = keys.size();
+      blocks.clear();
+      if (pids.empty()) {
+         return;
+      }
+      blocks.resize((pids.size() + KEYS_PER_BLOCK - 1) / KEYS_PER_BLOCK);
+      for (size_t i = 0; i < blocks.size() * KEYS_PER_BLOCK; i++) {
+         auto& block = blocks[i / KEYS_PER_BLOCK];
+         // Padding sorts last, so every block search terminates in the block
+         block.keys[i % KEYS_PER_BLOCK] = (i < count) ? keys[i] : std::numeric_limits<MODEL_KEY>::max();
+         block.leafs[i % KEYS_PER_BLOCK] = (i < pids.size()) ? Leaf{pids[i], bfs[i]} : Leaf{0, nullptr};
+      }
+   }
+   inline size_t size() const { return count; }
+   inline MODEL_KEY key(const size_t i) const { return blocks[i / KEYS_PER_BLOCK].keys[i % KEYS_PER_BLOCK]; }
+   inline Leaf& leaf(const size_t i) { return blocks[i / KEYS_PER_BLOCK].leafs[i % KEYS_PER_BLOCK]; }
+   inline const Leaf& leaf(const size_t i) const { return blocks[i / KEYS_PER_BLOCK].leafs[i % KEYS_PER_BLOCK]; }
+   inline Keys keys() const { return Keys{*this}; }
+   // Key line of the block the search starts in, and the slots of a found leaf
+   inline void prefetchKeys(const double estimate) const
+   {
+      const size_t pos = (estimate <= 0) ? 0 : std::min<size_t>(estimate, count);
+      __builtin_prefetch(blocks[pos / KEYS_PER_BLOCK].keys);
+   }
+   inline void prefetchLeaf(const size_t i) const { __builtin_prefetch(&blocks[i / KEYS_PER_BLOCK].leafs[i % KEYS_PER_BLOCK]); }
+   // -------------------------------------------------------------------------------------
+   // Same contract as utils::simd::searchAround: first separator >= key, exact for any estimate.
+   // The window moves by whole blocks, a block is known to hold the answer from its own key line.
+   size_t search(const MODEL_KEY key, const double estimate, const size_t max_error) const
+   {
+      if (count == 0) {
+         return 0;
+      }
+      const size_t last = blocks.size() - 1;
+      const size_t pos = (estimate <= 0) ? 0 : std::min<size_t>(estimate, count - 1);
+      size_t lower = std::min(pos / KEYS_PER_BLOCK, last), upper = lower;
+      size_t step = max_error / KEYS_PER_BLOCK + 1;
+      if (blocks[upper].keys[KEYS_PER_BLOCK - 1] < key) {
+         // Terminates, the last block ends with padding
+         while (blocks[upper].keys[KEYS_PER_BLOCK - 1] < key) {
+            lower = upper + 1;
+            upper = std::min(last, upper + step);
+            step *= 2;
+         }
+      } else {
+         while (lower > 0 && blocks[lower].keys[0] >= key) {
+            upper = lower;
+            lower = (lower > step) ? lower - step : 0;
+            step *= 2;
+         }
+      }
+      // First block whose last separator is >= key, then within its key line
+      while (lower < upper) {
+         const size_t mid = (lower + upper) / 2;
+         if (blocks[mid].keys[KEYS_PER_BLOCK - 1] < key) {
+            lower = mid + 1;
+         } else {
+            upper = mid;
+         }
+      }
+      const size_t idx = lower * KEYS_PER_BLOCK + utils::simd::lowerBound(blocks[lower].keys, 0, KEYS_PER_BLOCK, key);
+      return std::min(idx, count);
+   }
+
+  private:
+   std::vector<Block> blocks;
+   size_t count = 0;
+};
+// -------------------------------------------------------------------------------------
+}  // namespace btree
+}  // namespace storage
+}  // namespace leanstore
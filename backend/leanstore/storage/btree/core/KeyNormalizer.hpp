@@ -0,0 +1,76 @@
+#pragma once
+#include "Units.hpp"
+#include "leanstore/utils/convert.hpp"
+// -------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+namespace btree
+{
+// -------------------------------------------------------------------------------------
+// Maps byte keys (folded multi column keys, strings) to the integer keys the models are trained on.
+// The bytes every key of the tree starts with are dropped, the next sizeof(T) bytes are read big
+// endian and zero padded. The mapping keeps the order but not the identity of keys, callers check
+// the leaf they land in against its fences. Keys that fit T map as they always did (no prefix).
+template <typename T>
+class KeyNormalizer
+{
+  public:
+   static constexpr u16 MAX_PREFIX = 32;
+   // -------------------------------------------------------------------------------------
+   // Pre: only called before any key was normalized for a model, min <= max
+   void learn(const u8* min_key, const u16 min_length, const u8* max_key, const u16 max_length)
+   {
+      u16 length = 0;
+      if (std::max(min_length, max_length) > sizeof(T)) {
+         const u16 limit = std::min<u16>({min_length, max_length, MAX_PREFIX});
+         while (length < limit && min_key[length] == max_key[length]) {
+            length++;
+         }
+      }
+      std::memcpy(prefix, min_key, length);
+      prefix_length.store(length, std::memory_order_release);
+      is_learned = true;
+   }
+   inline bool learned() const { return is_learned; }
+   inline u16 prefixLength() const { return prefix_length.load(std::memory_order_acquire); }
+   // -------------------------------------------------------------------------------------
+   inline T normalize(const u8* key, const u16 key_length) const
+   {
+      const u16 length = prefixLength();
+      if (length > 0) {
+         const int cmp = std::memcmp(key, prefix, std::min(key_length, length));
+         if (cmp < 0 || (cmp == 0 && key_length < length)) {
+            return std::numeric_limits<T>::min();
+         } else if (cmp > 0) {
+            return std::numeric_limits<T>::max();
+         }
+      }
+      return utils::u8_to<T>(key + length, std::min<u16>(key_length - length, sizeof(T)));
+   }
+   // A byte key with the prefix that normalizes to key, writes prefixLength() + sizeof(T) bytes
+   inline u16 denormalize(const T key, u8* out) const
+   {
+      const u16 length = prefixLength();
+      std::memcpy(out, prefix, length);
+      for (u16 i = 0; i < sizeof(T); i++) {
+         out[length + i] = static_cast<u8>(key >> (8 * (sizeof(T) - 1 - i)));
+      }
+      return length + sizeof(T);
+   }
+
+  private:
+   u8 prefix[MAX_PREFIX] = {};
+   std::atomic<u16> prefix_length = 0;
+   bool is_learned = false;
+};
+// -------------------------------------------------------------------------------------
+}  // namespace btree
+}  // namespace storage
+}  // namespace leanstore
@@ -0,0 +1,91 @@
+#pragma once
+#include "Units.hpp"
+#include "leanstore/utils/ArrayView.hpp"
+// -------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <vector>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+namespace btree
+{
+// -------------------------------------------------------------------------------------
+// Count-min sketch of the leafs the learned lookups go to, every SAMPLE-th lookup of a thread
+// is counted. It is persisted in the learned index image, so that the warmup after a recovery
+// knows which leafs were hot. Counters are bumped with a relaxed load and store, a racing bump
+// is lost, which only makes the estimate a bit lower.
+class LeafAccessSketch
+{
+  public:
+   static constexpr u64 ROWS = 4;
+   static constexpr u64 COLUMN_BITS = 14;
+   static constexpr u64 COLUMNS = u64(1) << COLUMN_BITS;
+   static constexpr u64 COUNTERS = ROWS * COLUMNS;
+   static constexpr u64 SAMPLE = 16;
+   // -------------------------------------------------------------------------------------
+   LeafAccessSketch() : counters(new std::atomic<u32>[COUNTERS])
+   {
+      for (u64 i = 0; i < COUNTERS; i++) {
+         counters[i].store(0, std::memory_order_relaxed);
+      }
+   }
+   inline void record(const PID pid)
+   {
+      static thread_local u64 lookups = 0;
+      if (++lookups % SAMPLE != 0) {
+         return;
+      }
+      for (u64 r_i = 0; r_i < ROWS; r_i++) {
+         auto& counter = counters[r_i * COLUMNS + column(pid, r_i)];
+         const u32 count = counter.load(std::memory_order_relaxed);
+         if (count != std::numeric_limits<u32>::max()) {
+            counter.store(count + 1, std::memory_order_relaxed);
+         }
+      }
+   }
+   inline u32 estimate(const PID pid) const
+   {
+      u32 count = std::numeric_limits<u32>::max();
+      for (u64 r_i = 0; r_i < ROWS; r_i++) {
+         count = std::min(count, counters[r_i * COLUMNS + column(pid, r_i)].load(std::memory_order_relaxed));
+      }
+      return count;
+   }
+   // -------------------------------------------------------------------------------------
+   std::vector<u32> counts() const
+   {
+      std::vector<u32> result(COUNTERS);
+      for (u64 i = 0; i < COUNTERS; i++) {
+         result[i] = counters[i].load(std::memory_order_relaxed);
+      }
+      return result;
+   }
+   // Counts of another geometry are dropped, the warmup then has no history
+   void load(utils::ArrayView<u32> persisted)
+   {
+      if (persisted.size() != COUNTERS) {
+         return;
+      }
+      for (u64 i = 0; i < COUNTERS; i++) {
+         counters[i].store(persisted[i], std::memory_order_relaxed);
+      }
+   }
+
+  private:
+   std::unique_ptr<std::atomic<u32>[]> counters;
+   // -------------------------------------------------------------------------------------
+   static inline u64 column(const PID pid, const u64 row)
+   {
+      static constexpr u64 SEEDS[ROWS] = {0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0xD6E8FEB86659FD93ull};
+      return ((pid + 1) * SEEDS[row]) >> (64 - COLUMN_BITS);
+   }
+};
+// -------------------------------------------------------------------------------------
+}  // namespace btree
+}  // namespace storage
+}  // namespace leanstore
@@ -0,0 +1,122 @@
+#pragma once
+#include "Units.hpp"
+// -------------------------------------------------------------------------------------
+#include <atomic>
+#include <memory>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+struct BufferFrame;
+namespace btree
+{
+// -------------------------------------------------------------------------------------
+// Leafs whose keys changed since their model was trained. Every writer thread pushes into its own
+// bounded ring (threads past RINGS share one), trainer t drains the rings r with r % trainers == t.
+// The rings are Vyukov's bounded queue, hence safe with several producers or consumers on one ring.
+// A full ring drops the leaf, it is queued again with its next write.
+class LeafTrainQueue
+{
+  public:
+   struct Entry {
+      PID pid;
+      BufferFrame* bf;
+   };
+   static constexpr u64 RINGS = 128;
+   static constexpr u64 RING_SIZE = 1024;  // power of 2
+   // -------------------------------------------------------------------------------------
+   LeafTrainQueue() : rings(new Ring[RINGS]) {}
+   // -------------------------------------------------------------------------------------
+   bool push(const PID pid, BufferFrame* bf)
+   {
+      Ring& ring = rings[myRing() % RINGS];
+      u64 pos = ring.tail.load(std::memory_order_relaxed);
+      while (true) {
+         Cell& cell = ring.cells[pos & (RING_SIZE - 1)];
+         const s64 diff = static_cast<s64>(cell.seq.load(std::memory_order_acquire)) - static_cast<s64>(pos);
+         if (diff == 0) {
+            if (ring.tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+               cell.entry = {pid, bf};
+               cell.seq.store(pos + 1, std::memory_order_release);
+               return true;
+            }
+         } else if (diff < 0) {
+            return false;  // full
+         } else {
+            pos = ring.tail.load(std::memory_order_relaxed);
+         }
+      }
+   }
+   // Hands at most limit entries of the trainer's rings to fn, returns how many
+   template <typename Fn>
+   u64 drain(const u64 trainer, const u64 trainers, const u64 limit, Fn fn)
+   {
+      u64 drained = 0;
+      for (u64 r_i = trainer; r_i < RINGS && drained < limit; r_i += trainers) {
+         Entry entry;
+         while (drained < limit && pop(rings[r_i], entry)) {
+            fn(entry);
+            drained++;
+         }
+      }
+      return drained;
+   }
+   // Racy, for the counters only
+   u64 size() const
+   {
+      u64 size = 0;
+      for (u64 r_i = 0; r_i < RINGS; r_i++) {
+         size += rings[r_i].tail.load(std::memory_order_relaxed) - rings[r_i].head.load(std::memory_order_relaxed);
+      }
+      return size;
+   }
+
+  private:
+   struct Cell {
+      std::atomic<u64> seq;
+      Entry entry;
+   };
+   struct Ring {
+      alignas(64) std::atomic<u64> head = 0;
+      alignas(64) std::atomic<u64> tail = 0;
+      alignas(64) Cell cells[RING_SIZE];
+      Ring()
+      {
+         for (u64 i = 0; i < RING_SIZE; i++) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+         }
+      }
+   };
+   std::unique_ptr<Ring[]> rings;
+   // -------------------------------------------------------------------------------------
+   static u64 myRing()
+   {
+      static std::atomic<u64> next_ring = 0;
+      static thread_local const u64 ring = next_ring++;
+      return ring;
+   }
+   bool pop(Ring& ring, Entry& entry)
+   {
+      u64 pos = ring.head.load(std::memory_order_relaxed);
+      while (true) {
+         Cell& cell = ring.cells[pos & (RING_SIZE - 1)];
+         const s64 diff = static_cast<s64>(cell.seq.load(std::memory_order_acquire)) - static_cast<s64>(pos + 1);
+         if (diff == 0) {
+            if (ring.head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+               entry = cell.entry;
+               cell.seq.store(pos + RING_SIZE, std::memory_order_release);
+               return true;
+            }
+         } else if (diff < 0) {
+            return false;  // empty
+         } else {
+            pos = ring.head.load(std::memory_order_relaxed);
+         }
+      }
+   }
+};
+// -------------------------------------------------------------------------------------
+}  // namespace btree
+}  // namespace storage
+}  // namespace leanstore
@@ -0,0 +1,243 @@
+#include "LearnedIndexImage.hpp"
+
+#include "Exceptions.hpp"
+#include "leanstore/utils/Misc.hpp"
+// -------------------------------------------------------------------------------------
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+namespace btree
+{
+// -------------------------------------------------------------------------------------
+namespace
+{
+inline u64 alignSection(const u64 offset)
+{
+   return (offset + 63) & ~63ull;
+}
+u32 headerCRC(LearnedIndexImage::Header header)
+{
+   header.header_crc = 0;
+   return utils::CRC(reinterpret_cast<const u8*>(&header), sizeof(header));
+}
+void writeFully(const int fd, const void* src, u64 length, u64 offset)
+{
+   auto ptr = reinterpret_cast<const u8*>(src);
+   while (length > 0) {
+      const ssize_t written = pwrite(fd, ptr, length, offset);
+      posix_check(written > 0);
+      ptr += written;
+      offset += written;
+      length -= written;
+   }
+}
+}  // namespace
+// -------------------------------------------------------------------------------------
+LearnedIndexImage::LearnedIndexImage(const std::string& path, const bool verify_sections)
+{
+   fd = open(path.c_str(), O_RDONLY);
+   if (fd == -1) {
+      throw ex::GenericException("learned index image " + path + " can not be opened");
+   }
+   struct stat sb;
+   posix_check(fstat(fd, &sb) != -1);
+   bytes = sb.st_size;
+   if (bytes < sizeof(Header)) {
+      release();
+      throw ex::GenericException("learned index image " + path + " is truncated");
+   }
+   base = reinterpret_cast<u8*>(mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0));
+   posix_check(base != MAP_FAILED);
+   // Lookups fault the keys in as they go, this only gets the readahead going
+   madvise(base, bytes, MADV_WILLNEED);
+   const char* error = validate(verify_sections);
+   if (error) {
+      release();
+      throw ex::GenericException("learned index image " + path + error);
+   }
+}
+// -------------------------------------------------------------------------------------
+LearnedIndexImage::~LearnedIndexImage()
+{
+   release();
+}
+// -------------------------------------------------------------------------------------
+void LearnedIndexImage::release()
+{
+   if (base) {
+      posix_check(munmap(base, bytes) == 0);
+      base = nullptr;
+   }
+   if (fd != -1) {
+      posix_check(close(fd) == 0);
+      fd = -1;
+   }
+}
+// -------------------------------------------------------------------------------------
+const char* LearnedIndexImage::validate(const bool verify_sections) const
+{
+   const Header& h = header();
+   if (h.magic != MAGIC || h.version != VERSION) {
+      return " has an unknown format";
+   }
+   if (h.header_crc != headerCRC(h)) {
+      return " has a corrupt header";
+   }
+   if (h.key_bytes != sizeof(MODEL_KEY) || h.pid_bytes != sizeof(PID) || h.file_bytes != bytes) {
+      return " does not match this build";
+   }
+   for (u32 s_i = 0; s_i < SECTIONS; s_i++) {
+      const Section& s = h.sections[s_i];
+      if (s.offset % 64 != 0 || s.offset < sizeof(Header) || s.offset > bytes || s.bytes > bytes - s.offset) {
+         return " has a section out of bounds";
+      }
+   }
+   const u64 key_count = h.sections[KEYS].bytes / sizeof(MODEL_KEY);
+   if (h.sections[KEYS].bytes % sizeof(MODEL_KEY) != 0 || (h.leaf_count != key_count && h.leaf_count != key_count + 1) ||
+       h.sections[PIDS].bytes != h.leaf_count * sizeof(PID) ||
+       h.sections[SPLINE_POINTS].bytes % sizeof(SplinePoint) != 0 || h.sections[LEAF_MODELS].bytes % sizeof(LeafModel) != 0 ||
+       h.sections[ATTACHED_SEGMENTS].bytes % sizeof(u64) != 0 || h.sections[ACCESS_SKETCH].bytes % sizeof(u32) != 0) {
+      return " has inconsistent section sizes";
+   }
+   if (verify_sections && !verify()) {
+      return " failed its checksum";
+   }
+   return nullptr;
+}
+// -------------------------------------------------------------------------------------
+bool LearnedIndexImage::verify() const
+{
+   for (u32 s_i = 0; s_i < SECTIONS; s_i++) {
+      const Section& s = header().sections[s_i];
+      if (utils::CRC(base + s.offset, s.bytes) != s.crc) {
+         return false;
+      }
+   }
+   return true;
+}
+// -------------------------------------------------------------------------------------
+std::vector<spline::Coord<MODEL_KEY>> LearnedIndexImage::splinePoints() const
+{
+   const auto points = section<SplinePoint>(SPLINE_POINTS);
+   std::vector<spline::Coord<MODEL_KEY>> result(header().sections[SPLINE_POINTS].bytes / sizeof(SplinePoint));
+   for (u64 p_i = 0; p_i < result.size(); p_i++) {
+      result[p_i].x = points[p_i].x;
+      result[p_i].y = points[p_i].y;
+   }
+   return result;
+}
+// -------------------------------------------------------------------------------------
+void LearnedIndexImage::loadLeafModels(ska::flat_hash_map<PID, learnedindex<KEY>>& models) const
+{
+   const auto records = section<LeafModel>(LEAF_MODELS);
+   const u64 count = header().sections[LEAF_MODELS].bytes / sizeof(LeafModel);
+   models.reserve(models.size() + count);
+   for (u64 m_i = 0; m_i < count; m_i++) {
+      auto& model = models[records[m_i].pid];
+      model.m = static_cast<long double>(records[m_i].m_hi) + records[m_i].m_lo;
+      model.c = static_cast<long double>(records[m_i].c_hi) + records[m_i].c_lo;
+      model.error = records[m_i].error;
+      model.version = records[m_i].version;
+   }
+}
+// -------------------------------------------------------------------------------------
+// pid, count, count segment ids, for every leaf with attached segments
+void LearnedIndexImage::loadAttachedSegments(ska::flat_hash_map<PID, std::vector<size_t>>& segments) const
+{
+   const u64* words = section<u64>(ATTACHED_SEGMENTS);
+   const u64 count = header().sections[ATTACHED_SEGMENTS].bytes / sizeof(u64);
+   for (u64 w_i = 0; w_i + 2 <= count;) {
+      const PID pid = words[w_i];
+      const u64 n = words[w_i + 1];
+      if (n > count - w_i - 2) {
+         throw ex::GenericException("learned index image has a truncated attached segment list");
+      }
+      segments[pid].assign(words + w_i + 2, words + w_i + 2 + n);
+      w_i += 2 + n;
+   }
+}
+// -------------------------------------------------------------------------------------
+void LearnedIndexImage::write(const std::string& path,
+                              utils::ArrayView<MODEL_KEY> keys,
+                              utils::ArrayView<PID> pids,
+                              const u64 max_error,
+                              const std::vector<spline::Coord<MODEL_KEY>>& spline_points,
+                              const ska::flat_hash_map<PID, learnedindex<KEY>>& leaf_models,
+                              const ska::flat_hash_map<PID, std::vector<size_t>>& attached_segments,
+                              utils::ArrayView<u32> access_sketch)
+{
+   ensure(pids.size() == keys.size() || pids.size() == keys.size() + 1);
+   std::vector<SplinePoint> points(spline_points.size());
+   for (u64 p_i = 0; p_i < points.size(); p_i++) {
+      points[p_i] = {static_cast<u64>(spline_points[p_i].x), spline_points[p_i].y};
+   }
+   std::vector<LeafModel> models;
+   models.reserve(leaf_models.size());
+   for (const auto& [pid, model] : leaf_models) {
+      const double m_hi = static_cast<double>(model.m);
+      const double c_hi = static_cast<double>(model.c);
+      models.push_back({pid, m_hi, static_cast<double>(model.m - m_hi), c_hi, static_cast<double>(model.c - c_hi), model.error, model.version});
+   }
+   std::vector<u64> segments;
+   for (const auto& [pid, ids] : attached_segments) {
+      segments.push_back(pid);
+      segments.push_back(ids.size());
+      segments.insert(segments.end(), ids.begin(), ids.end());
+   }
+   // -------------------------------------------------------------------------------------
+   const void* sources[SECTIONS] = {keys.data(), pids.data(), points.data(), models.data(), segments.data(), access_sketch.data()};
+   Header header;
+   memset(&header, 0, sizeof(header));
+   header.magic = MAGIC;
+   header.version = VERSION;
+   header.key_bytes = sizeof(MODEL_KEY);
+   header.pid_bytes = sizeof(PID);
+   header.max_error = max_error;
+   header.leaf_count = pids.size();
+   header.sections[KEYS].bytes = keys.size() * sizeof(MODEL_KEY);
+   header.sections[PIDS].bytes = pids.size() * sizeof(PID);
+   header.sections[SPLINE_POINTS].bytes = points.size() * sizeof(SplinePoint);
+   header.sections[LEAF_MODELS].bytes = models.size() * sizeof(LeafModel);
+   header.sections[ATTACHED_SEGMENTS].bytes = segments.size() * sizeof(u64);
+   header.sections[ACCESS_SKETCH].bytes = access_sketch.size() * sizeof(u32);
+   u64 offset = alignSection(sizeof(Header));
+   for (u32 s_i = 0; s_i < SECTIONS; s_i++) {
+      Section& s = header.sections[s_i];
+      s.offset = offset;
+      s.crc = utils::CRC(reinterpret_cast<const u8*>(sources[s_i]), s.bytes);
+      offset = alignSection(offset + s.bytes);
+   }
+   header.file_bytes = offset;
+   header.header_crc = headerCRC(header);
+   // -------------------------------------------------------------------------------------
+   const std::string tmp_path = path + ".tmp";
+   const int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+   posix_check(fd != -1);
+   posix_check(ftruncate(fd, header.file_bytes) == 0);
+   for (u32 s_i = 0; s_i < SECTIONS; s_i++) {
+      writeFully(fd, sources[s_i], header.sections[s_i].bytes, header.sections[s_i].offset);
+   }
+   // Header last, a crash before the rename leaves the previous image in place
+   writeFully(fd, &header, sizeof(header), 0);
+   posix_check(fsync(fd) == 0);
+   posix_check(close(fd) == 0);
+   posix_check(rename(tmp_path.c_str(), path.c_str()) == 0);
+   const std::string directory = std::filesystem::path(path).parent_path().string();
+   const int dir_fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+   posix_check(dir_fd != -1);
+   posix_check(fsync(dir_fd) == 0);
+   posix_check(close(dir_fd) == 0);
+}
+// -------------------------------------------------------------------------------------
+}  // namespace btree
+}  // namespace storage
+}  // namespace leanstore
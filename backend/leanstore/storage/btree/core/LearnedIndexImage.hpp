@@ -0,0 +1,110 @@
+#pragma once
+#include "Units.hpp"
+#include "flat_hash_map.hpp"
+#include "leanstore/compileConst.hpp"
+#include "leanstore/lr/learnedIndex.hpp"
+#include "leanstore/rs/builder.hpp"
+#include "leanstore/utils/ArrayView.hpp"
+// -------------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+namespace btree
+{
+// -------------------------------------------------------------------------------------
+// Everything learnedIndexStore persists, in one file that is mmaped on recovery. The mapping
+// keys and pids are used in place by the published ModelSnapshot and by the trainer until its
+// mapping changes, only the small sections (spline points, leaf models, attached segments,
+// access sketch) are copied into their in-memory structures.
+// Layout: Header, then every section at a 64 byte aligned offset, each with its own CRC32 and
+// the header covered by one, so a torn or foreign file is rejected instead of routing lookups.
+class LearnedIndexImage
+{
+  public:
+   static constexpr u64 MAGIC = 0x31474D49584E494Cull;  // "LINXIMG1"
+   static constexpr u32 VERSION = 3;
+   enum SECTION : u32 { KEYS = 0, PIDS = 1, SPLINE_POINTS = 2, LEAF_MODELS = 3, ATTACHED_SEGMENTS = 4, ACCESS_SKETCH = 5, SECTIONS = 6 };
+   struct Section {
+      u64 offset;
+      u64 bytes;
+      u32 crc;
+      u32 reserved;
+   };
+   struct Header {
+      u64 magic;
+      u32 version;
+      u32 header_crc;  // of the header with this field 0
+      u32 key_bytes;
+      u32 pid_bytes;
+      u64 max_error;
+      u64 leaf_count;  // pids, the keys are the separators and one less when the rightmost leaf has none
+      u64 file_bytes;
+      Section sections[SECTIONS];
+   };
+   // Fixed width records instead of the in-memory structs, which carry padding and long double
+   struct SplinePoint {
+      u64 x;
+      double y;
+   };
+   // m and c as the sum of two doubles, which holds the 64 bit mantissa of the long doubles exactly
+   struct LeafModel {
+      PID pid;
+      double m_hi;
+      double m_lo;
+      double c_hi;
+      double c_lo;
+      u64 error;
+      u64 version;
+   };
+   // -------------------------------------------------------------------------------------
+   // Maps path and checks the header, the section CRCs only with verify_sections.
+   // Throws ex::GenericException when the file is no intact image of this build.
+   LearnedIndexImage(const std::string& path, const bool verify_sections);
+   ~LearnedIndexImage();
+   LearnedIndexImage(const LearnedIndexImage&) = delete;
+   LearnedIndexImage& operator=(const LearnedIndexImage&) = delete;
+   // -------------------------------------------------------------------------------------
+   inline const Header& header() const { return *reinterpret_cast<const Header*>(base); }
+   inline utils::ArrayView<MODEL_KEY> keys() const { return {section<MODEL_KEY>(KEYS), header().sections[KEYS].bytes / sizeof(MODEL_KEY)}; }
+   inline utils::ArrayView<PID> pids() const { return {section<PID>(PIDS), header().leaf_count}; }
+   std::vector<spline::Coord<MODEL_KEY>> splinePoints() const;
+   void loadLeafModels(ska::flat_hash_map<PID, learnedindex<KEY>>& models) const;
+   void loadAttachedSegments(ska::flat_hash_map<PID, std::vector<size_t>>& segments) const;
+   // The LeafAccessSketch counters
+   inline utils::ArrayView<u32> accessSketch() const { return {section<u32>(ACCESS_SKETCH), header().sections[ACCESS_SKETCH].bytes / sizeof(u32)}; }
+   // Every section CRC matches
+   bool verify() const;
+   // -------------------------------------------------------------------------------------
+   // Writes a temporary file next to path and renames it over path once it is synced, then syncs the directory
+   // so that the rename survives a crash as well
+   static void write(const std::string& path,
+                     utils::ArrayView<MODEL_KEY> keys,
+                     utils::ArrayView<PID> pids,
+                     const u64 max_error,
+                     const std::vector<spline::Coord<MODEL_KEY>>& spline_points,
+                     const ska::flat_hash_map<PID, learnedindex<KEY>>& leaf_models,
+                     const ska::flat_hash_map<PID, std::vector<size_t>>& attached_segments,
+                     utils::ArrayView<u32> access_sketch);
+
+  private:
+   int fd = -1;
+   u8* base = nullptr;
+   u64 bytes = 0;
+   // -------------------------------------------------------------------------------------
+   void release();
+   // nullptr if the mapped file is an intact image, what is wrong otherwise
+   const char* validate(const bool verify_sections) const;
+   template <typename T>
+   inline const T* section(const SECTION s) const
+   {
+      return reinterpret_cast<const T*>(base + header().sections[s].offset);
+   }
+};
+// -------------------------------------------------------------------------------------
+}  // namespace btree
+}  // namespace storage
+}  // namespace leanstore
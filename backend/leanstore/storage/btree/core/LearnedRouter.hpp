@@ -0,0 +1,331 @@
+#pragma once
+#include "Exceptions.hpp"
+#include "Units.hpp"
+#include "leanstore/pla/pla.hpp"
+#include "leanstore/rmi/rmi.hpp"
+#include "leanstore/rs/radix_spline.h"
+#include "leanstore/utils/SIMDSearch.hpp"
+// -------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <variant>
+#include <vector>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+namespace btree
+{
+// -------------------------------------------------------------------------------------
+// Root models: estimate() the position of a key in the mapping, off by at most errorAt(key) <= maxError()
+// for the keys they were trained on
+template <typename Key>
+class RadixSplineModel
+{
+  public:
+   RadixSplineModel() = default;
+   explicit RadixSplineModel(const spline::RadixSpline<Key>& spline) : spline(spline) {}
+   // The first spline point is its own segment, keys at or outside the ends use the outermost segments
+   inline double estimate(const Key key) const
+   {
+      const size_t segment = std::clamp<size_t>(spline.GetSplineSegment(key), 1, spline.GetSize() - 1);
+      return spline.GetEstimatedPosition(key, segment);
+   }
+   inline size_t maxError() const { return spline.max_error_; }
+   inline size_t errorAt(const Key) const { return spline.max_error_; }
+
+  private:
+   spline::RadixSpline<Key> spline;
+};
+// -------------------------------------------------------------------------------------
+// One least squares line over the whole mapping, for key sets without much structure
+template <typename Key>
+class LinearModel
+{
+  public:
+   void train(const std::vector<Key>& keys)
+   {
+      const size_t n = keys.size();
+      base = (n > 0) ? keys.front() : 0;
+      slope = 0;
+      intercept = 0;
+      max_error = 0;
+      if (n < 2) {
+         return;
+      }
+      // Relative to the first key, so that 64 bit keys keep their precision
+      long double sum_x = 0, sum_y = 0, sum_xy = 0, sum_xx = 0;
+      for (size_t i = 0; i < n; i++) {
+         const long double x = keys[i] - base;
+         sum_x += x;
+         sum_y += i;
+         sum_xy += x * i;
+         sum_xx += x * x;
+      }
+      const long double delta = n * sum_xx - sum_x * sum_x;
+      if (delta != 0) {
+         slope = (n * sum_xy - sum_x * sum_y) / delta;
+      }
+      intercept = (sum_y - slope * sum_x) / n;
+      for (size_t i = 0; i < n; i++) {
+         const double error = std::abs(estimate(keys[i]) - static_cast<double>(i));
+         max_error = std::max<size_t>(max_error, std::ceil(error));
+      }
+   }
+   inline double estimate(const Key key) const { return (key < base) ? 0 : slope * static_cast<double>(key - base) + intercept; }
+   inline size_t maxError() const { return max_error; }
+   inline size_t errorAt(const Key) const { return max_error; }
+
+  private:
+   Key base = 0;
+   double slope = 0, intercept = 0;
+   size_t max_error = 0;
+};
+// -------------------------------------------------------------------------------------
+// Two stage RMI, cheaper to evaluate than the spline on smooth key sets. Every leaf model has its own
+// error bound, so the search window only grows where the keys are hard to fit.
+template <typename Key>
+class RMIModel
+{
+  public:
+   void train(const std::vector<Key>& keys, const size_t leaf_models) { rmi.train(keys, leaf_models); }
+   inline double estimate(const Key key) const { return rmi.GetEstimatedPosition(key); }
+   inline size_t maxError() const { return rmi.max_error(); }
+   inline size_t errorAt(const Key key) const { return rmi.GetError(key); }
+
+  private:
+   rmi::TwoStageRMI<Key> rmi;
+};
+// -------------------------------------------------------------------------------------
+// Optimal piecewise linear model with the error bound of the spline, usually with fewer segments
+template <typename Key>
+class PLAModel
+{
+  public:
+   void train(const std::vector<Key>& keys, const size_t max_error, const size_t recursive_error) { pla.Build(keys, max_error, recursive_error); }
+   inline double estimate(const Key key) const { return pla.GetEstimatedPosition(key); }
+   // +1 for the rounding of the double segments
+   inline size_t maxError() const { return pla.max_error_ + 1; }
+   inline size_t errorAt(const Key) const { return pla.max_error_ + 1; }
+
+  private:
+   pla::RecursivePLA<Key> pla;
+};
+// -------------------------------------------------------------------------------------
+// Last mile searches: first key >= key, exact for any estimate
+struct SimdSearch {
+   template <typename Keys, typename Key>
+   static inline size_t lowerBound(const Keys& keys, const double estimate, const size_t max_error, const Key key)
+   {
+      return utils::simd::searchAround(keys, estimate, max_error, key);
+   }
+};
+// Gallops away from the estimate, for models whose error bound is loose
+struct ExponentialSearch {
+   template <typename Keys, typename Key>
+   static inline size_t lowerBound(const Keys& keys, const double estimate, const size_t, const Key key)
+   {
+      const size_t size = keys.size();
+      if (size == 0) {
+         return 0;
+      }
+      size_t pos = (estimate <= 0) ? 0 : std::min<size_t>(estimate, size - 1);
+      size_t lower = pos, upper = pos, step = 1;
+      if (keys[pos] < key) {
+         // keys[lower] < key
+         upper = pos + 1;
+         while (upper < size && keys[upper] < key) {
+            lower = upper;
+            upper = lower + step;
+            step *= 2;
+         }
+         return std::lower_bound(keys.begin() + lower + 1, keys.begin() + std::min(upper, size), key) - keys.begin();
+      }
+      // keys[upper] >= key
+      while (lower > 0 && keys[lower - 1] >= key) {
+         upper = lower - 1;
+         lower = (upper > step) ? upper - step : 0;
+         step *= 2;
+      }
+      return std::lower_bound(keys.begin() + lower, keys.begin() + upper, key) - keys.begin();
+   }
+};
+// Binary search of the error window, the rest of the array only if the window misses
+struct BinarySearch {
+   template <typename Keys, typename Key>
+   static inline size_t lowerBound(const Keys& keys, const double estimate, const size_t max_error, const Key key)
+   {
+      const size_t size = keys.size();
+      const size_t pos = (estimate <= 0) ? 0 : std::min<size_t>(estimate, size);
+      size_t begin = (pos > max_error + 1) ? pos - max_error - 1 : 0;
+      size_t end = std::min<size_t>(size, pos + max_error + 2);
+      if (begin > 0 && keys[begin - 1] >= key) {
+         end = begin;
+         begin = 0;
+      } else if (end < size && keys[end - 1] < key) {
+         begin = end;
+         end = size;
+      }
+      return std::lower_bound(keys.begin() + begin, keys.begin() + end, key) - keys.begin();
+   }
+};
+// -------------------------------------------------------------------------------------
+template <typename Key, typename Model, typename Search>
+struct LearnedRouter {
+   Model model;
+   // -------------------------------------------------------------------------------------
+   inline double estimate(const Key key) const { return model.estimate(key); }
+   inline size_t maxError() const { return model.maxError(); }
+   inline size_t errorAt(const Key key) const { return model.errorAt(key); }
+   template <typename Keys>
+   inline size_t search(const Keys& keys, const Key key, const double estimate) const
+   {
+      return Search::lowerBound(keys, estimate, model.errorAt(key), key);
+   }
+   template <typename Keys>
+   inline size_t search(const Keys& keys, const Key key) const
+   {
+      return search(keys, key, estimate(key));
+   }
+};
+// -------------------------------------------------------------------------------------
+enum class ROUTER_MODEL : u8 { SPLINE = 0, LINEAR = 1, RMI = 2, PLA = 3 };
+enum class ROUTER_SEARCH : u8 { SIMD = 0, EXPONENTIAL = 1, BINARY = 2 };
+struct RouterConfig {
+   ROUTER_MODEL model = ROUTER_MODEL::SPLINE;
+   ROUTER_SEARCH search = ROUTER_SEARCH::SIMD;
+   u64 rmi_leaf_models = 0;  // 0: one per rmi::TwoStageRMI<>::AUTO_KEYS_PER_LEAF mapping keys
+   u64 pla_recursive_error = 4;  // 0: binary search of the segments
+   // -------------------------------------------------------------------------------------
+   // Whether a model trained with other is trained the same way, the search does not matter
+   inline bool sameModel(const RouterConfig& other) const
+   {
+      return model == other.model && rmi_leaf_models == other.rmi_leaf_models && pla_recursive_error == other.pla_recursive_error;
+   }
+   static RouterConfig parse(const std::string& model, const std::string& search)
+   {
+      RouterConfig config;
+      if (model == "spline") {
+         config.model = ROUTER_MODEL::SPLINE;
+      } else if (model == "linear") {
+         config.model = ROUTER_MODEL::LINEAR;
+      } else if (model == "rmi") {
+         config.model = ROUTER_MODEL::RMI;
+      } else if (model == "pla") {
+         config.model = ROUTER_MODEL::PLA;
+      } else {
+         throw ex::GenericException("unknown root model: " + model);
+      }
+      if (search == "simd") {
+         config.search = ROUTER_SEARCH::SIMD;
+      } else if (search == "exponential") {
+         config.search = ROUTER_SEARCH::EXPONENTIAL;
+      } else if (search == "binary") {
+         config.search = ROUTER_SEARCH::BINARY;
+      } else {
+         throw ex::GenericException("unknown mapping search: " + search);
+      }
+      return config;
+   }
+};
+// -------------------------------------------------------------------------------------
+// The router of one tree. Every model/search pair is its own instantiation, so choosing one per
+// tree at runtime costs one indexed jump per call, model and search still inline into it.
+template <typename Key>
+class RootRouter
+{
+   using Any = std::variant<LearnedRouter<Key, RadixSplineModel<Key>, SimdSearch>,
+                            LearnedRouter<Key, RadixSplineModel<Key>, ExponentialSearch>,
+                            LearnedRouter<Key, RadixSplineModel<Key>, BinarySearch>,
+                            LearnedRouter<Key, LinearModel<Key>, SimdSearch>,
+                            LearnedRouter<Key, LinearModel<Key>, ExponentialSearch>,
+                            LearnedRouter<Key, LinearModel<Key>, BinarySearch>,
+                            LearnedRouter<Key, RMIModel<Key>, SimdSearch>,
+                            LearnedRouter<Key, RMIModel<Key>, ExponentialSearch>,
+                            LearnedRouter<Key, RMIModel<Key>, BinarySearch>,
+                            LearnedRouter<Key, PLAModel<Key>, SimdSearch>,
+                            LearnedRouter<Key, PLAModel<Key>, ExponentialSearch>,
+                            LearnedRouter<Key, PLAModel<Key>, BinarySearch>>;
+   Any router;
+   RouterConfig built_with;
+   // -------------------------------------------------------------------------------------
+   template <typename Model>
+   void emplace(const ROUTER_SEARCH search, Model model)
+   {
+      switch (search) {
+         case ROUTER_SEARCH::SIMD:
+            router = LearnedRouter<Key, Model, SimdSearch>{std::move(model)};
+            break;
+         case ROUTER_SEARCH::EXPONENTIAL:
+            router = LearnedRouter<Key, Model, ExponentialSearch>{std::move(model)};
+            break;
+         case ROUTER_SEARCH::BINARY:
+            router = LearnedRouter<Key, Model, BinarySearch>{std::move(model)};
+            break;
+      }
+   }
+
+  public:
+   // The spline comes from the trainer, the other models are fitted to keys here (PLA with its max_error)
+   void build(const RouterConfig config, const std::vector<Key>& keys, const spline::RadixSpline<Key>& spline)
+   {
+      built_with = config;
+      switch (config.model) {
+         case ROUTER_MODEL::SPLINE:
+            emplace(config.search, RadixSplineModel<Key>(spline));
+            break;
+         case ROUTER_MODEL::LINEAR: {
+            LinearModel<Key> linear;
+            linear.train(keys);
+            emplace(config.search, std::move(linear));
+            break;
+         }
+         case ROUTER_MODEL::RMI: {
+            RMIModel<Key> rmi;
+            rmi.train(keys, config.rmi_leaf_models);
+            emplace(config.search, std::move(rmi));
+            break;
+         }
+         case ROUTER_MODEL::PLA: {
+            PLAModel<Key> pla;
+            pla.train(keys, spline.max_error_, config.pla_recursive_error);
+            emplace(config.search, std::move(pla));
+            break;
+         }
+      }
+   }
+   // The trained model of this router behind another search
+   RootRouter withSearch(const ROUTER_SEARCH search) const
+   {
+      RootRouter result;
+      result.built_with = built_with;
+      result.built_with.search = search;
+      std::visit([&](const auto& r) { result.emplace(search, r.model); }, router);
+      return result;
+   }
+   inline const RouterConfig& config() const { return built_with; }
+   inline double estimate(const Key key) const
+   {
+      return std::visit([&](const auto& r) { return r.estimate(key); }, router);
+   }
+   inline size_t maxError() const
+   {
+      return std::visit([&](const auto& r) { return r.maxError(); }, router);
+   }
+   inline size_t errorAt(const Key key) const
+   {
+      return std::visit([&](const auto& r) { return r.errorAt(key); }, router);
+   }
+   // keys is the mapping the router was built over, as a vector or a view of it
+   template <typename Keys>
+   inline size_t search(const Keys& keys, const Key key, const double estimate) const
+   {
+      return std::visit([&](const auto& r) { return r.search(keys, key, estimate); }, router);
+   }
+};
+// -------------------------------------------------------------------------------------
+}  // namespace btree
+}  // namespace storage
+}  // namespace leanstore
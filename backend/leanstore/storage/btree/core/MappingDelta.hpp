@@ -0,0 +1,182 @@
+#pragma once
+#include "Units.hpp"
+#include "leanstore/compileConst.hpp"
+#include "leanstore/sync-primitives/Epoch.hpp"
+#include "leanstore/utils/ArrayView.hpp"
+// -------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+struct BufferFrame;
+namespace btree
+{
+// -------------------------------------------------------------------------------------
+// Leaf level SMO that happened after the secondary mapping was built.
+// A split publishes the separator of the freshly created left node, a merge retracts the
+// separator of the node that went away. An entry overrides the mapping entry with the same key.
+struct MappingDelta {
+   MODEL_KEY key;
+   PID pid = 0;
+   BufferFrame* bf = nullptr;
+   bool removed = false;
+   u64 seq = 0;
+};
+// -------------------------------------------------------------------------------------
+// Writers copy the sorted entries, change the copy and swap it in, the old copy goes through the EpochManager.
+// Readers neither lock nor write.
+class MappingDeltaBuffer
+{
+  public:
+   MappingDeltaBuffer() : deltas(new Deltas()) {}
+   ~MappingDeltaBuffer() { delete deltas.load(); }
+   MappingDeltaBuffer(const MappingDeltaBuffer&) = delete;
+   MappingDeltaBuffer& operator=(const MappingDeltaBuffer&) = delete;
+   // -------------------------------------------------------------------------------------
+   void publish(const MODEL_KEY key, const PID pid, BufferFrame* bf) { put({key, pid, bf, false, 0}); }
+   void retract(const MODEL_KEY key) { put({key, 0, nullptr, true, 0}); }
+   // -------------------------------------------------------------------------------------
+   inline bool empty() const { return deltas.load(std::memory_order_acquire)->empty(); }
+   inline size_t size() const { return deltas.load(std::memory_order_acquire)->size(); }
+   // Sequence number the next entry gets, a model that folded everything below it passes it to resolve
+   u64 sequence() const
+   {
+      std::unique_lock<std::mutex> guard(writer_mutex);
+      return next_seq;
+   }
+   std::vector<MappingDelta> snapshot() const
+   {
+      std::unique_lock<std::mutex> guard(writer_mutex);
+      return *deltas.load(std::memory_order_relaxed);
+   }
+   // -------------------------------------------------------------------------------------
+   // Pre: caller holds an EpochGuard
+   // leaf_idx is the position of the first mapping key >= key.
+   // Returns true when the leaf is only known to the buffer; pid and bf are set in that case.
+   // Otherwise leaf_idx is moved past mapping entries whose separator was retracted.
+   // Entries below folded_seq are in the mapping already and are skipped.
+   // Keys is anything with size() and operator[] over the mapping separators.
+   template <typename Keys>
+   bool resolve(const MODEL_KEY key, const Keys& mapping_key, size_t& leaf_idx, PID& pid, BufferFrame*& bf, const u64 folded_seq = 0) const
+   {
+      const Deltas& current = *deltas.load(std::memory_order_acquire);
+      auto cmp = [](const MappingDelta& delta, const MODEL_KEY k) { return delta.key < k; };
+      auto published = std::lower_bound(current.begin(), current.end(), key, cmp);
+      auto retracted = published;
+      while (leaf_idx < mapping_key.size()) {
+         retracted = std::lower_bound(retracted, current.end(), mapping_key[leaf_idx], cmp);
+         if (retracted == current.end() || retracted->key != mapping_key[leaf_idx] || !retracted->removed || retracted->seq < folded_seq) {
+            break;
+         }
+         leaf_idx++;
+      }
+      while (published != current.end() && (published->removed || published->seq < folded_seq)) {
+         published++;
+      }
+      if (published != current.end() && (leaf_idx == mapping_key.size() || published->key <= mapping_key[leaf_idx])) {
+         pid = published->pid;
+         bf = published->bf;
+         return true;
+      }
+      return false;
+   }
+   // -------------------------------------------------------------------------------------
+   // Folds the given deltas into copies of the mapping arrays, which may be those of a mapped image.
+   // pids/bfs carry the extra entry of the rightmost leaf. dirty_keys gets every separator that was added or dropped.
+   static void apply(const std::vector<MappingDelta>& applied,
+                     const utils::ArrayView<MODEL_KEY> keys,
+                     const utils::ArrayView<PID> pids,
+                     const std::vector<BufferFrame*>& bfs,
+                     std::vector<MODEL_KEY>& new_keys,
+                     std::vector<PID>& new_pids,
+                     std::vector<BufferFrame*>& new_bfs,
+                     std::vector<MODEL_KEY>& dirty_keys)
+   {
+      new_keys.clear();
+      new_pids.clear();
+      new_bfs.clear();
+      dirty_keys.clear();
+      new_keys.reserve(keys.size() + applied.size());
+      new_pids.reserve(pids.size() + applied.size());
+      new_bfs.reserve(bfs.size() + applied.size());
+      size_t i = 0, j = 0;
+      while (i < keys.size() || j < applied.size()) {
+         if (j == applied.size() || (i < keys.size() && keys[i] < applied[j].key)) {
+            new_keys.push_back(keys[i]);
+            new_pids.push_back(pids[i]);
+            new_bfs.push_back(bfs[i]);
+            i++;
+            continue;
+         }
+         auto& delta = applied[j];
+         const bool existing = (i < keys.size() && keys[i] == delta.key);
+         if (!delta.removed) {
+            new_keys.push_back(delta.key);
+            new_pids.push_back(delta.pid);
+            new_bfs.push_back(delta.bf);
+         }
+         if (existing == delta.removed) {
+            dirty_keys.push_back(delta.key);
+         }
+         i += existing;
+         j++;
+      }
+      new_pids.push_back(pids.back());
+      new_bfs.push_back(bfs.back());
+   }
+   // -------------------------------------------------------------------------------------
+   // Drops the entries that made it into the mapping. Entries that were overwritten in the
+   // meantime (newer seq) stay.
+   void erase(const std::vector<MappingDelta>& applied)
+   {
+      std::unique_lock<std::mutex> guard(writer_mutex);
+      auto next = new Deltas(*deltas.load(std::memory_order_relaxed));
+      auto cmp = [](const MappingDelta& delta, const MODEL_KEY k) { return delta.key < k; };
+      for (auto& delta : applied) {
+         auto itr = std::lower_bound(next->begin(), next->end(), delta.key, cmp);
+         if (itr != next->end() && itr->key == delta.key && itr->seq == delta.seq) {
+            next->erase(itr);
+         }
+      }
+      swap(next);
+   }
+   // A full retrain already reflects everything that happened before it started harvesting
+   void eraseBefore(const u64 seq)
+   {
+      std::unique_lock<std::mutex> guard(writer_mutex);
+      auto next = new Deltas(*deltas.load(std::memory_order_relaxed));
+      next->erase(std::remove_if(next->begin(), next->end(), [&](const MappingDelta& delta) { return delta.seq < seq; }), next->end());
+      swap(next);
+   }
+
+  private:
+   using Deltas = std::vector<MappingDelta>;  // sorted by key, one entry per key
+   void put(MappingDelta delta)
+   {
+      std::unique_lock<std::mutex> guard(writer_mutex);
+      auto next = new Deltas(*deltas.load(std::memory_order_relaxed));
+      delta.seq = next_seq++;
+      auto itr = std::lower_bound(next->begin(), next->end(), delta.key, [](const MappingDelta& d, const MODEL_KEY k) { return d.key < k; });
+      if (itr != next->end() && itr->key == delta.key) {
+         *itr = delta;
+      } else {
+         next->insert(itr, delta);
+      }
+      swap(next);
+   }
+   // Pre: writer_mutex is held
+   void swap(Deltas* next) { EpochManager::global().retire(deltas.exchange(next, std::memory_order_acq_rel)); }
+   // -------------------------------------------------------------------------------------
+   mutable std::mutex writer_mutex;
+   std::atomic<Deltas*> deltas;
+   u64 next_seq = 0;
+};
+// -------------------------------------------------------------------------------------
+}  // namespace btree
+}  // namespace storage
+}  // namespace leanstore
@@ -0,0 +1,72 @@
+#include "AsyncReadBuffer.hpp"
+
+#include "Exceptions.hpp"
+// -------------------------------------------------------------------------------------
+// -------------------------------------------------------------------------------------
+#include <cstring>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+// -------------------------------------------------------------------------------------
+AsyncReadBuffer::AsyncReadBuffer(int fd, u64 page_size, u64 batch_max_size, u8* fixed_region, u64 fixed_bytes)
+    : fd(fd), page_size(page_size), batch_max_size(batch_max_size), free_slots_count(batch_max_size)
+{
+   read_commands = make_unique<ReadCommand[]>(batch_max_size);
+   free_slots = make_unique<u64[]>(batch_max_size);
+   completions = make_unique<io::IOEngine::Completion[]>(batch_max_size);
+   for (u64 slot = 0; slot < batch_max_size; slot++) {
+      free_slots[slot] = slot;
+   }
+   // -------------------------------------------------------------------------------------
+   engine = io::IOEngine::create(fd, batch_max_size, fixed_region, fixed_bytes);
+}
+// -------------------------------------------------------------------------------------
+void AsyncReadBuffer::add(BufferFrame& bf, PID pid)
+{
+   assert(!full());
+   assert(u64(&bf.page) % 512 == 0);
+   // -------------------------------------------------------------------------------------
+   const u64 slot = free_slots[--free_slots_count];
+   read_commands[slot].bf = &bf;
+   read_commands[slot].pid = pid;
+   engine->prepRead(bf.page, page_size, page_size * pid, &read_commands[slot]);
+   queued_requests++;
+}
+// -------------------------------------------------------------------------------------
+u64 AsyncReadBuffer::submit()
+{
+   if (queued_requests > 0) {
+      const u64 submitted = engine->submit();
+      ensure(submitted == queued_requests);
+      in_flight_requests += submitted;
+      queued_requests = 0;
+      return submitted;
+   }
+   return 0;
+}
+// -------------------------------------------------------------------------------------
+u64 AsyncReadBuffer::pollEvents(bool wait)
+{
+   if (in_flight_requests == 0) {
+      return 0;
+   }
+   return engine->reap(completions.get(), wait ? 1 : 0, in_flight_requests);
+}
+// -------------------------------------------------------------------------------------
+void AsyncReadBuffer::getReadBfs(std::function<void(BufferFrame&, PID)> callback, u64 n_events)
+{
+   for (u64 i = 0; i < n_events; i++) {
+      auto& command = *reinterpret_cast<ReadCommand*>(completions[i].user_data);
+      const u64 slot = &command - read_commands.get();
+      // -------------------------------------------------------------------------------------
+      ensure(completions[i].result == s64(page_size));
+      in_flight_requests--;
+      free_slots[free_slots_count++] = slot;
+      callback(*command.bf, command.pid);
+   }
+}
+// -------------------------------------------------------------------------------------
+}  // namespace storage
+}  // namespace leanstore
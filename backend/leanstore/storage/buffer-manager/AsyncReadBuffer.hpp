@@ -0,0 +1,49 @@
+#pragma once
+#include "BufferFrame.hpp"
+#include "Units.hpp"
+#include "leanstore/io/IOEngine.hpp"
+// -------------------------------------------------------------------------------------
+// -------------------------------------------------------------------------------------
+#include <functional>
+#include <memory>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+// -------------------------------------------------------------------------------------
+// Counterpart of AsyncWriteBuffer for read-ahead. The pages are read straight into their
+// frames, reads complete in any order so every read keeps its slot until it is reaped.
+class AsyncReadBuffer
+{
+  private:
+   struct ReadCommand {
+      BufferFrame* bf;
+      PID pid;
+   };
+   std::unique_ptr<io::IOEngine> engine;
+   int fd;
+   u64 page_size, batch_max_size;
+   u64 queued_requests = 0;     // added, not submitted yet
+   u64 in_flight_requests = 0;  // submitted, not reaped yet
+   u64 free_slots_count;
+
+  public:
+   std::unique_ptr<ReadCommand[]> read_commands;
+   std::unique_ptr<u64[]> free_slots;
+   std::unique_ptr<io::IOEngine::Completion[]> completions;
+   // -------------------------------------------------------------------------------------
+   // The frames read into may lie in [fixed_region, fixed_region + fixed_bytes), see IOEngine::create
+   AsyncReadBuffer(int fd, u64 page_size, u64 batch_max_size, u8* fixed_region = nullptr, u64 fixed_bytes = 0);
+   // Caller takes care of sync
+   bool full() { return free_slots_count == 0; }
+   bool empty() { return queued_requests + in_flight_requests == 0; }
+   void add(BufferFrame& bf, PID pid);
+   u64 submit();
+   // Reaps the completed reads, with wait at least one
+   u64 pollEvents(bool wait);
+   void getReadBfs(std::function<void(BufferFrame&, PID)> callback, u64 n_events);
+};
+// -------------------------------------------------------------------------------------
+}  // namespace storage
+}  // namespace leanstore
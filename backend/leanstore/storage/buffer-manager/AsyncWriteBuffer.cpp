@@ -19,15 +19,10 @@ AsyncWriteBuffer::AsyncWriteBuffer(int fd, u64 page_size, u64 batch_max_size) :
 {
    write_buffer = make_unique<BufferFrame::Page[]>(batch_max_size);
    write_buffer_commands = make_unique<WriteCommand[]>(batch_max_size);
-   iocbs = make_unique<struct iocb[]>(batch_max_size);
-   iocbs_ptr = make_unique<struct iocb*[]>(batch_max_size);
-   events = make_unique<struct io_event[]>(batch_max_size);
+   completions = make_unique<io::IOEngine::Completion[]>(batch_max_size);
    // -------------------------------------------------------------------------------------
-   memset(&aio_context, 0, sizeof(aio_context));
-   const int ret = io_setup(batch_max_size, &aio_context);
-   if (ret != 0) {
-      throw ex::GenericException("io_setup failed, ret code = " + std::to_string(ret));
-   }
+   // Pages are written from the copies in write_buffer, which io_uring keeps registered
+   engine = io::IOEngine::create(fd, batch_max_size, reinterpret_cast<u8*>(write_buffer.get()), batch_max_size * sizeof(BufferFrame::Page));
 }
 // -------------------------------------------------------------------------------------
 bool AsyncWriteBuffer::full()
@@ -50,17 +45,15 @@ void AsyncWriteBuffer::add(BufferFrame& bf, PID pid)
    write_buffer_commands[slot].pid = pid;
    bf.page.magic_debugging_number = pid;
    std::memcpy(&write_buffer[slot], bf.page, page_size);
-   void* write_buffer_slot_ptr = &write_buffer[slot];
-   io_prep_pwrite(&iocbs[slot], fd, write_buffer_slot_ptr, page_size, page_size * pid);
-   iocbs[slot].data = write_buffer_slot_ptr;
-   iocbs_ptr[slot] = &iocbs[slot];
+   u8* write_buffer_slot_ptr = write_buffer[slot];
+   engine->prepWrite(write_buffer_slot_ptr, page_size, page_size * pid, write_buffer_slot_ptr);
 }
 // -------------------------------------------------------------------------------------
 u64 AsyncWriteBuffer::submit()
 {
    if (pending_requests > 0) {
-      int ret_code = io_submit(aio_context, pending_requests, iocbs_ptr.get());
-      ensure(ret_code == s32(pending_requests));
+      const u64 submitted = engine->submit();
+      ensure(submitted == pending_requests);
       return pending_requests;
    }
    return 0;
@@ -69,8 +62,8 @@ u64 AsyncWriteBuffer::submit()
 u64 AsyncWriteBuffer::pollEventsSync()
 {
    if (pending_requests > 0) {
-      const int done_requests = io_getevents(aio_context, pending_requests, pending_requests, events.get(), NULL);
-      if (u32(done_requests) != pending_requests) {
+      const u64 done_requests = engine->reap(completions.get(), pending_requests, pending_requests);
+      if (done_requests != pending_requests) {
          cerr << done_requests << endl;
          raise(SIGTRAP);
          ensure(false);
@@ -84,10 +77,9 @@ u64 AsyncWriteBuffer::pollEventsSync()
 void AsyncWriteBuffer::getWrittenBfs(std::function<void(BufferFrame&, u64, PID)> callback, u64 n_events)
 {
    for (u64 i = 0; i < n_events; i++) {
-      const auto slot = (u64(events[i].data) - u64(write_buffer.get())) / page_size;
+      const auto slot = (u64(completions[i].user_data) - u64(write_buffer.get())) / page_size;
       // -------------------------------------------------------------------------------------
-      ensure(events[i].res == page_size);
-      explain(events[i].res2 == 0);
+      ensure(completions[i].result == s64(page_size));
       auto written_lsn = write_buffer[slot].GSN;
       callback(*write_buffer_commands[slot].bf, written_lsn, write_buffer_commands[slot].pid);
    }
@@ -1,10 +1,9 @@
 #pragma once
 #include "BufferFrame.hpp"
 #include "Units.hpp"
+#include "leanstore/io/IOEngine.hpp"
 // -------------------------------------------------------------------------------------
 // -------------------------------------------------------------------------------------
-#include <libaio.h>
-
 #include <functional>
 #include <list>
 #include <unordered_map>
@@ -21,8 +20,7 @@ class AsyncWriteBuffer
       BufferFrame* bf;
       PID pid;
    };
-   // MyNote:: What is aio_context?
-   io_context_t aio_context;
+   std::unique_ptr<io::IOEngine> engine;
    int fd;
    u64 page_size, batch_max_size;
    // MyNote:: what is pending requests??
@@ -32,9 +30,7 @@ class AsyncWriteBuffer
    // MyNote:: write_buffer
    std::unique_ptr<BufferFrame::Page[]> write_buffer;
    std::unique_ptr<WriteCommand[]> write_buffer_commands;
-   std::unique_ptr<struct iocb[]> iocbs;
-   std::unique_ptr<struct iocb*[]> iocbs_ptr;
-   std::unique_ptr<struct io_event[]> events;
+   std::unique_ptr<io::IOEngine::Completion[]> completions;
    // -------------------------------------------------------------------------------------
    // Debug
    // -------------------------------------------------------------------------------------
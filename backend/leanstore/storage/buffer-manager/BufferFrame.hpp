@@ -44,6 +44,7 @@ struct BufferFrame {
       };
       // TODO: for logging
       u64 lastWrittenGSN = 0;
+      u16 last_writer_worker = 0;  // logged page.GSN, the page is written back once its WAL is durable
       STATE state = STATE::FREE;  // INIT:
       bool isWB = false;
       bool keep_in_memory = false;
@@ -59,6 +60,9 @@ struct BufferFrame {
       std::vector<size_t>* attached_segments = nullptr;
       spline::RadixSpline<KEY> splines;
       learnedindex<KEY> model;
+      std::atomic<bool> model_queued = false;  // in the leaf train queue
+      // CLOCK reference bit and sampled access count of the ReplacementPolicy
+      std::atomic<u8> access = 0;
    };
    struct alignas(512) Page {
       u64 GSN = 0;
@@ -78,6 +82,17 @@ struct BufferFrame {
    // -------------------------------------------------------------------------------------
    inline bool isDirty() const { return header.lastWrittenGSN != page.GSN; }
    inline bool isFree() const { return header.state == STATE::FREE; }
+   // The first access after the replacement policy cleared the frame sets it referenced, every
+   // ACCESS_SAMPLE-th access of a thread counts. Hot frames are only read, their line stays shared.
+   static constexpr u8 ACCESS_SAMPLE = 16;
+   inline void touch()
+   {
+      static thread_local u8 accesses = 0;
+      const u8 access = header.access.load(std::memory_order_relaxed);
+      if (access == 0 || (++accesses % ACCESS_SAMPLE == 0 && access != 255)) {
+         header.access.store(access + 1, std::memory_order_relaxed);
+      }
+   }
    // -------------------------------------------------------------------------------------
    // Pre: bf is exclusively locked
    void reset()
@@ -87,11 +102,14 @@ struct BufferFrame {
       assert(!header.isWB);
       header.latch.assertExclusivelyLatched();
       header.lastWrittenGSN = 0;
+      header.last_writer_worker = 0;
       header.state = STATE::FREE;  // INIT:
       header.isWB = false;
       header.pid = 9999;
       header.next_free_bf = nullptr;
       header.contention_tracker.reset();
+      header.model_queued = false;
+      header.access = 0;
       // std::memset(reinterpret_cast<u8*>(&page), 0, PAGE_SIZE);
    }
    // -------------------------------------------------------------------------------------
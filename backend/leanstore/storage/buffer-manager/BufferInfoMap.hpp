@@ -0,0 +1,114 @@
+#pragma once
+#include "Exceptions.hpp"
+#include "Units.hpp"
+#include "leanstore/compileConst.hpp"
+// -------------------------------------------------------------------------------------
+#include <sys/mman.h>
+
+#include <cstring>
+#include <string>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+struct BufferFrame;
+}
+}  // namespace leanstore
+// With 32 bit keys an entry is 16 bytes, read and written with one 128 bit access
+struct alignas(16) BufferInfo {
+   leanstore::storage::BufferFrame* bf;
+   KEY lower_fence, upper_fence;
+};
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+// -------------------------------------------------------------------------------------
+// PID -> BufferInfo for every page the SSD can hold, as one flat array. The range is only reserved,
+// pages are backed (by huge pages where possible) on first touch and read as zero, i.e. untracked.
+// Entries are loaded and stored whole, neither lookups nor tracking take a lock.
+class BufferInfoMap
+{
+#if defined(__x86_64__)
+   static constexpr bool NATIVE_128 = sizeof(BufferInfo) == 16;
+#else
+   static constexpr bool NATIVE_128 = false;
+#endif
+
+  public:
+   explicit BufferInfoMap(u64 capacity) : capacity(capacity)
+   {
+      const u64 bytes = capacity * sizeof(BufferInfo);
+      void* mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (mem == MAP_FAILED) {
+         throw ex::GenericException("mmap of the PID map failed, pages = " + std::to_string(capacity));
+      }
+      madvise(mem, bytes, MADV_HUGEPAGE);
+      madvise(mem, bytes, MADV_DONTFORK);
+      entries = reinterpret_cast<BufferInfo*>(mem);
+   }
+   ~BufferInfoMap() { munmap(entries, capacity * sizeof(BufferInfo)); }
+   BufferInfoMap(const BufferInfoMap&) = delete;
+   BufferInfoMap& operator=(const BufferInfoMap&) = delete;
+   // -------------------------------------------------------------------------------------
+   inline u64 size() const { return capacity; }
+   inline BufferInfo load(const PID pid) const
+   {
+      assert(pid < capacity);
+      BufferInfo info;
+      if constexpr (NATIVE_128) {
+#if defined(__x86_64__)
+         // Aligned 16 byte vector loads are atomic on the AVX capable CPUs we build for
+         _mm_store_si128(reinterpret_cast<__m128i*>(&info), _mm_load_si128(reinterpret_cast<const __m128i*>(entries + pid)));
+#endif
+      } else {
+         __atomic_load(entries + pid, &info, __ATOMIC_ACQUIRE);
+      }
+      return info;
+   }
+   inline void store(const PID pid, const BufferInfo info)
+   {
+      ensure(pid < capacity);
+      BufferInfo expected = {nullptr, 0, 0};
+      while (!compareExchange(pid, expected, info)) {
+      }
+   }
+   // Replaces the frame only, the fences of the entry stay as they are
+   inline void storeFrame(const PID pid, BufferFrame* bf)
+   {
+      ensure(pid < capacity);
+      BufferInfo expected = load(pid);
+      while (!compareExchange(pid, expected, {bf, expected.lower_fence, expected.upper_fence})) {
+      }
+   }
+
+  private:
+   BufferInfo* entries;
+   u64 capacity;
+   // On failure expected holds the current entry
+   inline bool compareExchange(const PID pid, BufferInfo& expected, BufferInfo desired)
+   {
+      if constexpr (NATIVE_128) {
+         // cmpxchg16b (-mcx16)
+         unsigned __int128 expected_raw, desired_raw;
+         std::memcpy(&expected_raw, &expected, sizeof(expected_raw));
+         std::memcpy(&desired_raw, &desired, sizeof(desired_raw));
+         const unsigned __int128 seen = __sync_val_compare_and_swap(reinterpret_cast<unsigned __int128*>(entries + pid), expected_raw, desired_raw);
+         if (seen == expected_raw) {
+            return true;
+         }
+         std::memcpy(&expected, &seen, sizeof(expected));
+         return false;
+      } else {
+         return __atomic_compare_exchange(entries + pid, &expected, &desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+      }
+   }
+};
+// -------------------------------------------------------------------------------------
+}  // namespace storage
+}  // namespace leanstore
@@ -1,4 +1,5 @@
 #include "BufferManager.hpp"
+#include "AsyncReadBuffer.hpp"
 #include "AsyncWriteBuffer.hpp"
 #include "BufferFrame.hpp"
 #include "Exceptions.hpp"
@@ -6,8 +7,10 @@
 #include "leanstore/profiling/counters/CPUCounters.hpp"
 #include "leanstore/profiling/counters/PPCounters.hpp"
 #include "leanstore/profiling/counters/WorkerCounters.hpp"
+#include "leanstore/threads/UT.hpp"
 #include "leanstore/utils/FVector.hpp"
 #include "leanstore/utils/Misc.hpp"
+#include "leanstore/utils/NUMA.hpp"
 #include "leanstore/utils/Parallelize.hpp"
 #include "leanstore/utils/RandomGenerator.hpp"
 #include "leanstore/utils/convert.hpp"
@@ -27,6 +30,7 @@
 #include <iomanip>
 #include <leanstore/storage/btree/core/BTreeNode.hpp>
 #include <set>
+#include <unordered_map>
 // -------------------------------------------------------------------------------------
 // Local GFlags
 // -------------------------------------------------------------------------------------
@@ -35,9 +39,57 @@ namespace leanstore
 {
 namespace storage
 {
+namespace
+{
+std::atomic<u64> instances_counter = 0;
+constexpr u64 MAX_MAGAZINE_SIZE = 64;
+// -------------------------------------------------------------------------------------
+// Live instances by id, a magazine only drains into an instance that still exists
+std::mutex instances_mutex;
+std::unordered_map<u64, BufferManager*> instances;
+// -------------------------------------------------------------------------------------
+struct AllocationMagazine {
+   u64 instance_id = 0;
+   BufferFrame* bfs_head = nullptr;  // chained through next_free_bf
+   u64 bfs_count = 0;
+   PID pids[MAX_MAGAZINE_SIZE];
+   u64 pids_count = 0;
+   // Hands the cached frames and PIDs back to the partitions of their instance
+   void drain()
+   {
+      std::unique_lock<std::mutex> guard(instances_mutex);
+      auto instance = instances.find(instance_id);
+      if (instance != instances.end()) {
+         instance->second->returnMagazine(bfs_head, pids, pids_count);
+      }
+      bfs_head = nullptr;
+      bfs_count = pids_count = 0;
+   }
+   ~AllocationMagazine() { drain(); }
+};
+thread_local AllocationMagazine magazine;
+// -------------------------------------------------------------------------------------
+// Waits until the reader of io_frame lets go. A user thread yields instead of blocking its worker,
+// the reader can be a user thread parked on the very same worker.
+void waitForReader(IOFrame& io_frame)
+{
+   if (threads::UTM::isUserThread()) {
+      while (!io_frame.mutex.try_lock()) {
+         threads::UTM::yield();
+      }
+   } else {
+      io_frame.mutex.lock();
+   }
+   io_frame.mutex.unlock();
+}
+}  // namespace
 // -------------------------------------------------------------------------------------
-BufferManager::BufferManager(s32 ssd_fd) : ssd_fd(ssd_fd)
+BufferManager::BufferManager(s32 ssd_fd) : ssd_fd(ssd_fd), instance_id(++instances_counter)
 {
+   {
+      std::unique_lock<std::mutex> guard(instances_mutex);
+      instances[instance_id] = this;
+   }
    // -------------------------------------------------------------------------------------
    // Init DRAM pool
    {
@@ -45,8 +97,8 @@ BufferManager::BufferManager(s32 ssd_fd) : ssd_fd(ssd_fd)
 #ifdef TRACK_WITH_HT
       bf_ht.rehash(dram_pool_size * 2);
 #else
-      bf_vt.resize(2, {nullptr, 0, 0});
       // bf_vt.resize(dram_pool_size, nullptr);
+      // bf_vt reserves an entry for every page of the SSD, nothing to size here
 #endif
       INFO("Total Number of Buffer Frames %lu\n", dram_pool_size);
       const u64 dram_total_size = sizeof(BufferFrame) * (dram_pool_size + safety_pages);
@@ -56,12 +108,40 @@ BufferManager::BufferManager(s32 ssd_fd) : ssd_fd(ssd_fd)
       madvise(bfs, dram_total_size, MADV_HUGEPAGE);
       madvise(bfs, dram_total_size,
               MADV_DONTFORK);  // O_DIRECT does not work with forking.
-      // // -------------------------------------------------------------------------------------
+      // -------------------------------------------------------------------------------------
+      // NUMA slices, bound before the memset below touches the pool
+      const u64 machine_nodes = utils::numa::machineNodes();
+      slices_count = FLAGS_numa_slices ? FLAGS_numa_slices : machine_nodes;
+      bfs_per_slice = dram_pool_size / slices_count;
+      ensure(bfs_per_slice > 0);
+      slices = std::make_unique<BufferPoolSlice[]>(slices_count);
+      for (u64 s_i = 0; s_i < slices_count; s_i++) {
+         BufferPoolSlice& slice = slices[s_i];
+         slice.node = s_i % machine_nodes;
+         slice.bf_begin = s_i * bfs_per_slice;
+         slice.bf_end = (s_i == slices_count - 1) ? dram_pool_size : slice.bf_begin + bfs_per_slice;
+         if (machine_nodes > 1 && !utils::numa::bindMemory(bfs + slice.bf_begin, (slice.bf_end - slice.bf_begin) * sizeof(BufferFrame), slice.node)) {
+            INFO("Could not bind slice %lu to NUMA node %lu\n", s_i, slice.node);
+         }
+      }
+      // More slices than nodes share the nodes, their threads are told apart by CPU
+      cpu_slice.resize(std::thread::hardware_concurrency());
+      for (u64 cpu = 0; cpu < cpu_slice.size(); cpu++) {
+         cpu_slice[cpu] = (slices_count > machine_nodes) ? cpu % slices_count : utils::numa::nodeOfCPU(cpu) % slices_count;
+      }
+      INFO("NUMA slices %lu over %lu nodes\n", slices_count, machine_nodes);
+      // -------------------------------------------------------------------------------------
       // MyNote:: Not sure the role of partition
       // Initialize partitions
       partitions_count = (1 << FLAGS_partition_bits);
       partitions_mask = partitions_count - 1;
       INFO("partition count: %llu", partitions_count);
+      ensure(partitions_count % slices_count == 0);
+      const u64 partitions_per_slice = partitions_count / slices_count;
+      for (u64 s_i = 0; s_i < slices_count; s_i++) {
+         slices[s_i].p_begin = s_i * partitions_per_slice;
+         slices[s_i].p_end = slices[s_i].p_begin + partitions_per_slice;
+      }
 
       const u64 free_bfs_limit = std::ceil((FLAGS_free_pct * 1.0 * dram_pool_size / 100.0) / static_cast<double>(partitions_count));
       INFO("Free Buffer Frames Limit %lu (Each partition)\n", free_bfs_limit);
@@ -74,43 +154,63 @@ BufferManager::BufferManager(s32 ssd_fd) : ssd_fd(ssd_fd)
       // -------------------------------------------------------------------------------------
       utils::Parallelize::parallelRange(dram_total_size, [&](u64 begin, u64 end) { memset(reinterpret_cast<u8*>(bfs) + begin, 0, end - begin); });
       utils::Parallelize::parallelRange(dram_pool_size, [&](u64 bf_b, u64 bf_e) {
-         u64 p_i = 0;
          for (u64 bf_i = bf_b; bf_i < bf_e; bf_i++) {
-            partitions[p_i].dram_free_list.push(*new (bfs + bf_i) BufferFrame());
-            p_i = (p_i + 1) % partitions_count;
+            BufferFrame& bf = *new (bfs + bf_i) BufferFrame();
+            homePartition(bf).dram_free_list.push(bf);
          }
       });
+      for (u64 s_i = 0; s_i < slices_count; s_i++) {
+         BufferPoolSlice& slice = slices[s_i];
+         slice.replacement_policy = ReplacementPolicy::create(FLAGS_replacement_policy, bfs + slice.bf_begin, slice.bf_end - slice.bf_begin);
+      }
+      // libaio has nothing over pread for a single read
+      sync_reads_through_engine = FLAGS_io_engine != "libaio";
       // -------------------------------------------------------------------------------------
    }
    // std::cout << "page_provider_thread: " << FLAGS_pp_threads << std::endl;
    // -------------------------------------------------------------------------------------
    // Page Provider threads
    if (FLAGS_pp_threads) {  // make it optional for pure in-memory experiments
+      // Thread t_i serves slice t_i % slices_count and runs on its node, the partitions of a slice are split among its threads
       std::vector<thread> pp_threads;
-      const u64 partitions_per_thread = partitions_count / FLAGS_pp_threads;
-      INFO("Partitions for each thread %lu\n", partitions_per_thread);
-      ensure(FLAGS_pp_threads <= partitions_count);
-      const u64 extra_partitions_for_last_thread = partitions_count % FLAGS_pp_threads;
+      ensure(FLAGS_pp_threads >= slices_count);
+      const u64 partitions_per_slice = partitions_count / slices_count;
+      std::vector<u64> slice_threads(slices_count, 0);
+      for (u64 t_i = 0; t_i < FLAGS_pp_threads; t_i++) {
+         slice_threads[t_i % slices_count]++;
+      }
+      ensure(slice_threads[0] <= partitions_per_slice);
       // -------------------------------------------------------------------------------------
       for (u64 t_i = 0; t_i < FLAGS_pp_threads; t_i++) {
+         const u64 s_i = t_i % slices_count, slice_t_i = t_i / slices_count;
+         const u64 partitions_per_thread = partitions_per_slice / slice_threads[s_i];
+         const u64 extra_partitions_for_last_thread = partitions_per_slice % slice_threads[s_i];
+         const u64 p_begin = slices[s_i].p_begin + slice_t_i * partitions_per_thread;
+         const u64 p_end = p_begin + partitions_per_thread + ((slice_t_i == slice_threads[s_i] - 1) ? extra_partitions_for_last_thread : 0);
          pp_threads.emplace_back(
-             [&](u64 t_i, u64 p_begin, u64 p_end) {
+             [&](u64 t_i, u64 s_i, u64 p_begin, u64 p_end) {
                 CPUCounters::registerThread("pp_" + std::to_string(t_i));
                 // https://linux.die.net/man/2/setpriority
                 if (FLAGS_root) {
                    posix_check(setpriority(PRIO_PROCESS, 0, -20) == 0);
                 }
-                pageProviderThread(p_begin, p_end);
+                pageProviderThread(s_i, p_begin, p_end);
              },
-             t_i, t_i * partitions_per_thread,
-             ((t_i + 1) * partitions_per_thread) + ((t_i == FLAGS_pp_threads - 1) ? extra_partitions_for_last_thread : 0));
+             t_i, s_i, p_begin, p_end);
          bg_threads_counter++;
       }
       for (u64 t_i = 0; t_i < FLAGS_pp_threads; t_i++) {
          thread& page_provider_thread = pp_threads[t_i];
          cpu_set_t cpuset;
          CPU_ZERO(&cpuset);
-         CPU_SET(t_i, &cpuset);
+         if (slices_count == 1) {
+            CPU_SET(t_i, &cpuset);
+         } else {
+            // Anywhere on the node of its slice
+            for (u64 cpu : utils::numa::cpusOfNode(slices[t_i % slices_count].node)) {
+               CPU_SET(cpu, &cpuset);
+            }
+         }
          posix_check(pthread_setaffinity_np(page_provider_thread.native_handle(), sizeof(cpu_set_t), &cpuset) == 0);
          page_provider_thread.detach();
       }
@@ -188,6 +288,69 @@ BufferFrame& BufferManager::randomBufferFrame()
    auto rand_buffer_i = utils::RandomGenerator::getRand<u64>(0, dram_pool_size);
    return bfs[rand_buffer_i];
 }
+// -------------------------------------------------------------------------------------
+Partition& BufferManager::randomPartition(const BufferPoolSlice& slice)
+{
+   return partitions[utils::RandomGenerator::getRand<u64>(slice.p_begin, slice.p_end)];
+}
+// -------------------------------------------------------------------------------------
+BufferPoolSlice& BufferManager::localSlice()
+{
+   if (slices_count == 1) {
+      return slices[0];
+   }
+   const int cpu = sched_getcpu();
+   return slices[(cpu >= 0 && u64(cpu) < cpu_slice.size()) ? cpu_slice[cpu] : 0];
+}
+// -------------------------------------------------------------------------------------
+BufferPoolSlice& BufferManager::sliceOf(const BufferFrame& bf)
+{
+   const u64 bf_i = &bf - bfs;
+   return slices[std::min<u64>(bf_i / bfs_per_slice, slices_count - 1)];
+}
+// -------------------------------------------------------------------------------------
+Partition& BufferManager::homePartition(const BufferFrame& bf)
+{
+   const BufferPoolSlice& slice = sliceOf(bf);
+   const u64 bf_i = &bf - bfs;
+   return partitions[slice.p_begin + (bf_i - slice.bf_begin) % (slice.p_end - slice.p_begin)];
+}
+// -------------------------------------------------------------------------------------
+BufferFrame* BufferManager::tryPopFreeFrame()
+{
+   BufferPoolSlice& local = localSlice();
+   if (BufferFrame* bf = randomPartition(local).dram_free_list.tryPop()) {
+      return bf;
+   }
+   const u64 local_i = &local - slices.get();
+   for (u64 s_i = 1; s_i < slices_count; s_i++) {
+      BufferPoolSlice& slice = slices[(local_i + s_i) % slices_count];
+      if (BufferFrame* bf = randomPartition(slice).dram_free_list.tryPop()) {
+         slice.remote_allocations++;
+         return bf;
+      }
+   }
+   return nullptr;
+}
+// -------------------------------------------------------------------------------------
+BufferFrame& BufferManager::popFreeFrame()
+{
+   BufferFrame* bf = tryPopFreeFrame();
+   if (bf == nullptr) {
+      jumpmu::jump();
+   }
+   return *bf;
+}
+// -------------------------------------------------------------------------------------
+BufferFrame& BufferManager::popFreeFrame(JMUW<std::unique_lock<std::mutex>>& lock)
+{
+   BufferFrame* bf = tryPopFreeFrame();
+   if (bf == nullptr) {
+      lock->unlock();
+      jumpmu::jump();
+   }
+   return *bf;
+}
 
 /*
 BufferFrame* BufferManager::getBufferFrame(PID pid)
@@ -215,10 +378,14 @@ BufferFrame* BufferManager::getBufferFrame(PID pid)
 // returns a *write locked* new buffer frame
 BufferFrame& BufferManager::allocatePage()
 {
-   // Pick a pratition randomly
-   Partition& partition = randomPartition();
-   BufferFrame& free_bf = partition.dram_free_list.pop();
-   PID free_pid = partition.nextPID();
+   [[maybe_unused]] std::chrono::high_resolution_clock::time_point allocate_begin;
+   COUNTERS_BLOCK()
+   {
+      allocate_begin = std::chrono::high_resolution_clock::now();
+   }
+   // The frame from the local slice, the PID from any partition
+   BufferFrame& free_bf = FLAGS_alloc_magazine_size ? magazineFrame() : popFreeFrame();
+   PID free_pid = FLAGS_alloc_magazine_size ? magazinePID() : randomPartition().nextPID();
    assert(free_bf.header.state == BufferFrame::STATE::FREE);
    // -------------------------------------------------------------------------------------
    // Initialize Buffer Frame
@@ -244,6 +411,9 @@ BufferFrame& BufferManager::allocatePage()
    COUNTERS_BLOCK()
    {
       WorkerCounters::myCounters().allocate_operations_counter++;
+      const u64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - allocate_begin).count();
+      const u64 bucket = std::min<u64>(ns ? 63 - __builtin_clzll(ns) : 0, WorkerCounters::allocate_latency_buckets - 1);
+      WorkerCounters::myCounters().allocate_latency_ns_log2[bucket]++;
    }
    // -------------------------------------------------------------------------------------
    // MyNote:: Allocated new page in buffer frame
@@ -252,6 +422,51 @@ BufferFrame& BufferManager::allocatePage()
    return free_bf;
 }
 // -------------------------------------------------------------------------------------
+BufferFrame& BufferManager::magazineFrame()
+{
+   if (magazine.instance_id != instance_id) {
+      magazine.drain();
+      magazine.instance_id = instance_id;
+   }
+   if (magazine.bfs_count == 0) {
+      const u64 batch = std::min<u64>(FLAGS_alloc_magazine_size, MAX_MAGAZINE_SIZE);
+      magazine.bfs_count = randomPartition(localSlice()).dram_free_list.tryPopBatch(magazine.bfs_head, batch);
+      if (magazine.bfs_count == 0) {
+         // Single frames from the other slices, the local one is empty
+         return popFreeFrame();
+      }
+   }
+   BufferFrame& bf = *magazine.bfs_head;
+   magazine.bfs_head = bf.header.next_free_bf;
+   magazine.bfs_count--;
+   bf.header.next_free_bf = nullptr;
+   return bf;
+}
+// -------------------------------------------------------------------------------------
+PID BufferManager::magazinePID()
+{
+   // magazineFrame ran before and dropped a stale magazine
+   assert(magazine.instance_id == instance_id);
+   if (magazine.pids_count == 0) {
+      magazine.pids_count = std::min<u64>(FLAGS_alloc_magazine_size, MAX_MAGAZINE_SIZE);
+      randomPartition().nextPIDs(magazine.pids, magazine.pids_count);
+      std::reverse(magazine.pids, magazine.pids + magazine.pids_count);
+   }
+   return magazine.pids[--magazine.pids_count];
+}
+// -------------------------------------------------------------------------------------
+void BufferManager::returnMagazine(BufferFrame* bfs_head, const PID* pids, u64 pids_count)
+{
+   while (bfs_head) {
+      BufferFrame& bf = *bfs_head;
+      bfs_head = bf.header.next_free_bf;
+      homePartition(bf).dram_free_list.push(bf);
+   }
+   for (u64 p_i = 0; p_i < pids_count; p_i++) {
+      getPartition(pids[p_i]).freePage(pids[p_i]);
+   }
+}
+// -------------------------------------------------------------------------------------
 // Pre: bf is exclusively locked
 // ATTENTION: this function unlocks it !!
 // -------------------------------------------------------------------------------------
@@ -259,7 +474,10 @@ void BufferManager::reclaimPage(BufferFrame& bf)
 {
    Partition& partition = getPartition(bf.header.pid);
    // MyNote:: free page refers to the pid which are not longer used i.e. not a valid page id anymore
-   partition.freePage(bf.header.pid);
+   // With the WAL a pid keeps one history, the redo orders the records of a page by GSN only
+   if (!FLAGS_wal) {
+      partition.freePage(bf.header.pid);
+   }
    // MyNote:: Check what free page does.
    untrackPID(bf.header.pid);
 
@@ -270,11 +488,10 @@ void BufferManager::reclaimPage(BufferFrame& bf)
       bf.header.latch.mutex.unlock();
       cout << "garbage collector, yeah" << endl;
    } else {
-      Partition& partition = getPartition(bf.header.pid);
       bf.reset();
       bf.header.latch->fetch_add(LATCH_EXCLUSIVE_BIT, std::memory_order_release);
       bf.header.latch.mutex.unlock();
-      partition.dram_free_list.push(bf);
+      homePartition(bf).dram_free_list.push(bf);
    }
 }
 // -------------------------------------------------------------------------------------
@@ -335,7 +552,7 @@ BufferFrame& BufferManager::resolveSwip(Guard& swip_guard, Swip<BufferFrame>& sw
       while (bfptr == nullptr) {
          jumpmuTry()
          {
-            bfptr = &(randomPartition().dram_free_list.tryPop(g_guard));  // EXP
+            bfptr = &popFreeFrame(g_guard);
             jumpmu_break;
          }
          jumpmuCatch()
@@ -437,8 +654,7 @@ BufferFrame& BufferManager::resolveSwip(Guard& swip_guard, Swip<BufferFrame>& sw
    if (io_frame.state == IOFrame::STATE::READING) {
       io_frame.readers_counter++;  // incremented while holding partition lock
       g_guard->unlock();
-      io_frame.mutex.lock();
-      io_frame.mutex.unlock();
+      waitForReader(io_frame);
       if (io_frame.readers_counter.fetch_add(-1) == 1) {
          g_guard->lock();
          if (io_frame.readers_counter == 0) {
@@ -508,7 +724,7 @@ bool BufferManager::isPageInBufferPool(PID pid)
    return false;
 #else
    if (bf_vt.size() > pid) {
-      return bf_vt[pid].bf != nullptr;
+      return bf_vt.load(pid).bf != nullptr;
    } else {
       return false;
    }
@@ -523,28 +739,12 @@ bool BufferManager::trackPID(PID pid, BufferFrame* bf, KEY lower_fence, KEY uppe
       bf_ht.insert(std::make_pair(pid, {bf, lower_fence, upper_fence}));
    }
 #else
-
-   auto size = bf_vt.size();
-   // we need to comment this out temporarily for static array to be used
-   while (size <= pid) {
-      // std::cout << "bf_vt_size: " << size << " pid: " << pid << " bf_vt needs doubling" << std::endl;
-      size = size * 2;
-   }
-   {
-      // JMUW<std::unique_lock<std::mutex>> g_guard(bf_mutex);
-      if (size > bf_vt.size()) {
-         bf_vt.resize(size);
-      }
-      ensure(pid < bf_vt.size());
-      ensure(bf_vt.size() >= size);
-      bf_vt[pid] = {bf, lower_fence, upper_fence};
-   }
+   bf_vt.store(pid, {bf, lower_fence, upper_fence});
    return false;
 #endif
 }
 bool BufferManager::trackPID(PID pid, BufferFrame* bf)
 {
-   auto info = pageInBufferFrame(pid);
 #ifdef TRACK_WITH_HT
    {
       // JMUW<std::unique_lock<std::mutex>> g_guard(bf_mutex);
@@ -552,22 +752,8 @@ bool BufferManager::trackPID(PID pid, BufferFrame* bf)
       bf_ht.insert(std::make_pair(pid, {bf, lower_fence, upper_fence}));
    }
 #else
-
-   auto size = bf_vt.size();
-   // we need to comment this out temporarily for static array to be used
-   while (size <= pid) {
-      // std::cout << "bf_vt_size: " << size << " pid: " << pid << " bf_vt needs doubling" << std::endl;
-      size = size * 2;
-   }
-   {
-      // JMUW<std::unique_lock<std::mutex>> g_guard(bf_mutex);
-      if (size > bf_vt.size()) {
-         bf_vt.resize(size);
-      }
-      ensure(pid < bf_vt.size());
-      ensure(bf_vt.size() >= size);
-      bf_vt[pid] = {bf, info.lower_fence, info.upper_fence};
-   }
+   // Keeps the fences the page had when it was untracked
+   bf_vt.storeFrame(pid, bf);
    return false;
 #endif
 }
@@ -588,12 +774,11 @@ bool BufferManager::untrackPID(PID pid)
    if (bf_vt.size() > pid) {
       // JMUW<std::unique_lock<std::mutex>> g_guard(bf_mutex);
       // std::unique_lock<std::mutex> bf_guard(bf_mutex);
-      auto info = bf_vt[pid];
+      auto info = bf_vt.load(pid);
       HybridPageGuard<leanstore::storage::btree::BTreeNode> guard(info.bf);
       auto lower_fence = utils::u8_to<KEY>(guard->getLowerFenceKey(), sizeof(KEY));
       auto upper_fence = utils::u8_to<KEY>(guard->getUpperFenceKey(), sizeof(KEY));
-      bf_vt[pid] = {nullptr, lower_fence, upper_fence};
-      ensure(bf_vt[pid].bf == nullptr);
+      bf_vt.store(pid, {nullptr, lower_fence, upper_fence});
       return true;
    } else {
       return false;
@@ -679,13 +864,28 @@ BufferInfo BufferManager::getPageinBufferPool(PID pid)
 
    Partition& partition = getPartition(pid);
    JMUW<std::unique_lock<std::mutex>> g_guard(partition.io_mutex);
+   if (auto frame_handler = partition.io_ht.lookup(pid); frame_handler && frame_handler.frame().state == IOFrame::STATE::READING) {
+      // Read by someone else (e.g. a scan read-ahead), wait for it, the reader tracks the page before it lets go
+      IOFrame& io_frame = frame_handler.frame();
+      io_frame.readers_counter++;
+      g_guard->unlock();
+      waitForReader(io_frame);
+      if (io_frame.readers_counter.fetch_add(-1) == 1) {
+         g_guard->lock();
+         if (io_frame.readers_counter == 0) {
+            partition.io_ht.remove(pid);
+         }
+         g_guard->unlock();
+      }
+      return getPageinBufferPool(pid);
+   }
    BufferFrame* bfptr = nullptr;
    u64 failcount = 0;
    volatile u32 mask = 1;
    while (bfptr == nullptr) {
       jumpmuTry()
       {
-         bfptr = &(randomPartition().dram_free_list.tryPop(g_guard));  // EXP
+         bfptr = &popFreeFrame(g_guard);
          jumpmu_break;
       }
       jumpmuCatch()
@@ -770,7 +970,101 @@ BufferInfo BufferManager::getPageinBufferPool(PID pid)
    }
 }
 
-// namespace storage
+// -------------------------------------------------------------------------------------
+// Scan read-ahead
+// -------------------------------------------------------------------------------------
+namespace
+{
+thread_local std::unique_ptr<AsyncReadBuffer> read_ahead_buffer;
+thread_local std::unique_ptr<io::IOEngine> sync_read_engine;
+}
+u64 BufferManager::readAhead(const PID* pids, u64 n)
+{
+   // The reads belong to the OS thread, a user thread can resume on another one
+   if (threads::UTM::isUserThread()) {
+      return 0;
+   }
+   if (!read_ahead_buffer) {
+      const u64 pool_bytes = FLAGS_io_uring_fixed_pool ? sizeof(BufferFrame) * (dram_pool_size + safety_pages) : 0;
+      read_ahead_buffer =
+          std::make_unique<AsyncReadBuffer>(ssd_fd, PAGE_SIZE, std::max<u64>(2 * FLAGS_scan_readahead_leaves, 2), reinterpret_cast<u8*>(bfs), pool_bytes);
+   }
+   auto& buffer = *read_ahead_buffer;
+   for (u64 i = 0; i < n && !buffer.full(); i++) {
+      const PID pid = pids[i];
+      if (isPageInBufferPool(pid)) {
+         continue;
+      }
+      Partition& partition = getPartition(pid);
+      JMUW<std::unique_lock<std::mutex>> g_guard(partition.io_mutex);
+      // Loaded or in flight meanwhile
+      if (isPageInBufferPool(pid) || partition.io_ht.lookup(pid)) {
+         continue;
+      }
+      BufferFrame* bf = tryPopFreeFrame();
+      if (bf == nullptr) {
+         // No free frame, the page provider catches up meanwhile
+         break;
+      }
+      IOFrame& io_frame = partition.io_ht.insert(pid);
+      assert(bf->header.state == BufferFrame::STATE::FREE);
+      bf->header.latch.assertNotExclusivelyLatched();
+      // -------------------------------------------------------------------------------------
+      io_frame.state = IOFrame::STATE::READING;
+      io_frame.readers_counter = 1;
+      io_frame.mutex.lock();
+      // -------------------------------------------------------------------------------------
+      g_guard->unlock();
+      buffer.add(*bf, pid);
+   }
+   return buffer.submit();
+}
+// -------------------------------------------------------------------------------------
+u64 BufferManager::pollReadAhead(bool wait)
+{
+   if (!readAheadPending()) {
+      return 0;
+   }
+   auto& buffer = *read_ahead_buffer;
+   const u64 done = buffer.pollEvents(wait);
+   buffer.getReadBfs(
+       [&](BufferFrame& bf, PID pid) {
+          COUNTERS_BLOCK()
+          {
+             WorkerCounters::myCounters().read_operations_counter++;
+          }
+          assert(bf.page.magic_debugging_number == pid);
+          // -------------------------------------------------------------------------------------
+          // ATTENTION: Fill the BF
+          bf.header.lastWrittenGSN = bf.page.GSN;
+          bf.header.pid = pid;
+          auto mitr = BMC::leaf_node_models.find(pid);
+          if (mitr != BMC::leaf_node_models.end()) {
+             bf.header.model = mitr->second;
+          }
+          {
+             OptimisticGuard bf_guard(bf.header.latch, true);
+             ExclusiveGuard bf_x_guard(bf_guard);
+             bf.header.state = BufferFrame::STATE::UNLINKED_HOT;
+          }
+          trackPID(pid, &bf);
+          // -------------------------------------------------------------------------------------
+          Partition& partition = getPartition(pid);
+          std::unique_lock<std::mutex> g_guard(partition.io_mutex);
+          IOFrame& io_frame = partition.io_ht.lookup(pid).frame();
+          io_frame.mutex.unlock();
+          if (io_frame.readers_counter.fetch_add(-1) == 1) {
+             partition.io_ht.remove(pid);
+          }
+       },
+       done);
+   return done;
+}
+// -------------------------------------------------------------------------------------
+bool BufferManager::readAheadPending()
+{
+   return read_ahead_buffer && !read_ahead_buffer->empty();
+}
 // -------------------------------------------------------------------------------------
 // SSD management
 // -------------------------------------------------------------------------------------
@@ -779,12 +1073,27 @@ void BufferManager::readPageSync(u64 pid, u8* destination)
    // MyNote:: Read detected
    // std::cout << "Reading page sync" << std::endl;
    assert(u64(destination) % 512 == 0);
-   s64 bytes_left = PAGE_SIZE;
-   do {
-      const int bytes_read = pread(ssd_fd, destination, bytes_left, pid * PAGE_SIZE + (PAGE_SIZE - bytes_left));
-      assert(bytes_left > 0);
-      bytes_left -= bytes_read;
-   } while (bytes_left > 0);
+   if (threads::UTM::isUserThread()) {
+      // Synchronous for the caller only, its worker runs other user threads meanwhile
+      threads::UTM::readAsync(ssd_fd, destination, PAGE_SIZE, pid * PAGE_SIZE);
+   } else if (sync_reads_through_engine) {
+      // One io_uring_enter per read, with the fixed file and, if registered, the fixed pool
+      if (!sync_read_engine) {
+         const u64 pool_bytes = FLAGS_io_uring_fixed_pool ? sizeof(BufferFrame) * (dram_pool_size + safety_pages) : 0;
+         sync_read_engine = io::IOEngine::create(ssd_fd, 1, reinterpret_cast<u8*>(bfs), pool_bytes);
+      }
+      io::IOEngine::Completion completion;
+      sync_read_engine->prepRead(destination, PAGE_SIZE, pid * PAGE_SIZE, nullptr);
+      sync_read_engine->submitAndWait(&completion, 1);
+      ensure(completion.result == s64(PAGE_SIZE));
+   } else {
+      s64 bytes_left = PAGE_SIZE;
+      do {
+         const int bytes_read = pread(ssd_fd, destination, bytes_left, pid * PAGE_SIZE + (PAGE_SIZE - bytes_left));
+         assert(bytes_left > 0);
+         bytes_left -= bytes_read;
+      } while (bytes_left > 0);
+   }
    // -------------------------------------------------------------------------------------
    COUNTERS_BLOCK()
    {
@@ -819,6 +1128,11 @@ void BufferManager::stopBackgroundThreads()
 // -------------------------------------------------------------------------------------
 BufferManager::~BufferManager()
 {
+   {
+      // Magazines of threads that exit from now on drop their content
+      std::unique_lock<std::mutex> guard(instances_mutex);
+      instances.erase(instance_id);
+   }
    stopBackgroundThreads();
    free(partitions);
    // -------------------------------------------------------------------------------------
@@ -848,6 +1162,14 @@ void BufferManager::deserialize(std::unordered_map<std::string, std::string> map
    }
 }
 // -------------------------------------------------------------------------------------
+void BufferManager::reservePIDsUpTo(PID max_pid)
+{
+   const PID next_pid = (max_pid + 1 + (partitions_count - 1)) & ~(partitions_count - 1);
+   for (u64 p_i = 0; p_i < partitions_count; p_i++) {
+      getPartition(p_i).next_pid = std::max<PID>(getPartition(p_i).next_pid, next_pid + p_i);
+   }
+}
+// -------------------------------------------------------------------------------------
 void BufferManager::BufferPoolUseInf()
 {
    int cool = 0;
@@ -1,8 +1,10 @@
 #pragma once
 #include "BufferFrame.hpp"
+#include "BufferInfoMap.hpp"
 #include "DTRegistry.hpp"
 #include "FreeList.hpp"
 #include "Partition.hpp"
+#include "ReplacementPolicy.hpp"
 #include "Swip.hpp"
 #include "Units.hpp"
 // -------------------------------------------------------------------------------------
@@ -17,6 +19,7 @@
 #include <queue>
 #include <thread>
 #include "flat_hash_map.hpp"
+#include "leanstore/Config.hpp"
 #include "leanstore/compileConst.hpp"
 
 #ifdef TRACK_WITH_HT
@@ -51,16 +54,10 @@ struct UIntHashCompare {
    bool operator()(const uint32_t& key1, const uint32_t& key2) const { return key1 == key2; }
 };
 #else
-#include <tbb/concurrent_vector.h>
 #include <vector>
 #include "leanstore/utils/array.hpp"
 #include "leanstore/utils/staticarray.hpp"
 #endif
-
-struct BufferInfo {
-   leanstore::storage::BufferFrame* bf;
-   KEY lower_fence, upper_fence;
-};
 // -------------------------------------------------------------------------------------
 namespace leanstore
 {
@@ -72,6 +69,18 @@ class BMTable;
 namespace storage
 {
 // -------------------------------------------------------------------------------------
+// A contiguous part of the pool bound to one NUMA node. Its frames are only ever in the free lists
+// and cooling queues of its own partitions, its page providers run on that node and only cool and
+// evict its frames. The partitions of a PID (I/O frames, PID allocation) are independent of it.
+struct BufferPoolSlice {
+   u64 node;                            // of the machine
+   u64 bf_begin, bf_end;                // [bf_begin, bf_end) of bfs
+   u64 p_begin, p_end;                  // its partitions
+   std::unique_ptr<ReplacementPolicy> replacement_policy;
+   atomic<u64> remote_allocations = 0;  // frames threads of other nodes took because theirs were empty
+   atomic<u64> evicted_pages = 0;
+};
+// -------------------------------------------------------------------------------------
 /*
  * Swizzle a page:
  * 1- bf_s_lock global bf_s_lock
@@ -102,6 +111,12 @@ class BufferManager
    u64 partitions_count;
    u64 partitions_mask;
    Partition* partitions;
+   // NUMA slices, partitions_count is a multiple of their count
+   u64 slices_count;
+   u64 bfs_per_slice;  // the last one takes the remainder
+   std::unique_ptr<BufferPoolSlice[]> slices;
+   std::vector<u64> cpu_slice;  // slice of the threads running on a CPU
+   bool sync_reads_through_engine = false;  // readPageSync outside of user threads
    // MyNote -------------------------------------------------------------------------------
    std::mutex bf_mutex;
 #ifdef TRACK_WITH_HT
@@ -116,18 +131,35 @@ class BufferManager
    // std::vector<BufferInfo> bf_vt;
    // DynamicArray<BufferInfo> bf_vt;
    // StaticArray<BufferInfo, 50000000> bf_vt;
-   tbb::concurrent_vector<BufferInfo> bf_vt;
+   // tbb::concurrent_vector<BufferInfo> bf_vt;
+   BufferInfoMap bf_vt{ssdPIDCapacity()};
 #endif
   private:
    // -------------------------------------------------------------------------------------
    // Threads managements
-   void pageProviderThread(u64 p_begin, u64 p_end);  // [p_begin, p_end)
+   void pageProviderThread(u64 s_i, u64 p_begin, u64 p_end);  // [p_begin, p_end) of slice s_i
    atomic<u64> bg_threads_counter = 0;
    atomic<bool> bg_threads_keep_running = true;
    // -------------------------------------------------------------------------------------
    // Misc
    Partition& randomPartition();
+   Partition& randomPartition(const BufferPoolSlice& slice);
    BufferFrame& randomBufferFrame();
+   // Slice of the CPU the caller runs on
+   BufferPoolSlice& localSlice();
+   BufferPoolSlice& sliceOf(const BufferFrame& bf);
+   // The partition whose free list and cooling queue bf goes to
+   Partition& homePartition(const BufferFrame& bf);
+   // A free frame of the local slice, of another one when the local free list is empty. nullptr when
+   // there is none, popFreeFrame jumps instead, after it released lock.
+   BufferFrame* tryPopFreeFrame();
+   BufferFrame& popFreeFrame();
+   BufferFrame& popFreeFrame(JMUW<std::unique_lock<std::mutex>>& lock);
+   // allocatePage takes frames and PIDs from a per-thread magazine refilled in batches, magazines
+   // of another instance are recognized by its id and drained into that one while it lives
+   const u64 instance_id;
+   BufferFrame& magazineFrame();
+   PID magazinePID();
    struct BufferInfo getBufferFrame(PID pid);
    Partition& getPartition(PID);
    u64 getPartitionID(PID);
@@ -136,6 +168,8 @@ class BufferManager
    // -------------------------------------------------------------------------------------
    BufferManager(s32 ssd_fd);
    ~BufferManager();
+   // Frames chained through next_free_bf go to their free lists, PIDs to their partitions
+   void returnMagazine(BufferFrame* bfs_head, const PID* pids, u64 pids_count);
    // -------------------------------------------------------------------------------------
    BufferFrame& allocatePage();
    inline BufferFrame& tryFastResolveSwip(Guard& swip_guard, Swip<BufferFrame>& swip_value)
@@ -171,7 +205,7 @@ class BufferManager
       // }
 #else
       BufferInfo nullinfo = {nullptr, 0, 0};
-      return (bf_vt.size() > pid) ? bf_vt[pid] : nullinfo;
+      return (bf_vt.size() > pid) ? bf_vt.load(pid) : nullinfo;
       // bf = bf_vt[pid];
       // if (bf == nullptr) {
       //    return nullptr;
@@ -183,6 +217,19 @@ class BufferManager
    bool untrackPID(PID pid);
    // -------------------------------------------------------------------------------------
    BufferInfo getPageinBufferPool(PID pid);
+   // -------------------------------------------------------------------------------------
+   /*
+    * Read-ahead for scans, per worker thread (libaio). The pages that are neither in the pool nor in io_ht
+    * are read into free frames with one io_submit, announced as READING IOFrames meanwhile. Completed
+    * reads are installed UNLINKED_HOT, as getPageinBufferPool does, so the learned lookups find them
+    * and resolveSwip swizzles them in. Free frames are never waited for, the rest is read on demand.
+    * The submitting thread holds the IOFrame mutexes: it has to poll with wait before it can block
+    * on one of its own pages (resolveSwip, getPageinBufferPool) and before it hands control to code
+    * that may (a scan callback).
+    */
+   u64 readAhead(const PID* pids, u64 n);
+   u64 pollReadAhead(bool wait);
+   bool readAheadPending();
 
    bool getPage(PID pid, BufferFrame* bf);
    void reclaimPage(BufferFrame& bf);
@@ -206,6 +253,8 @@ class BufferManager
    void writeAllBufferFrames();
    std::unordered_map<std::string, std::string> serialize();
    void deserialize(std::unordered_map<std::string, std::string> map);
+   // Pages up to max_pid exist, e.g. allocated by the WAL the redo replayed
+   void reservePIDsUpTo(PID max_pid);
    // -------------------------------------------------------------------------------------
    u64 getPoolSize() { return dram_pool_size; }
    DTRegistry& getDTRegistry() { return DTRegistry::global_dt_registry; }
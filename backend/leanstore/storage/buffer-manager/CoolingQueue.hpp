@@ -0,0 +1,90 @@
+#pragma once
+#include "Units.hpp"
+// -------------------------------------------------------------------------------------
+#include <atomic>
+#include <memory>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+struct BufferFrame;
+// -------------------------------------------------------------------------------------
+// FIFO of the frames a partition has in the cooling stage. Any page provider thread cools into
+// it, the thread owning the partition pops from the front and pushes what it can not evict yet to
+// the back. Vyukov's bounded queue: one CAS per push or pop and no lock between the phases.
+// Entries are not removed when a frame is swizzled in again, the consumer drops them on sight.
+class CoolingQueue
+{
+  public:
+   explicit CoolingQueue(u64 min_capacity) : mask(capacityFor(min_capacity) - 1), cells(new Cell[mask + 1])
+   {
+      for (u64 i = 0; i <= mask; i++) {
+         cells[i].seq.store(i, std::memory_order_relaxed);
+      }
+   }
+   // -------------------------------------------------------------------------------------
+   bool push(BufferFrame* bf)
+   {
+      u64 pos = tail.load(std::memory_order_relaxed);
+      while (true) {
+         Cell& cell = cells[pos & mask];
+         const s64 diff = static_cast<s64>(cell.seq.load(std::memory_order_acquire)) - static_cast<s64>(pos);
+         if (diff == 0) {
+            if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+               cell.bf = bf;
+               cell.seq.store(pos + 1, std::memory_order_release);
+               return true;
+            }
+         } else if (diff < 0) {
+            return false;  // full
+         } else {
+            pos = tail.load(std::memory_order_relaxed);
+         }
+      }
+   }
+   bool pop(BufferFrame*& bf)
+   {
+      u64 pos = head.load(std::memory_order_relaxed);
+      while (true) {
+         Cell& cell = cells[pos & mask];
+         const s64 diff = static_cast<s64>(cell.seq.load(std::memory_order_acquire)) - static_cast<s64>(pos + 1);
+         if (diff == 0) {
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+               bf = cell.bf;
+               cell.seq.store(pos + mask + 1, std::memory_order_release);
+               return true;
+            }
+         } else if (diff < 0) {
+            return false;  // empty
+         } else {
+            pos = head.load(std::memory_order_relaxed);
+         }
+      }
+   }
+   // Racy, exact only while nobody pushes or pops
+   u64 size() const { return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed); }
+   u64 capacity() const { return mask + 1; }
+
+  private:
+   struct Cell {
+      std::atomic<u64> seq;
+      BufferFrame* bf;
+   };
+   alignas(64) std::atomic<u64> head = 0;
+   alignas(64) std::atomic<u64> tail = 0;
+   alignas(64) const u64 mask;
+   std::unique_ptr<Cell[]> cells;
+   // -------------------------------------------------------------------------------------
+   static u64 capacityFor(u64 min_capacity)
+   {
+      u64 capacity = 64;
+      while (capacity < min_capacity) {
+         capacity <<= 1;
+      }
+      return capacity;
+   }
+};
+// -------------------------------------------------------------------------------------
+}  // namespace storage
+}  // namespace leanstore
@@ -71,6 +71,13 @@ void DTRegistry::todo(DTID dt_id, const u8* wal_entry, u64 tts)
    return dt_types_ht[std::get<0>(dt_meta)].todo(std::get<1>(dt_meta), wal_entry, tts);
 }
 // -------------------------------------------------------------------------------------
+void DTRegistry::redo(DTID dt_id, BufferFrame::Page& page, PID pid, LID gsn, const u8* wal_entry, u16 entry_size)
+{
+   // Once per record of the WAL, without copying the instance
+   const auto& dt_meta = dt_instances_ht[dt_id];
+   return dt_types_ht[std::get<0>(dt_meta)].redo(std::get<1>(dt_meta), page, pid, gsn, wal_entry, entry_size);
+}
+// -------------------------------------------------------------------------------------
 std::unordered_map<std::string, std::string> DTRegistry::serialize(DTID dt_id)
 {
    auto dt_meta = dt_instances_ht[dt_id];
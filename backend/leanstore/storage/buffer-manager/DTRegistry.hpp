@@ -37,6 +37,8 @@ struct DTRegistry {
       // MVCC / SI
       std::function<void(void* btree_object, const u8* entry, u64 tts)> undo;
       std::function<void(void* btree_object, const u8* entry, u64 tts)> todo;
+      // WAL redo, applies one record to the SSD copy of the page. Compares the GSNs itself
+      std::function<void(void* btree_object, BufferFrame::Page& page, PID pid, LID gsn, const u8* entry, u16 entry_size)> redo;
       // -------------------------------------------------------------------------------------
       // Serialization
       std::function<std::unordered_map<std::string, std::string>(void* btree_boject)> serialize;
@@ -64,6 +66,7 @@ struct DTRegistry {
    // Recovery / SI
    void undo(DTID dt_id, const u8* wal_entry, u64 tts);
    void todo(DTID dt_id, const u8* wal_entry, u64 tts);
+   void redo(DTID dt_id, BufferFrame::Page& page, PID pid, LID gsn, const u8* wal_entry, u16 entry_size);
    // -------------------------------------------------------------------------------------
    // Serialization
    std::unordered_map<std::string, std::string> serialize(DTID dt_id);
@@ -3,18 +3,48 @@
 #include "Exceptions.hpp"
 #include "leanstore/profiling/counters/WorkerCounters.hpp"
 // -------------------------------------------------------------------------------------
-// -------------------------------------------------------------------------------------
+#include <cstring>
 // -------------------------------------------------------------------------------------
 namespace leanstore
 {
 namespace storage
 {
 // -------------------------------------------------------------------------------------
+FreeList::Head FreeList::loadHead()
+{
+   // The halves are read one by one, the tag twice so a torn head is not mistaken for an empty list
+   Head current;
+   do {
+      current.tag = __atomic_load_n(&head.tag, __ATOMIC_ACQUIRE);
+      current.bf = __atomic_load_n(&head.bf, __ATOMIC_ACQUIRE);
+   } while (current.tag != __atomic_load_n(&head.tag, __ATOMIC_ACQUIRE));
+   return current;
+}
+// -------------------------------------------------------------------------------------
+bool FreeList::compareExchangeHead(Head& expected, BufferFrame* desired)
+{
+   Head next = {desired, expected.tag + 1};
+#if defined(__x86_64__)
+   unsigned __int128 expected_raw, desired_raw;
+   std::memcpy(&expected_raw, &expected, sizeof(expected_raw));
+   std::memcpy(&desired_raw, &next, sizeof(desired_raw));
+   const unsigned __int128 seen = __sync_val_compare_and_swap(reinterpret_cast<unsigned __int128*>(&head), expected_raw, desired_raw);
+   if (seen == expected_raw) {
+      return true;
+   }
+   std::memcpy(&expected, &seen, sizeof(expected));
+   return false;
+#else
+   return __atomic_compare_exchange(&head, &expected, &next, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+// -------------------------------------------------------------------------------------
 void FreeList::batchPush(BufferFrame* batch_head, BufferFrame* batch_tail, u64 batch_counter)
 {
-   batch_tail->header.next_free_bf = head.load();
-   while (!head.compare_exchange_strong(batch_tail->header.next_free_bf, batch_head))
-      ;
+   Head current = loadHead();
+   do {
+      batch_tail->header.next_free_bf = current.bf;
+   } while (!compareExchangeHead(current, batch_head));
    counter += batch_counter;
 }
 // -------------------------------------------------------------------------------------
@@ -22,61 +52,48 @@ void FreeList::push(BufferFrame& bf)
 {
    assert(bf.header.state == BufferFrame::STATE::FREE);
    bf.header.latch.assertNotExclusivelyLatched();
-   bf.header.next_free_bf = head.load();
-   while (!head.compare_exchange_strong(bf.header.next_free_bf, &bf))
-      ;
+   Head current = loadHead();
+   do {
+      bf.header.next_free_bf = current.bf;
+   } while (!compareExchangeHead(current, &bf));
    counter++;
 }
 // -------------------------------------------------------------------------------------
-struct BufferFrame& FreeList::tryPop(JMUW<std::unique_lock<std::mutex>>& lock)
+BufferFrame* FreeList::tryPop()
 {
-   BufferFrame* c_header = head;
-   BufferFrame* free_bf = nullptr;
-   if (c_header != nullptr) {
-      BufferFrame* next = c_header->header.next_free_bf;
-      if (head.compare_exchange_strong(c_header, next)) {
-         free_bf = c_header;
+   Head current = loadHead();
+   while (current.bf != nullptr) {
+      BufferFrame* next = current.bf->header.next_free_bf;
+      if (compareExchangeHead(current, next)) {
+         BufferFrame* free_bf = current.bf;
          free_bf->header.next_free_bf = nullptr;
          counter--;
          free_bf->header.latch.assertNotExclusivelyLatched();
          assert(free_bf->header.state == BufferFrame::STATE::FREE);
-      } else {
-         lock->unlock();
-         jumpmu::jump();
+         return free_bf;
       }
-   } else {
-      lock->unlock();
-      jumpmu::jump();
    }
-   return *free_bf;
+   return nullptr;
 }
 // -------------------------------------------------------------------------------------
-struct BufferFrame& FreeList::pop()
+u64 FreeList::tryPopBatch(BufferFrame*& batch_head, u64 max)
 {
-   BufferFrame* c_header = head;
-   BufferFrame* free_bf = nullptr;
-   while (c_header != nullptr) {
-      BufferFrame* next = c_header->header.next_free_bf;
-      if (head.compare_exchange_strong(c_header, next)) {
-         free_bf = c_header;
-         free_bf->header.next_free_bf = nullptr;
-         counter--;
-         free_bf->header.latch.assertNotExclusivelyLatched();
-         assert(free_bf->header.state == BufferFrame::STATE::FREE);
-         return *free_bf;
-      } else {
-         // WorkerCounters::myCounters().dt_researchy_1[0]++;
-         if (c_header == nullptr) {
-            // WorkerCounters::myCounters().dt_researchy_2[0]++;
-            jumpmu::jump();
-         } else {
-            c_header = head.load();
-         }
+   Head current = loadHead();
+   while (current.bf != nullptr) {
+      BufferFrame* batch_tail = current.bf;
+      u64 batch_counter = 1;
+      while (batch_counter < max && batch_tail->header.next_free_bf != nullptr) {
+         batch_tail = batch_tail->header.next_free_bf;
+         batch_counter++;
+      }
+      if (compareExchangeHead(current, batch_tail->header.next_free_bf)) {
+         batch_tail->header.next_free_bf = nullptr;
+         counter -= batch_counter;
+         batch_head = current.bf;
+         return batch_counter;
       }
    }
-   // WorkerCounters::myCounters().dt_researchy_2[0]++;
-   jumpmu::jump();
-   return *free_bf;  // unreachable
+   return 0;
 }
 // -------------------------------------------------------------------------------------
 }  // namespace storage
@@ -11,12 +11,25 @@ namespace storage
 {
 // -------------------------------------------------------------------------------------
 struct FreeList {
-   atomic<BufferFrame*> head = nullptr;
+   // The head pointer and a tag every successful CAS increments, swapped as one with cmpxchg16b (-mcx16).
+   // A pop reads next_free_bf before its CAS, meanwhile the frame can be popped, used and pushed again:
+   // the pointer is the same then, the tag is not (ABA)
+   struct alignas(16) Head {
+      BufferFrame* bf;
+      u64 tag;
+   };
+   Head head = {nullptr, 0};
    atomic<u64> counter = 0;
-   BufferFrame& tryPop(JMUW<std::unique_lock<std::mutex>>& lock);
-   BufferFrame& pop();
+   BufferFrame* tryPop();  // nullptr when empty
+   // Up to max frames chained through next_free_bf, returns how many
+   u64 tryPopBatch(BufferFrame*& batch_head, u64 max);
    void batchPush(BufferFrame* head, BufferFrame* tail, u64 counter);
    void push(BufferFrame& bf);
+
+  private:
+   Head loadHead();
+   // On failure expected holds the current head
+   bool compareExchangeHead(Head& expected, BufferFrame* desired);
 };
 // -------------------------------------------------------------------------------------
 }  // namespace storage
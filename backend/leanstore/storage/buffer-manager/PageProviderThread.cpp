@@ -3,6 +3,7 @@
 #include "BufferManager.hpp"
 #include "Exceptions.hpp"
 #include "leanstore/Config.hpp"
+#include "leanstore/concurrency-recovery/CRMG.hpp"
 #include "leanstore/concurrency-recovery/Worker.hpp"
 #include "leanstore/profiling/counters/CPUCounters.hpp"
 #include "leanstore/profiling/counters/PPCounters.hpp"
@@ -24,7 +25,17 @@ namespace leanstore
 namespace storage
 {
 // -------------------------------------------------------------------------------------
-void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_end)
+namespace
+{
+// WAL before data: the records of a page are on the SSD once its last writer's are durable up to page.GSN,
+// the rounds cut all workers at one instant and the records of the others came before under the latch
+bool isWALDurable(const BufferFrame& bf)
+{
+   return !FLAGS_wal || bf.page.GSN <= cr::CRManager::global->workers[bf.header.last_writer_worker]->wal_durable_gsn.load(std::memory_order_acquire);
+}
+}  // namespace
+// -------------------------------------------------------------------------------------
+void BufferManager::pageProviderThread(u64 s_i, u64 p_begin, u64 p_end)  // [p_begin, p_end) of slice s_i
 {
    pthread_setname_np(pthread_self(), "page_provider");
 
@@ -40,11 +51,19 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
    // -------------------------------------------------------------------------------------
    // Init AIO Context
    AsyncWriteBuffer async_write_buffer(ssd_fd, PAGE_SIZE, FLAGS_async_batch_size);
+   // Only the frames of its slice are cooled and evicted, they only go to its partitions
+   BufferPoolSlice& slice = slices[s_i];
+   auto& replacement_policy = slice.replacement_policy;
    // -------------------------------------------------------------------------------------
    // MyNote:: phase 1 -> empty buffer frame plus bf is coolling queue is less that cooling bfs limit
    auto phase_1_condition = [&](Partition& p) { return (p.dram_free_list.counter + p.cooling_bfs_counter) < p.cooling_bfs_limit; };  //
    // MyNote:: phase 2 and 3 -> empty buffer frame is less that free bfs limit
    auto phase_2_3_condition = [&](Partition& p) { return (p.dram_free_list.counter < p.free_bfs_limit); };
+   // Half of a cooling queue is left to the entries its consumer pushes back
+   auto has_cooling_room = [&](Partition& p) { return p.cooling_bfs_counter < p.cooling_queue.capacity() / 2; };
+   // Dirty frames of the cooling queues that are written back in this round
+   std::vector<BufferFrame*> written_bfs;
+   written_bfs.reserve(FLAGS_async_batch_size);
    // -------------------------------------------------------------------------------------
    while (bg_threads_keep_running) {
       /*
@@ -56,14 +75,14 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
       {
          phase_1_begin = std::chrono::high_resolution_clock::now();
       }
-      BufferFrame* volatile r_buffer = &randomBufferFrame();  // Attention: we may set the r_buffer to a child of a bf instead of random
+      BufferFrame* volatile r_buffer = &replacement_policy->pick();  // Attention: we may set the r_buffer to a child of a bf instead
       volatile u64 failed_attempts =
           0;  // [corner cases]: prevent starving when free list is empty and cooling to the required level can not be achieved
-#define repickIf(cond)                 \
-   if (cond) {                         \
-      r_buffer = &randomBufferFrame(); \
-      failed_attempts++;               \
-      continue;                        \
+#define repickIf(cond)                        \
+   if (cond) {                                \
+      r_buffer = &replacement_policy->pick(); \
+      failed_attempts++;                      \
+      continue;                               \
    }
       while (true) {
          jumpmuTry()
@@ -73,8 +92,7 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                std::cout << "Trying to add to cooling queue. " << std::endl;
             }
             */
-            // MyNote:: randomPartition maps from whole parition count not just from p_begin to p_end
-            while (phase_1_condition(randomPartition()) && failed_attempts < 10) {
+            while (phase_1_condition(randomPartition(slice)) && failed_attempts < 10) {
                COUNTERS_BLOCK()
                {
                   PPCounters::myCounters().phase_1_counter++;
@@ -105,21 +123,20 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                   // pass it to cooling queue
                   // std::cout << "Found cooling candidate of UNLINKED_HOT" << std::endl;
 
-                  const PID pid = r_buffer->header.pid;
-                  assert(r_buffer->header.pid == pid);
-                  Partition& partition = getPartition(pid);
+                  Partition& partition = homePartition(*r_buffer);
+                  repickIf(!has_cooling_room(partition));
                   r_guard.recheck();
-                  // r_x_guard can only be acquired and release while the partition mutex is locked
+                  // The consumer finds the frame latched until it is COOL, it pushes it back then
                   {
-                     JMUW<std::unique_lock<std::mutex>> g_guard(partition.cooling_mutex);
-                     r_guard.recheck();
                      ExclusiveGuard r_x_guard(r_guard);
                      // -------------------------------------------------------------------------------------
                      assert(r_buffer->header.state == BufferFrame::STATE::UNLINKED_HOT);
                      // assert(r_buffer->header.pid == pid);
                      assert(r_buffer->header.isWB == false);
                      // assert(parent_handler.parent_guard.version == parent_handler.parent_guard.latch->ref().load());
-                     partition.cooling_queue.emplace_back(reinterpret_cast<BufferFrame*>(r_buffer));
+                     if (!partition.cooling_queue.push(reinterpret_cast<BufferFrame*>(r_buffer))) {
+                        jumpmu::jump();
+                     }
                      r_buffer->header.state = BufferFrame::STATE::UNLINKED_COOL;
                      assert(r_buffer->header.state == BufferFrame::STATE::UNLINKED_COOL);
                      DEBUG_BLOCK()
@@ -145,15 +162,22 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                      PPCounters::myCounters().touched_bfs_counter++;
                   }
                   ensure(r_buffer->header.state == BufferFrame::STATE::HOT);
-                  bool picked_a_child_instead = false, all_children_evicted = true;
+                  bool picked_a_child_instead = false, all_children_evicted = true, other_slice_child = false;
                   [[maybe_unused]] Time iterate_children_begin, iterate_children_end;
                   COUNTERS_BLOCK()
                   {
                      iterate_children_begin = std::chrono::high_resolution_clock::now();
                   }
+                  const bool descend = replacement_policy->descendsToChildren();
                   getDTRegistry().iterateChildrenSwips(r_buffer->page.dt_id, *r_buffer, [&](Swip<BufferFrame>& swip) {
                      all_children_evicted &= swip.isEVICTED();  // ignore when it has a child in the cooling stage
-                     if (swip.isHOT()) {
+                     if (swip.isHOT() && descend) {
+                        // Frames of other NUMA slices are cooled by the page providers of their slice
+                        if (&sliceOf(swip.bfRef()) != &slice) {
+                           other_slice_child = true;
+                           r_guard.recheck();
+                           return true;
+                        }
                         r_buffer = &swip.bfRef();
                         r_guard.recheck();
                         picked_a_child_instead = true;
@@ -171,6 +195,11 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                   if (picked_a_child_instead) {
                      continue;  // restart the inner loop
                   }
+                  if (!all_children_evicted && (!descend || other_slice_child)) {
+                     // Passed over, not a failed attempt: its children are cooled on their own
+                     r_buffer = &replacement_policy->pick();
+                     continue;
+                  }
                   repickIf(!all_children_evicted);
 
                   // -------------------------------------------------------------------------------------
@@ -193,7 +222,7 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                   // -------------------------------------------------------------------------------------
                   r_guard.recheck();
                   if (getDTRegistry().checkSpaceUtilization(r_buffer->page.dt_id, *r_buffer, r_guard, parent_handler)) {
-                     r_buffer = &randomBufferFrame();
+                     r_buffer = &replacement_policy->pick();
                      continue;
                   }
                   r_guard.recheck();
@@ -201,10 +230,9 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                   // Suitable page founds, lets cool
                   {
                      const PID pid = r_buffer->header.pid;
-                     Partition& partition = getPartition(pid);
-                     // r_x_guard can only be acquired and release while the partition mutex is locked
+                     Partition& partition = homePartition(*r_buffer);
+                     repickIf(!has_cooling_room(partition));
                      {
-                        JMUW<std::unique_lock<std::mutex>> g_guard(partition.cooling_mutex);
                         ExclusiveUpgradeIfNeeded p_x_guard(parent_handler.parent_guard);
                         ExclusiveGuard r_x_guard(r_guard);
                         // -------------------------------------------------------------------------------------
@@ -213,7 +241,9 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                         assert(r_buffer->header.isWB == false);
                         assert(parent_handler.parent_guard.version == parent_handler.parent_guard.latch->ref().load());
                         // assert(parent_handler.swip.bf == r_buffer);
-                        partition.cooling_queue.emplace_back(reinterpret_cast<BufferFrame*>(r_buffer));
+                        if (!partition.cooling_queue.push(reinterpret_cast<BufferFrame*>(r_buffer))) {
+                           jumpmu::jump();
+                        }
                         r_buffer->header.state = BufferFrame::STATE::COOL;
                         parent_handler.swip.cool();
                         partition.cooling_bfs_counter++;
@@ -232,14 +262,13 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                      }
                   }
                }
-               const PID pid = r_buffer->header.pid;
-               Partition& partition = getPartition(pid);
+               Partition& partition = homePartition(*r_buffer);
                // -------------------------------------------------------------------------------------
                if (!phase_1_condition(partition)) {
-                  r_buffer = &randomBufferFrame();
+                  r_buffer = &replacement_policy->pick();
                   break;
                }
-               r_buffer = &randomBufferFrame();
+               r_buffer = &replacement_policy->pick();
                // -------------------------------------------------------------------------------------
             }
             failed_attempts = 0;
@@ -247,7 +276,7 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
          }
          jumpmuCatch()
          {
-            r_buffer = &randomBufferFrame();
+            r_buffer = &replacement_policy->pick();
             /*
             DEBUG_BLOCK() {
                std::cout << "jump encountered. Retrying to add to the queue." << std::endl;
@@ -299,14 +328,22 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
          // -------------------------------------------------------------------------------------
          FreedBfsBatch freed_bfs_batch;
          // -------------------------------------------------------------------------------------
-         auto evict_bf = [&](BufferFrame& bf, OptimisticGuard& guard, std::list<BufferFrame*>::iterator& bf_itr) {
+         // Entries that can not be decided now go to the back of the queue. The producers leave half
+         // of it free for them, a push that fails anyway forgets the frame: it stays COOL until it is
+         // swizzled in again.
+         auto requeue_bf = [&](BufferFrame& bf) {
+            if (!partition.cooling_queue.push(&bf)) {
+               partition.cooling_bfs_counter--;
+            }
+         };
+         // Pre: bf was popped from the cooling queue
+         auto evict_bf = [&](BufferFrame& bf, OptimisticGuard& guard) {
             assert(!bf.header.isWB);
             // Reclaim buffer frame
             assert(bf.header.state == BufferFrame::STATE::COOL || bf.header.state == BufferFrame::STATE::UNLINKED_COOL);
             /*
             if (!(bf.header.state == BufferFrame::STATE::COOL || bf.header.state == BufferFrame::STATE::UNLINKED_COOL)) {
                std::cout << " removing page not in cooling state from cooling queue bf: " << &bf << " pid: " << bf.header.pid << std::endl;
-               partition.cooling_queue.erase(bf_itr);
                partition.cooling_bfs_counter--;
                return;
             }
@@ -316,7 +353,6 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
             guard.recheck();
             if (bf.header.state == BufferFrame::STATE::UNLINKED_COOL) {
                guard.guard.toExclusive();
-               partition.cooling_queue.erase(bf_itr);
                partition.cooling_bfs_counter--;
                /*
                DEBUG_BLOCK()
@@ -330,7 +366,6 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                ExclusiveUpgradeIfNeeded p_x_guard(parent_handler.parent_guard);
                guard.guard.toExclusive();
                // -------------------------------------------------------------------------------------
-               partition.cooling_queue.erase(bf_itr);
                partition.cooling_bfs_counter--;
                // -------------------------------------------------------------------------------------
                parent_handler.swip.evict(bf.header.pid);
@@ -364,6 +399,7 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                freed_bfs_batch.push(partition);
             }
             // -------------------------------------------------------------------------------------
+            slice.evicted_pages++;
             COUNTERS_BLOCK()
             {
                PPCounters::myCounters().evicted_pages++;
@@ -386,35 +422,39 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
             if (pages_to_iterate_partition > 0) {
                PPCounters::myCounters().phase_2_counter++;
                volatile u64 pages_left_to_iterate_partition = pages_to_iterate_partition;
-               JMUW<std::unique_lock<std::mutex>> g_guard(partition.cooling_mutex);
-               auto bf_itr = partition.cooling_queue.begin();
-               while (pages_left_to_iterate_partition && bf_itr != partition.cooling_queue.end()) {
-                  BufferFrame& bf = **bf_itr;
-                  auto next_bf_tr = std::next(bf_itr, 1);
+               // Each entry is looked at once per round, the pushed back ones come after
+               volatile u64 entries_left = partition.cooling_queue.size();
+               BufferFrame* bf_ptr;
+               while (pages_left_to_iterate_partition && entries_left-- && partition.cooling_queue.pop(bf_ptr)) {
+                  BufferFrame& bf = *bf_ptr;
+                  volatile bool dropped = false;
                   // -------------------------------------------------------------------------------------
                   jumpmuTry()
                   {
                      OptimisticGuard o_guard(bf.header.latch, true);
-                     // Check if the BF got swizzled in or unswizzle another time in another partition
-                     if (!(bf.header.state == BufferFrame::STATE::COOL || bf.header.state == BufferFrame::STATE::UNLINKED_COOL) ||
-                         getPartitionID(bf.header.pid) != p_i) {
-                        partition.cooling_queue.erase(bf_itr);
+                     // Check if the BF got swizzled in meanwhile
+                     if (!(bf.header.state == BufferFrame::STATE::COOL || bf.header.state == BufferFrame::STATE::UNLINKED_COOL)) {
+                        dropped = true;
                         partition.cooling_bfs_counter--;
                         jumpmu::jump();
                      }
                      if (!bf.header.isWB) {
                         // Prevent evicting a page that already has an IO Frame with (possibly) threads working on it.
                         {
-                           JMUW<std::unique_lock<std::mutex>> io_guard(partition.io_mutex);
-                           if (partition.io_ht.lookup(bf.header.pid)) {
-                              partition.cooling_queue.erase(bf_itr);
+                           Partition& pid_partition = getPartition(bf.header.pid);
+                           JMUW<std::unique_lock<std::mutex>> io_guard(pid_partition.io_mutex);
+                           if (pid_partition.io_ht.lookup(bf.header.pid)) {
+                              dropped = true;
                               partition.cooling_bfs_counter--;
                               jumpmu::jump();
                            }
                         }
                         pages_left_to_iterate_partition--;
                         if (bf.isDirty()) {
-                           if (!async_write_buffer.full()) {
+                           if (!isWALDurable(bf)) {
+                              // Cools on until the group committer wrote the WAL of its last change
+                              requeue_bf(bf);
+                           } else if (!async_write_buffer.full()) {
                               {
                                  ExclusiveGuard ex_guard(o_guard);
                                  assert(!bf.header.isWB);
@@ -424,24 +464,28 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                                  SharedGuard s_guard(o_guard);
                                  PID wb_pid = bf.header.pid;
                                  if (FLAGS_out_of_place) {
-                                    wb_pid = partitions[p_i].nextPID();
-                                    assert(getPartitionID(bf.header.pid) == p_i);
-                                    assert(getPartitionID(wb_pid) == p_i);
+                                    wb_pid = getPartition(bf.header.pid).nextPID();
+                                    assert(getPartitionID(wb_pid) == getPartitionID(bf.header.pid));
                                  }
                                  async_write_buffer.add(bf, wb_pid);
                               }
+                              written_bfs.push_back(&bf);
                            } else {
+                              requeue_bf(bf);
                               jumpmu_break;
                            }
                         } else {
-                           evict_bf(bf, o_guard, bf_itr);
+                           evict_bf(bf, o_guard);
                         }
+                     } else {
+                        requeue_bf(bf);
                      }
-                     bf_itr = next_bf_tr;
                   }
                   jumpmuCatch()
                   {
-                     bf_itr = next_bf_tr;
+                     if (!dropped) {
+                        requeue_bf(bf);
+                     }
                   }
                }
             };
@@ -499,7 +543,7 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                             assert(written_bf.header.lastWrittenGSN < written_lsn);
                             // -------------------------------------------------------------------------------------
                             if (FLAGS_out_of_place) {
-                               partition.freePage(written_bf.header.pid);
+                               getPartition(written_bf.header.pid).freePage(written_bf.header.pid);
                                written_bf.header.pid = out_of_place_pid;
                             }
                             written_bf.header.lastWrittenGSN = written_lsn;
@@ -518,34 +562,33 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                   async_wb_end = std::chrono::high_resolution_clock::now();
                }
                // -------------------------------------------------------------------------------------
-               volatile u64 pages_left_to_iterate_partition = polled_events;
-               JMUW<std::unique_lock<std::mutex>> g_guard(partition.cooling_mutex);
-               // -------------------------------------------------------------------------------------
-               auto bf_itr = partition.cooling_queue.begin();
-               while (pages_left_to_iterate_partition-- && bf_itr != partition.cooling_queue.end()) {
-                  BufferFrame& bf = **bf_itr;
-                  auto next_bf_tr = std::next(bf_itr, 1);
+               // The frames written back in this round were not pushed back, they are evicted or pushed now
+               for (volatile u64 w_i = 0; w_i < written_bfs.size(); w_i++) {
+                  BufferFrame& bf = *written_bfs[w_i];
+                  volatile bool dropped = false;
                   // -------------------------------------------------------------------------------------
                   jumpmuTry()
                   {
                      OptimisticGuard o_guard(bf.header.latch, true);
-                     if (!(bf.header.state == BufferFrame::STATE::COOL || bf.header.state == BufferFrame::STATE::UNLINKED_COOL) ||
-                         getPartitionID(bf.header.pid) != p_i) {
-                        partition.cooling_queue.erase(bf_itr);
+                     if (!(bf.header.state == BufferFrame::STATE::COOL || bf.header.state == BufferFrame::STATE::UNLINKED_COOL)) {
+                        dropped = true;
                         partition.cooling_bfs_counter--;
                         jumpmu::jump();
                      }
                      if (!bf.header.isWB && !bf.isDirty()) {
-                        evict_bf(bf, o_guard, bf_itr);
+                        evict_bf(bf, o_guard);
+                     } else {
+                        requeue_bf(bf);
                      }
-                     // -------------------------------------------------------------------------------------
-                     bf_itr = next_bf_tr;
                   }
                   jumpmuCatch()
                   {
-                     bf_itr = next_bf_tr;
+                     if (!dropped) {
+                        requeue_bf(bf);
+                     }
                   }
                }
+               written_bfs.clear();
                // -------------------------------------------------------------------------------------
                COUNTERS_BLOCK()
                {
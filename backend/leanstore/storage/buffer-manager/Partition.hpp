@@ -1,12 +1,14 @@
 #pragma once
 #include "BufferFrame.hpp"
+#include "CoolingQueue.hpp"
 #include "FreeList.hpp"
 #include "Units.hpp"
 #include "leanstore/Config.hpp"
 // -------------------------------------------------------------------------------------
 // -------------------------------------------------------------------------------------
-#include <list>
+#include <atomic>
 #include <mutex>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 // -------------------------------------------------------------------------------------
@@ -15,6 +17,26 @@ namespace leanstore
 namespace storage
 {
 // -------------------------------------------------------------------------------------
+// Held by the reader of a page from the submission of the read until the page is installed. Unlike a
+// std::mutex it is not owned by an OS thread: a user thread parked on its read can be revived on
+// another worker and release it there.
+struct IOLatch {
+   std::atomic<bool> locked = false;
+   // -------------------------------------------------------------------------------------
+   inline bool try_lock() { return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire); }
+   inline void lock()
+   {
+      for (u64 spins = 0; !try_lock(); spins++) {
+         if (spins < 64) {
+            MYPAUSE();
+         } else {
+            std::this_thread::yield();
+         }
+      }
+   }
+   inline void unlock() { locked.store(false, std::memory_order_release); }
+};
+// -------------------------------------------------------------------------------------
 struct IOFrame {
    enum class STATE : u8 {
       READING = 0,
@@ -22,7 +44,7 @@ struct IOFrame {
       TO_DELETE = 2,
       UNDEFINED = 3  // for debugging
    };
-   std::mutex mutex;
+   IOLatch mutex;
    STATE state = STATE::UNDEFINED;
    BufferFrame* bf = nullptr;
    // -------------------------------------------------------------------------------------
@@ -62,16 +84,22 @@ struct HashTable {
    HashTable(u64 size_in_bits);
 };
 // -------------------------------------------------------------------------------------
+// PIDs the SSD holds, the BufferInfoMap is reserved for exactly these
+inline u64 ssdPIDCapacity()
+{
+   return static_cast<u64>(FLAGS_ssd_gib * 1024 * 1024 * 1024 / PAGE_SIZE);
+}
+// -------------------------------------------------------------------------------------
 struct Partition {
    // MyNote:: list of page id requested
    std::mutex io_mutex;
    HashTable io_ht;
    // -------------------------------------------------------------------------------------
-   // MyNote:: cooling stage bufferframe list but not sure why we need mutex
-   std::mutex cooling_mutex;
-   std::list<BufferFrame*> cooling_queue;
+   // MyNote:: cooling stage bufferframes
+   CoolingQueue cooling_queue;
    // -------------------------------------------------------------------------------------
    // MyNote:: track stats
+   // Entries of the cooling queue plus those its consumer holds while they are written back
    atomic<u64> cooling_bfs_counter = 0;
    const u64 free_bfs_limit;
    const u64 cooling_bfs_limit;
@@ -92,10 +120,25 @@ struct Partition {
       } else {
          const u64 pid = next_pid;
          next_pid += pid_distance;
-         ensure((pid * PAGE_SIZE / 1024 / 1024 / 1024) <= FLAGS_ssd_gib);
+         ensure(pid < ssdPIDCapacity());
          return pid;
       }
    }
+   // n PIDs under one lock, the freed ones first
+   inline void nextPIDs(PID* pids, u64 n)
+   {
+      std::unique_lock<std::mutex> g_guard(pids_mutex);
+      u64 p_i = 0;
+      for (; p_i < n && freed_pids.size(); p_i++) {
+         pids[p_i] = freed_pids.back();
+         freed_pids.pop_back();
+      }
+      for (; p_i < n; p_i++) {
+         pids[p_i] = next_pid;
+         next_pid += pid_distance;
+      }
+      ensure(pids[n - 1] < ssdPIDCapacity());
+   }
    // pushes pid to freed_pids vector
    void freePage(PID pid)
    {
@@ -0,0 +1,81 @@
+#include "ReplacementPolicy.hpp"
+
+#include "Exceptions.hpp"
+#include "leanstore/Config.hpp"
+#include "leanstore/utils/RandomGenerator.hpp"
+// -------------------------------------------------------------------------------------
+#include <algorithm>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+// -------------------------------------------------------------------------------------
+std::unique_ptr<ReplacementPolicy> ReplacementPolicy::create(const std::string& name, BufferFrame* bfs, u64 dram_pool_size)
+{
+   if (name == "random") {
+      return std::make_unique<RandomPolicy>(bfs, dram_pool_size);
+   } else if (name == "clock") {
+      return std::make_unique<ClockPolicy>(bfs, dram_pool_size);
+   } else if (name == "sampled") {
+      return std::make_unique<SampledFrequencyPolicy>(bfs, dram_pool_size, std::max<u64>(FLAGS_replacement_samples, 1));
+   }
+   throw ex::GenericException("unknown replacement policy " + name);
+}
+// -------------------------------------------------------------------------------------
+BufferFrame& RandomPolicy::pick()
+{
+   return bfs[utils::RandomGenerator::getRand<u64>(0, dram_pool_size)];
+}
+// -------------------------------------------------------------------------------------
+BufferFrame& ClockPolicy::pick()
+{
+   for (u64 step = 0; step < MAX_SWEEP; step++) {
+      BufferFrame& bf = bfs[hand.fetch_add(1, std::memory_order_relaxed) % dram_pool_size];
+      if (!isCandidate(bf)) {
+         continue;
+      }
+      if (bf.header.access.load(std::memory_order_relaxed) != 0) {
+         bf.header.access.store(0, std::memory_order_relaxed);
+         continue;
+      }
+      return bf;
+   }
+   // Everything looked at was referenced and has lost its bit, the next candidate under the hand had its chance
+   for (u64 step = 0; step < MAX_SWEEP; step++) {
+      BufferFrame& bf = bfs[hand.fetch_add(1, std::memory_order_relaxed) % dram_pool_size];
+      if (isCandidate(bf)) {
+         return bf;
+      }
+   }
+   // No candidate in two sweeps, phase 1 turns the frame down and counts a failed attempt
+   return bfs[hand.load(std::memory_order_relaxed) % dram_pool_size];
+}
+// -------------------------------------------------------------------------------------
+BufferFrame& SampledFrequencyPolicy::pick()
+{
+   BufferFrame* victim = nullptr;
+   u8 victim_access = 0;
+   // Free and cooling frames do not count as samples, a mostly free pool still ends the loop
+   for (u64 s_i = 0, tries = 0; s_i < samples && tries < 4 * samples; tries++) {
+      BufferFrame& bf = bfs[utils::RandomGenerator::getRand<u64>(0, dram_pool_size)];
+      if (!isCandidate(bf)) {
+         continue;
+      }
+      s_i++;
+      const u8 access = bf.header.access.load(std::memory_order_relaxed);
+      if (victim == nullptr || access < victim_access) {
+         if (victim != nullptr && victim_access > 1) {
+            victim->header.access.store(victim_access / 2, std::memory_order_relaxed);
+         }
+         victim = &bf;
+         victim_access = access;
+      } else if (access > 1) {
+         bf.header.access.store(access / 2, std::memory_order_relaxed);
+      }
+   }
+   return victim ? *victim : bfs[utils::RandomGenerator::getRand<u64>(0, dram_pool_size)];
+}
+// -------------------------------------------------------------------------------------
+}  // namespace storage
+}  // namespace leanstore
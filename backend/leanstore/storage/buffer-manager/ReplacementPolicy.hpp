@@ -0,0 +1,80 @@
+#pragma once
+#include "BufferFrame.hpp"
+#include "Units.hpp"
+// -------------------------------------------------------------------------------------
+#include <atomic>
+#include <memory>
+#include <string>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace storage
+{
+// -------------------------------------------------------------------------------------
+// Picks the frames phase 1 of the page provider tries to cool. One instance per NUMA slice over its
+// frames, shared by its page provider threads. Frames are read without latches, phase 1 validates
+// whatever it gets.
+class ReplacementPolicy
+{
+  public:
+   ReplacementPolicy(BufferFrame* bfs, u64 dram_pool_size) : bfs(bfs), dram_pool_size(dram_pool_size) {}
+   virtual ~ReplacementPolicy() = default;
+   // -------------------------------------------------------------------------------------
+   virtual BufferFrame& pick() = 0;
+   // Whether phase 1 cools a hot child of the picked inner node instead (the original behaviour).
+   // Policies that track accesses pass over the node: learned lookups bypass inner nodes, so they
+   // look cold while their children are the hottest frames in the pool.
+   virtual bool descendsToChildren() const { return false; }
+   // -------------------------------------------------------------------------------------
+   // random, clock or sampled, throws ex::GenericException for anything else
+   static std::unique_ptr<ReplacementPolicy> create(const std::string& name, BufferFrame* bfs, u64 dram_pool_size);
+
+  protected:
+   BufferFrame* const bfs;
+   const u64 dram_pool_size;
+   // -------------------------------------------------------------------------------------
+   static inline bool isCandidate(const BufferFrame& bf)
+   {
+      return (bf.header.state == BufferFrame::STATE::HOT || bf.header.state == BufferFrame::STATE::UNLINKED_HOT) && !bf.header.keep_in_memory &&
+             !bf.header.isWB;
+   }
+};
+// -------------------------------------------------------------------------------------
+// Uniformly random frames
+class RandomPolicy : public ReplacementPolicy
+{
+  public:
+   using ReplacementPolicy::ReplacementPolicy;
+   BufferFrame& pick() override;
+   bool descendsToChildren() const override { return true; }
+};
+// -------------------------------------------------------------------------------------
+// Second chance: the hand sweeps the pool and clears the reference bit of the frames accessed since
+// its last pass, the first candidate without one is picked
+class ClockPolicy : public ReplacementPolicy
+{
+  public:
+   static constexpr u64 MAX_SWEEP = 1024;  // frames looked at per pick
+   using ReplacementPolicy::ReplacementPolicy;
+   BufferFrame& pick() override;
+
+  private:
+   std::atomic<u64> hand = 0;
+};
+// -------------------------------------------------------------------------------------
+// Compares the access counts of a few random candidates and picks the lowest. The counts of the
+// others are halved, so they decay with every look the policy takes at them. Accesses through the
+// learned mapping count like swip traversals (BufferFrame::touch), which is what keeps the leafs of
+// mapping_bfs apart from the inner nodes learned lookups skip.
+class SampledFrequencyPolicy : public ReplacementPolicy
+{
+  public:
+   SampledFrequencyPolicy(BufferFrame* bfs, u64 dram_pool_size, u64 samples) : ReplacementPolicy(bfs, dram_pool_size), samples(samples) {}
+   BufferFrame& pick() override;
+
+  private:
+   const u64 samples;
+};
+// -------------------------------------------------------------------------------------
+}  // namespace storage
+}  // namespace leanstore
@@ -0,0 +1,198 @@
+#pragma once
+#include "Exceptions.hpp"
+#include "Units.hpp"
+#include "leanstore/utils/JumpMU.hpp"
+// -------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <vector>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+// -------------------------------------------------------------------------------------
+/*
+ * Epoch based reclamation for read-mostly structures that are replaced as a whole
+ * (e.g. the trained model of a BTree).
+ * Readers announce the global epoch in their own cache line when they enter and
+ * withdraw when they leave, they never write to shared cache lines.
+ * Writers swap the pointer first, then retire the old object. It is freed once every
+ * reader that could have seen it has left.
+ */
+class EpochManager
+{
+  public:
+   static constexpr u64 MAX_THREADS = 256;
+   static constexpr u64 QUIESCENT = std::numeric_limits<u64>::max();
+   // -------------------------------------------------------------------------------------
+   struct alignas(64) Slot {
+      std::atomic<u64> epoch = QUIESCENT;
+      std::atomic<bool> in_use = false;
+      u64 depth = 0;
+   };
+   // -------------------------------------------------------------------------------------
+   static EpochManager& global()
+   {
+      static EpochManager manager;
+      return manager;
+   }
+   // -------------------------------------------------------------------------------------
+   inline void enter()
+   {
+      Slot& slot = mySlot();
+      if (slot.depth++ == 0) {
+         slot.epoch.store(global_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+      }
+   }
+   inline void leave()
+   {
+      Slot& slot = mySlot();
+      assert(slot.depth > 0);
+      if (--slot.depth == 0) {
+         slot.epoch.store(QUIESCENT, std::memory_order_release);
+      }
+   }
+   // -------------------------------------------------------------------------------------
+   // Pre: obj is no longer reachable for new readers
+   void retire(std::function<void()> deleter)
+   {
+      std::unique_lock<std::mutex> guard(retired_mutex);
+      const u64 epoch = global_epoch.fetch_add(1);
+      retired.push_back({epoch, std::move(deleter)});
+      collect(guard);
+   }
+   template <typename T>
+   void retire(T* obj)
+   {
+      if (obj != nullptr) {
+         retire([obj]() { delete obj; });
+      }
+   }
+   void collect()
+   {
+      std::unique_lock<std::mutex> guard(retired_mutex);
+      collect(guard);
+   }
+   u64 pending()
+   {
+      std::unique_lock<std::mutex> guard(retired_mutex);
+      return retired.size();
+   }
+   // -------------------------------------------------------------------------------------
+   // A user thread can park inside a reader section and resume on another OS thread, so it brings its
+   // own slot: it stays published while parked and enter/leave of the user thread always meet in it.
+   // The scheduler installs it on the OS thread running the user thread, nullptr restores the thread's own
+   void addSlot(Slot* slot)
+   {
+      std::unique_lock<std::mutex> guard(retired_mutex);
+      user_slots.push_back(slot);
+   }
+   void removeSlot(Slot* slot)
+   {
+      std::unique_lock<std::mutex> guard(retired_mutex);
+      assert(slot->depth == 0);
+      user_slots.erase(std::find(user_slots.begin(), user_slots.end(), slot));
+   }
+   static void install(Slot* slot) { installedSlot() = slot; }
+   // -------------------------------------------------------------------------------------
+   ~EpochManager()
+   {
+      for (auto& r : retired) {
+         r.deleter();
+      }
+   }
+
+  private:
+   // Slots are tracked per thread, so there is only the global instance
+   EpochManager() = default;
+   struct Retired {
+      u64 epoch;
+      std::function<void()> deleter;
+   };
+   // -------------------------------------------------------------------------------------
+   std::atomic<u64> global_epoch = 0;
+   Slot slots[MAX_THREADS];
+   std::mutex retired_mutex;
+   std::vector<Retired> retired;
+   std::vector<Slot*> user_slots;  // under retired_mutex
+   // -------------------------------------------------------------------------------------
+   struct SlotOwner {
+      Slot* slot = nullptr;
+      ~SlotOwner()
+      {
+         if (slot != nullptr) {
+            slot->in_use.store(false, std::memory_order_release);
+         }
+      }
+   };
+   // Not inlined: the compiler must not keep the thread local address of a user thread across a park
+   static __attribute__((noinline)) Slot*& installedSlot()
+   {
+      static thread_local Slot* slot = nullptr;
+      return slot;
+   }
+   inline Slot& mySlot()
+   {
+      if (Slot* installed = installedSlot()) {
+         return *installed;
+      }
+      static thread_local SlotOwner owner;
+      if (owner.slot == nullptr) {
+         for (u64 s_i = 0; s_i < MAX_THREADS && owner.slot == nullptr; s_i++) {
+            bool expected = false;
+            if (slots[s_i].in_use.compare_exchange_strong(expected, true)) {
+               owner.slot = &slots[s_i];
+            }
+         }
+         ensure(owner.slot != nullptr);
+      }
+      return *owner.slot;
+   }
+   void collect(std::unique_lock<std::mutex>&)
+   {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      u64 min_epoch = QUIESCENT;
+      for (u64 s_i = 0; s_i < MAX_THREADS; s_i++) {
+         min_epoch = std::min(min_epoch, slots[s_i].epoch.load(std::memory_order_acquire));
+      }
+      for (Slot* slot : user_slots) {
+         min_epoch = std::min(min_epoch, slot->epoch.load(std::memory_order_acquire));
+      }
+      auto itr = retired.begin();
+      while (itr != retired.end()) {
+         if (itr->epoch < min_epoch) {
+            itr->deleter();
+            itr = retired.erase(itr);
+         } else {
+            itr++;
+         }
+      }
+   }
+};
+// -------------------------------------------------------------------------------------
+// RAII reader section, survives jumpmu unwinding like the page guards
+class EpochGuard
+{
+  public:
+   EpochGuard() : manager(EpochManager::global())
+   {
+      manager.enter();
+      jumpmu_registerDestructor();
+   }
+   jumpmu_defineCustomDestructor(EpochGuard);
+   ~EpochGuard()
+   {
+      manager.leave();
+      jumpmu::clearLastDestructor();
+   }
+   EpochGuard(const EpochGuard&) = delete;
+   EpochGuard& operator=(const EpochGuard&) = delete;
+
+  private:
+   EpochManager& manager;
+};
+// -------------------------------------------------------------------------------------
+}  // namespace leanstore
@@ -47,6 +47,8 @@ class HybridPageGuard
    HybridPageGuard(BufferFrame* bf) : bf(bf), guard(bf->header.latch)
    {
       guard.toOptimisticSpin();
+      // Learned lookups come in here with the leaf of mapping_bfs, past the swips of the inner nodes
+      bf->touch();
       syncGSN();
       jumpmu_registerDestructor();
    }
@@ -68,6 +70,7 @@ class HybridPageGuard
       } else if (if_contended == LATCH_FALLBACK_MODE::SHARED) {
          guard.toOptimisticOrShared();
       }
+      bf->touch();
       syncGSN();
       jumpmu_registerDestructor();
       // -------------------------------------------------------------------------------------
@@ -125,6 +128,7 @@ class HybridPageGuard
       assert(guard.state == GUARD_STATE::EXCLUSIVE);
       const LID gsn = std::max<LID>(bf->page.GSN, cr::Worker::my().getCurrentGSN()) + 1;
       bf->page.GSN = gsn;
+      bf->header.last_writer_worker = cr::Worker::my().worker_id;
       cr::Worker::my().setCurrentGSN(gsn);
       // -------------------------------------------------------------------------------------
       const auto pid = bf->header.pid;
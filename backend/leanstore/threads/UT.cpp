@@ -2,6 +2,8 @@
 
 #include "leanstore/utils/Misc.hpp"
 // -------------------------------------------------------------------------------------
+#include <algorithm>
+// -------------------------------------------------------------------------------------
 DEFINE_bool(disable_cross_cores_ut, false, "");
 // -------------------------------------------------------------------------------------
 namespace leanstore
@@ -23,6 +25,58 @@ static thread_local std::function<void(std::function<void()>)> work_to_execute_a
 static thread_local bool is_work_delegated = false;
 static atomic<s64> in_flight = 0;
 // -------------------------------------------------------------------------------------
+// Reads of the user threads parked on this worker
+struct AsyncRead {
+   struct iocb cb;
+   s64 slot;
+   s64 res = 0;
+   std::function<void()> revive;
+};
+static thread_local io_context_t worker_aio_context = 0;
+static thread_local u64 worker_reads_in_flight = 0;
+// Revives the user threads whose reads completed, with wait blocks a little for the first one
+static u64 pollReads(bool wait)
+{
+   if (worker_reads_in_flight == 0) {
+      return 0;
+   }
+   constexpr u64 MAX_EVENTS = 64;
+   struct io_event events[MAX_EVENTS];
+   struct timespec timeout = {0, wait ? 50000 : 0};
+   const int done = io_getevents(worker_aio_context, wait ? 1 : 0, MAX_EVENTS, events, &timeout);
+   if (done <= 0) {
+      return 0;
+   }
+   for (int e_i = 0; e_i < done; e_i++) {
+      AsyncRead& read = *reinterpret_cast<AsyncRead*>(events[e_i].data);
+      read.res = events[e_i].res;
+      worker_reads_in_flight--;
+      UserThreadManager::utm_mutex.lock();
+      auto& blocked = UserThreadManager::uts_blocked;
+      blocked.erase(std::find(blocked.begin(), blocked.end(), read.slot));
+      UserThreadManager::utm_mutex.unlock();
+      // read lives on the stack of the user thread, gone as soon as it runs again
+      auto revive = std::move(read.revive);
+      revive();
+   }
+   return done;
+}
+static void submitRead(AsyncRead& read)
+{
+   if (worker_aio_context == 0) {
+      const int ret = io_setup(FLAGS_ut_io_depth, &worker_aio_context);
+      if (ret != 0) {
+         throw ex::GenericException("io_setup failed, ret code = " + std::to_string(ret));
+      }
+   }
+   while (worker_reads_in_flight >= FLAGS_ut_io_depth) {
+      pollReads(true);
+   }
+   struct iocb* cbs[1] = {&read.cb};
+   ensure(io_submit(worker_aio_context, 1, cbs) == 1);
+   worker_reads_in_flight++;
+}
+// -------------------------------------------------------------------------------------
 static void exec()
 {
    assert(current_user_thread_slot != -1);
@@ -31,7 +85,13 @@ static void exec()
 // -------------------------------------------------------------------------------------
 void UserThreadManager::destroy()
 {
-   while (uts_ready.size() + in_flight > 0) {
+   while (true) {
+      utm_mutex.lock();
+      const bool idle = uts_ready.empty() && in_flight == 0;
+      utm_mutex.unlock();
+      if (idle) {
+         break;
+      }
    }
    keep_running = false;
    while (running_threads > 0) {
@@ -39,6 +99,13 @@ void UserThreadManager::destroy()
    for (auto& wt : worker_threads) {
       wt.join();
    }
+   worker_threads.clear();
+   for (auto& th : uts) {
+      EpochManager::global().removeSlot(th.epoch_slot.get());
+   }
+   uts.clear();
+   uts_ready.clear();
+   uts_blocked.clear();
 }
 // -------------------------------------------------------------------------------------
 void UserThreadManager::init(u64 n)
@@ -70,6 +137,11 @@ void UserThreadManager::init(u64 n)
          ucontext_t worker_thread_uctx;
          current_uctx = &worker_thread_uctx;
          while (keep_running) {
+            // Nothing else to run, then the worker can as well wait for its reads
+            utm_mutex.lock();
+            const bool nothing_ready = uts_ready.empty();
+            utm_mutex.unlock();
+            pollReads(nothing_ready);
             UserThread* th = nullptr;
             utm_mutex.lock();
             if (uts_ready.size() > 0) {
@@ -97,9 +169,12 @@ void UserThreadManager::init(u64 n)
                   if (th->worker_id != worker_id) {
                      overwrite_uc_link(th->context, &worker_thread_uctx);
                   }
+                  th->jumpmu_context.restore();
                }
                assert(current_user_thread_slot != -1);
+               EpochManager::install(th->epoch_slot.get());
                posix_check(swapcontext(current_uctx, &th->context) != -1);
+               EpochManager::install(nullptr);
                if (is_work_delegated) {
                   // after sleepThenCall
                   const s64 slot_id = current_user_thread_slot;
@@ -115,6 +190,10 @@ void UserThreadManager::init(u64 n)
                }
             }
          }
+         if (worker_aio_context != 0) {
+            io_destroy(worker_aio_context);
+            worker_aio_context = 0;
+         }
          running_threads--;
       });
 }
@@ -127,10 +206,12 @@ void UserThreadManager::addThread(std::function<void()> run)
    th.run = run;
    th.init = false;
    posix_check(getcontext(&th.context) != -1);
-   th.stack = make_unique<u8[]>(STACK_SIZE);
+   th.stack = std::unique_ptr<u8[]>(new u8[STACK_SIZE]);  // not value initialized, pages are touched on demand
    th.context.uc_stack.ss_sp = th.stack.get();
    th.context.uc_stack.ss_size = STACK_SIZE;
    th.context.uc_link = nullptr;
+   th.epoch_slot = std::make_unique<EpochManager::Slot>();
+   EpochManager::global().addSlot(th.epoch_slot.get());
    uts_ready.push_back(uts.size() - 1);
    utm_mutex.unlock();
 }
@@ -140,9 +221,37 @@ void UserThreadManager::sleepThenCall(std::function<void(std::function<void()>)>
    assert(current_user_thread_slot != -1);
    work_to_execute_after_context_switch = work;
    const s64 slot_id = current_user_thread_slot;
+   uts[slot_id].jumpmu_context.save();
    is_work_delegated = true;
    posix_check(swapcontext(&uts[slot_id].context, current_uctx) != -1);
 }
 // -------------------------------------------------------------------------------------
+bool UserThreadManager::isUserThread()
+{
+   return current_user_thread_slot != -1;
+}
+// -------------------------------------------------------------------------------------
+void UserThreadManager::yield()
+{
+   sleepThenCall([](std::function<void()> revive) { revive(); });
+}
+// -------------------------------------------------------------------------------------
+void UserThreadManager::readAsync(int fd, u8* destination, u64 size, u64 offset)
+{
+   assert(isUserThread());
+   AsyncRead read;
+   read.slot = current_user_thread_slot;
+   io_prep_pread(&read.cb, fd, destination, size, offset);
+   read.cb.data = &read;
+   sleepThenCall([&read](std::function<void()> revive) {
+      read.revive = std::move(revive);
+      utm_mutex.lock();
+      uts_blocked.push_back(read.slot);
+      utm_mutex.unlock();
+      submitRead(read);
+   });
+   ensure(read.res == s64(size));
+}
+// -------------------------------------------------------------------------------------
 }  // namespace threads
 }  // namespace leanstore
@@ -2,7 +2,9 @@
 #include "Exceptions.hpp"
 #include "Units.hpp"
 #include "leanstore/Config.hpp"
+#include "leanstore/sync-primitives/Epoch.hpp"
 #include "leanstore/utils/Misc.hpp"
+#include "leanstore/utils/JumpMU.hpp"
 #include "leanstore/utils/RandomGenerator.hpp"
 // -------------------------------------------------------------------------------------
 #include <emmintrin.h>
@@ -39,6 +41,8 @@ struct UserThread {
    unique_ptr<u8[]> stack;
    std::function<void()> run;
    s64 worker_id = -1;
+   jumpmu::Context jumpmu_context;  // while parked
+   std::unique_ptr<EpochManager::Slot> epoch_slot;  // installed on the worker running it, stays published while parked
 };
 struct UserThreadManager {
    static atomic<bool> keep_running;
@@ -51,6 +55,12 @@ struct UserThreadManager {
    static void destroy();
    static void addThread(std::function<void()> run);
    static void sleepThenCall(std::function<void(std::function<void()>)> work);
+   // -------------------------------------------------------------------------------------
+   // Non-blocking I/O: readAsync parks the calling user thread in uts_blocked, its worker submits the
+   // read with libaio and runs the ready user threads until polling the completion revives it
+   static bool isUserThread();
+   static void yield();
+   static void readAsync(int fd, u8* destination, u64 size, u64 offset);
 };
 using UT = UserThread;
 using UTM = UserThreadManager;
@@ -0,0 +1,35 @@
+#pragma once
+#include "Units.hpp"
+// -------------------------------------------------------------------------------------
+#include <vector>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace utils
+{
+// -------------------------------------------------------------------------------------
+// Read only view of a contiguous array someone else owns (a vector or a mapped file)
+template <typename T>
+class ArrayView
+{
+  public:
+   ArrayView() = default;
+   ArrayView(const T* data, const size_t size) : ptr(data), count(size) {}
+   ArrayView(const std::vector<T>& vector) : ptr(vector.data()), count(vector.size()) {}
+   // -------------------------------------------------------------------------------------
+   inline size_t size() const { return count; }
+   inline bool empty() const { return count == 0; }
+   inline const T* data() const { return ptr; }
+   inline const T& operator[](const size_t idx) const { return ptr[idx]; }
+   inline const T* begin() const { return ptr; }
+   inline const T* end() const { return ptr + count; }
+   inline const T& front() const { return ptr[0]; }
+   inline const T& back() const { return ptr[count - 1]; }
+
+  private:
+   const T* ptr = nullptr;
+   size_t count = 0;
+};
+// -------------------------------------------------------------------------------------
+}  // namespace utils
+}  // namespace leanstore
@@ -1,6 +1,8 @@
 #include "JumpMU.hpp"
 
 #include <signal.h>
+
+#include <cstring>
 // -------------------------------------------------------------------------------------
 namespace jumpmu
 {
@@ -31,4 +33,27 @@ void jump()
    checkpoint_counter--;
    longjmp(env_to_jump, 1);
 }
+// -------------------------------------------------------------------------------------
+void Context::save()
+{
+   assert(!in_jump);
+   checkpoint_counter = jumpmu::checkpoint_counter;
+   de_stack_counter = jumpmu::de_stack_counter;
+   std::memcpy(env, jumpmu::env, sizeof(jmp_buf) * checkpoint_counter);
+   std::memcpy(checkpoint_stacks_counter, jumpmu::checkpoint_stacks_counter, sizeof(int) * checkpoint_counter);
+   std::memcpy(de_stack_arr, jumpmu::de_stack_arr, sizeof(de_stack_arr[0]) * de_stack_counter);
+   std::memcpy(de_stack_obj, jumpmu::de_stack_obj, sizeof(void*) * de_stack_counter);
+   jumpmu::checkpoint_counter = 0;
+   jumpmu::de_stack_counter = 0;
+}
+void Context::restore()
+{
+   assert(jumpmu::checkpoint_counter == 0 && jumpmu::de_stack_counter == 0);
+   jumpmu::checkpoint_counter = checkpoint_counter;
+   jumpmu::de_stack_counter = de_stack_counter;
+   std::memcpy(jumpmu::env, env, sizeof(jmp_buf) * checkpoint_counter);
+   std::memcpy(jumpmu::checkpoint_stacks_counter, checkpoint_stacks_counter, sizeof(int) * checkpoint_counter);
+   std::memcpy(jumpmu::de_stack_arr, de_stack_arr, sizeof(de_stack_arr[0]) * de_stack_counter);
+   std::memcpy(jumpmu::de_stack_obj, de_stack_obj, sizeof(void*) * de_stack_counter);
+}
 }  // namespace jumpmu
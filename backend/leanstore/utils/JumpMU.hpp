@@ -18,6 +18,20 @@ extern __thread void* de_stack_obj[JUMPMU_STACK_SIZE];
 extern __thread int de_stack_counter;
 extern __thread bool in_jump;
 void jump();
+// Checkpoints and registered destructors of one execution context. A user thread can park inside a
+// jumpmuTry and resume on another OS thread, so it carries them along (threads/UT.cpp).
+struct Context {
+   int checkpoint_counter = 0;
+   jmp_buf env[JUMPMU_STACK_SIZE];
+   int checkpoint_stacks_counter[JUMPMU_STACK_SIZE];
+   void (*de_stack_arr[JUMPMU_STACK_SIZE])(void*);
+   void* de_stack_obj[JUMPMU_STACK_SIZE];
+   int de_stack_counter = 0;
+   // Moves the state of the calling thread in here and leaves the thread without checkpoints
+   void save();
+   // Installs the saved state on the calling thread, which has no checkpoints of its own
+   void restore();
+};
 // MyNote: uses de_stack_obj and de_stack_arr
 inline void clearLastDestructor()
 {
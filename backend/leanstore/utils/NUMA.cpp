@@ -0,0 +1,99 @@
+#include "NUMA.hpp"
+// -------------------------------------------------------------------------------------
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace utils
+{
+namespace numa
+{
+namespace
+{
+// "0-3,8-11" to {0, 1, 2, 3, 8, 9, 10, 11}
+std::vector<u64> parseList(const std::string& list)
+{
+   std::vector<u64> ids;
+   std::stringstream ranges(list);
+   std::string range;
+   while (std::getline(ranges, range, ',')) {
+      if (range.empty() || range == "\n") {
+         continue;
+      }
+      const auto dash = range.find('-');
+      const u64 first = std::stoull(range.substr(0, dash));
+      const u64 last = dash == std::string::npos ? first : std::stoull(range.substr(dash + 1));
+      for (u64 id = first; id <= last; id++) {
+         ids.push_back(id);
+      }
+   }
+   return ids;
+}
+// -------------------------------------------------------------------------------------
+std::vector<u64> readList(const std::string& path)
+{
+   std::ifstream file(path);
+   std::string list;
+   if (!file || !std::getline(file, list)) {
+      return {};
+   }
+   return parseList(list);
+}
+}  // namespace
+// -------------------------------------------------------------------------------------
+u64 machineNodes()
+{
+   const auto nodes = readList("/sys/devices/system/node/has_memory");
+   return nodes.empty() ? 1 : nodes.back() + 1;
+}
+// -------------------------------------------------------------------------------------
+std::vector<u64> cpusOfNode(u64 node)
+{
+   auto cpus = readList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+   if (cpus.empty() && machineNodes() == 1) {
+      for (u64 cpu = 0; cpu < std::thread::hardware_concurrency(); cpu++) {
+         cpus.push_back(cpu);
+      }
+   }
+   return cpus;
+}
+// -------------------------------------------------------------------------------------
+u64 nodeOfCPU(u64 cpu)
+{
+   const u64 nodes = machineNodes();
+   for (u64 node = 0; node < nodes; node++) {
+      for (u64 node_cpu : cpusOfNode(node)) {
+         if (node_cpu == cpu) {
+            return node;
+         }
+      }
+   }
+   return 0;
+}
+// -------------------------------------------------------------------------------------
+bool bindMemory(void* addr, u64 bytes, u64 node)
+{
+   const u64 page_size = sysconf(_SC_PAGESIZE);
+   const u64 begin = (reinterpret_cast<u64>(addr) + page_size - 1) & ~(page_size - 1);
+   const u64 end = (reinterpret_cast<u64>(addr) + bytes) & ~(page_size - 1);
+   if (end <= begin) {
+      return true;
+   }
+   unsigned long node_mask[16] = {0};
+   if (node >= sizeof(node_mask) * 8) {
+      return false;
+   }
+   node_mask[node / 64] |= 1ul << (node % 64);
+   return syscall(SYS_mbind, begin, end - begin, MPOL_BIND, node_mask, sizeof(node_mask) * 8, 0) == 0;
+}
+// -------------------------------------------------------------------------------------
+}  // namespace numa
+}  // namespace utils
+}  // namespace leanstore
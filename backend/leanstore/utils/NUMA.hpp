@@ -0,0 +1,24 @@
+#pragma once
+#include "Units.hpp"
+// -------------------------------------------------------------------------------------
+#include <vector>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace utils
+{
+namespace numa
+{
+// -------------------------------------------------------------------------------------
+// Topology from sysfs, without libnuma. A machine without /sys/devices/system/node is one node
+// holding every CPU.
+u64 machineNodes();
+std::vector<u64> cpusOfNode(u64 node);
+u64 nodeOfCPU(u64 cpu);
+// Binds the pages of [addr, addr + bytes) that are not touched yet to node (mbind), false if the
+// kernel refuses
+bool bindMemory(void* addr, u64 bytes, u64 node);
+// -------------------------------------------------------------------------------------
+}  // namespace numa
+}  // namespace utils
+}  // namespace leanstore
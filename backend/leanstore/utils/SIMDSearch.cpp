@@ -0,0 +1,296 @@
+#include "SIMDSearch.hpp"
+// -------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cstring>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace utils
+{
+namespace simd
+{
+namespace
+{
+// -------------------------------------------------------------------------------------
+// Number of elements in data[0, n) that come before key, i.e. < key (<= key for UPPER).
+// data is sorted, so this is the offset of the lower (upper) bound.
+template <bool UPPER, typename T>
+size_t countBeforeScalar(const T* data, size_t n, T key)
+{
+   return (UPPER ? std::upper_bound(data, data + n, key) : std::lower_bound(data, data + n, key)) - data;
+}
+#if defined(__x86_64__)
+// AVX2 only compares signed integers, flipping the sign bit maps the unsigned order onto it
+template <bool UPPER>
+__attribute__((target("avx2"))) size_t countBeforeAVX2(const u32* data, size_t n, u32 key)
+{
+   const __m256i flip = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+   const __m256i needle = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(key)), flip);
+   size_t count = 0, i = 0;
+   for (; i + 8 <= n; i += 8) {
+      const __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), flip);
+      if (UPPER) {
+         count += 8 - __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, needle))));
+      } else {
+         count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, v))));
+      }
+   }
+   for (; i < n; i++) {
+      count += UPPER ? data[i] <= key : data[i] < key;
+   }
+   return count;
+}
+template <bool UPPER>
+__attribute__((target("avx2"))) size_t countBeforeAVX2(const u64* data, size_t n, u64 key)
+{
+   const __m256i flip = _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ull));
+   const __m256i needle = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<long long>(key)), flip);
+   size_t count = 0, i = 0;
+   for (; i + 4 <= n; i += 4) {
+      const __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), flip);
+      if (UPPER) {
+         count += 4 - __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, needle))));
+      } else {
+         count += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(needle, v))));
+      }
+   }
+   for (; i < n; i++) {
+      count += UPPER ? data[i] <= key : data[i] < key;
+   }
+   return count;
+}
+// -------------------------------------------------------------------------------------
+// The tail is handled with a masked load, lanes past n never match
+template <bool UPPER>
+__attribute__((target("avx512f"))) size_t countBeforeAVX512(const u32* data, size_t n, u32 key)
+{
+   const __m512i needle = _mm512_set1_epi32(static_cast<int>(key));
+   size_t count = 0, i = 0;
+   for (; i + 16 <= n; i += 16) {
+      const __m512i v = _mm512_loadu_si512(data + i);
+      count += __builtin_popcount(UPPER ? _mm512_cmple_epu32_mask(v, needle) : _mm512_cmplt_epu32_mask(v, needle));
+   }
+   if (i < n) {
+      const __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+      const __m512i v = _mm512_maskz_loadu_epi32(tail, data + i);
+      count += __builtin_popcount(UPPER ? _mm512_mask_cmple_epu32_mask(tail, v, needle) : _mm512_mask_cmplt_epu32_mask(tail, v, needle));
+   }
+   return count;
+}
+template <bool UPPER>
+__attribute__((target("avx512f"))) size_t countBeforeAVX512(const u64* data, size_t n, u64 key)
+{
+   const __m512i needle = _mm512_set1_epi64(static_cast<long long>(key));
+   size_t count = 0, i = 0;
+   for (; i + 8 <= n; i += 8) {
+      const __m512i v = _mm512_loadu_si512(data + i);
+      count += __builtin_popcount(UPPER ? _mm512_cmple_epu64_mask(v, needle) : _mm512_cmplt_epu64_mask(v, needle));
+   }
+   if (i < n) {
+      const __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+      const __m512i v = _mm512_maskz_loadu_epi64(tail, data + i);
+      count += __builtin_popcount(UPPER ? _mm512_mask_cmple_epu64_mask(tail, v, needle) : _mm512_mask_cmplt_epu64_mask(tail, v, needle));
+   }
+   return count;
+}
+// -------------------------------------------------------------------------------------
+// Strided values are gathered (scale 1, so any stride works), lanes past n are masked off and not read
+__attribute__((target("avx2"))) size_t countLessStridedAVX2(const u8* first, size_t stride, size_t n, u32 key)
+{
+   const __m256i flip = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+   const __m256i needle = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(key)), flip);
+   const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+   const __m256i offsets = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(static_cast<int>(stride)));
+   size_t count = 0;
+   for (size_t i = 0; i < n; i += 8, first += 8 * stride) {
+      const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(n - i)), lanes);
+      const __m256i v = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), reinterpret_cast<const int*>(first), offsets, mask, 1);
+      const __m256i less = _mm256_and_si256(mask, _mm256_cmpgt_epi32(needle, _mm256_xor_si256(v, flip)));
+      count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(less)));
+   }
+   return count;
+}
+__attribute__((target("avx512f"))) size_t countLessStridedAVX512(const u8* first, size_t stride, size_t n, u32 key)
+{
+   const __m512i needle = _mm512_set1_epi32(static_cast<int>(key));
+   const __m512i offsets = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                              _mm512_set1_epi32(static_cast<int>(stride)));
+   size_t count = 0;
+   for (size_t i = 0; i < n; i += 16, first += 16 * stride) {
+      const __mmask16 mask = (n - i >= 16) ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+      const __m512i v = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), mask, offsets, first, 1);
+      count += __builtin_popcount(_mm512_mask_cmplt_epu32_mask(mask, v, needle));
+   }
+   return count;
+}
+#endif
+size_t countLessStridedScalar(const u8* first, size_t stride, size_t n, u32 key)
+{
+   size_t count = 0;
+   for (size_t i = 0; i < n; i++) {
+      u32 value;
+      std::memcpy(&value, first + i * stride, sizeof(value));
+      count += value < key;
+   }
+   return count;
+}
+template <ISA isa>
+size_t countStrided(const u8* first, size_t stride, size_t n, u32 key)
+{
+#if defined(__x86_64__)
+   if constexpr (isa == ISA::AVX512) {
+      return countLessStridedAVX512(first, stride, n, key);
+   } else if constexpr (isa == ISA::AVX2) {
+      return countLessStridedAVX2(first, stride, n, key);
+   }
+#endif
+   return countLessStridedScalar(first, stride, n, key);
+}
+// -------------------------------------------------------------------------------------
+template <typename T, ISA isa, bool UPPER>
+size_t search(const T* data, size_t begin, size_t end, T key)
+{
+   if constexpr (isa == ISA::SCALAR) {
+      return begin + countBeforeScalar<UPPER>(data + begin, end - begin, key);
+   } else {
+      // Binary search until four registers are left, counting them beats the branch misses
+      constexpr size_t linear = 4 * ((isa == ISA::AVX512) ? 64 : 32) / sizeof(T);
+      while (end - begin > linear) {
+         const size_t mid = begin + (end - begin) / 2;
+         if (UPPER ? data[mid] <= key : data[mid] < key) {
+            begin = mid + 1;
+         } else {
+            end = mid;
+         }
+      }
+#if defined(__x86_64__)
+      if constexpr (isa == ISA::AVX512) {
+         return begin + countBeforeAVX512<UPPER>(data + begin, end - begin, key);
+      } else {
+         return begin + countBeforeAVX2<UPPER>(data + begin, end - begin, key);
+      }
+#else
+      return begin + countBeforeScalar<UPPER>(data + begin, end - begin, key);
+#endif
+   }
+}
+// -------------------------------------------------------------------------------------
+struct Kernels {
+   ISA isa;
+   size_t (*lower_32)(const u32*, size_t, size_t, u32);
+   size_t (*lower_64)(const u64*, size_t, size_t, u64);
+   size_t (*upper_32)(const u32*, size_t, size_t, u32);
+   size_t (*upper_64)(const u64*, size_t, size_t, u64);
+   size_t (*less_strided_32)(const u8*, size_t, size_t, u32);
+};
+template <ISA isa>
+constexpr Kernels kernelsFor()
+{
+   return {isa, &search<u32, isa, false>, &search<u64, isa, false>, &search<u32, isa, true>, &search<u64, isa, true>, &countStrided<isa>};
+}
+Kernels selectKernels(ISA isa)
+{
+   switch (isa) {
+      case ISA::AVX512:
+         return kernelsFor<ISA::AVX512>();
+      case ISA::AVX2:
+         return kernelsFor<ISA::AVX2>();
+      default:
+         return kernelsFor<ISA::SCALAR>();
+   }
+}
+// Starts out scalar, so calls during static initialization are safe
+Kernels kernels = kernelsFor<ISA::SCALAR>();
+[[maybe_unused]] const bool kernels_selected = (kernels = selectKernels(detectISA()), true);
+}  // namespace
+// -------------------------------------------------------------------------------------
+ISA detectISA()
+{
+#if defined(__x86_64__)
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx512f")) {
+      return ISA::AVX512;
+   }
+   if (__builtin_cpu_supports("avx2")) {
+      return ISA::AVX2;
+   }
+#endif
+   return ISA::SCALAR;
+}
+ISA activeISA()
+{
+   return kernels.isa;
+}
+ISA forceISA(ISA isa)
+{
+   kernels = selectKernels(std::min(isa, detectISA()));
+   return kernels.isa;
+}
+const char* isaName(ISA isa)
+{
+   switch (isa) {
+      case ISA::AVX512:
+         return "avx512";
+      case ISA::AVX2:
+         return "avx2";
+      default:
+         return "scalar";
+   }
+}
+// -------------------------------------------------------------------------------------
+template <typename T, ISA isa>
+size_t lowerBound(const T* data, size_t begin, size_t end, T key)
+{
+   return search<T, isa, false>(data, begin, end, key);
+}
+template <typename T, ISA isa>
+size_t upperBound(const T* data, size_t begin, size_t end, T key)
+{
+   return search<T, isa, true>(data, begin, end, key);
+}
+#define INSTANTIATE(T, isa)                                          \
+   template size_t lowerBound<T, isa>(const T*, size_t, size_t, T); \
+   template size_t upperBound<T, isa>(const T*, size_t, size_t, T);
+INSTANTIATE(u32, ISA::SCALAR)
+INSTANTIATE(u32, ISA::AVX2)
+INSTANTIATE(u32, ISA::AVX512)
+INSTANTIATE(u64, ISA::SCALAR)
+INSTANTIATE(u64, ISA::AVX2)
+INSTANTIATE(u64, ISA::AVX512)
+#undef INSTANTIATE
+template <ISA isa>
+size_t countLessStrided(const u8* first, size_t stride, size_t n, u32 key)
+{
+   return countStrided<isa>(first, stride, n, key);
+}
+template size_t countLessStrided<ISA::SCALAR>(const u8*, size_t, size_t, u32);
+template size_t countLessStrided<ISA::AVX2>(const u8*, size_t, size_t, u32);
+template size_t countLessStrided<ISA::AVX512>(const u8*, size_t, size_t, u32);
+// -------------------------------------------------------------------------------------
+size_t lowerBound(const u32* data, size_t begin, size_t end, u32 key)
+{
+   return kernels.lower_32(data, begin, end, key);
+}
+size_t lowerBound(const u64* data, size_t begin, size_t end, u64 key)
+{
+   return kernels.lower_64(data, begin, end, key);
+}
+size_t upperBound(const u32* data, size_t begin, size_t end, u32 key)
+{
+   return kernels.upper_32(data, begin, end, key);
+}
+size_t upperBound(const u64* data, size_t begin, size_t end, u64 key)
+{
+   return kernels.upper_64(data, begin, end, key);
+}
+size_t countLessStrided(const u8* first, size_t stride, size_t n, u32 key)
+{
+   return kernels.less_strided_32(first, stride, n, key);
+}
+// -------------------------------------------------------------------------------------
+}  // namespace simd
+}  // namespace utils
+}  // namespace leanstore
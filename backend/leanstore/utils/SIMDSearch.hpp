@@ -0,0 +1,71 @@
+#pragma once
+#include "Units.hpp"
+// -------------------------------------------------------------------------------------
+#include <algorithm>
+#include <vector>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace utils
+{
+namespace simd
+{
+// -------------------------------------------------------------------------------------
+enum class ISA : u8 { SCALAR = 0, AVX2 = 1, AVX512 = 2 };
+// Best kernel the CPU supports (CPUID)
+ISA detectISA();
+ISA activeISA();
+// Pins the kernels to `isa` (at most the detected one), for benchmarks and tests. Not thread safe.
+ISA forceISA(ISA isa);
+const char* isaName(ISA isa);
+// -------------------------------------------------------------------------------------
+// Index of the first element >= key in the sorted range data[begin, end), end if there is none.
+// Narrows the range with a scalar binary search down to a few registers, then counts the
+// smaller elements branch free with the widest vectors available.
+template <typename T, ISA isa>
+size_t lowerBound(const T* data, size_t begin, size_t end, T key);
+size_t lowerBound(const u32* data, size_t begin, size_t end, u32 key);
+size_t lowerBound(const u64* data, size_t begin, size_t end, u64 key);
+// Index of the first element > key
+template <typename T, ISA isa>
+size_t upperBound(const T* data, size_t begin, size_t end, T key);
+size_t upperBound(const u32* data, size_t begin, size_t end, u32 key);
+size_t upperBound(const u64* data, size_t begin, size_t end, u64 key);
+// Number of the n u32 values stride bytes apart, starting at first, that are < key. Counted
+// branch free with gathers, for fields of packed structs (the slot heads of a BTreeNode).
+template <ISA isa>
+size_t countLessStrided(const u8* first, size_t stride, size_t n, u32 key);
+size_t countLessStrided(const u8* first, size_t stride, size_t n, u32 key);
+// -------------------------------------------------------------------------------------
+// Last mile search of a learned index: the position of key is expected within max_error of
+// estimate. Only keys that are in the array are bounded by the model, so the window is
+// moved until its borders enclose the answer. The result is exact in any case.
+// keys is any contiguous array: a vector or a utils::ArrayView.
+template <typename T, bool UPPER = false, typename Keys = std::vector<T>>
+size_t searchAround(const Keys& keys, const double estimate, const size_t max_error, const T key)
+{
+   const size_t size = keys.size();
+   if (size == 0) {
+      return 0;
+   }
+   auto before = [&](const T k) { return UPPER ? k <= key : k < key; };
+   const size_t pos = (estimate <= 0) ? 0 : std::min<size_t>(estimate, size - 1);
+   size_t begin = (pos > max_error + 1) ? pos - max_error - 1 : 0;
+   size_t end = std::min<size_t>(size, pos + max_error + 2);
+   size_t step = end - begin;
+   while (begin > 0 && !before(keys[begin - 1])) {
+      end = begin;
+      begin = (begin > step) ? begin - step : 0;
+      step *= 2;
+   }
+   while (end < size && before(keys[end - 1])) {
+      begin = end;
+      end = std::min<size_t>(size, end + step);
+      step *= 2;
+   }
+   return UPPER ? upperBound(keys.data(), begin, end, key) : lowerBound(keys.data(), begin, end, key);
+}
+// -------------------------------------------------------------------------------------
+}  // namespace simd
+}  // namespace utils
+}  // namespace leanstore
@@ -0,0 +1,99 @@
+// Microbenchmark of the I/O engines. Keeps a fixed number of random 4 KiB O_DIRECT reads or writes in flight on
+// one file and reports IOPS and the CPU time the submitting thread spends per I/O, for every engine given.
+#include "Exceptions.hpp"
+#include "Units.hpp"
+#include "leanstore/Config.hpp"
+#include "leanstore/io/IOEngine.hpp"
+// -------------------------------------------------------------------------------------
+#include <gflags/gflags.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+// -------------------------------------------------------------------------------------
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+// -------------------------------------------------------------------------------------
+DEFINE_string(io_file, "./io_engine.img", "file the benchmark reads and writes, created when missing");
+DEFINE_uint64(io_file_gib, 4, "size of the file");
+DEFINE_uint64(io_depth, 64, "I/Os kept in flight");
+DEFINE_uint64(io_seconds, 5, "duration of every run");
+DEFINE_string(io_engines, "libaio,io_uring", "comma separated engines to compare");
+DEFINE_bool(io_fixed_buffers, true, "let the engines register the I/O buffers");
+// -------------------------------------------------------------------------------------
+using namespace leanstore;
+static constexpr u64 IO_SIZE = 4096;
+// -------------------------------------------------------------------------------------
+static double threadCPUSeconds()
+{
+   struct rusage usage;
+   posix_check(getrusage(RUSAGE_THREAD, &usage) == 0);
+   return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+// -------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+   gflags::SetUsageMessage("I/O engine microbenchmark");
+   gflags::ParseCommandLineFlags(&argc, &argv, true);
+   // -------------------------------------------------------------------------------------
+   const int fd = open(FLAGS_io_file.c_str(), O_RDWR | O_DIRECT | O_CREAT, 0600);
+   posix_check(fd > -1);
+   const u64 file_bytes = FLAGS_io_file_gib * 1024 * 1024 * 1024;
+   const u64 file_pages = file_bytes / IO_SIZE;
+   posix_check(fallocate(fd, 0, 0, file_bytes) == 0);
+   u8* buffers = static_cast<u8*>(aligned_alloc(IO_SIZE, IO_SIZE * FLAGS_io_depth));
+   memset(buffers, 0xaa, IO_SIZE * FLAGS_io_depth);
+   std::vector<io::IOEngine::Completion> completions(FLAGS_io_depth);
+   // -------------------------------------------------------------------------------------
+   auto run = [&](const std::string& engine_name, bool writes) {
+      auto engine = io::IOEngine::create(engine_name, fd, FLAGS_io_depth, FLAGS_io_fixed_buffers ? buffers : nullptr,
+                                         FLAGS_io_fixed_buffers ? IO_SIZE * FLAGS_io_depth : 0);
+      std::mt19937_64 gen(42);
+      auto issue = [&](u64 slot) {
+         u8* buffer = buffers + slot * IO_SIZE;
+         const u64 offset = (gen() % file_pages) * IO_SIZE;
+         if (writes) {
+            engine->prepWrite(buffer, IO_SIZE, offset, reinterpret_cast<void*>(slot));
+         } else {
+            engine->prepRead(buffer, IO_SIZE, offset, reinterpret_cast<void*>(slot));
+         }
+      };
+      for (u64 slot = 0; slot < FLAGS_io_depth; slot++) {
+         issue(slot);
+      }
+      engine->submit();
+      u64 done = 0;
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(FLAGS_io_seconds);
+      const auto begin = std::chrono::steady_clock::now();
+      const double cpu_begin = threadCPUSeconds();
+      while (std::chrono::steady_clock::now() < deadline) {
+         const u64 reaped = engine->reap(completions.data(), 1, FLAGS_io_depth);
+         for (u64 c_i = 0; c_i < reaped; c_i++) {
+            ensure(completions[c_i].result == s64(IO_SIZE));
+            issue(reinterpret_cast<u64>(completions[c_i].user_data));
+         }
+         engine->submit();
+         done += reaped;
+      }
+      const double cpu_seconds = threadCPUSeconds() - cpu_begin;
+      const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+      while (engine->inFlight()) {
+         engine->reap(completions.data(), 1, FLAGS_io_depth);
+      }
+      printf("engine: %-10s op: %-6s depth: %4lu %10.0f IOPS %8.2f us cpu/io\n", engine_name.c_str(), writes ? "write" : "read", FLAGS_io_depth,
+             done / seconds, cpu_seconds * 1e6 / std::max<u64>(done, 1));
+   };
+   std::stringstream engines(FLAGS_io_engines);
+   std::string engine_name;
+   while (std::getline(engines, engine_name, ',')) {
+      run(engine_name, false);
+      run(engine_name, true);
+   }
+   // -------------------------------------------------------------------------------------
+   free(buffers);
+   close(fd);
+   return 0;
+}
@@ -0,0 +1,87 @@
+// Microbenchmark of the search inside a leaf. Fills one leaf with folded integer keys, trains the per-leaf
+// learnedindex on them and compares cycles per lookup of the full lowerBound, the exponential search from the
+// predicted slot and the head counting modelSearch around it, for every ISA the CPU has.
+#include "Units.hpp"
+#include "leanstore/compileConst.hpp"
+#include "leanstore/fold.hpp"
+#include "leanstore/lr/learnedIndex.hpp"
+#include "leanstore/storage/btree/core/BTreeNode.hpp"
+#include "leanstore/utils/SIMDSearch.hpp"
+// -------------------------------------------------------------------------------------
+#include <gflags/gflags.h>
+#include <x86intrin.h>
+// -------------------------------------------------------------------------------------
+#include <functional>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+// -------------------------------------------------------------------------------------
+DEFINE_uint64(leaf_lookups, 10000000, "lookups per search");
+DEFINE_uint64(leaf_payload_size, 8, "payload bytes of every key, the smaller the more keys per leaf");
+DEFINE_uint64(leaf_key_gap, 100, "keys are drawn uniformly from [0, gap * leaf capacity)");
+// -------------------------------------------------------------------------------------
+using namespace leanstore;
+using namespace leanstore::storage::btree;
+using namespace leanstore::utils;
+// -------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+   gflags::SetUsageMessage("Leaf search microbenchmark");
+   gflags::ParseCommandLineFlags(&argc, &argv, true);
+   // -------------------------------------------------------------------------------------
+   alignas(64) static u8 page[EFFECTIVE_PAGE_SIZE];
+   auto& node = *new (page) BTreeNode(true);
+   std::vector<u8> payload(FLAGS_leaf_payload_size, 0);
+   const u64 capacity = EFFECTIVE_PAGE_SIZE / BTreeNode::spaceNeeded(sizeof(KEY), payload.size(), 0);
+   std::mt19937_64 gen(42);
+   std::set<KEY> unique;
+   while (node.canInsert(sizeof(KEY), payload.size())) {
+      const KEY key = gen() % (FLAGS_leaf_key_gap * capacity);
+      if (!unique.insert(key).second) {
+         continue;
+      }
+      u8 key_bytes[sizeof(KEY)];
+      fold(key_bytes, key);
+      node.insert(key_bytes, sizeof(KEY), payload.data(), payload.size());
+   }
+   std::vector<KEY> keys(unique.begin(), unique.end());
+   learnedindex<KEY> model;
+   model.train(keys);
+   // Half hits, half misses in between
+   std::vector<KEY> lookups(FLAGS_leaf_lookups);
+   std::vector<std::array<u8, sizeof(KEY)>> lookup_bytes(lookups.size());
+   std::vector<size_t> predicted(lookups.size());
+   for (u64 l_i = 0; l_i < lookups.size(); l_i++) {
+      lookups[l_i] = keys[gen() % keys.size()] + (l_i % 2);
+      fold(lookup_bytes[l_i].data(), lookups[l_i]);
+      predicted[l_i] = std::min<size_t>(model.predict(lookups[l_i]), node.count - 1);
+   }
+   std::cout << "detected isa: " << simd::isaName(simd::detectISA()) << " keys in leaf: " << node.count << " model error: " << model.get_error()
+             << std::endl;
+   // -------------------------------------------------------------------------------------
+   auto run = [&](const std::string& name, std::function<s16(u64)> search) {
+      u64 checksum = 0, wrong = 0;
+      const u64 begin = __rdtsc();
+      for (u64 l_i = 0; l_i < lookups.size(); l_i++) {
+         checksum += search(l_i);
+      }
+      const u64 cycles = __rdtsc() - begin;
+      for (u64 l_i = 0; l_i < lookups.size(); l_i += 97) {
+         wrong += search(l_i) != node.lowerBound<false>(lookup_bytes[l_i].data(), sizeof(KEY));
+      }
+      printf("search: %-20s %8.2f cycles/lookup wrong: %lu checksum: %lu\n", name.c_str(), cycles * 1.0 / lookups.size(), wrong, checksum);
+   };
+   run("lowerBound", [&](u64 l_i) { return node.lowerBound<false>(lookup_bytes[l_i].data(), sizeof(KEY)); });
+   // Stops at the last slot for keys above it, hence not exact there
+   run("exponential", [&](u64 l_i) { return node.exponentialSearch<false>(lookup_bytes[l_i].data(), sizeof(KEY), predicted[l_i]); });
+   for (auto isa : {simd::ISA::SCALAR, simd::ISA::AVX2, simd::ISA::AVX512}) {
+      if (simd::forceISA(isa) != isa) {
+         continue;
+      }
+      run(std::string("model/") + simd::isaName(isa),
+          [&](u64 l_i) { return node.modelSearch<false>(lookup_bytes[l_i].data(), sizeof(KEY), predicted[l_i], model.get_error()); });
+   }
+   simd::forceISA(simd::detectISA());
+   return 0;
+}
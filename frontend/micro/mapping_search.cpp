@@ -0,0 +1,110 @@
+// Microbenchmark of the last mile search over the secondary mapping.
+// Builds the root spline over random separators and compares the search kernels for a range of max_error values,
+// then the separate mapping vectors against the blocked layout when the leaf is resolved as well.
+#include "Units.hpp"
+#include "leanstore/compileConst.hpp"
+#include "leanstore/rs/radix_spline.h"
+#include "leanstore/storage/btree/core/BlockedMapping.hpp"
+#include "leanstore/utils/SIMDSearch.hpp"
+// -------------------------------------------------------------------------------------
+#include <gflags/gflags.h>
+// -------------------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <vector>
+// -------------------------------------------------------------------------------------
+DEFINE_uint64(mapping_keys, 1000000, "number of leaf separators in the mapping");
+DEFINE_uint64(lookups, 10000000, "lookups per kernel and max_error");
+DEFINE_string(max_errors, "4,8,16,32,64,128,256", "");
+// -------------------------------------------------------------------------------------
+using namespace leanstore;
+using namespace leanstore::utils;
+// -------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+   gflags::SetUsageMessage("Mapping search microbenchmark");
+   gflags::ParseCommandLineFlags(&argc, &argv, true);
+   // -------------------------------------------------------------------------------------
+   std::mt19937_64 gen(42);
+   std::uniform_int_distribution<MODEL_KEY> key_dist(0, std::numeric_limits<MODEL_KEY>::max());
+   std::set<MODEL_KEY> unique;
+   while (unique.size() < FLAGS_mapping_keys) {
+      unique.insert(key_dist(gen));
+   }
+   std::vector<MODEL_KEY> keys(unique.begin(), unique.end());
+   std::vector<MODEL_KEY> lookups(FLAGS_lookups);
+   std::uniform_int_distribution<MODEL_KEY> lookup_dist(keys.front(), keys.back() - 1);
+   for (auto& key : lookups) {
+      key = lookup_dist(gen);
+   }
+   std::vector<size_t> max_errors;
+   std::stringstream ss(FLAGS_max_errors);
+   for (std::string token; std::getline(ss, token, ',');) {
+      max_errors.push_back(std::stoul(token));
+   }
+   std::cout << "detected isa: " << simd::isaName(simd::detectISA()) << " mapping keys: " << keys.size() << std::endl;
+   // -------------------------------------------------------------------------------------
+   for (auto max_error : max_errors) {
+      spline::Builder<MODEL_KEY> builder(max_error);
+      for (auto key : keys) {
+         builder.AddKey(key);
+      }
+      auto rs = spline::RadixSpline<MODEL_KEY>(max_error, keys.size() + 1, builder.Finalize());
+      std::vector<double> estimates(lookups.size());
+      std::vector<size_t> segments(lookups.size());
+      for (u64 l_i = 0; l_i < lookups.size(); l_i++) {
+         segments[l_i] = rs.GetSplineSegment(lookups[l_i]);
+         estimates[l_i] = rs.GetEstimatedPosition(lookups[l_i], segments[l_i]);
+      }
+      // -------------------------------------------------------------------------------------
+      auto run = [&](const std::string& name, std::function<size_t(u64)> search) {
+         u64 checksum = 0, wrong = 0;
+         auto begin = std::chrono::high_resolution_clock::now();
+         for (u64 l_i = 0; l_i < lookups.size(); l_i++) {
+            checksum += search(l_i);
+         }
+         auto end = std::chrono::high_resolution_clock::now();
+         for (u64 l_i = 0; l_i < lookups.size(); l_i += 97) {
+            wrong += search(l_i) != static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), lookups[l_i]) - keys.begin());
+         }
+         const double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() * 1.0 / lookups.size();
+         printf("max_error: %4lu kernel: %-12s %8.2f ns/lookup wrong: %lu checksum: %lu\n", max_error, name.c_str(), ns, wrong, checksum);
+      };
+      run("exponential", [&](u64 l_i) { return rs.GetEstimatedPosition(lookups[l_i], segments[l_i], keys); });
+      run("std", [&](u64 l_i) {
+         auto bound = rs.GetSearchBound(estimates[l_i]);
+         return static_cast<size_t>(std::lower_bound(keys.begin() + bound.begin, keys.begin() + std::min(bound.end + 2, keys.size()), lookups[l_i]) -
+                                    keys.begin());
+      });
+      for (auto isa : {simd::ISA::SCALAR, simd::ISA::AVX2, simd::ISA::AVX512}) {
+         if (simd::forceISA(isa) != isa) {
+            continue;
+         }
+         run(simd::isaName(isa), [&](u64 l_i) { return simd::searchAround(keys, estimates[l_i], max_error, lookups[l_i]); });
+      }
+      simd::forceISA(simd::detectISA());
+      // -------------------------------------------------------------------------------------
+      std::vector<PID> pids(keys.size() + 1);
+      std::vector<storage::BufferFrame*> bfs(keys.size() + 1, nullptr);
+      for (u64 p_i = 0; p_i < pids.size(); p_i++) {
+         pids[p_i] = p_i;
+      }
+      storage::btree::BlockedMapping blocked;
+      blocked.build(keys, pids, bfs);
+      // pid == position, so the checksum and the check above stay comparable
+      run("vectors+leaf", [&](u64 l_i) {
+         auto idx = simd::searchAround(keys, estimates[l_i], max_error, lookups[l_i]);
+         return static_cast<size_t>(pids[idx] + reinterpret_cast<uintptr_t>(bfs[idx]));
+      });
+      run("blocked+leaf", [&](u64 l_i) {
+         auto& leaf = blocked.leaf(blocked.search(lookups[l_i], estimates[l_i], max_error));
+         return static_cast<size_t>(leaf.pid + reinterpret_cast<uintptr_t>(leaf.bf));
+      });
+   }
+   return 0;
+}
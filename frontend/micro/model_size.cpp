@@ -0,0 +1,75 @@
+// Segment counts and model bytes of the greedy spline against the optimal PLA for the same max_error.
+// Reads SOSD datasets (uint64 payload when the file name ends in uint64, uint32 otherwise) with KeyTrace::FromSOSD
+// and builds both models over the sorted, deduplicated keys, as fast_train sees the mapping. The PLA levels use
+// --pla_recursive_error.
+#include "Units.hpp"
+#include "leanstore/Config.hpp"
+#include "leanstore/pla/pla.hpp"
+#include "leanstore/rs/radix_spline.h"
+// -------------------------------------------------------------------------------------
+#include <gflags/gflags.h>
+// -------------------------------------------------------------------------------------
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+// test_util.h relies on <iostream> being included before it
+#include "../ycsb/test_util.h"
+// -------------------------------------------------------------------------------------
+DEFINE_string(datasets, "", "comma separated SOSD files");
+DEFINE_string(max_errors, "4,8,16,32,64,128,256", "");
+// -------------------------------------------------------------------------------------
+using namespace util;
+// -------------------------------------------------------------------------------------
+template <typename Key>
+static void report(const std::string& dataset, const std::vector<size_t>& max_errors)
+{
+   KeyTrace<Key> trace;
+   trace.FromSOSD(dataset);
+   trace.RemoveDuplicates();
+   const auto& keys = trace.keys_;
+   std::cout << "dataset: " << dataset << " keys: " << keys.size() << " key bytes: " << sizeof(Key) << std::endl;
+   for (auto max_error : max_errors) {
+      auto begin = std::chrono::high_resolution_clock::now();
+      spline::Builder<Key> builder(max_error);
+      for (auto key : keys) {
+         builder.AddKey(key);
+      }
+      auto rs = spline::RadixSpline<Key>(max_error, keys.size(), builder.Finalize());
+      const double spline_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+      // -------------------------------------------------------------------------------------
+      begin = std::chrono::high_resolution_clock::now();
+      pla::RecursivePLA<Key> pla;
+      pla.Build(keys, max_error, FLAGS_pla_recursive_error);
+      const double pla_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+      // -------------------------------------------------------------------------------------
+      const size_t spline_segments = rs.spline_points_.size() - 1;
+      const size_t spline_bytes = rs.spline_points_.size() * sizeof(spline::Coord<Key>);
+      printf("max_error: %4lu spline: %9lu segments %11lu bytes %8.1f ms pla: %9lu segments %2lu levels %11lu bytes %8.1f ms ratio: %.2f\n",
+             max_error, spline_segments, spline_bytes, spline_ms, pla.GetNumSegments(), pla.GetNumLevels(), pla.GetSize(), pla_ms,
+             static_cast<double>(spline_segments) / std::max<size_t>(1, pla.GetNumSegments()));
+   }
+}
+// -------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+   gflags::SetUsageMessage("Spline vs. PLA model size on SOSD datasets");
+   gflags::ParseCommandLineFlags(&argc, &argv, true);
+   // -------------------------------------------------------------------------------------
+   std::vector<size_t> max_errors;
+   std::stringstream ss(FLAGS_max_errors);
+   for (std::string token; std::getline(ss, token, ',');) {
+      max_errors.push_back(std::stoul(token));
+   }
+   std::stringstream datasets(FLAGS_datasets);
+   for (std::string dataset; std::getline(datasets, dataset, ',');) {
+      const std::string suffix = "uint64";
+      if (dataset.size() >= suffix.size() && dataset.compare(dataset.size() - suffix.size(), suffix.size(), suffix) == 0) {
+         report<u64>(dataset, max_errors);
+      } else {
+         report<u32>(dataset, max_errors);
+      }
+   }
+   return 0;
+}
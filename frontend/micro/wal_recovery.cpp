@@ -0,0 +1,143 @@
+// Recovery time of BTreeLL from the group commit WAL. Three runs of the same binary on the same SSD:
+//   --wal_phase=load     creates the tree with wal_tuples tuples and persists it
+//   --wal_phase=log      recovers it, runs updates and inserts until wal_gib of WAL are on the SSD, waits for their
+//                        commit and dies without persisting, as a crash would
+//   --wal_phase=recover  times the recovery: meta data, redo of the WAL and the learned mapping
+#include "Exceptions.hpp"
+#include "Units.hpp"
+#include "leanstore/BTreeAdapter.hpp"
+#include "leanstore/Config.hpp"
+#include "leanstore/LeanStore.hpp"
+#include "leanstore/utils/RandomGenerator.hpp"
+// -------------------------------------------------------------------------------------
+#include <gflags/gflags.h>
+#include <unistd.h>
+// -------------------------------------------------------------------------------------
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <optional>
+// -------------------------------------------------------------------------------------
+DEFINE_string(wal_phase, "load", "load, log or recover");
+DEFINE_uint64(wal_tuples, 10000000, "tuples the load phase inserts");
+DEFINE_uint64(wal_gib, 10, "WAL the log phase writes before it dies");
+DEFINE_uint32(wal_insert_ratio, 10, "percentage of inserts among the operations of the log phase, the rest updates");
+DEFINE_uint64(wal_tx_ops, 16, "operations per transaction");
+// -------------------------------------------------------------------------------------
+using namespace leanstore;
+static constexpr u64 VALUE_SIZE = 120;
+static constexpr u16 DELTA_SIZE = sizeof(u64);
+// -------------------------------------------------------------------------------------
+// Only the first 8 bytes of a value change: [offset][size][before][after]
+static void deltaBefore(u8* tuple, u8* entry)
+{
+   *reinterpret_cast<u16*>(entry) = 0;
+   *reinterpret_cast<u16*>(entry + sizeof(u16)) = DELTA_SIZE;
+   std::memcpy(entry + 2 * sizeof(u16), tuple, DELTA_SIZE);
+}
+static void deltaAfter(u8* tuple, u8* entry)
+{
+   std::memcpy(entry + 2 * sizeof(u16) + DELTA_SIZE, tuple, DELTA_SIZE);
+}
+// -------------------------------------------------------------------------------------
+// WAL on the SSD, from the chunk every stripe meta points to up to the meta
+static u64 walBytes(cr::CRManager& crm)
+{
+   auto meta = static_cast<cr::SSDMeta*>(aligned_alloc(512, sizeof(cr::SSDMeta)));
+   u64 bytes = 0;
+   for (const auto& stripe : crm.wal_stripes) {
+      posix_check(pread(stripe.fd, meta, sizeof(cr::SSDMeta), stripe.end - sizeof(cr::SSDMeta)) == sizeof(cr::SSDMeta));
+      if (meta->last_written_chunk != 0) {
+         bytes += stripe.end - sizeof(cr::SSDMeta) - meta->last_written_chunk;
+      }
+   }
+   free(meta);
+   return bytes;
+}
+// -------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+   gflags::SetUsageMessage("WAL recovery benchmark");
+   gflags::ParseCommandLineFlags(&argc, &argv, true);
+   // -------------------------------------------------------------------------------------
+   ensure(FLAGS_wal_phase == "load" || FLAGS_wal_phase == "log" || FLAGS_wal_phase == "recover");
+   FLAGS_wal = true;
+   FLAGS_recover = FLAGS_wal_phase != "load";
+   FLAGS_persist = FLAGS_wal_phase != "log";
+   // -------------------------------------------------------------------------------------
+   const auto begin = std::chrono::high_resolution_clock::now();
+   LeanStore db;
+   const double recovery_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+   auto& crm = db.getCRManager();
+   auto& btree = FLAGS_recover ? db.retrieveBTreeLL("wal") : db.registerBTreeLL("wal");
+   if (FLAGS_wal_phase == "recover") {
+      std::cout << "recovery took " << recovery_seconds << " s" << std::endl;
+      return 0;
+   }
+   // -------------------------------------------------------------------------------------
+   if (!FLAGS_recover) {
+      std::atomic<u64> loaded = 0;
+      for (u64 t_i = 0; t_i < FLAGS_worker_threads; t_i++) {
+         crm.scheduleJobAsync(t_i, [&]() {
+            u8 key_bytes[sizeof(u64)];
+            u8 value[VALUE_SIZE];
+            for (u64 k = loaded.fetch_add(FLAGS_wal_tx_ops); k < FLAGS_wal_tuples; k = loaded.fetch_add(FLAGS_wal_tx_ops)) {
+               cr::Worker::my().startTX();
+               for (u64 key = k; key < std::min<u64>(k + FLAGS_wal_tx_ops, FLAGS_wal_tuples); key++) {
+                  utils::RandomGenerator::getRandString(value, VALUE_SIZE);
+                  btree.insert(key_bytes, fold(key_bytes, key), value, VALUE_SIZE);
+               }
+               cr::Worker::my().commitTX();
+            }
+         });
+      }
+      crm.joinAll();
+      std::cout << "loaded " << FLAGS_wal_tuples << " tuples" << std::endl;
+      return 0;
+   }
+   // -------------------------------------------------------------------------------------
+   // Log: new keys are appended behind the loaded ones
+   std::atomic<u64> next_key = FLAGS_wal_tuples;
+   const u64 target_bytes = FLAGS_wal_gib * 1024 * 1024 * 1024;
+   std::atomic<bool> keep_running = true;
+   std::atomic<u64> ops = 0;
+   std::vector<std::optional<cr::Transaction>> last_tx(FLAGS_worker_threads);
+   for (u64 t_i = 0; t_i < FLAGS_worker_threads; t_i++) {
+      crm.scheduleJobAsync(t_i, [&, t_i]() {
+         u8 key_bytes[sizeof(u64)];
+         u8 value[VALUE_SIZE];
+         const storage::btree::WALUpdateGenerator delta{deltaBefore, deltaAfter, 2 * sizeof(u16) + 2 * DELTA_SIZE};
+         while (keep_running) {
+            cr::Worker::my().startTX();
+            for (u64 o_i = 0; o_i < FLAGS_wal_tx_ops; o_i++) {
+               if (utils::RandomGenerator::getRandU64(0, 100) < FLAGS_wal_insert_ratio) {
+                  utils::RandomGenerator::getRandString(value, VALUE_SIZE);
+                  btree.insert(key_bytes, fold(key_bytes, next_key++), value, VALUE_SIZE);
+               } else {
+                  const u64 key = utils::RandomGenerator::getRandU64(0, FLAGS_wal_tuples);
+                  btree.updateSameSize(
+                      key_bytes, fold(key_bytes, key), [](u8* payload, u16) { (*reinterpret_cast<u64*>(payload))++; }, delta);
+               }
+            }
+            cr::Worker::my().commitTX();
+            last_tx[t_i] = cr::Worker::my().active_tx;
+            ops += FLAGS_wal_tx_ops;
+         }
+      });
+   }
+   u64 bytes = 0;
+   while ((bytes = walBytes(crm)) < target_bytes) {
+      sleep(1);
+      std::cout << "\rWAL: " << bytes / 1024 / 1024 << " MiB, " << ops << " operations" << std::flush;
+   }
+   keep_running = false;
+   crm.joinAll();
+   for (u64 t_i = 0; t_i < FLAGS_worker_threads; t_i++) {
+      while (last_tx[t_i] && !crm.workers[t_i]->isCommitted(*last_tx[t_i])) {
+         usleep(1000);
+      }
+   }
+   std::cout << std::endl << "WAL: " << walBytes(crm) / 1024 / 1024 << " MiB, " << ops << " operations committed, crashing" << std::endl;
+   _exit(0);
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <leanstore/storage/buffer-manager/BufferInfoMap.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using leanstore::storage::BufferFrame;
+using leanstore::storage::BufferInfoMap;
+
+static BufferFrame* frame(u64 i)
+{
+   return reinterpret_cast<BufferFrame*>(i * 64);
+}
+
+TEST(BufferInfoMapTest, UntrackedIsEmpty)
+{
+   BufferInfoMap map(1 << 20);
+   EXPECT_EQ(map.size(), 1u << 20);
+   EXPECT_EQ(map.load(0).bf, nullptr);
+   EXPECT_EQ(map.load((1 << 20) - 1).bf, nullptr);
+}
+
+TEST(BufferInfoMapTest, StoreFrameKeepsFences)
+{
+   BufferInfoMap map(1024);
+   map.store(7, {frame(1), 10, 20});
+   map.store(7, {nullptr, 11, 21});
+   map.storeFrame(7, frame(2));
+   const BufferInfo info = map.load(7);
+   EXPECT_EQ(info.bf, frame(2));
+   EXPECT_EQ(info.lower_fence, 11u);
+   EXPECT_EQ(info.upper_fence, 21u);
+}
+
+TEST(BufferInfoMapTest, EntriesAreNeverTorn)
+{
+   // Every entry a writer stores has its fences derived from the frame, a reader must never see a mix
+   BufferInfoMap map(64);
+   std::atomic<bool> stop = false;
+   std::atomic<u64> torn = 0;
+   std::vector<std::thread> threads;
+   for (u64 w = 1; w <= 2; w++) {
+      threads.emplace_back([&, w]() {
+         for (u64 i = 1; !stop; i++) {
+            const u64 v = i * 2 + w;
+            map.store(v % 64, {frame(v), KEY(v), KEY(~v)});
+         }
+      });
+   }
+   threads.emplace_back([&]() {
+      for (u64 i = 0; i < 2000000; i++) {
+         const BufferInfo info = map.load(i % 64);
+         const u64 v = reinterpret_cast<u64>(info.bf) / 64;
+         torn += (info.bf != nullptr) && (info.lower_fence != KEY(v) || info.upper_fence != KEY(~v));
+      }
+      stop = true;
+   });
+   for (auto& t : threads) {
+      t.join();
+   }
+   EXPECT_EQ(torn, 0u);
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+#include <leanstore/sync-primitives/Epoch.hpp>
+#include <atomic>
+#include <thread>
+
+using leanstore::EpochGuard;
+using leanstore::EpochManager;
+
+struct Tracked {
+   std::atomic<int>& alive;
+   explicit Tracked(std::atomic<int>& alive) : alive(alive) { alive++; }
+   ~Tracked() { alive--; }
+};
+
+TEST(EpochTest, RetireWithoutReaders)
+{
+   std::atomic<int> alive = 0;
+   EpochManager::global().retire(new Tracked(alive));
+   EXPECT_EQ(alive, 0);
+}
+
+TEST(EpochTest, RetireWaitsForReader)
+{
+   std::atomic<int> alive = 0;
+   std::atomic<bool> entered = false, release = false;
+   std::thread reader([&]() {
+      EpochGuard guard;
+      entered = true;
+      while (!release) {
+      }
+   });
+   while (!entered) {
+   }
+   EpochManager::global().retire(new Tracked(alive));
+   EXPECT_EQ(alive, 1);
+   release = true;
+   reader.join();
+   EpochManager::global().collect();
+   EXPECT_EQ(alive, 0);
+}
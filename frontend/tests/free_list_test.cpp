@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <Units.hpp>
+#include <leanstore/storage/buffer-manager/FreeList.hpp>
+#include <leanstore/storage/buffer-manager/Partition.hpp>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace leanstore::storage;
+
+TEST(FreeListTest, PopsBatchesInStackOrder)
+{
+   constexpr u64 FRAMES = 10;
+   std::unique_ptr<BufferFrame[]> bfs(new BufferFrame[FRAMES]);
+   FreeList free_list;
+   for (u64 bf_i = 0; bf_i < FRAMES; bf_i++) {
+      free_list.push(bfs[bf_i]);
+   }
+   BufferFrame* batch_head = nullptr;
+   ASSERT_EQ(free_list.tryPopBatch(batch_head, 4), 4u);
+   EXPECT_EQ(free_list.counter, FRAMES - 4);
+   u64 chained = 0;
+   for (BufferFrame* bf = batch_head; bf != nullptr; bf = bf->header.next_free_bf) {
+      EXPECT_EQ(bf, &bfs[FRAMES - 1 - chained]);
+      chained++;
+   }
+   EXPECT_EQ(chained, 4u);
+   ASSERT_EQ(free_list.tryPopBatch(batch_head, 100), FRAMES - 4);
+   EXPECT_EQ(free_list.tryPopBatch(batch_head, 100), 0u);
+   EXPECT_EQ(free_list.tryPop(), nullptr);
+   EXPECT_EQ(free_list.counter, 0u);
+}
+
+TEST(FreeListTest, ConcurrentPopsNeverHandOutAFrameTwice)
+{
+   constexpr u64 FRAMES = 16;
+   constexpr u64 THREADS = 4;
+   constexpr u64 ROUNDS = 20000;
+   std::unique_ptr<BufferFrame[]> bfs(new BufferFrame[FRAMES]);
+   std::unique_ptr<std::atomic<bool>[]> owned(new std::atomic<bool>[FRAMES]);
+   FreeList free_list;
+   for (u64 bf_i = 0; bf_i < FRAMES; bf_i++) {
+      owned[bf_i] = false;
+      free_list.push(bfs[bf_i]);
+   }
+   std::atomic<u64> handed_out_twice = 0;
+   auto take = [&](BufferFrame* bf) {
+      if (owned[bf - bfs.get()].exchange(true)) {
+         handed_out_twice++;
+      }
+   };
+   auto give_back = [&](BufferFrame* bf) { owned[bf - bfs.get()] = false; };
+   std::vector<std::thread> threads;
+   for (u64 t_i = 0; t_i < THREADS; t_i++) {
+      threads.emplace_back([&, t_i]() {
+         for (u64 round_i = 0; round_i < ROUNDS; round_i++) {
+            if ((round_i + t_i) % 2 == 0) {
+               // Single pops, pushed back one by one with the rest still held: a pop that read the first one's
+               // next_free_bf before they were taken must not hand out a held frame
+               BufferFrame* popped[3];
+               u64 popped_count = 0;
+               while (popped_count < 3) {
+                  BufferFrame* bf = free_list.tryPop();
+                  if (bf == nullptr) {
+                     break;
+                  }
+                  take(bf);
+                  popped[popped_count++] = bf;
+               }
+               for (u64 p_i = 0; p_i < popped_count; p_i++) {
+                  give_back(popped[p_i]);
+                  free_list.push(*popped[p_i]);
+                  std::this_thread::yield();
+               }
+            } else {
+               // A batch, pushed back as one chain
+               BufferFrame* batch_head = nullptr;
+               const u64 batch_counter = free_list.tryPopBatch(batch_head, 1 + round_i % 5);
+               if (batch_counter == 0) {
+                  continue;
+               }
+               BufferFrame* batch_tail = batch_head;
+               for (u64 b_i = 0; b_i < batch_counter; b_i++) {
+                  take(batch_tail);
+                  if (b_i + 1 < batch_counter) {
+                     batch_tail = batch_tail->header.next_free_bf;
+                  }
+               }
+               EXPECT_EQ(batch_tail->header.next_free_bf, nullptr);
+               for (BufferFrame* bf = batch_head; bf != nullptr; bf = bf->header.next_free_bf) {
+                  give_back(bf);
+               }
+               free_list.batchPush(batch_head, batch_tail, batch_counter);
+            }
+         }
+      });
+   }
+   for (auto& thread : threads) {
+      thread.join();
+   }
+   EXPECT_EQ(handed_out_twice, 0u);
+   EXPECT_EQ(free_list.counter, FRAMES);
+   u64 listed = 0;
+   for (BufferFrame* bf = free_list.tryPop(); bf != nullptr; bf = free_list.tryPop()) {
+      take(bf);
+      listed++;
+   }
+   EXPECT_EQ(listed, FRAMES);
+   EXPECT_EQ(handed_out_twice, 0u);
+}
+
+TEST(FreeListTest, PartitionHandsOutFreedPIDsFirst)
+{
+   // Never destroyed, as the ones of the buffer manager
+   Partition& partition = *new Partition(1, 4, 0, 0);
+   partition.freePage(101);
+   PID pids[3];
+   partition.nextPIDs(pids, 3);
+   EXPECT_EQ(pids[0], 101u);
+   EXPECT_EQ(pids[1], 1u);
+   EXPECT_EQ(pids[2], 5u);
+   EXPECT_EQ(partition.nextPID(), 9u);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <Exceptions.hpp>
+#include <leanstore/Config.hpp>
+#include <leanstore/concurrency-recovery/CRMG.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace leanstore;
+using namespace leanstore::cr;
+
+class GroupCommitTest : public ::testing::Test
+{
+  protected:
+   static constexpr u64 WORKERS = 2;
+   static constexpr u64 STRIPES = 2;
+   std::vector<std::string> paths;
+   std::string ssd_path = ::testing::TempDir() + "group_commit_test.ssd";
+   int ssd_fd = -1;
+   void SetUp() override
+   {
+      ssd_fd = open(ssd_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+      ASSERT_NE(ssd_fd, -1);
+      std::string files;
+      for (u64 s_i = 0; s_i < STRIPES; s_i++) {
+         paths.push_back(::testing::TempDir() + "group_commit_test_" + std::to_string(s_i) + ".wal");
+         files += (s_i ? "," : "") + paths.back();
+      }
+      FLAGS_wal = true;
+      FLAGS_wal_fsync = false;
+      FLAGS_wal_files = files;
+      FLAGS_wal_file_gib = 1;
+      FLAGS_worker_threads = WORKERS;
+      // The group committer is pinned to the CPU behind the page providers, there are none here
+      FLAGS_pp_threads = 0;
+   }
+   void TearDown() override
+   {
+      FLAGS_wal = false;
+      FLAGS_wal_files = "";
+      close(ssd_fd);
+      std::remove(ssd_path.c_str());
+      for (const auto& path : paths) {
+         std::remove(path.c_str());
+      }
+   }
+};
+
+TEST_F(GroupCommitTest, RoundsChainAcrossStripesAndCursorsAdvance)
+{
+   constexpr u64 TXS = 200;
+   CRManager crm(ssd_fd, 0);
+   ASSERT_EQ(crm.wal_stripes.size(), STRIPES);
+   // The committed cursors only ever grow
+   std::atomic<bool> sampling = true;
+   std::atomic<u64> regressions = 0;
+   std::thread sampler([&]() {
+      u64 last[WORKERS] = {};
+      while (sampling) {
+         for (u64 w_i = 0; w_i < WORKERS; w_i++) {
+            const u64 cursor = crm.workers[w_i]->wal_committed_cursor.load();
+            regressions += cursor < last[w_i];
+            last[w_i] = cursor;
+         }
+      }
+   });
+   // Every transaction waits for its acknowledgement, the next one then goes to a later round
+   std::atomic<u64> out_of_order = 0;
+   for (u64 t_i = 0; t_i < WORKERS; t_i++) {
+      crm.scheduleJobAsync(t_i, [&]() {
+         Worker& worker = Worker::my();
+         Transaction previous;
+         for (u64 tx_i = 0; tx_i < TXS; tx_i++) {
+            worker.startTX();
+            worker.commitTX();
+            const Transaction tx = worker.active_tx;
+            while (!worker.isCommitted(tx)) {
+            }
+            out_of_order += tx_i > 0 && (previous.commit_seq + 1 != tx.commit_seq || !worker.isCommitted(previous));
+            previous = tx;
+         }
+      });
+   }
+   crm.joinAll();
+   sampling = false;
+   sampler.join();
+   EXPECT_EQ(regressions, 0u);
+   EXPECT_EQ(out_of_order, 0u);
+   for (u64 w_i = 0; w_i < WORKERS; w_i++) {
+      EXPECT_EQ(crm.workers[w_i]->wal_committed_cursor.load(), TXS);
+   }
+   // Chunks of round r are on stripe r % STRIPES, sorted by round they form one chain from NO_ROUND
+   struct Chunk {
+      u64 round, prev_round, stripe_i;
+   };
+   std::vector<Chunk> chunks;
+   auto header = static_cast<WALChunk*>(std::aligned_alloc(512, sizeof(WALChunk)));
+   auto meta = static_cast<SSDMeta*>(std::aligned_alloc(512, sizeof(SSDMeta)));
+   u64 stripes_used = 0;
+   for (u64 s_i = 0; s_i < STRIPES; s_i++) {
+      const auto& stripe = crm.wal_stripes[s_i];
+      const u64 meta_offset = stripe.end - sizeof(SSDMeta);
+      ASSERT_EQ(pread(stripe.fd, meta, sizeof(SSDMeta), meta_offset), s64(sizeof(SSDMeta)));
+      stripes_used += meta->last_written_chunk != 0;
+      for (u64 offset = meta->last_written_chunk; offset && offset < meta_offset; offset += header->total_size) {
+         ASSERT_EQ(pread(stripe.fd, header, sizeof(WALChunk), offset), s64(sizeof(WALChunk)));
+         ASSERT_GE(header->total_size, sizeof(WALChunk));
+         chunks.push_back({header->round, header->prev_round, s_i});
+      }
+   }
+   free(header);
+   free(meta);
+   EXPECT_EQ(stripes_used, STRIPES);
+   ASSERT_FALSE(chunks.empty());
+   std::sort(chunks.begin(), chunks.end(), [](const Chunk& a, const Chunk& b) { return a.round < b.round; });
+   u64 prev_round = WALChunk::NO_ROUND;
+   for (const auto& chunk : chunks) {
+      EXPECT_EQ(chunk.stripe_i, chunk.round % STRIPES);
+      EXPECT_EQ(chunk.prev_round, prev_round);
+      prev_round = chunk.round;
+   }
+}
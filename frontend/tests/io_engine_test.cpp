@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <Exceptions.hpp>
+#include <leanstore/io/IOEngine.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+
+using namespace leanstore::io;
+
+class IOEngineTest : public ::testing::TestWithParam<std::string>
+{
+  protected:
+   static constexpr u64 PAGE = 4096;
+   static constexpr u64 PAGES = 32;
+   std::string path = ::testing::TempDir() + "io_engine_test.img";
+   int fd = -1;
+   u8* pages = nullptr;
+   void SetUp() override
+   {
+      fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+      ASSERT_NE(fd, -1);
+      ASSERT_EQ(posix_memalign(reinterpret_cast<void**>(&pages), 512, PAGE * (PAGES + 1)), 0);
+   }
+   void TearDown() override
+   {
+      close(fd);
+      std::remove(path.c_str());
+      free(pages);
+   }
+};
+
+TEST_P(IOEngineTest, WritesSyncsAndReadsBack)
+{
+   // Registers the first half of the pages, the rest goes through the plain buffers
+   auto engine = IOEngine::create(GetParam(), fd, PAGES + 2, pages, PAGE * PAGES / 2);
+   for (u64 p_i = 0; p_i < PAGES; p_i++) {
+      memset(pages + p_i * PAGE, int(p_i + 1), PAGE);
+      engine->prepWrite(pages + p_i * PAGE, PAGE, p_i * PAGE, reinterpret_cast<void*>(p_i + 1));
+   }
+   engine->prepSync(nullptr);
+   // Behind the sync
+   memset(pages + PAGES * PAGE, 0xee, PAGE);
+   engine->prepWrite(pages + PAGES * PAGE, PAGE, PAGES * PAGE, reinterpret_cast<void*>(PAGES + 1));
+   EXPECT_EQ(engine->queued(), PAGES + 2);
+   IOEngine::Completion completions[PAGES + 2];
+   ASSERT_EQ(engine->submitAndWait(completions, PAGES + 2), PAGES + 2);
+   EXPECT_EQ(engine->inFlight(), 0u);
+   std::set<u64> written;
+   for (const auto& completion : completions) {
+      if (completion.user_data == nullptr) {
+         EXPECT_EQ(completion.result, 0);
+      } else {
+         EXPECT_EQ(completion.result, s64(PAGE));
+         written.insert(reinterpret_cast<u64>(completion.user_data));
+      }
+   }
+   EXPECT_EQ(written.size(), PAGES + 1);
+   // -------------------------------------------------------------------------------------
+   memset(pages, 0, PAGE * PAGES);
+   for (u64 p_i = 0; p_i < PAGES; p_i++) {
+      engine->prepRead(pages + p_i * PAGE, PAGE, p_i * PAGE, nullptr);
+   }
+   EXPECT_EQ(engine->submit(), PAGES);
+   u64 reaped = 0;
+   while (reaped < PAGES) {
+      reaped += engine->reap(completions, 1, PAGES - reaped);
+   }
+   for (u64 p_i = 0; p_i < PAGES; p_i++) {
+      ASSERT_EQ(pages[p_i * PAGE], u8(p_i + 1));
+      ASSERT_EQ(pages[p_i * PAGE + PAGE - 1], u8(p_i + 1));
+   }
+   u8 last;
+   ASSERT_EQ(pread(fd, &last, 1, PAGES * PAGE), 1);
+   EXPECT_EQ(last, 0xee);
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, IOEngineTest, ::testing::Values("libaio", "io_uring"));
+
+TEST(IOEngineFactoryTest, UnknownEngineThrows)
+{
+   EXPECT_THROW(IOEngine::create("posix", 0, 1), leanstore::ex::GenericException);
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <leanstore/compileConst.hpp>
+#include <leanstore/fold.hpp>
+#include <leanstore/storage/btree/core/KeyNormalizer.hpp>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using leanstore::storage::btree::KeyNormalizer;
+
+// (w_id, d_id, o_id) as the TPC-C records fold it
+static std::string folded(u32 w_id, u32 d_id, u32 o_id)
+{
+   u8 key[12];
+   leanstore::fold(key, w_id);
+   leanstore::fold(key + 4, d_id);
+   leanstore::fold(key + 8, o_id);
+   return std::string(reinterpret_cast<char*>(key), sizeof(key));
+}
+
+template <typename T>
+static void learnFrom(KeyNormalizer<T>& normalizer, const std::string& min_key, const std::string& max_key)
+{
+   normalizer.learn(reinterpret_cast<const u8*>(min_key.data()), min_key.size(), reinterpret_cast<const u8*>(max_key.data()), max_key.size());
+}
+
+template <typename T>
+static T normalize(const KeyNormalizer<T>& normalizer, const std::string& key)
+{
+   return normalizer.normalize(reinterpret_cast<const u8*>(key.data()), key.size());
+}
+
+TEST(KeyNormalizerTest, FittingKeysMapAsBefore)
+{
+   KeyNormalizer<u32> normalizer;
+   u8 min_key[4], max_key[4];
+   leanstore::fold(min_key, u32(5));
+   leanstore::fold(max_key, u32(1000));
+   normalizer.learn(min_key, 4, max_key, 4);
+   EXPECT_EQ(normalizer.prefixLength(), 0);
+   u8 key[4];
+   leanstore::fold(key, u32(123456));
+   EXPECT_EQ(normalizer.normalize(key, 4), 123456u);
+}
+
+TEST(KeyNormalizerTest, CompositeKeysKeepTheirOrder)
+{
+   std::vector<std::string> keys;
+   std::mt19937 rng(42);
+   for (u32 i = 0; i < 5000; i++) {
+      keys.push_back(folded(3, 1 + rng() % 10, rng() % 200000));
+   }
+   std::sort(keys.begin(), keys.end());
+   KeyNormalizer<u32> normalizer;
+   learnFrom(normalizer, keys.front(), keys.back());
+   EXPECT_EQ(normalizer.prefixLength(), 7);  // w_id and the 3 high bytes of d_id
+   u64 distinct = 1;
+   for (u64 i = 1; i < keys.size(); i++) {
+      ASSERT_LE(normalize(normalizer, keys[i - 1]), normalize(normalizer, keys[i]));
+      distinct += normalize(normalizer, keys[i - 1]) != normalize(normalizer, keys[i]);
+   }
+   // d_id and the top 3 bytes of o_id survive
+   EXPECT_GT(distinct, keys.size() / 2);
+   // A key that normalizes to the same value sorts the same way after denormalizing
+   u8 bytes[KeyNormalizer<u32>::MAX_PREFIX + sizeof(u32)];
+   const u16 length = normalizer.denormalize(normalize(normalizer, keys[100]), bytes);
+   EXPECT_EQ(normalizer.normalize(bytes, length), normalize(normalizer, keys[100]));
+}
+
+TEST(KeyNormalizerTest, KeysOutsideThePrefixAreClamped)
+{
+   KeyNormalizer<u64> normalizer;
+   learnFrom(normalizer, std::string("customer:alice"), std::string("customer:zoe"));
+   EXPECT_EQ(normalizer.prefixLength(), 9);
+   EXPECT_EQ(normalize(normalizer, std::string("aaa")), 0u);
+   EXPECT_EQ(normalize(normalizer, std::string("custom")), 0u);
+   EXPECT_EQ(normalize(normalizer, std::string("district:1")), std::numeric_limits<u64>::max());
+   EXPECT_LT(normalize(normalizer, std::string("customer:bob")), normalize(normalizer, std::string("customer:carol")));
+   EXPECT_LT(normalize(normalizer, std::string("customer:")), normalize(normalizer, std::string("customer:a")));
+}
+
+TEST(KeyNormalizerTest, ModelKeysTellCompositeKeysApart)
+{
+   std::vector<std::string> keys;
+   std::mt19937 rng(7);
+   for (u32 i = 0; i < 5000; i++) {
+      keys.push_back(folded(3, 1 + rng() % 10, rng() % 200000));
+   }
+   std::sort(keys.begin(), keys.end());
+   keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+   KeyNormalizer<MODEL_KEY> normalizer;
+   learnFrom(normalizer, keys.front(), keys.back());
+   // d_id and o_id fit behind the prefix, every key keeps its own model key
+   for (u64 i = 1; i < keys.size(); i++) {
+      ASSERT_LT(normalize(normalizer, keys[i - 1]), normalize(normalizer, keys[i]));
+   }
+   // Integer keys are widened in order
+   KeyNormalizer<MODEL_KEY> integers;
+   u8 min_key[sizeof(KEY)], max_key[sizeof(KEY)], key[sizeof(KEY)];
+   leanstore::fold(min_key, KEY(0));
+   leanstore::fold(max_key, std::numeric_limits<KEY>::max());
+   integers.learn(min_key, sizeof(KEY), max_key, sizeof(KEY));
+   MODEL_KEY previous = 0;
+   for (KEY k = 1; k < 100000; k += 97) {
+      leanstore::fold(key, k);
+      ASSERT_LT(previous, integers.normalize(key, sizeof(KEY)));
+      previous = integers.normalize(key, sizeof(KEY));
+   }
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include <leanstore/compileConst.hpp>
+#include <leanstore/fold.hpp>
+#include <leanstore/storage/btree/BTreeLL.hpp>
+#include <leanstore/storage/btree/core/BTreeNode.hpp>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace leanstore::storage;
+using namespace leanstore::storage::btree;
+
+#ifdef INCREMENTAL_LEAF_MODEL
+// The running sums after any mix of inserts and removes are those a rebuild over the slots gives
+static void expectSameAsRebuild(BTreeNode& node)
+{
+   alignas(64) static u8 copy_page[EFFECTIVE_PAGE_SIZE];
+   memcpy(copy_page, &node, sizeof(BTreeNode));
+   auto& copy = *reinterpret_cast<BTreeNode*>(copy_page);
+   copy.rebuildFit();
+   ASSERT_EQ(node.fit.n, node.count);
+   ASSERT_EQ(node.fit.sum_x, copy.fit.sum_x);
+   ASSERT_EQ(node.fit.sum_xy, copy.fit.sum_xy);
+   ASSERT_TRUE(node.fit.getSumXX() == copy.fit.getSumXX());
+   ASSERT_DOUBLE_EQ(node.fit.m, copy.fit.m);
+   ASSERT_DOUBLE_EQ(node.fit.c, copy.fit.c);
+}
+
+TEST(LeafModelTest, RunningSumsFollowInsertsAndRemoves)
+{
+   alignas(64) static u8 page[EFFECTIVE_PAGE_SIZE];
+   auto& node = *new (page) BTreeNode(true);
+   std::mt19937 gen(42);
+   std::set<KEY> keys;
+   u8 payload[8] = {};
+   for (u32 round = 0; round < 20000; round++) {
+      const KEY key = gen() % 100000;
+      u8 key_bytes[sizeof(KEY)];
+      leanstore::fold(key_bytes, key);
+      if (keys.count(key)) {
+         ASSERT_TRUE(node.remove(key_bytes, sizeof(KEY)));
+         keys.erase(key);
+      } else if (node.canInsert(sizeof(KEY), sizeof(payload))) {
+         node.insert(key_bytes, sizeof(KEY), payload, sizeof(payload));
+         keys.insert(key);
+      } else {
+         continue;
+      }
+      expectSameAsRebuild(node);
+   }
+   // The error lags the fit between refreshes, the search is exact either way
+   for (KEY key = 0; key < 100010; key += 3) {
+      u8 key_bytes[sizeof(KEY)];
+      leanstore::fold(key_bytes, key);
+      bool expected_equal = false, is_equal = false;
+      const s16 expected = node.lowerBound<false>(key_bytes, sizeof(KEY), &expected_equal);
+      ASSERT_EQ(node.fitSearch<false>(key_bytes, sizeof(KEY), &is_equal), expected);
+      ASSERT_EQ(is_equal, expected_equal);
+   }
+   node.refreshFitError();
+   for (u16 i = 0; i < node.count; i++) {
+      const size_t predicted = node.fit.predict(node.slot[i].head);
+      ASSERT_LE((predicted > i) ? predicted - i : i - predicted, node.fit.error);
+   }
+}
+
+TEST(LeafModelTest, ErrorGoesStaleForTheTrainersBeforeTheLeafRefreshes)
+{
+   alignas(64) static u8 page[EFFECTIVE_PAGE_SIZE];
+   auto& node = *new (page) BTreeNode(true);
+   u8 payload[8] = {};
+   auto insert = [&](KEY key) {
+      u8 key_bytes[sizeof(KEY)];
+      leanstore::fold(key_bytes, key);
+      node.insert(key_bytes, sizeof(KEY), payload, sizeof(payload));
+   };
+   for (KEY key = 0; key < 64; key++) {
+      insert(key * 1000);
+   }
+   node.refreshFitError();
+   EXPECT_FALSE(node.fitErrorStale());
+   // Skewed inserts, queued for the trainers after count / 8 of them
+   KEY key = 1;
+   while (!node.fitErrorStale()) {
+      insert(key++);
+   }
+   EXPECT_EQ(node.fit.updates, node.count / 8 + 1);
+   // What a trainer publishes
+   const u16 error = node.fitError();
+   EXPECT_GT(error, node.fit.error);
+   node.fit.error = error;
+   node.fit.updates = 0;
+   EXPECT_FALSE(node.fitErrorStale());
+   // Without trainers the leaf refreshes itself once half as many slots moved as it has
+   while (node.fit.updates <= node.count / 2) {
+      const u16 updates = node.fit.updates;
+      insert(key++);
+      if (node.fit.updates < updates) {
+         break;
+      }
+   }
+   EXPECT_EQ(node.fit.updates, 0u);
+   EXPECT_EQ(node.fit.error, node.fitError());
+}
+
+// What a leaf trainer runs for a queued leaf: the fit stays as the writers left it, the bound is recomputed
+TEST(LeafModelTest, TrainerRecomputesOnlyTheErrorBound)
+{
+   std::unique_ptr<BufferFrame> bf(new BufferFrame());
+   auto& node = *new (bf->page.dt) BTreeNode(true);
+   u8 payload[8] = {};
+   for (KEY key = 0; key < 64; key++) {
+      u8 key_bytes[sizeof(KEY)];
+      leanstore::fold(key_bytes, (key < 16) ? key : key * 1000);
+      node.insert(key_bytes, sizeof(KEY), payload, sizeof(payload));
+   }
+   node.refreshFitError();
+   for (KEY key = 100; !node.fitErrorStale(); key++) {
+      u8 key_bytes[sizeof(KEY)];
+      leanstore::fold(key_bytes, key);
+      node.insert(key_bytes, sizeof(KEY), payload, sizeof(payload));
+   }
+   const LeafFit fit = node.fit;
+   const u64 version = bf->header.latch.ref().load();
+   BTreeLL btree;
+   jumpmuTry()
+   {
+      HybridPageGuard<BTreeNode> leaf(bf.get());
+      EXPECT_TRUE(btree.train_leaf_node(leaf, 1));
+   }
+   jumpmuCatch() { ADD_FAILURE() << "no writer ran, the upgrade has to succeed"; }
+   EXPECT_FALSE(bf->header.latch.isExclusivelyLatched());
+   EXPECT_NE(bf->header.latch.ref().load(), version);
+   EXPECT_EQ(node.fit.sum_x, fit.sum_x);
+   EXPECT_EQ(node.fit.sum_xy, fit.sum_xy);
+   EXPECT_DOUBLE_EQ(node.fit.m, fit.m);
+   EXPECT_DOUBLE_EQ(node.fit.c, fit.c);
+   EXPECT_EQ(node.fit.error, node.fitError());
+   EXPECT_EQ(node.fit.updates, 0u);
+   EXPECT_FALSE(node.fitErrorStale());
+}
+#endif
+
+// SOSD keys are u64: the leaf search of the integer lookups folds the whole key, whatever the width of KEY
+TEST(LeafModelTest, SearchLeafTakesKeysWiderThanKEY)
+{
+   std::unique_ptr<BufferFrame> bf(new BufferFrame());
+   auto& node = *new (bf->page.dt) BTreeNode(true);
+   u8 payload[8] = {};
+   std::vector<u64> keys;
+   for (u64 high = 1; high <= 64; high++) {
+      keys.push_back((high << 32) | 7);
+   }
+   for (const u64 key : keys) {
+      u8 key_bytes[sizeof(u64)];
+      leanstore::fold(key_bytes, key);
+      node.insert(key_bytes, sizeof(u64), payload, sizeof(payload));
+   }
+#ifdef INCREMENTAL_LEAF_MODEL
+   node.refreshFitError();
+#endif
+   BTreeLL btree;
+   jumpmuTry()
+   {
+      HybridPageGuard<BTreeNode> leaf(bf.get());
+      for (u64 i = 0; i < keys.size(); i++) {
+         ASSERT_EQ(btree.searchLeaf<u64>(leaf, keys[i]), s16(i));
+         ASSERT_EQ(btree.searchLeaf<u64>(leaf, keys[i] + 1), -1);
+      }
+      // Truncated to 32 bits all of them are the same key, which is not in the leaf
+      ASSERT_EQ(btree.searchLeaf<u32>(leaf, u32(keys[0])), -1);
+   }
+   jumpmuCatch() { ADD_FAILURE() << "no writer ran"; }
+}
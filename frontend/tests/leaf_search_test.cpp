@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <leanstore/compileConst.hpp>
+#include <leanstore/fold.hpp>
+#include <leanstore/storage/btree/core/BTreeNode.hpp>
+#include <leanstore/utils/SIMDSearch.hpp>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace leanstore::storage::btree;
+using namespace leanstore::utils::simd;
+
+// Every window, including wrong ones, gives the slot lowerBound gives
+static void expectSameAsLowerBound(BTreeNode& node, const std::vector<std::string>& probes)
+{
+   std::mt19937_64 gen(7);
+   for (auto isa : {ISA::SCALAR, ISA::AVX2, ISA::AVX512}) {
+      if (forceISA(isa) != isa) {
+         continue;
+      }
+      for (const auto& probe : probes) {
+         const u8* key = reinterpret_cast<const u8*>(probe.data());
+         const u16 length = probe.size();
+         bool expected_equal = false, is_equal = false;
+         const s16 expected = node.lowerBound<false>(key, length, &expected_equal);
+         const size_t predicted = (gen() % 4 == 0) ? gen() % (node.count + 10) : std::max<s32>(0, expected + static_cast<s32>(gen() % 9) - 4);
+         const size_t max_error = gen() % 8;
+         ASSERT_EQ(node.modelSearch<false>(key, length, predicted, max_error, &is_equal), expected);
+         ASSERT_EQ(is_equal, expected_equal);
+         ASSERT_EQ(node.modelSearch<true>(key, length, predicted, max_error), expected_equal ? expected : -1);
+      }
+   }
+   forceISA(detectISA());
+}
+
+TEST(LeafSearchTest, FixedWidthKeys)
+{
+   alignas(64) static u8 page[EFFECTIVE_PAGE_SIZE];
+   auto& node = *new (page) BTreeNode(true);
+   std::mt19937 gen(42);
+   std::set<KEY> keys;
+   u8 payload[8] = {};
+   while (node.canInsert(sizeof(KEY), sizeof(payload))) {
+      const KEY key = gen() % 100000;
+      if (!keys.insert(key).second) {
+         continue;
+      }
+      u8 key_bytes[sizeof(KEY)];
+      leanstore::fold(key_bytes, key);
+      node.insert(key_bytes, sizeof(KEY), payload, sizeof(payload));
+   }
+   std::vector<std::string> probes;
+   for (KEY key = 0; key < 100010; key += 7) {
+      u8 key_bytes[sizeof(KEY)];
+      leanstore::fold(key_bytes, key);
+      probes.emplace_back(reinterpret_cast<char*>(key_bytes), sizeof(KEY));
+   }
+   expectSameAsLowerBound(node, probes);
+}
+
+TEST(LeafSearchTest, HeadTiesFallBackToFullKeys)
+{
+   alignas(64) static u8 page[EFFECTIVE_PAGE_SIZE];
+   auto& node = *new (page) BTreeNode(true);
+   // Keys that share their first 4 bytes in runs, and some that are shorter than a head
+   std::set<std::string> keys;
+   std::mt19937 gen(42);
+   while (keys.size() < 200) {
+      std::string key = "k" + std::to_string(gen() % 4);
+      for (u32 i = gen() % 8; i > 0; i--) {
+         key.push_back('a' + gen() % 3);
+      }
+      keys.insert(key);
+   }
+   u8 payload[4] = {};
+   for (const auto& key : keys) {
+      if (!node.canInsert(key.size(), sizeof(payload))) {
+         break;
+      }
+      node.insert(reinterpret_cast<const u8*>(key.data()), key.size(), payload, sizeof(payload));
+   }
+   std::vector<std::string> probes(keys.begin(), keys.end());
+   for (const auto& key : keys) {
+      probes.push_back(key + "b");
+      probes.push_back(key.substr(0, key.size() - 1));
+   }
+   expectSameAsLowerBound(node, probes);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <Units.hpp>
+#include <leanstore/storage/btree/core/LeafTrainQueue.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace leanstore::storage::btree;
+
+TEST(LeafTrainQueueTest, FullRingDropsAndDrainSplitsRings)
+{
+   LeafTrainQueue queue;
+   u64 pushed = 0;
+   for (PID pid = 0; pid < LeafTrainQueue::RING_SIZE + 10; pid++) {
+      pushed += queue.push(pid, nullptr);
+   }
+   EXPECT_EQ(pushed, LeafTrainQueue::RING_SIZE);
+   EXPECT_EQ(queue.size(), LeafTrainQueue::RING_SIZE);
+   // This thread's ring belongs to exactly one of the two trainers
+   std::vector<PID> drained;
+   const u64 limit = 100;
+   for (u64 t_i = 0; t_i < 2; t_i++) {
+      queue.drain(t_i, 2, limit, [&](const LeafTrainQueue::Entry& entry) { drained.push_back(entry.pid); });
+   }
+   ASSERT_EQ(drained.size(), limit);
+   for (u64 i = 0; i < drained.size(); i++) {
+      EXPECT_EQ(drained[i], i);
+   }
+}
+
+TEST(LeafTrainQueueTest, ConcurrentWritersAndTrainers)
+{
+   LeafTrainQueue queue;
+   const u64 writers = 8, trainers = 3, per_writer = 100000;
+   std::atomic<u64> pushed = 0, drained = 0, pid_sum = 0, expected_sum = 0;
+   std::atomic<bool> writing = true;
+   std::vector<std::thread> threads;
+   for (u64 t_i = 0; t_i < trainers; t_i++) {
+      threads.emplace_back([&, t_i]() {
+         while (true) {
+            const bool last_round = !writing;
+            queue.drain(t_i, trainers, 64, [&](const LeafTrainQueue::Entry& entry) {
+               drained++;
+               pid_sum += entry.pid;
+            });
+            if (last_round) {
+               // Everything was pushed before this round started
+               queue.drain(t_i, trainers, ~0ull, [&](const LeafTrainQueue::Entry& entry) {
+                  drained++;
+                  pid_sum += entry.pid;
+               });
+               return;
+            }
+         }
+      });
+   }
+   std::vector<std::thread> producers;
+   for (u64 w_i = 0; w_i < writers; w_i++) {
+      producers.emplace_back([&, w_i]() {
+         for (u64 i = 0; i < per_writer; i++) {
+            const PID pid = w_i * per_writer + i;
+            if (queue.push(pid, nullptr)) {
+               pushed++;
+               expected_sum += pid;
+            }
+         }
+      });
+   }
+   for (auto& producer : producers) {
+      producer.join();
+   }
+   writing = false;
+   for (auto& thread : threads) {
+      thread.join();
+   }
+   EXPECT_GT(pushed.load(), 0u);
+   EXPECT_EQ(drained.load(), pushed.load());
+   EXPECT_EQ(pid_sum.load(), expected_sum.load());
+   EXPECT_EQ(queue.size(), 0u);
+}
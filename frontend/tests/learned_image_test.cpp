@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <Exceptions.hpp>
+#include <leanstore/storage/btree/core/LeafAccessSketch.hpp>
+#include <leanstore/storage/btree/core/LearnedIndexImage.hpp>
+#include <leanstore/storage/btree/core/LearnedRouter.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace leanstore::storage::btree;
+
+class LearnedImageTest : public ::testing::Test
+{
+  protected:
+   std::string path = ::testing::TempDir() + "learned_image_test.img";
+   std::vector<MODEL_KEY> keys;
+   std::vector<PID> pids;
+   spline::RadixSpline<MODEL_KEY> spline;
+   ska::flat_hash_map<PID, learnedindex<KEY>> models;
+   ska::flat_hash_map<PID, std::vector<size_t>> segments;
+   LeafAccessSketch sketch;
+
+   void SetUp() override
+   {
+      for (u64 i = 0; i < 5000; i++) {
+         keys.push_back(i * 7 + (i % 3));
+         pids.push_back(1000 + i);
+      }
+      // The rightmost leaf has no separator
+      pids.push_back(1000 + keys.size());
+      spline::Builder<MODEL_KEY> builder(8);
+      for (const MODEL_KEY key : keys) {
+         builder.AddKey(key);
+      }
+      spline = spline::RadixSpline<MODEL_KEY>(8, keys.size(), builder.Finalize());
+      models[1000].train(std::vector<KEY>(keys.begin(), keys.end()), 3);
+      segments[1001] = {4, 5, 6};
+      segments[1002] = {};
+      // Every run of SAMPLE records is sampled once, 10 times per pid
+      for (u64 i = 0; i < 100 * LeafAccessSketch::SAMPLE; i++) {
+         sketch.record(1000 + (i / LeafAccessSketch::SAMPLE) % 10);
+      }
+      const auto counts = sketch.counts();
+      LearnedIndexImage::write(path, keys, pids, spline.max_error_, spline.spline_points_, models, segments, counts);
+   }
+   void TearDown() override { std::remove(path.c_str()); }
+   void flipByte(const u64 offset)
+   {
+      std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+      file.seekg(offset);
+      const char byte = file.get() ^ 0x5a;
+      file.seekp(offset);
+      file.put(byte);
+   }
+};
+
+TEST_F(LearnedImageTest, RoundTripServesLookupsInPlace)
+{
+   LearnedIndexImage image(path, true);
+   ASSERT_EQ(image.keys().size(), keys.size());
+   EXPECT_TRUE(std::equal(keys.begin(), keys.end(), image.keys().begin()));
+   ASSERT_EQ(image.pids().size(), pids.size());
+   EXPECT_TRUE(std::equal(pids.begin(), pids.end(), image.pids().begin()));
+   EXPECT_EQ(reinterpret_cast<uintptr_t>(image.keys().data()) % 64, 0u);
+   const auto points = image.splinePoints();
+   ASSERT_EQ(points.size(), spline.spline_points_.size());
+   for (u64 p_i = 0; p_i < points.size(); p_i++) {
+      EXPECT_EQ(points[p_i].x, spline.spline_points_[p_i].x);
+      EXPECT_EQ(points[p_i].y, spline.spline_points_[p_i].y);
+   }
+   ska::flat_hash_map<PID, learnedindex<KEY>> loaded_models;
+   image.loadLeafModels(loaded_models);
+   ASSERT_EQ(loaded_models.count(1000), 1u);
+   EXPECT_EQ(loaded_models[1000].version, 3u);
+   // Bit for bit, so the error bound still holds without slack
+   EXPECT_TRUE(loaded_models[1000].m == models[1000].m);
+   EXPECT_TRUE(loaded_models[1000].c == models[1000].c);
+   EXPECT_EQ(loaded_models[1000].error, models[1000].error);
+   ska::flat_hash_map<PID, std::vector<size_t>> loaded_segments;
+   image.loadAttachedSegments(loaded_segments);
+   EXPECT_EQ(loaded_segments, segments);
+   LeafAccessSketch loaded_sketch;
+   loaded_sketch.load(image.accessSketch());
+   for (PID pid = 1000; pid < 1020; pid++) {
+      EXPECT_EQ(loaded_sketch.estimate(pid), sketch.estimate(pid));
+   }
+   // Count-min never underestimates
+   EXPECT_GE(loaded_sketch.estimate(1003), 10u);
+   // The router searches the mapped keys as it searches the vector
+   RootRouter<MODEL_KEY> router;
+   router.build(RouterConfig(), keys, spline::RadixSpline<MODEL_KEY>(image.header().max_error, keys.size(), points));
+   for (MODEL_KEY key = 0; key < keys.back() + 10; key += 5) {
+      ASSERT_EQ(router.search(image.keys(), key, router.estimate(key)), router.search(keys, key, router.estimate(key)));
+   }
+}
+
+TEST_F(LearnedImageTest, CorruptionIsDetected)
+{
+   const u64 keys_offset = LearnedIndexImage(path, true).header().sections[LearnedIndexImage::KEYS].offset;
+   flipByte(keys_offset + 100);
+   EXPECT_THROW(LearnedIndexImage(path, true), leanstore::ex::GenericException);
+   // Without verification the image opens, verify() still tells
+   LearnedIndexImage unverified(path, false);
+   EXPECT_FALSE(unverified.verify());
+   flipByte(offsetof(LearnedIndexImage::Header, max_error));
+   EXPECT_THROW(LearnedIndexImage(path, false), leanstore::ex::GenericException);
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <leanstore/compileConst.hpp>
+#include <leanstore/fold.hpp>
+#include <leanstore/rmi/rmi.hpp>
+#include <leanstore/rs/builder.hpp>
+#include <leanstore/storage/btree/core/KeyNormalizer.hpp>
+#include <leanstore/storage/btree/core/LearnedRouter.hpp>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace leanstore::storage::btree;
+
+template <typename Key>
+class LearnedRouterTest : public ::testing::Test
+{
+  protected:
+   std::vector<Key> keys;
+   spline::RadixSpline<Key> spline;
+   void SetUp() override
+   {
+      // Clustered, so that the line is off by a lot and the searches have to leave the window
+      std::mt19937_64 gen(42);
+      std::set<Key> unique;
+      while (unique.size() < 20000) {
+         const Key cluster = gen() % 8;
+         unique.insert(cluster * (std::numeric_limits<Key>::max() / 8) + gen() % 100000);
+      }
+      keys.assign(unique.begin(), unique.end());
+      spline::Builder<Key> builder(16);
+      for (const Key key : keys) {
+         builder.AddKey(key);
+      }
+      spline = spline::RadixSpline<Key>(16, keys.size(), builder.Finalize());
+   }
+   void expectExact(const RootRouter<Key>& router)
+   {
+      std::mt19937_64 gen(7);
+      for (u64 i = 0; i < 20000; i++) {
+         const Key key = (i % 2) ? keys[gen() % keys.size()] : keys[gen() % (keys.size() - 1)] + 1;
+         const size_t expected = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+         ASSERT_EQ(router.search(keys, key, router.estimate(key)), expected);
+         ASSERT_EQ(router.search(keys, key, 0), expected);
+         ASSERT_EQ(router.search(keys, key, keys.size() + 10), expected);
+      }
+   }
+};
+using KeyTypes = ::testing::Types<u32, u64>;
+TYPED_TEST_SUITE(LearnedRouterTest, KeyTypes);
+
+TYPED_TEST(LearnedRouterTest, EverySearchIsExact)
+{
+   for (auto model : {ROUTER_MODEL::SPLINE, ROUTER_MODEL::LINEAR, ROUTER_MODEL::RMI, ROUTER_MODEL::PLA}) {
+      for (auto search : {ROUTER_SEARCH::SIMD, ROUTER_SEARCH::EXPONENTIAL, ROUTER_SEARCH::BINARY}) {
+         RootRouter<TypeParam> router;
+         router.build({model, search}, this->keys, this->spline);
+         this->expectExact(router);
+      }
+   }
+}
+
+TYPED_TEST(LearnedRouterTest, ModelsKeepTheirErrorBound)
+{
+   for (auto model : {ROUTER_MODEL::SPLINE, ROUTER_MODEL::LINEAR, ROUTER_MODEL::RMI, ROUTER_MODEL::PLA}) {
+      RootRouter<TypeParam> router;
+      router.build({model, ROUTER_SEARCH::SIMD}, this->keys, this->spline);
+      for (size_t i = 0; i + 1 < this->keys.size(); i++) {
+         ASSERT_LE(std::abs(router.estimate(this->keys[i]) - static_cast<double>(i)), router.errorAt(this->keys[i]) + 1e-6);
+         ASSERT_LE(router.errorAt(this->keys[i]), router.maxError());
+      }
+   }
+}
+
+// Switching the search keeps the trained model, so the estimates stay the same
+TYPED_TEST(LearnedRouterTest, SearchSwitchKeepsTheModel)
+{
+   for (auto model : {ROUTER_MODEL::SPLINE, ROUTER_MODEL::LINEAR, ROUTER_MODEL::RMI, ROUTER_MODEL::PLA}) {
+      RootRouter<TypeParam> trained;
+      trained.build({model, ROUTER_SEARCH::SIMD}, this->keys, this->spline);
+      for (auto search : {ROUTER_SEARCH::EXPONENTIAL, ROUTER_SEARCH::BINARY}) {
+         const auto router = trained.withSearch(search);
+         ASSERT_TRUE(router.config().sameModel(trained.config()));
+         ASSERT_EQ(router.config().search, search);
+         for (size_t i = 0; i + 1 < this->keys.size(); i += 13) {
+            ASSERT_EQ(router.estimate(this->keys[i]), trained.estimate(this->keys[i]));
+         }
+         this->expectExact(router);
+      }
+   }
+}
+
+// 64 bit keys (SOSD) stored as folded 8 byte keys route through the tree's normalizer at full width,
+// whatever the compile time KEY is
+TEST(LearnedRouterTest, WideKeysRouteThroughTheNormalizer)
+{
+   std::mt19937_64 gen(3);
+   std::set<u64> unique;
+   while (unique.size() < 20000) {
+      unique.insert(gen());
+   }
+   std::vector<std::vector<u8>> folded;
+   for (const u64 key : unique) {
+      folded.emplace_back(sizeof(u64));
+      leanstore::fold(folded.back().data(), key);
+   }
+   KeyNormalizer<MODEL_KEY> normalizer;
+   normalizer.learn(folded.front().data(), sizeof(u64), folded.back().data(), sizeof(u64));
+   std::vector<MODEL_KEY> keys;
+   for (const auto& key : folded) {
+      keys.push_back(normalizer.normalize(key.data(), key.size()));
+   }
+   ASSERT_TRUE(std::equal(keys.begin(), keys.end(), unique.begin()));
+   spline::Builder<MODEL_KEY> builder(16);
+   for (const MODEL_KEY key : keys) {
+      builder.AddKey(key);
+   }
+   const auto spline = spline::RadixSpline<MODEL_KEY>(16, keys.size(), builder.Finalize());
+   for (auto model : {ROUTER_MODEL::SPLINE, ROUTER_MODEL::LINEAR, ROUTER_MODEL::RMI, ROUTER_MODEL::PLA}) {
+      RootRouter<MODEL_KEY> router;
+      router.build({model, ROUTER_SEARCH::SIMD}, keys, spline);
+      for (size_t i = 0; i < keys.size(); i += 7) {
+         ASSERT_EQ(router.search(keys, keys[i], router.estimate(keys[i])), i);
+      }
+   }
+}
+
+TEST(RouterConfigTest, Parse)
+{
+   auto config = RouterConfig::parse("linear", "exponential");
+   EXPECT_EQ(config.model, ROUTER_MODEL::LINEAR);
+   EXPECT_EQ(config.search, ROUTER_SEARCH::EXPONENTIAL);
+   EXPECT_EQ(RouterConfig::parse("rmi", "simd").model, ROUTER_MODEL::RMI);
+   EXPECT_ANY_THROW(RouterConfig::parse("pgm", "simd"));
+}
+
+TYPED_TEST(LearnedRouterTest, RMILeavesRouteContiguousRanges)
+{
+   for (size_t leaf_models : {size_t(1), size_t(7), size_t(1000), this->keys.size() * 2}) {
+      rmi::TwoStageRMI<TypeParam> rmi;
+      rmi.train(this->keys, leaf_models);
+      EXPECT_LE(rmi.leaf_models(), this->keys.size());
+      for (size_t i = 0; i < this->keys.size(); i++) {
+         const auto bound = rmi.GetSearchBound(this->keys[i]);
+         ASSERT_LE(bound.begin, i);
+         ASSERT_LT(i, bound.end);
+         if (i > 0) {
+            ASSERT_LE(rmi.leafOf(this->keys[i - 1]), rmi.leafOf(this->keys[i]));
+         }
+      }
+   }
+}
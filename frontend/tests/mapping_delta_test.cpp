@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <leanstore/rs/radix_spline.h>
+#include <leanstore/rs/refit.hpp>
+#include <leanstore/storage/btree/core/BlockedMapping.hpp>
+#include <leanstore/storage/btree/core/MappingDelta.hpp>
+#include <vector>
+
+using leanstore::storage::BufferFrame;
+using leanstore::storage::btree::BlockedMapping;
+using leanstore::storage::btree::MappingDelta;
+using leanstore::storage::btree::MappingDeltaBuffer;
+
+class MappingDeltaFixture : public ::testing::Test
+{
+  protected:
+   void SetUp() override
+   {
+      for (MODEL_KEY k = 10; k <= 1000; k += 10) {
+         keys.push_back(k);
+         pids.push_back(k);
+         bfs.push_back(nullptr);
+      }
+      // rightmost leaf has no separator
+      pids.push_back(9999);
+      bfs.push_back(nullptr);
+   }
+   size_t lowerBound(const std::vector<MODEL_KEY>& v, MODEL_KEY key) { return std::lower_bound(v.begin(), v.end(), key) - v.begin(); }
+
+  public:
+   std::vector<MODEL_KEY> keys;
+   std::vector<PID> pids;
+   std::vector<BufferFrame*> bfs;
+};
+
+TEST_F(MappingDeltaFixture, ResolvePublishedSplit)
+{
+   MappingDeltaBuffer buffer;
+   // leaf 50 got split at 45
+   buffer.publish(45, 4500, nullptr);
+   size_t idx = lowerBound(keys, 42);
+   PID pid = 0;
+   BufferFrame* bf = nullptr;
+   EXPECT_TRUE(buffer.resolve(42, keys, idx, pid, bf));
+   EXPECT_EQ(pid, 4500);
+   idx = lowerBound(keys, 47);
+   EXPECT_FALSE(buffer.resolve(47, keys, idx, pid, bf));
+   EXPECT_EQ(keys[idx], 50);
+}
+
+TEST_F(MappingDeltaFixture, ResolveRetractedSeparator)
+{
+   MappingDeltaBuffer buffer;
+   // leaf 50 got merged into leaf 60
+   buffer.retract(50);
+   size_t idx = lowerBound(keys, 45);
+   PID pid = 0;
+   BufferFrame* bf = nullptr;
+   EXPECT_FALSE(buffer.resolve(45, keys, idx, pid, bf));
+   EXPECT_EQ(keys[idx], 60);
+}
+
+TEST_F(MappingDeltaFixture, ResolveSkipsFoldedDeltas)
+{
+   MappingDeltaBuffer buffer;
+   buffer.retract(50);
+   buffer.publish(45, 4500, nullptr);
+   const u64 folded_seq = buffer.sequence();
+   buffer.publish(47, 4700, nullptr);
+   // a model with the retraction and the first split folded in, the buffer still has them until erase
+   std::vector<MODEL_KEY> folded = keys;
+   folded.erase(std::find(folded.begin(), folded.end(), 50));
+   folded.insert(std::lower_bound(folded.begin(), folded.end(), 45), 45);
+   size_t idx = lowerBound(folded, 42);
+   PID pid = 0;
+   BufferFrame* bf = nullptr;
+   EXPECT_FALSE(buffer.resolve(42, folded, idx, pid, bf, folded_seq));
+   EXPECT_EQ(folded[idx], 45);
+   idx = lowerBound(folded, 46);
+   EXPECT_TRUE(buffer.resolve(46, folded, idx, pid, bf, folded_seq));
+   EXPECT_EQ(pid, 4700);
+}
+
+TEST_F(MappingDeltaFixture, ApplyAndRefit)
+{
+   auto builder = spline::Builder<MODEL_KEY>(4);
+   for (auto k : keys) {
+      builder.AddKey(k);
+   }
+   auto points = builder.Finalize();
+   MappingDeltaBuffer buffer;
+   buffer.publish(45, 4500, nullptr);
+   buffer.publish(47, 4700, nullptr);
+   buffer.retract(500);
+   buffer.publish(1005, 10050, nullptr);
+   std::vector<MODEL_KEY> new_keys, dirty_keys;
+   std::vector<PID> new_pids;
+   std::vector<BufferFrame*> new_bfs;
+   MappingDeltaBuffer::apply(buffer.snapshot(), keys, pids, bfs, new_keys, new_pids, new_bfs, dirty_keys);
+   EXPECT_EQ(new_keys.size(), keys.size() + 2);
+   EXPECT_EQ(new_pids.size(), new_keys.size() + 1);
+   EXPECT_EQ(new_pids[lowerBound(new_keys, 45)], 4500);
+   EXPECT_EQ(new_pids.back(), 9999);
+   EXPECT_EQ(dirty_keys.size(), 4);
+   // every key has to be found within max_error of the refitted spline
+   auto spline = spline::RadixSpline<MODEL_KEY>(4, new_pids.size(), spline::RefitSegments(points, new_keys, dirty_keys, 4));
+   for (size_t i = 1; i < new_keys.size(); i++) {
+      auto estimate = spline.GetEstimatedPosition(new_keys[i]);
+      EXPECT_LE(std::abs(estimate - static_cast<double>(i)), 4.0 + 1e-6);
+   }
+   buffer.erase(buffer.snapshot());
+   EXPECT_TRUE(buffer.empty());
+}
+
+TEST_F(MappingDeltaFixture, BlockedMappingSearch)
+{
+   BlockedMapping mapping;
+   mapping.build(keys, pids, bfs);
+   EXPECT_EQ(mapping.size(), keys.size());
+   EXPECT_EQ(mapping.leaf(keys.size()).pid, 9999);
+   for (MODEL_KEY key = 0; key <= 1010; key++) {
+      const size_t expected = lowerBound(keys, key);
+      // exact for any estimate, the window is only where the search starts
+      for (double estimate : {static_cast<double>(expected), 0.0, 99.0, expected + 7.5}) {
+         ASSERT_EQ(mapping.search(key, estimate, 4), expected);
+      }
+   }
+   MappingDeltaBuffer buffer;
+   buffer.retract(50);
+   size_t idx = mapping.search(45, 4, 4);
+   PID pid = 0;
+   BufferFrame* bf = nullptr;
+   EXPECT_FALSE(buffer.resolve(45, mapping.keys(), idx, pid, bf));
+   EXPECT_EQ(mapping.key(idx), 60);
+}
@@ -0,0 +1,32 @@
+#include <gtest/gtest.h>
+#include <leanstore/utils/NUMA.hpp>
+#include <sys/mman.h>
+#include <set>
+
+using namespace leanstore::utils;
+
+TEST(NUMATest, EveryCPUBelongsToOneNode)
+{
+   const u64 nodes = numa::machineNodes();
+   ASSERT_GE(nodes, 1u);
+   std::set<u64> cpus;
+   for (u64 node = 0; node < nodes; node++) {
+      for (u64 cpu : numa::cpusOfNode(node)) {
+         EXPECT_TRUE(cpus.insert(cpu).second);
+         EXPECT_EQ(numa::nodeOfCPU(cpu), node);
+      }
+   }
+   EXPECT_FALSE(cpus.empty());
+}
+
+TEST(NUMATest, BindsUntouchedMemory)
+{
+   const u64 bytes = 16 * 4096;
+   void* region = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   ASSERT_NE(region, MAP_FAILED);
+   // Unaligned ends are shrunk to whole pages
+   EXPECT_TRUE(numa::bindMemory(static_cast<u8*>(region) + 100, bytes - 200, 0));
+   EXPECT_FALSE(numa::bindMemory(region, bytes, 1024 * 1024));
+   static_cast<u8*>(region)[4096] = 1;
+   munmap(region, bytes);
+}
@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+#include <leanstore/compileConst.hpp>
+#include <leanstore/rs/partitioned.hpp>
+#include <leanstore/rs/radix_spline.h>
+#include <random>
+#include <set>
+#include <vector>
+
+TEST(PartitionedSplineTest, StitchedRangesKeepMaxError)
+{
+   std::mt19937 gen(42);
+   std::uniform_int_distribution<KEY> dist(0, std::numeric_limits<KEY>::max());
+   std::set<KEY> unique;
+   while (unique.size() < 100000) {
+      unique.insert(dist(gen));
+   }
+   std::vector<KEY> keys(unique.begin(), unique.end());
+   const size_t max_error = 16;
+   for (size_t ranges : {1, 3, 8}) {
+      std::vector<std::vector<spline::Coord<KEY>>> parts(ranges);
+      for (size_t r_i = 0; r_i < ranges; r_i++) {
+         parts[r_i] = spline::BuildRange(keys, r_i * (keys.size() - 1) / ranges, (r_i + 1) * (keys.size() - 1) / ranges, max_error);
+      }
+      auto points = spline::StitchRanges(parts);
+      for (size_t p_i = 1; p_i < points.size(); p_i++) {
+         EXPECT_LT(points[p_i - 1].x, points[p_i].x);
+      }
+      EXPECT_EQ(points.front().x, keys.front());
+      EXPECT_EQ(points.back().x, keys.back());
+      auto spline = spline::RadixSpline<KEY>(max_error, keys.size(), points);
+      for (size_t i = 0; i + 1 < keys.size(); i++) {
+         auto estimate = spline.GetEstimatedPosition(keys[i]);
+         ASSERT_LE(std::abs(estimate - static_cast<double>(i)), max_error + 1e-6);
+      }
+   }
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <Units.hpp>
+#include <leanstore/pla/pla.hpp>
+#include <leanstore/rs/builder.hpp>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+#include <vector>
+
+// Uniform gaps with a few dense runs, so that neither model gets away with one line
+template <typename Key>
+static std::vector<Key> skewedKeys(size_t count)
+{
+   std::mt19937_64 gen(42);
+   std::set<Key> unique;
+   Key key = 0;
+   while (unique.size() < count) {
+      key += (gen() % 64 == 0) ? 1 + gen() % 4 : 1 + gen() % 1000;
+      unique.insert(key);
+   }
+   return std::vector<Key>(unique.begin(), unique.end());
+}
+
+template <typename Key>
+class PLATest : public ::testing::Test
+{
+};
+using KeyTypes = ::testing::Types<u32, u64>;
+TYPED_TEST_SUITE(PLATest, KeyTypes);
+
+TYPED_TEST(PLATest, SegmentsKeepMaxErrorAndBeatTheSpline)
+{
+   const auto keys = skewedKeys<TypeParam>(200000);
+   for (size_t max_error : {2, 16, 64}) {
+      pla::Builder<TypeParam> builder(max_error);
+      for (const auto key : keys) {
+         builder.AddKey(key);
+      }
+      const auto segments = builder.Finalize();
+      size_t s_i = 0;
+      for (size_t i = 0; i < keys.size(); i++) {
+         while (s_i + 1 < segments.size() && segments[s_i + 1].key <= keys[i]) {
+            s_i++;
+         }
+         ASSERT_LE(std::abs(segments[s_i].Estimate(keys[i]) - static_cast<double>(i)), max_error + 1e-3);
+      }
+      spline::Builder<TypeParam> spline_builder(max_error);
+      for (const auto key : keys) {
+         spline_builder.AddKey(key);
+      }
+      EXPECT_LE(segments.size(), spline_builder.Finalize().size() - 1);
+   }
+}
+
+TYPED_TEST(PLATest, RecursiveLevelsFindTheSegment)
+{
+   const auto keys = skewedKeys<TypeParam>(200000);
+   for (size_t recursive_error : {0, 1, 4}) {
+      pla::RecursivePLA<TypeParam> pla;
+      pla.Build(keys, 2, recursive_error);
+      EXPECT_EQ(pla.GetNumLevels() > 1, recursive_error > 0);
+      pla::Builder<TypeParam> builder(2);
+      for (const auto key : keys) {
+         builder.AddKey(key);
+      }
+      const auto segments = builder.Finalize();
+      ASSERT_EQ(pla.GetNumSegments(), segments.size());
+      std::mt19937_64 gen(7);
+      for (size_t i = 0; i < 50000; i++) {
+         // Keys of the mapping, keys in between and keys outside of it
+         const TypeParam key = (i % 3 == 0) ? keys[gen() % keys.size()] : gen() % (keys.back() + 100);
+         const auto it = std::upper_bound(segments.begin(), segments.end(), key, [](TypeParam k, const auto& s) { return k < s.key; });
+         const size_t expected = (it == segments.begin()) ? 0 : (it - segments.begin()) - 1;
+         ASSERT_EQ(pla.GetSegment(key), expected);
+      }
+      for (size_t i = 0; i < keys.size(); i++) {
+         ASSERT_LE(std::abs(pla.GetEstimatedPosition(keys[i]) - static_cast<double>(i)), 2 + 1e-3);
+      }
+   }
+}
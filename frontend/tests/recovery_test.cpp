@@ -0,0 +1,483 @@
+#include <gtest/gtest.h>
+#include <Exceptions.hpp>
+#include <leanstore/Config.hpp>
+#include <leanstore/concurrency-recovery/CRMG.hpp>
+#include <leanstore/storage/btree/BTreeLL.hpp>
+#include <leanstore/storage/buffer-manager/DTRegistry.hpp>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace leanstore;
+using namespace leanstore::cr;
+using namespace leanstore::storage;
+using namespace leanstore::storage::btree;
+
+// The records the B-Tree logs, written straight into the WAL of the workers and replayed by CRManager::redo
+// on the pages of a scratch SSD file. The group committer runs as in LeanStore, every restart is a new CRManager
+// on the same WAL stripes.
+class RecoveryTest : public ::testing::Test
+{
+  protected:
+   static constexpr u64 WORKERS = 2;
+   static constexpr u64 STRIPES = 2;
+   std::vector<std::string> paths;
+   std::string ssd_path = ::testing::TempDir() + "recovery_test.ssd";
+   int ssd_fd = -1;
+   BTreeLL btree;
+   DTID dt_id = 0;
+   std::unique_ptr<CRManager> crm;
+   std::atomic<LID> gsn_counter = 0;
+   void SetUp() override
+   {
+      ssd_fd = open(ssd_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+      ASSERT_NE(ssd_fd, -1);
+      std::string files;
+      for (u64 s_i = 0; s_i < STRIPES; s_i++) {
+         paths.push_back(::testing::TempDir() + "recovery_test_" + std::to_string(s_i) + ".wal");
+         std::remove(paths.back().c_str());
+         files += (s_i ? "," : "") + paths.back();
+      }
+      FLAGS_wal = true;
+      FLAGS_wal_fsync = false;
+      FLAGS_wal_files = files;
+      FLAGS_wal_file_gib = 1;
+      FLAGS_worker_threads = WORKERS;
+      // The group committer is pinned to the CPU behind the page providers, there are none here
+      FLAGS_pp_threads = 0;
+      DTRegistry::global_dt_registry.registerDatastructureType(0, BTreeLL::getMeta());
+      dt_id = DTRegistry::global_dt_registry.registerDatastructureInstance(0, &btree, "recovery_test");
+      crm = std::make_unique<CRManager>(ssd_fd, 0);
+   }
+   void TearDown() override
+   {
+      crm.reset();
+      DTRegistry::global_dt_registry.dt_instances_ht.erase(dt_id);
+      FLAGS_wal = false;
+      FLAGS_wal_files = "";
+      close(ssd_fd);
+      std::remove(ssd_path.c_str());
+      for (const auto& path : paths) {
+         std::remove(path.c_str());
+      }
+   }
+   // -------------------------------------------------------------------------------------
+   // A crash: the workers and the group committer are gone, the WAL stripes and the SSD stay
+   void restart()
+   {
+      crm.reset();
+      crm = std::make_unique<CRManager>(ssd_fd, 0);
+   }
+   // The records logs one transaction on worker w_i, it returns once the group commit acknowledged it
+   void commit(u64 w_i, std::function<void()> records)
+   {
+      crm->scheduleJobSync(w_i, [&]() {
+         Worker& worker = Worker::my();
+         worker.startTX();
+         records();
+         worker.commitTX();
+         const Transaction tx = worker.active_tx;
+         while (!worker.isCommitted(tx)) {
+         }
+      });
+   }
+   // -------------------------------------------------------------------------------------
+   // One DT record of the test's tree at the next GSN, from inside a job of a worker. As PageGuard::reserveWALEntry,
+   // the payload begins at T::payload, within the tail padding of T
+   template <typename T>
+   Worker::WALEntryHandler<T> reserve(PID pid, u64 payload_size)
+   {
+      Worker& worker = Worker::my();
+      worker.walEnsureEnoughSpace(sizeof(WALDTEntry) + sizeof(T) + payload_size);
+      const LID gsn = ++gsn_counter;
+      worker.setCurrentGSN(gsn);
+      return worker.reserveDTEntry<T>(sizeof(T) + payload_size, pid, gsn, dt_id);
+   }
+   template <typename T>
+   void log(PID pid, const T& record)
+   {
+      auto entry = reserve<T>(pid, 0);
+      *entry = record;
+      entry.submit();
+   }
+   template <typename T>
+   void log(PID pid, const T& record, const std::vector<u8>& payload)
+   {
+      auto entry = reserve<T>(pid, payload.size());
+      *entry = record;
+      std::memcpy(entry->payload, payload.data(), payload.size());
+      entry.submit();
+   }
+   // Keys are big endian, their order is the one of the numbers
+   static std::vector<u8> key(u64 k)
+   {
+      const u64 big_endian = __builtin_bswap64(k);
+      const u8* bytes = reinterpret_cast<const u8*>(&big_endian);
+      return {bytes, bytes + sizeof(u64)};
+   }
+   static std::vector<u8> value(u64 v)
+   {
+      const u8* bytes = reinterpret_cast<const u8*>(&v);
+      return {bytes, bytes + sizeof(u64)};
+   }
+   static void append(std::vector<u8>& dest, const std::vector<u8>& src) { dest.insert(dest.end(), src.begin(), src.end()); }
+   // -------------------------------------------------------------------------------------
+   void logInitPage(PID pid, bool is_leaf, PID root_pid = -1)
+   {
+      WALInitPage init_page;
+      init_page.type = WAL_LOG_TYPE::WALInitPage;
+      init_page.dt_id = dt_id;
+      init_page.is_leaf = is_leaf;
+      init_page.root_pid = root_pid;
+      log(pid, init_page);
+   }
+   void logInsert(PID pid, u64 k, u64 v)
+   {
+      BTreeLL::WALInsert insert;
+      insert.type = WAL_LOG_TYPE::WALInsert;
+      insert.key_length = sizeof(u64);
+      insert.value_length = sizeof(u64);
+      std::vector<u8> payload = key(k);
+      append(payload, value(v));
+      log(pid, insert, payload);
+   }
+   // One DELTA_COPY of the whole value: offset, size, before image, after image
+   void logUpdate(PID pid, u64 k, u64 before, u64 after)
+   {
+      BTreeLL::WALUpdate update;
+      update.type = WAL_LOG_TYPE::WALUpdate;
+      update.key_length = sizeof(u64);
+      std::vector<u8> payload = key(k);
+      const u16 delta[2] = {0, sizeof(u64)};
+      payload.insert(payload.end(), reinterpret_cast<const u8*>(delta), reinterpret_cast<const u8*>(delta + 2));
+      append(payload, value(before));
+      append(payload, value(after));
+      log(pid, update, payload);
+   }
+   void logRemove(PID pid, u64 k, u64 v)
+   {
+      BTreeLL::WALRemove remove;
+      remove.type = WAL_LOG_TYPE::WALRemove;
+      remove.key_length = sizeof(u64);
+      remove.value_length = sizeof(u64);
+      std::vector<u8> payload = key(k);
+      append(payload, value(v));
+      log(pid, remove, payload);
+   }
+   static std::vector<u8> image(BTreeNode& node)
+   {
+      std::vector<u8> image(BTreeGeneric::nodeImageSize(node));
+      BTreeGeneric::logNodeImage(node, image.data());
+      return image;
+   }
+   // -------------------------------------------------------------------------------------
+   std::unique_ptr<BufferFrame::Page> readPage(PID pid)
+   {
+      auto page = std::make_unique<BufferFrame::Page>();
+      EXPECT_EQ(pread(ssd_fd, page.get(), PAGE_SIZE, pid * PAGE_SIZE), s64(PAGE_SIZE));
+      return page;
+   }
+   static BTreeNode& node(BufferFrame::Page& page) { return *reinterpret_cast<BTreeNode*>(page.dt); }
+   static std::optional<u64> lookup(BTreeNode& node, u64 k)
+   {
+      const auto key_bytes = key(k);
+      const s16 slot_id = node.lowerBound<true>(key_bytes.data(), key_bytes.size());
+      if (slot_id == -1) {
+         return std::nullopt;
+      }
+      EXPECT_EQ(node.getPayloadLength(slot_id), sizeof(u64));
+      u64 v;
+      std::memcpy(&v, node.getPayload(slot_id), sizeof(u64));
+      return v;
+   }
+   static PID child(BTreeNode& node, u16 slot_id)
+   {
+      EXPECT_TRUE(node.getChild(slot_id).isEVICTED());
+      return node.getChild(slot_id).asPageID();
+   }
+   static PID upper(BTreeNode& node)
+   {
+      EXPECT_TRUE(node.upper.isEVICTED());
+      return node.upper.asPageID();
+   }
+   // -------------------------------------------------------------------------------------
+   struct Chunk {
+      u64 round, total_size, stripe_i, offset;
+   };
+   // Every chunk the stripe metas reach, in the order of the rounds
+   std::vector<Chunk> chunks()
+   {
+      std::vector<Chunk> chunks;
+      auto header = static_cast<WALChunk*>(std::aligned_alloc(512, sizeof(WALChunk)));
+      auto meta = static_cast<SSDMeta*>(std::aligned_alloc(512, sizeof(SSDMeta)));
+      for (u64 s_i = 0; s_i < crm->wal_stripes.size(); s_i++) {
+         const auto& stripe = crm->wal_stripes[s_i];
+         const u64 meta_offset = stripe.end - sizeof(SSDMeta);
+         EXPECT_EQ(pread(stripe.fd, meta, sizeof(SSDMeta), meta_offset), s64(sizeof(SSDMeta)));
+         for (u64 offset = meta->last_written_chunk; offset && offset < meta_offset; offset += header->total_size) {
+            EXPECT_EQ(pread(stripe.fd, header, sizeof(WALChunk), offset), s64(sizeof(WALChunk)));
+            chunks.push_back({header->round, header->total_size, s_i, offset});
+         }
+      }
+      free(header);
+      free(meta);
+      std::sort(chunks.begin(), chunks.end(), [](const Chunk& a, const Chunk& b) { return a.round < b.round; });
+      return chunks;
+   }
+};
+// -------------------------------------------------------------------------------------
+TEST_F(RecoveryTest, InsertUpdateRemoveRoundTrip)
+{
+   constexpr PID LEAF = 1;
+   constexpr u64 KEYS = 10;
+   commit(0, [&]() {
+      logInitPage(LEAF, true);
+      for (u64 k = 0; k < KEYS; k++) {
+         logInsert(LEAF, k, k);
+      }
+   });
+   commit(1, [&]() {
+      logUpdate(LEAF, 3, 3, 33);
+      logRemove(LEAF, 5, 5);
+   });
+   commit(0, [&]() { logInsert(LEAF, KEYS, 100); });
+   restart();
+   const auto stats = crm->redo();
+   EXPECT_EQ(stats.records, 1 + KEYS + 2 + 1);
+   EXPECT_EQ(stats.pages, 1u);
+   EXPECT_EQ(stats.max_pid, LEAF);
+   auto page = readPage(LEAF);
+   EXPECT_EQ(page->dt_id, dt_id);
+   EXPECT_EQ(page->GSN, gsn_counter.load());
+   EXPECT_EQ(page->magic_debugging_number, LEAF);
+   ASSERT_TRUE(node(*page).is_leaf);
+   EXPECT_EQ(node(*page).count, KEYS);
+   for (u64 k = 0; k < KEYS; k++) {
+      if (k == 5) {
+         EXPECT_FALSE(lookup(node(*page), k));
+      } else {
+         EXPECT_EQ(lookup(node(*page), k), k == 3 ? 33 : k);
+      }
+   }
+   EXPECT_EQ(lookup(node(*page), KEYS), 100u);
+   // A crash during recovery replays the same WAL on the pages redo already wrote
+   crm->redo();
+   auto again = readPage(LEAF);
+   EXPECT_EQ(std::memcmp(page.get(), again.get(), PAGE_SIZE), 0);
+}
+// -------------------------------------------------------------------------------------
+// The records BTreeGeneric::trySplit logs for a root split and BTreeGeneric::tryMerge for the merge of the two leaves
+TEST_F(RecoveryTest, SplitAndMergeRoundTrip)
+{
+   constexpr PID META = 1, LEAF = 2, NEW_ROOT = 3, NEW_LEFT = 4;
+   constexpr u64 KEYS = 20;
+   constexpr s32 RIGHT_POS = KEYS / 2 - 1;
+   BTreeNode leaf(true);
+   for (u64 k = 0; k < KEYS; k++) {
+      const auto key_bytes = key(k);
+      const auto value_bytes = value(k);
+      ASSERT_TRUE(leaf.prepareInsert(key_bytes.size(), value_bytes.size()));
+      leaf.insert(key_bytes.data(), key_bytes.size(), value_bytes.data(), value_bytes.size());
+   }
+   auto sep = key(RIGHT_POS);
+   BTreeNode left(true);
+   left.setFences(nullptr, 0, sep.data(), sep.size());
+   leaf.copyKeyValueRange(&left, 0, 0, RIGHT_POS + 1);
+   left.makeHint();
+   // -------------------------------------------------------------------------------------
+   commit(0, [&]() {
+      logInitPage(LEAF, true);
+      logInitPage(META, false, LEAF);
+      for (u64 k = 0; k < KEYS; k++) {
+         logInsert(LEAF, k, k);
+      }
+   });
+   commit(1, [&]() {
+      WALLogicalSplit split;
+      split.type = WAL_LOG_TYPE::WALLogicalSplit;
+      split.parent_pid = NEW_ROOT;
+      split.left_pid = NEW_LEFT;
+      split.right_pid = LEAF;
+      split.right_pos = RIGHT_POS;
+      split.sep_length = sep.size();
+      split.root_split = true;
+      logInitPage(NEW_ROOT, false);
+      logInitPage(NEW_LEFT, true);
+      log(LEAF, split, sep);
+      log(NEW_ROOT, split, sep);
+      std::vector<u8> payload = sep;
+      append(payload, image(left));
+      log(NEW_LEFT, split, payload);
+      WALLogicalSplit meta_split = split;
+      meta_split.sep_length = 0;
+      log(META, meta_split);
+   });
+   restart();
+   auto stats = crm->redo();
+   EXPECT_EQ(stats.pages, 4u);
+   EXPECT_EQ(btree.redone_smos, 1u);
+   // As LeanStore once the redone pages are on the SSD, the next rounds start from an empty WAL
+   crm->resetWAL();
+   auto meta = readPage(META);
+   EXPECT_EQ(upper(node(*meta)), NEW_ROOT);
+   auto root = readPage(NEW_ROOT);
+   ASSERT_FALSE(node(*root).is_leaf);
+   ASSERT_EQ(node(*root).count, 1);
+   EXPECT_EQ(child(node(*root), 0), NEW_LEFT);
+   EXPECT_EQ(upper(node(*root)), LEAF);
+   auto left_page = readPage(NEW_LEFT);
+   auto right_page = readPage(LEAF);
+   EXPECT_EQ(node(*left_page).count, RIGHT_POS + 1);
+   EXPECT_EQ(node(*right_page).count, KEYS - RIGHT_POS - 1);
+   for (u64 k = 0; k < KEYS; k++) {
+      EXPECT_EQ(lookup(node(*(s32(k) <= RIGHT_POS ? left_page : right_page)), k), k);
+      EXPECT_FALSE(lookup(node(*(s32(k) <= RIGHT_POS ? right_page : left_page)), k));
+   }
+   // -------------------------------------------------------------------------------------
+   // The left leaf goes back into the right one, the root keeps only its upper
+   commit(0, [&]() {
+      WALLogicalMerge merge;
+      merge.type = WAL_LOG_TYPE::WALLogicalMerge;
+      merge.parent_pid = NEW_ROOT;
+      merge.left_pid = NEW_LEFT;
+      merge.right_pid = LEAF;
+      merge.left_pos = 0;
+      log(NEW_ROOT, merge);
+      log(LEAF, merge, image(leaf));
+   });
+   restart();
+   btree.redone_smos = 0;
+   stats = crm->redo();
+   EXPECT_EQ(stats.records, 2u);
+   EXPECT_EQ(btree.redone_smos, 1u);
+   meta = readPage(META);
+   EXPECT_EQ(upper(node(*meta)), NEW_ROOT);
+   root = readPage(NEW_ROOT);
+   EXPECT_EQ(node(*root).count, 0);
+   EXPECT_EQ(upper(node(*root)), LEAF);
+   right_page = readPage(LEAF);
+   EXPECT_EQ(node(*right_page).count, KEYS);
+   for (u64 k = 0; k < KEYS; k++) {
+      EXPECT_EQ(lookup(node(*right_page), k), k);
+   }
+}
+// -------------------------------------------------------------------------------------
+// The newest chunk of one stripe is lost, the rounds after it on the other stripe must not be replayed
+TEST_F(RecoveryTest, TruncatesAtTheFirstMissingRound)
+{
+   constexpr PID LEAF = 1;
+   constexpr u64 TXS = 40;
+   commit(0, [&]() { logInitPage(LEAF, true); });
+   for (u64 k = 0; k < TXS; k++) {
+      commit(0, [&]() { logInsert(LEAF, k, k); });
+   }
+   restart();
+   const auto all = chunks();
+   ASSERT_GE(all.size(), 3u);
+   // The other stripe than the one of the last round loses its newest round
+   u64 kept = all.size() - 1;
+   while (kept > 0 && all[kept].stripe_i == all.back().stripe_i) {
+      kept--;
+   }
+   ASSERT_GT(kept, 0u);
+   const Chunk& lost = all[kept];
+   {
+      const auto& stripe = crm->wal_stripes[lost.stripe_i];
+      const u64 meta_offset = stripe.end - sizeof(SSDMeta);
+      auto meta = static_cast<SSDMeta*>(std::aligned_alloc(512, sizeof(SSDMeta)));
+      ASSERT_EQ(pread(stripe.fd, meta, sizeof(SSDMeta), meta_offset), s64(sizeof(SSDMeta)));
+      ASSERT_EQ(meta->last_written_chunk, lost.offset);
+      meta->last_written_chunk = lost.offset + lost.total_size < meta_offset ? lost.offset + lost.total_size : 0;
+      ASSERT_EQ(pwrite(stripe.fd, meta, sizeof(SSDMeta), meta_offset), s64(sizeof(SSDMeta)));
+      free(meta);
+   }
+   const auto stats = crm->redo();
+   EXPECT_EQ(stats.chunks, kept);
+   auto page = readPage(LEAF);
+   // A prefix of the transactions survives, none after the lost round
+   u64 present = 0;
+   while (present < TXS && lookup(node(*page), present)) {
+      present++;
+   }
+   EXPECT_LT(present, TXS);
+   EXPECT_EQ(node(*page).count, present);
+   EXPECT_EQ(stats.records, 1 + present);
+}
+// -------------------------------------------------------------------------------------
+// Two workers take turns on one tuple, every round goes to the other stripe than the one before
+TEST_F(RecoveryTest, ReplaysRoundsOfAllStripesInOrder)
+{
+   constexpr PID LEAF = 1;
+   constexpr u64 TURNS = 50;
+   commit(0, [&]() {
+      logInitPage(LEAF, true);
+      logInsert(LEAF, 0, 0);
+   });
+   for (u64 t = 0; t < TURNS; t++) {
+      commit(t % WORKERS, [&]() {
+         logUpdate(LEAF, 0, t, t + 1);
+         logInsert(LEAF, 1 + t, t);
+      });
+   }
+   restart();
+   const auto all = chunks();
+   u64 stripes_used = 0;
+   for (u64 s_i = 0; s_i < STRIPES; s_i++) {
+      stripes_used += std::any_of(all.begin(), all.end(), [&](const Chunk& chunk) { return chunk.stripe_i == s_i; });
+   }
+   EXPECT_EQ(stripes_used, STRIPES);
+   const auto stats = crm->redo();
+   EXPECT_EQ(stats.chunks, all.size());
+   EXPECT_EQ(stats.records, 2 + 2 * TURNS);
+   auto page = readPage(LEAF);
+   EXPECT_EQ(lookup(node(*page), 0), TURNS);
+   for (u64 t = 0; t < TURNS; t++) {
+      EXPECT_EQ(lookup(node(*page), 1 + t), t);
+   }
+}
+// -------------------------------------------------------------------------------------
+// No page of the tree ever reached the SSD: BTreeGeneric::create logs the root and the meta node pointing to it,
+// the redo alone rebuilds the tree LeanStore::registerBTreeLL checkpointed
+TEST_F(RecoveryTest, RedoesATreeCreatedAfterTheLastPageWrite)
+{
+   constexpr PID META = 7, ROOT = 8;
+   constexpr u64 KEYS = 16;
+   commit(1, [&]() {
+      logInitPage(ROOT, true);
+      logInitPage(META, false, ROOT);
+   });
+   commit(0, [&]() {
+      for (u64 k = 0; k < KEYS; k++) {
+         logInsert(ROOT, k, 2 * k);
+      }
+   });
+   struct stat st;
+   ASSERT_EQ(fstat(ssd_fd, &st), 0);
+   ASSERT_EQ(st.st_size, 0);
+   restart();
+   const auto stats = crm->redo();
+   EXPECT_EQ(stats.pages, 2u);
+   EXPECT_EQ(stats.max_pid, ROOT);
+   auto meta = readPage(META);
+   EXPECT_EQ(meta->dt_id, dt_id);
+   EXPECT_FALSE(node(*meta).is_leaf);
+   EXPECT_EQ(node(*meta).count, 0);
+   EXPECT_EQ(upper(node(*meta)), ROOT);
+   auto root = readPage(ROOT);
+   EXPECT_EQ(root->dt_id, dt_id);
+   ASSERT_TRUE(node(*root).is_leaf);
+   EXPECT_EQ(node(*root).count, KEYS);
+   for (u64 k = 0; k < KEYS; k++) {
+      EXPECT_EQ(lookup(node(*root), k), 2 * k);
+   }
+}
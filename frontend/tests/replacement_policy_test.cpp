@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <Units.hpp>
+#include <leanstore/storage/buffer-manager/CoolingQueue.hpp>
+#include <leanstore/storage/buffer-manager/ReplacementPolicy.hpp>
+#include <memory>
+#include <vector>
+
+using namespace leanstore::storage;
+
+TEST(CoolingQueueTest, FifoUpToCapacity)
+{
+   CoolingQueue queue(100);
+   ASSERT_EQ(queue.capacity(), 128u);
+   std::vector<BufferFrame*> frames(queue.capacity() + 1);
+   for (u64 i = 0; i < frames.size(); i++) {
+      frames[i] = reinterpret_cast<BufferFrame*>(i + 1);
+   }
+   for (u64 i = 0; i < queue.capacity(); i++) {
+      ASSERT_TRUE(queue.push(frames[i]));
+   }
+   EXPECT_FALSE(queue.push(frames.back()));
+   BufferFrame* bf;
+   ASSERT_TRUE(queue.pop(bf));
+   EXPECT_EQ(bf, frames[0]);
+   // Pushed back behind the rest
+   EXPECT_TRUE(queue.push(bf));
+   for (u64 i = 1; i < queue.capacity(); i++) {
+      ASSERT_TRUE(queue.pop(bf));
+      EXPECT_EQ(bf, frames[i]);
+   }
+   ASSERT_TRUE(queue.pop(bf));
+   EXPECT_EQ(bf, frames[0]);
+   EXPECT_FALSE(queue.pop(bf));
+}
+
+class ReplacementPolicyTest : public ::testing::Test
+{
+  protected:
+   static constexpr u64 FRAMES = 64;
+   std::unique_ptr<BufferFrame[]> bfs{new BufferFrame[FRAMES]};
+   void SetUp() override
+   {
+      for (u64 i = 0; i < FRAMES; i++) {
+         bfs[i].header.state = BufferFrame::STATE::HOT;
+         bfs[i].header.access = 200;
+      }
+   }
+};
+
+TEST_F(ReplacementPolicyTest, ClockGivesReferencedFramesASecondChance)
+{
+   bfs[5].header.access = 0;
+   bfs[9].header.keep_in_memory = true;
+   bfs[9].header.access = 0;
+   ClockPolicy clock(bfs.get(), FRAMES);
+   EXPECT_EQ(&clock.pick(), &bfs[5]);
+   EXPECT_EQ(bfs[0].header.access, 0);
+   // A touched frame is referenced again, the second lap passes over it
+   bfs[1].touch();
+   EXPECT_EQ(&clock.pick(), &bfs[0]);
+   EXPECT_EQ(&clock.pick(), &bfs[2]);
+}
+
+// A sweep that only finds referenced frames falls back to the next candidate, never to a frame phase 1 can not cool
+TEST(ClockPolicyTest, FallbackSkipsNonCandidates)
+{
+   const u64 frames = 2 * ClockPolicy::MAX_SWEEP;
+   std::unique_ptr<BufferFrame[]> bfs{new BufferFrame[frames]};
+   for (u64 i = 0; i < frames; i++) {
+      bfs[i].header.state = BufferFrame::STATE::HOT;
+      bfs[i].header.access = 200;
+   }
+   for (u64 i = ClockPolicy::MAX_SWEEP; i < ClockPolicy::MAX_SWEEP + 10; i++) {
+      bfs[i].header.state = BufferFrame::STATE::COOL;
+   }
+   ClockPolicy clock(bfs.get(), frames);
+   EXPECT_EQ(&clock.pick(), &bfs[ClockPolicy::MAX_SWEEP + 10]);
+}
+
+TEST_F(ReplacementPolicyTest, SampledPicksTheColdestCandidate)
+{
+   bfs[17].header.access = 0;
+   // Samples every candidate several times, only free frames are left out
+   for (u64 i = 32; i < FRAMES; i++) {
+      bfs[i].header.state = BufferFrame::STATE::FREE;
+   }
+   SampledFrequencyPolicy sampled(bfs.get(), FRAMES, 256);
+   EXPECT_EQ(&sampled.pick(), &bfs[17]);
+   // Looking at the others aged them
+   u64 aged = 0;
+   for (u64 i = 0; i < 32; i++) {
+      aged += i != 17 && bfs[i].header.access < 200;
+   }
+   EXPECT_GT(aged, 0u);
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <leanstore/utils/SIMDSearch.hpp>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace leanstore::utils::simd;
+
+template <typename T>
+void checkKernels()
+{
+   std::mt19937_64 gen(7);
+   std::set<T> unique;
+   while (unique.size() < 4096) {
+      unique.insert(gen() % 100000);
+   }
+   std::vector<T> keys(unique.begin(), unique.end());
+   for (auto isa : {ISA::SCALAR, ISA::AVX2, ISA::AVX512}) {
+      if (forceISA(isa) != isa) {
+         continue;
+      }
+      for (int i = 0; i < 20000; i++) {
+         const T key = gen() % 100010;
+         const size_t begin = gen() % keys.size();
+         const size_t end = begin + gen() % (keys.size() - begin + 1);
+         ASSERT_EQ(lowerBound(keys.data(), begin, end, key), std::lower_bound(keys.begin() + begin, keys.begin() + end, key) - keys.begin());
+         ASSERT_EQ(upperBound(keys.data(), begin, end, key), std::upper_bound(keys.begin() + begin, keys.begin() + end, key) - keys.begin());
+      }
+   }
+   forceISA(detectISA());
+}
+
+TEST(SIMDSearchTest, Kernels32)
+{
+   checkKernels<uint32_t>();
+}
+
+TEST(SIMDSearchTest, Kernels64)
+{
+   checkKernels<uint64_t>();
+}
+
+TEST(SIMDSearchTest, SearchAroundWrongEstimate)
+{
+   std::vector<uint32_t> keys;
+   for (uint32_t k = 10; k <= 10000; k += 10) {
+      keys.push_back(k);
+   }
+   // the estimate is only a hint, the window moves until it encloses the answer
+   EXPECT_EQ(searchAround(keys, 900.0, 4, uint32_t(55)), 5);
+   EXPECT_EQ(searchAround(keys, 2.0, 4, uint32_t(9000)), 899);
+   EXPECT_EQ((searchAround<uint32_t, true>(keys, 899.0, 4, uint32_t(9000))), 900);
+   EXPECT_EQ(searchAround(keys, -3.0, 4, uint32_t(20000)), keys.size());
+   EXPECT_EQ(searchAround(keys, 5000.0, 4, uint32_t(0)), 0);
+}
+
+TEST(SIMDSearchTest, CountLessStrided)
+{
+   // Unaligned u32 fields 10 bytes apart, like the packed slots of a BTreeNode
+   struct __attribute__((packed)) Record {
+      uint16_t a, b, c;
+      uint32_t head;
+   };
+   std::mt19937_64 gen(7);
+   std::vector<Record> records(300);
+   for (auto& record : records) {
+      record.head = static_cast<uint32_t>(gen());
+   }
+   for (auto isa : {ISA::SCALAR, ISA::AVX2, ISA::AVX512}) {
+      if (forceISA(isa) != isa) {
+         continue;
+      }
+      for (int i = 0; i < 20000; i++) {
+         const uint32_t key = (i % 2) ? records[gen() % records.size()].head : static_cast<uint32_t>(gen());
+         const size_t begin = gen() % records.size();
+         const size_t n = gen() % (records.size() - begin + 1);
+         const size_t expected = std::count_if(records.begin() + begin, records.begin() + begin + n, [&](const Record& r) { return r.head < key; });
+         ASSERT_EQ(countLessStrided(reinterpret_cast<const uint8_t*>(&records[begin].head), sizeof(Record), n, key), expected);
+      }
+   }
+   forceISA(detectISA());
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <leanstore/sync-primitives/Epoch.hpp>
+#include <leanstore/threads/UT.hpp>
+#include <leanstore/utils/JumpMU.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+
+using leanstore::EpochGuard;
+using leanstore::EpochManager;
+using leanstore::threads::UTM;
+
+struct Counted {
+   int& destructed;
+   explicit Counted(int& destructed) : destructed(destructed) {}
+   ~Counted() { destructed++; }
+};
+
+class UTReadTest : public ::testing::Test
+{
+  protected:
+   static constexpr u64 PAGE = 4096, PAGES = 256;
+   char path[32] = "/tmp/ut_test_XXXXXX";
+   int fd = -1;
+   void SetUp() override
+   {
+      fd = mkstemp(path);
+      ASSERT_GE(fd, 0);
+      for (u64 p = 0; p < PAGES; p++) {
+         std::vector<u32> page(PAGE / sizeof(u32), p);
+         ASSERT_EQ(write(fd, page.data(), PAGE), s64(PAGE));
+      }
+   }
+   void TearDown() override
+   {
+      close(fd);
+      unlink(path);
+   }
+};
+
+TEST_F(UTReadTest, ParkedThreadsReadTheirPages)
+{
+   std::atomic<u64> correct = 0;
+   UTM::init(2);
+   for (u64 t = 0; t < 16; t++) {
+      UTM::addThread([&, t]() {
+         alignas(512) u32 page[PAGE / sizeof(u32)];
+         for (u64 r = 0; r < 20; r++) {
+            const u64 pid = (t * 31 + r * 7) % PAGES;
+            UTM::readAsync(fd, reinterpret_cast<u8*>(page), PAGE, pid * PAGE);
+            correct += (page[0] == pid && page[PAGE / sizeof(u32) - 1] == pid);
+         }
+      });
+   }
+   UTM::destroy();
+   EXPECT_EQ(correct, 16u * 20);
+}
+
+TEST_F(UTReadTest, JumpAfterParking)
+{
+   // The checkpoint is taken before the read parks the thread, which may resume on the other worker
+   std::atomic<u64> caught = 0;
+   UTM::init(2);
+   for (u64 t = 0; t < 8; t++) {
+      UTM::addThread([&, t]() {
+         alignas(512) u32 page[PAGE / sizeof(u32)];
+         for (u64 r = 0; r < 10; r++) {
+            int destructed = 0;
+            jumpmuTry()
+            {
+               JMUW<Counted> counted(destructed);
+               UTM::readAsync(fd, reinterpret_cast<u8*>(page), PAGE, ((t + r) % PAGES) * PAGE);
+               jumpmu::jump();
+            }
+            jumpmuCatch()
+            {
+               caught += (destructed == 1);
+            }
+         }
+      });
+   }
+   UTM::destroy();
+   EXPECT_EQ(caught, 8u * 10);
+}
+
+// Not std::this_thread::get_id(), pthread_self is const and may be kept across a park
+static pid_t osThread()
+{
+   return syscall(SYS_gettid);
+}
+
+TEST(UTEpochTest, SectionSurvivesParkingAndMigration)
+{
+   // A lookup loads a snapshot in its reader section and parks on a page read, as UTM::readAsync does. While it
+   // is parked, the snapshot is replaced and retired, and a hog keeps its worker busy, so it resumes on the other
+   // one. The snapshot must outlive the park, and leaving on the other worker must unpin the section
+   struct Snapshot {
+      std::atomic<int>& alive;
+      explicit Snapshot(std::atomic<int>& alive) : alive(alive) { alive++; }
+      ~Snapshot() { alive--; }
+   };
+   constexpr u64 ROUNDS = 8;
+   std::atomic<int> alive = 0;
+   std::atomic<Snapshot*> current = new Snapshot(alive);
+   std::atomic<u64> migrated = 0, intact = 0;
+   UTM::init(2);
+   for (u64 r = 0; r < ROUNDS; r++) {
+      std::atomic<bool> parked = false, hogging = false, done = false, hog_left = false;
+      std::function<void()> revive;
+      pid_t reader_worker = 0;
+      UTM::addThread([&]() {
+         EpochGuard guard;
+         Snapshot* snapshot = current.load();
+         reader_worker = osThread();
+         UTM::sleepThenCall([&](std::function<void()> wake) {
+            revive = std::move(wake);
+            parked = true;
+         });
+         migrated += reader_worker != osThread();
+         intact += snapshot->alive.load() > 0 && alive == 2;
+         done = true;
+      });
+      while (!parked) {
+      }
+      EpochManager::global().retire(current.exchange(new Snapshot(alive)));
+      UTM::addThread([&]() {
+         while (osThread() != reader_worker) {
+            UTM::yield();
+         }
+         hogging = true;
+         while (!done) {
+         }
+         hog_left = true;
+      });
+      while (!hogging) {
+      }
+      revive();
+      while (!done || !hog_left) {
+      }
+   }
+   UTM::destroy();
+   EXPECT_EQ(migrated, ROUNDS);
+   EXPECT_EQ(intact, ROUNDS);
+   // Every section was left in the slot it was entered in, nothing stays pinned
+   EpochManager::global().retire(current.exchange(nullptr));
+   EXPECT_EQ(EpochManager::global().pending(), 0u);
+   EXPECT_EQ(alive, 0);
+}
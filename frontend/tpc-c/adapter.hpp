@@ -16,6 +16,7 @@ struct LeanStoreAdapter {
    storage::btree::BTreeInterface* btree;
    std::map<std::string, Record> map;
    string name;
+   bool learned = false;  // point operations and scans take the leaf from the tree's model
    LeanStoreAdapter()
    {
       // hack
@@ -30,6 +31,15 @@ struct LeanStoreAdapter {
    }
    // -------------------------------------------------------------------------------------
    void printTreeHeight() { cout << name << " height = " << btree->getHeight() << endl; }
+   // A tree that is a single leaf has nothing to skip
+   void train(const int max_error)
+   {
+      if (btree->getHeight() < 2) {
+         return;
+      }
+      btree->fast_train(max_error);
+      learned = true;
+   }
    // -------------------------------------------------------------------------------------
    template <class Fn>
    void scanDesc(const typename Record::Key& key, const Fn& fn, std::function<void()> undo)
@@ -66,12 +76,14 @@ struct LeanStoreAdapter {
    {
       u8 folded_key[Record::maxFoldLength()];
       u16 folded_key_len = Record::foldRecord(folded_key, key);
-      const auto res = btree->lookup(folded_key, folded_key_len, [&](const u8* payload, u16 payload_length) {
+      auto payload_callback = [&](const u8* payload, u16 payload_length) {
          static_cast<void>(payload_length);
          const Record& typed_payload = *reinterpret_cast<const Record*>(payload);
          assert(payload_length == sizeof(Record));
          fn(typed_payload);
-      });
+      };
+      const auto res = learned ? btree->lookupSeg(folded_key, folded_key_len, payload_callback)
+                               : btree->lookup(folded_key, folded_key_len, payload_callback);
       ensure(res == btree::OP_RESULT::OK);
    }
 
@@ -80,15 +92,14 @@ struct LeanStoreAdapter {
    {
       u8 folded_key[Record::maxFoldLength()];
       u16 folded_key_len = Record::foldRecord(folded_key, key);
-      const auto res = btree->updateSameSize(
-          folded_key, folded_key_len,
-          [&](u8* payload, u16 payload_length) {
-             static_cast<void>(payload_length);
-             assert(payload_length == sizeof(Record));
-             Record& typed_payload = *reinterpret_cast<Record*>(payload);
-             fn(typed_payload);
-          },
-          wal_update_generator);
+      auto update_callback = [&](u8* payload, u16 payload_length) {
+         static_cast<void>(payload_length);
+         assert(payload_length == sizeof(Record));
+         Record& typed_payload = *reinterpret_cast<Record*>(payload);
+         fn(typed_payload);
+      };
+      const auto res = learned ? btree->updateSameSizeSeg(folded_key, folded_key_len, update_callback, wal_update_generator)
+                               : btree->updateSameSize(folded_key, folded_key_len, update_callback, wal_update_generator);
       ensure(res != btree::OP_RESULT::NOT_FOUND);
       if (res == btree::OP_RESULT::ABORT_TX) {
          cr::Worker::my().abortTX();
@@ -111,19 +122,21 @@ struct LeanStoreAdapter {
    {
       u8 folded_key[Record::maxFoldLength()];
       u16 folded_key_len = Record::foldRecord(folded_key, key);
-      btree->scanAsc(
-          folded_key, folded_key_len,
-          [&](const u8* key, u16 key_length, const u8* payload, u16 payload_length) {
-             if (key_length != folded_key_len) {
-                return false;
-             }
-             static_cast<void>(payload_length);
-             typename Record::Key typed_key;
-             Record::unfoldRecord(key, typed_key);
-             const Record& typed_payload = *reinterpret_cast<const Record*>(payload);
-             return fn(typed_key, typed_payload);
-          },
-          undo);
+      auto callback = [&](const u8* key, u16 key_length, const u8* payload, u16 payload_length) {
+         if (key_length != folded_key_len) {
+            return false;
+         }
+         static_cast<void>(payload_length);
+         typename Record::Key typed_key;
+         Record::unfoldRecord(key, typed_key);
+         const Record& typed_payload = *reinterpret_cast<const Record*>(payload);
+         return fn(typed_key, typed_payload);
+      };
+      if (learned) {
+         btree->scanAscSeg(0, folded_key, folded_key_len, callback, undo);
+      } else {
+         btree->scanAsc(folded_key, folded_key_len, callback, undo);
+      }
    }
    // -------------------------------------------------------------------------------------
    template <class Field>
@@ -26,6 +26,7 @@ DEFINE_uint64(run_until_tx, 0, "");
 DEFINE_bool(tpcc_warehouse_affinity, false, "");
 DEFINE_bool(tpcc_fast_load, false, "");
 DEFINE_bool(tpcc_remove, true, "");
+DEFINE_bool(tpcc_learned, false, "train every table after loading, point operations and scans then go through the models");
 // -------------------------------------------------------------------------------------
 using namespace std;
 using namespace leanstore;
@@ -78,6 +79,7 @@ int main(int argc, char** argv)
    db.registerConfigEntry("tpcc_warehouse_count", FLAGS_tpcc_warehouse_count);
    db.registerConfigEntry("tpcc_warehouse_affinity", FLAGS_tpcc_warehouse_affinity);
    db.registerConfigEntry("run_until_tx", FLAGS_run_until_tx);
+   db.registerConfigEntry("tpcc_learned", FLAGS_tpcc_learned);
    // -------------------------------------------------------------------------------------
    // const u64 load_threads = (FLAGS_tpcc_fast_load) ? thread::hardware_concurrency() : FLAGS_worker_threads;
    if (!FLAGS_recover) {
@@ -109,6 +111,21 @@ int main(int argc, char** argv)
       crm.joinAll();
    }
    sleep(2);
+   if (FLAGS_tpcc_learned) {
+      crm.scheduleJobSync(0, [&]() {
+         warehouse.train(FLAGS_max_error);
+         district.train(FLAGS_max_error);
+         customer.train(FLAGS_max_error);
+         customerwdl.train(FLAGS_max_error);
+         history.train(FLAGS_max_error);
+         neworder.train(FLAGS_max_error);
+         order.train(FLAGS_max_error);
+         order_wdc.train(FLAGS_max_error);
+         orderline.train(FLAGS_max_error);
+         item.train(FLAGS_max_error);
+         stock.train(FLAGS_max_error);
+      });
+   }
    // -------------------------------------------------------------------------------------
    double gib = (db.getBufferManager().consumedPages() * EFFECTIVE_PAGE_SIZE / 1024.0 / 1024.0 / 1024.0);
    cout << "data loaded - consumed space in GiB = " << gib << endl;
@@ -28,7 +28,6 @@
 #define TRACE_DUMP false
 #define YCSB_USE_READ_TRACE
 #define SEG_IN_INSERT
-// #define TRACE_SOSD
 #define DUMP_EACH_LATENCY
 #define USE_SLOT_KEYS
 // ========== LEANSTORE HEADER ==========
@@ -38,6 +37,7 @@
 #include "leanstore/LeanStore.hpp"
 #include "leanstore/compileConst.hpp"
 #include "leanstore/profiling/counters/WorkerCounters.hpp"
+#include "leanstore/threads/UT.hpp"
 #include "leanstore/utils/FVector.hpp"
 #include "leanstore/utils/Files.hpp"
 #include "leanstore/utils/RandomGenerator.hpp"
@@ -48,7 +48,6 @@
 
 using namespace leanstore;
 using namespace util;
-using YCSBKey = KEY;
 // This is to be set for large dataset experiment 2O0M for 200GB dataset
 // using YCSBPayload = BytesPayload<512>;
 // This is normal wokrload experiment
@@ -81,10 +80,14 @@ DEFINE_uint64(range_length, 400, "Number of read operations");
 DEFINE_bool(hist, false, "");
 DEFINE_string(benchmarks, "load,readall", "");
 DEFINE_string(tracefile, "randomtrace.data", "");
+DEFINE_uint32(key_bytes, 0, "width of the keys, 4 or 8; 0 is 8 for traces named *_uint64 (SOSD) and 4 otherwise");
 DEFINE_uint32(step, 0, "0 for random keys while larger than 0 means sequential keys with given step");
 DEFINE_bool(seq_operation, false, "benchmark should be sequential");
 DEFINE_bool(seq_write_operation, false, "benchmark write should be sequential");
 DEFINE_double(zipfian_constant, 0.99, "Zipfian constant");
+DEFINE_uint32(ut_workers, 2, "OS threads the *ut benchmarks run their worker_threads user threads on");
+DEFINE_uint64(warmup_window_ms, 1000, "window the warmup benchmark measures its throughput over");
+DEFINE_double(warmup_steady_tolerance, 0.05, "relative throughput change between windows the warmup benchmark still counts as steady");
 
 namespace
 {
@@ -390,6 +393,19 @@ static std::string TrimSpace(std::string s)
 
 #define POOL_SIZE (1073741824L * 100L)  // 100GB
 
+static bool EndsWith(const std::string& s, const std::string& suffix)
+{
+   return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// SOSD datasets are named <name>_uint32 or <name>_uint64 and start with their key count
+static bool isSOSDTrace(const std::string& path)
+{
+   return EndsWith(path, "_uint32") || EndsWith(path, "_uint64");
+}
+
+// YCSBKey is the width of the trace and of the keys in the tree, u32 or u64 as main() picks from --key_bytes
+template <typename YCSBKey>
 class Benchmark
 {
   public:
@@ -404,8 +420,11 @@ class Benchmark
    LeanStore db;
    unique_ptr<BTreeInterface<YCSBKey, YCSBPayload>> adapter;
    leanstore::storage::btree::BTreeLL* btree_ptr = nullptr;
+   leanstore::storage::btree::RouterConfig registered_router;
    // rsindex::RadixSpline<YCSBKey> rsindex;
    std::vector<YCSBKey> mappingkeys;
+   std::atomic<uint64_t> warmup_ops = 0;
+   std::atomic<bool> warmup_steady = false;
 
    Benchmark()
        : value_size_(FLAGS_value_size),
@@ -421,6 +440,7 @@ class Benchmark
       } else {
          btree_ptr = &db.registerBTreeLL("ycsb");
       }
+      registered_router = btree_ptr->router_config;
       adapter.reset(new BTreeVSAdapter<YCSBKey, YCSBPayload>(*btree_ptr));
       db.registerConfigEntry("ycsb_target_gib", FLAGS_target_gib);
       db.startProfilingThread();
@@ -443,6 +463,7 @@ class Benchmark
       const char* benchmarks = FLAGS_benchmarks.c_str();
       while (benchmarks != nullptr) {
          int thread = FLAGS_worker_threads;
+         bool on_user_threads = false;
          void (Benchmark::*method)(ThreadState*) = nullptr;
          const char* sep = strchr(benchmarks, ',');
          std::string name;
@@ -532,12 +553,56 @@ class Benchmark
                std::cout << "Randomizing read key trace" << std::endl;
                read_key_trace_->Randomize();
             }
+            UseRouter(registered_router);
             method = &Benchmark::DoReadUseSegmentAll;
          } else if (name == "readzipwithseg") {
             std::cout << "Randomizing read key trace" << std::endl;
             read_key_trace_->Randomize();
             // read_key_trace_->Sort();
+            UseRouter(registered_router);
             method = &Benchmark::DoReadUseSegmentZipf;
+         } else if (name == "readallwithrmi") {
+            if (!FLAGS_seq_operation) {
+               std::cout << "Randomizing read key trace" << std::endl;
+               read_key_trace_->Randomize();
+            }
+            UseRouter(RMIRouter());
+            method = &Benchmark::DoReadUseSegmentAll;
+         } else if (name == "readzipwithrmi") {
+            std::cout << "Randomizing read key trace" << std::endl;
+            read_key_trace_->Randomize();
+            UseRouter(RMIRouter());
+            method = &Benchmark::DoReadUseSegmentZipf;
+         } else if (name == "warmup") {
+            std::cout << "Randomizing read key trace" << std::endl;
+            read_key_trace_->Randomize();
+            warmup_ops = 0;
+            warmup_steady = false;
+            method = &Benchmark::DoWarmup;
+         } else if (name == "readallut") {
+            if (!FLAGS_seq_operation) {
+               std::cout << "Randomizing read key trace" << std::endl;
+               read_key_trace_->Randomize();
+            }
+            on_user_threads = true;
+            method = &Benchmark::DoReadAll;
+         } else if (name == "readallwithsegut") {
+            if (!FLAGS_seq_operation) {
+               std::cout << "Randomizing read key trace" << std::endl;
+               read_key_trace_->Randomize();
+            }
+            on_user_threads = true;
+            method = &Benchmark::DoReadUseSegmentAll;
+         } else if (name == "readallbatch") {
+            if (!FLAGS_seq_operation) {
+               std::cout << "Randomizing read key trace" << std::endl;
+               read_key_trace_->Randomize();
+            }
+            method = &Benchmark::DoReadBatchAll;
+         } else if (name == "readzipbatch") {
+            std::cout << "Randomizing read key trace" << std::endl;
+            read_key_trace_->Randomize();
+            method = &Benchmark::DoReadBatchZipf;
          } else if (name == "readlatwithseg") {
             print_hist = true;
             if (!FLAGS_seq_operation) {
@@ -697,7 +762,11 @@ class Benchmark
 
          if (method != nullptr) {
             std::cout << "start:" << name << std::endl;
-            RunBenchmark(thread, name, method, print_hist);
+            if (on_user_threads) {
+               RunBenchmarkOnUserThreads(thread, name, method, print_hist);
+            } else {
+               RunBenchmark(thread, name, method, print_hist);
+            }
             std::cout << "end:" << name << std::endl;
          }
       }
@@ -753,6 +822,16 @@ class Benchmark
       std::cout << "final state read_trace_size_: " << read_trace_size_ << std::endl;
    }
 
+   leanstore::storage::btree::RouterConfig RMIRouter() const
+   {
+      auto config = registered_router;
+      config.model = leanstore::storage::btree::ROUTER_MODEL::RMI;
+      return config;
+   }
+
+   // Swaps the root model of the tree, only the root model is refitted and only when it is another one
+   void UseRouter(const leanstore::storage::btree::RouterConfig& config) { btree_ptr->useRouter(config); }
+
    void DoFastTrain(ThreadState* thread)
    {
       auto& table = *adapter;
@@ -929,6 +1008,117 @@ class Benchmark
       thread->stats.AddMessage(buf);
    }
 
+   // Zipfian learned lookups, meant to run right after a recovery. Thread 0 reports the throughput of
+   // every FLAGS_warmup_window_ms window and stops all threads once three windows in a row are within
+   // FLAGS_warmup_steady_tolerance of each other, the start of the first one is the time to steady state.
+   void DoWarmup(ThreadState* thread)
+   {
+      uint64_t batch = FLAGS_batch;
+      if (read_key_trace_ == nullptr) {
+         perror("DoWarmup lack key_trace_ initialization.");
+         return;
+      }
+      read_trace_size_ = read_key_trace_->keys_.size();
+      auto reads = (reads_ == 0) ? read_trace_size_ : reads_;
+      reads = reads / FLAGS_worker_threads;
+      auto key_iterator = read_key_trace_->zipfiterator(reads, FLAGS_zipfian_constant);
+      Duration duration(FLAGS_readtime, reads_);
+      auto& table = *adapter;
+      const uint64_t start = NowMicros();
+      uint64_t window_start = start, window_ops = 0, stable_windows = 0, steady_since = start;
+      double last_throughput = 0;
+      thread->stats.Start();
+      while (!warmup_steady && !duration.Done(batch) && key_iterator.Valid()) {
+         uint64_t j = 0;
+         for (; j < batch && key_iterator.Valid(); j++) {
+            YCSBPayload result;
+            table.trained_lookup(key_iterator.Next(), result);
+         }
+         thread->stats.FinishedBatchOp(j);
+         warmup_ops += j;
+         const uint64_t now = NowMicros();
+         if (thread->tid != 0 || now - window_start < FLAGS_warmup_window_ms * 1000) {
+            continue;
+         }
+         const uint64_t ops = warmup_ops;
+         const double throughput = (ops - window_ops) * 1e6 / (now - window_start);
+         const double change = (throughput > last_throughput) ? throughput - last_throughput : last_throughput - throughput;
+         if (last_throughput > 0 && change <= FLAGS_warmup_steady_tolerance * last_throughput) {
+            stable_windows++;
+         } else {
+            stable_windows = 0;
+            steady_since = window_start;
+         }
+         printf("warmup: %8.1f s %12.0f ops/s leaf warmup %s\n", (now - start) / 1e6, throughput, btree_ptr->warming_up ? "running" : "done");
+         if (stable_windows == 2) {
+            printf("warmup: steady state after %.1f s\n", (steady_since - start) / 1e6);
+            warmup_steady = true;
+         }
+         last_throughput = throughput;
+         window_start = now;
+         window_ops = ops;
+      }
+   }
+
+   // Same key streams as readallwithseg/readzipwithseg, looked up FLAGS_batch keys at a time with BTreeLL::multi_get
+   template <typename Iterator>
+   void ReadBatch(ThreadState* thread, Iterator& key_iterator, size_t interval)
+   {
+      uint64_t batch = FLAGS_batch;
+      std::vector<YCSBKey> keys(batch);
+      size_t not_find = 0;
+      size_t found = 0;
+      Duration duration(FLAGS_readtime, reads_);
+      thread->stats.Start();
+      while (!duration.Done(batch) && key_iterator.Valid()) {
+         uint64_t j = 0;
+         for (; j < batch && key_iterator.Valid(); j++) {
+            keys[j] = key_iterator.Next();
+         }
+         size_t value_length = 0;
+         const u8* value_ptr = nullptr;
+         auto batch_found = btree_ptr->multi_get(keys.data(), j, [&](u64, const u8* payload, u16 payload_length) {
+            value_ptr = payload;
+            value_length = payload_length;
+         });
+         found += batch_found;
+         not_find += j - batch_found;
+         thread->stats.FinishedBatchOp(j);
+      }
+      char buf[100];
+      snprintf(buf, sizeof(buf), "(num: %lu, not find: %lu found: %lu)", interval, not_find, found);
+      if (not_find)
+         printf("thread %2d num: %lu, not find: %lu\n found: %lu", thread->tid, interval, not_find, found);
+      thread->stats.AddMessage(buf);
+   }
+
+   void DoReadBatchAll(ThreadState* thread)
+   {
+      if (read_key_trace_ == nullptr) {
+         perror("DoReadBatchAll lack key_trace_ initialization.");
+         return;
+      }
+      read_trace_size_ = read_key_trace_->keys_.size();
+      size_t interval = read_trace_size_ / FLAGS_worker_threads;
+      size_t start_offset = thread->tid * interval;
+      auto key_iterator = read_key_trace_->iterate_between(start_offset, start_offset + interval);
+      ReadBatch(thread, key_iterator, interval);
+   }
+
+   void DoReadBatchZipf(ThreadState* thread)
+   {
+      if (read_key_trace_ == nullptr) {
+         perror("DoReadBatchZipf lack key_trace_ initialization.");
+         return;
+      }
+      read_trace_size_ = read_key_trace_->keys_.size();
+      size_t interval = read_trace_size_ / FLAGS_worker_threads;
+      auto reads = (reads_ == 0) ? read_trace_size_ : reads_;
+      reads = reads / FLAGS_worker_threads;
+      auto key_iterator = read_key_trace_->zipfiterator(reads, FLAGS_zipfian_constant);
+      ReadBatch(thread, key_iterator, interval);
+   }
+
    void DoReadAll(ThreadState* thread)
    {
       uint64_t batch = FLAGS_batch;
@@ -1872,11 +2062,11 @@ class Benchmark
          read_key_trace_->FromCSV(filepath);
       } else {
          std::cout << "[DoReadTraceLoad] Load trace from file: " << filepath << std::endl;
-#ifdef TRACE_SOSD
-         read_key_trace_->FromSOSD(filepath);
-#else
-         read_key_trace_->FromFile(filepath);
-#endif
+         if (isSOSDTrace(filepath)) {
+            read_key_trace_->FromSOSD(filepath);
+         } else {
+            read_key_trace_->FromFile(filepath);
+         }
       }
       // key_trace_->FromFile(FLAGS_tracefile);
       auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - starttime);
@@ -1900,11 +2090,11 @@ class Benchmark
          write_key_trace_->FromCSV(filepath);
       } else {
          std::cout << "[DoWriteTraceLoad] Load trace from file: " << filepath << std::endl;
-#ifdef TRACE_SOSD
-         write_key_trace_->FromSOSD(filepath);
-#else
-         write_key_trace_->FromFile(filepath);
-#endif
+         if (isSOSDTrace(filepath)) {
+            write_key_trace_->FromSOSD(filepath);
+         } else {
+            write_key_trace_->FromFile(filepath);
+         }
       }
       // key_trace_->FromFile(FLAGS_tracefile);
       auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - starttime);
@@ -2166,6 +2356,39 @@ class Benchmark
          th.join();
    }
 
+   // Same as RunBenchmark, but every ThreadState runs as a user thread on FLAGS_ut_workers OS threads.
+   // A page miss parks the user thread on its libaio read and the worker runs another one meanwhile.
+   void RunBenchmarkOnUserThreads(int thread_num, const std::string& name, void (Benchmark::*method)(ThreadState*), bool print_hist)
+   {
+      SharedState shared(thread_num);
+      // Nobody waits for the start, a user thread blocking on the condition variable would block its worker
+      shared.start = true;
+      ThreadArg* arg = new ThreadArg[thread_num];
+      for (int i = 0; i < thread_num; i++) {
+         arg[i].bm = this;
+         arg[i].method = method;
+         arg[i].shared = &shared;
+         arg[i].thread = new ThreadState(i);
+         arg[i].thread->shared = &shared;
+      }
+      leanstore::threads::UTM::init(FLAGS_ut_workers);
+      for (int i = 0; i < thread_num; i++) {
+         leanstore::threads::UTM::addThread([&arg, i]() { ThreadBody(&arg[i]); });
+      }
+      {
+         std::unique_lock<std::mutex> lck(shared.mu);
+         while (shared.num_done < thread_num) {
+            shared.cv.wait(lck);
+         }
+      }
+      leanstore::threads::UTM::destroy();
+
+      for (int i = 1; i < thread_num; i++) {
+         arg[0].thread->stats.Merge(arg[i].thread->stats);
+      }
+      arg[0].thread->stats.Report(name, print_hist);
+   }
+
    void PrintEnvironment()
    {
 #if defined(__linux)
@@ -2232,7 +2455,19 @@ int main(int argc, char* argv[])
    // tbb::task_scheduler_init taskScheduler(FLAGS_worker_threads);
    tbb::global_control control(tbb::global_control::max_allowed_parallelism, FLAGS_worker_threads);
 
-   Benchmark benchmark;
-   benchmark.Run();
+   u32 key_bytes = FLAGS_key_bytes;
+   if (key_bytes == 0) {
+      key_bytes = EndsWith(FLAGS_tracefile, "_uint64") ? 8 : 4;
+   }
+   if (key_bytes == 8) {
+      Benchmark<u64> benchmark;
+      benchmark.Run();
+   } else if (key_bytes == 4) {
+      Benchmark<u32> benchmark;
+      benchmark.Run();
+   } else {
+      std::cerr << "--key_bytes has to be 4 or 8" << std::endl;
+      return 1;
+   }
    return 0;
 }
@@ -132,6 +132,26 @@ while [[ "$#" -gt 0 ]]; do
     PROF="$2"
     shift
     ;;
+  --layout)
+    LAYOUT="$2"
+    shift
+    ;;
+  --readahead)
+    READAHEAD="$2"
+    shift
+    ;;
+  --ut_workers)
+    UT_WORKERS="$2"
+    shift
+    ;;
+  --root_model)
+    ROOT_MODEL="$2"
+    shift
+    ;;
+  --mapping_search)
+    MAPPING_SEARCH="$2"
+    shift
+    ;;
   --*)
     echo "Unknown parameter passed: $1"
     exit 1
@@ -141,6 +161,13 @@ while [[ "$#" -gt 0 ]]; do
 done
 PERSIST=false
 RECOVER=false
+# leafs the model guided scans read ahead from SSD, 0 reads every cold leaf on demand
+READAHEAD=${READAHEAD:-16}
+# OS threads the *ut benchmarks multiplex their WORKERS user threads on
+UT_WORKERS=${UT_WORKERS:-2}
+# model and last mile search of the learned root: spline|linear|rmi|pla, simd|exponential|binary
+ROOT_MODEL=${ROOT_MODEL:-spline}
+MAPPING_SEARCH=${MAPPING_SEARCH:-simd}
 
 # use variables defined in the configuration file
 
@@ -172,7 +199,12 @@ else
   # PREFIX_CMD="sudo"
 fi
 # run command in gdb
-BUILD_DIR=../build_$MODE/
+# builds with a different mapping layout live next to the default one, see cmp_mapping_layout.sh
+if [ -n "$LAYOUT" ]; then
+  BUILD_DIR=../build_${MODE}_${LAYOUT}/
+else
+  BUILD_DIR=../build_$MODE/
+fi
 bash compile.sh $BUILD_DIR
 # dstat -c -m -d -D total,nvme0n1 -r -fs -T 1
 sudo bash drop_cache.sh
@@ -231,6 +263,21 @@ scan)
 inmem)
   BENCHMARK=genlinear,load,writetracetoread,readall
   ;;
+layout)
+  remove_leanstore_db
+  create_leanstore_db
+  BENCHMARK=genrandom,fastload,writetracetoread,fasttrain,readallwithseg,readzipwithseg
+  ;;
+batch)
+  remove_leanstore_db
+  create_leanstore_db
+  BENCHMARK=genrandom,fastload,writetracetoread,fasttrain,readallwithseg,readallbatch,readzipwithseg,readzipbatch
+  ;;
+rmi)
+  remove_leanstore_db
+  create_leanstore_db
+  BENCHMARK=genrandom,fastload,writetracetoread,fasttrain,readallwithseg,readallwithrmi,readzipwithseg,readzipwithrmi
+  ;;
 inmem_fast)
   remove_leanstore_db
   create_leanstore_db
@@ -351,6 +398,11 @@ hotread)
   RECOVER=true
   PERSIST=false
   ;;
+warmup)
+  BENCHMARK=readtraceload,warmup
+  RECOVER=true
+  PERSIST=false
+  ;;
 readzipseg)
   BENCHMARK=readtraceload,readzipwithseg
   RECOVER=true
@@ -366,6 +418,20 @@ hotreadseg)
   RECOVER=true
   PERSIST=false
   ;;
+utread)
+  # run after create: a DRAM budget well below the dataset, page misses park user threads on libaio
+  # reads instead of blocking in pread, compare against the same reads on WORKERS OS threads
+  BENCHMARK=readtraceload,readallwithseg,readallwithsegut,readall,readallut
+  DRAM=1
+  RECOVER=true
+  PERSIST=false
+  ;;
+coldscanseg)
+  # run after create with --dram below the data size, compare --readahead 0 against the default
+  BENCHMARK=readtraceload,scanascseg
+  RECOVER=true
+  PERSIST=false
+  ;;
 origin)
   rm $SSD_FILE
   touch $SSD_FILE
@@ -426,6 +492,10 @@ echo "ATTACH_SEG_FILE: $ATTACH_SEG_FILE"
 echo "SPLINE_FILE: $SPLINE_FILE"
 echo "MAPPING_FILE: $MAPPING_FILE"
 echo "PROF: $PROF"
+echo "READAHEAD: $READAHEAD"
+echo "UT_WORKERS: $UT_WORKERS"
+echo "ROOT_MODEL: $ROOT_MODEL"
+echo "MAPPING_SEARCH: $MAPPING_SEARCH"
 
 if [ $COLLECT_STATS = true ]; then
   # start stats collection
@@ -460,6 +530,10 @@ $PREFIX_CMD ${BUILD_DIR}/frontend/benchmark_ycsb \
   --segments_file=$SPLINE_FILE \
   --secondary_mapping_file=$MAPPING_FILE \
   --max_error=$MAX_ERROR \
+  --scan_readahead_leaves=$READAHEAD \
+  --ut_workers=$UT_WORKERS \
+  --root_model=$ROOT_MODEL \
+  --mapping_search=$MAPPING_SEARCH \
   --readtime=$READTIME
 
 if [ $COLLECT_STATS = true ]; then
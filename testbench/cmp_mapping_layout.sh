@@ -0,0 +1,22 @@
+#!/bin/bash
+# Runs the layout experiment once with the separate mapping vectors and once with MAPPING_BLOCKS
+conf=in_mem.cfg
+# Check if there is a command line argument
+if [[ $# -ge 1 ]]; then
+    conf=$1
+fi
+source $conf
+log_dir=../logs
+mkdir -p $log_dir
+
+for layout in vectors blocks; do
+    build_dir=../build_${MODE}_${layout}
+    if [ "$layout" = "blocks" ]; then
+        flags=-DMAPPING_BLOCKS
+    else
+        flags=
+    fi
+    mkdir -p $build_dir
+    (cd $build_dir && cmake -DCMAKE_BUILD_TYPE=$MODE -DCMAKE_CXX_FLAGS="$flags" ..)
+    bash bench_learnedstore.sh $conf layout --layout $layout | tee $log_dir/${conf%.cfg}_layout_${layout}.log
+done